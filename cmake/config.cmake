@@ -33,6 +33,7 @@ check_function_exists(pthread_yield_np HAVE_PTHREAD_YIELD_NP)
 check_function_exists(pthread_delay HAVE_PTHREAD_DELAY)
 check_function_exists(pthread_delay_np HAVE_PTHREAD_DELAY_NP)
 check_function_exists(pthread_setschedprio HAVE_PTHREAD_SETSCHEDPRIO)
+check_function_exists(pthread_mutexattr_setrobust HAVE_PTHREAD_MUTEXATTR_SETROBUST)
 check_function_exists(ftok HAVE_FTOK)
 check_function_exists(shm_open HAVE_SHM_OPEN)
 check_function_exists(localtime_r HAVE_LOCALTIME_R)
@@ -67,6 +68,10 @@ check_include_files(dlfcn.h HAVE_DLFCN_H)
 check_include_files(stdint.h HAVE_STDINT_H)
 check_include_files(poll.h HAVE_POLL_H)
 check_include_files(sys/mman.h HAVE_SYS_MMAN_H)
+check_include_files(sys/sendfile.h HAVE_SYS_SENDFILE_H)
+check_include_files(linux/io_uring.h HAVE_LINUX_IO_URING_H)
+check_include_files(linux/futex.h HAVE_LINUX_FUTEX_H)
+check_include_files(linux/mempolicy.h HAVE_LINUX_MEMPOLICY_H)
 check_include_files(sys/shm.h HAVE_SYS_SHM_H)
 check_include_files(sys/poll.h HAVE_SYS_POLL_H)
 check_include_files(sys/timeb.h HAVE_SYS_TIMEB_H)
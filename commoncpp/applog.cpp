@@ -43,6 +43,10 @@
 #ifndef _MSWINDOWS_
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 #include <string>
 #include <iomanip>
@@ -62,6 +66,8 @@
 
 namespace ost {
 
+class asyncRing;
+
 class logStruct
 {
   public:
@@ -80,9 +86,14 @@ class logStruct
     };
     char         _msgbuf[BUFF_SIZE];
 
+    // async writer buffer and the date and time of the current second
+    asyncRing   *_ring;
+    ucommon::TimeStamp _stamp;
+
     logStruct() :  _ident("") ,  _priority(Slog::levelDebug),
         _level(Slog::levelDebug), _enable(false),
-        _clogEnable(false), _slogEnable(false), _msgpos(0)
+        _clogEnable(false), _slogEnable(false), _msgpos(0),
+        _ring(NULL)
     {
       memset(_msgbuf, 0, BUFF_SIZE);
     };
@@ -122,6 +133,7 @@ class logger : public ost::ThreadQueue
   protected:
     // to dequeue log messages and write them to file if not log_directly
     virtual void  runQueue(void *data);
+    virtual void  runBatch(void **list, unsigned count);
     virtual void  startQueue(void);
     virtual void  stopQueue(void);
     virtual void  onTimer(void);
@@ -140,6 +152,304 @@ class logger : public ost::ThreadQueue
 
 };
 
+#ifndef _MSWINDOWS_
+
+#if defined(HAVE_ATOMICS) && defined(__GNUC__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+static inline size_t acquire(const volatile size_t *ptr)
+{
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline void release(volatile size_t *ptr, size_t value)
+{
+  __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+#else
+static inline size_t acquire(const volatile size_t *ptr)
+{
+  ucommon::Mutex::protect((void *)ptr);
+  size_t value = *ptr;
+  ucommon::Mutex::release((void *)ptr);
+  return value;
+}
+
+static inline void release(volatile size_t *ptr, size_t value)
+{
+  ucommon::Mutex::protect((void *)ptr);
+  *ptr = value;
+  ucommon::Mutex::release((void *)ptr);
+}
+#endif
+
+// formatted records of one logging thread, drained by the async writer.
+// only the logging thread moves the head, and only the writer the tail.
+class asyncRing
+{
+  public:
+    char            *_data;
+    size_t           _size;
+    volatile size_t  _head;
+    volatile size_t  _tail;
+    volatile bool    _detached;
+    asyncRing       *_next;
+
+    asyncRing(size_t size) : _size(size), _head(0), _tail(0),
+        _detached(false), _next(NULL)
+    {
+      _data = new char[size];
+    }
+
+    ~asyncRing()
+    {
+      delete[] _data;
+    }
+
+    // copies a whole record in, or nothing if there is no room for it
+    bool put(const char *text, size_t len)
+    {
+      size_t head = _head;
+      if (len > _size - (head - acquire(&_tail)))
+        return false;
+
+      size_t pos = head & (_size - 1);
+      size_t first = _size - pos;
+      if (first > len)
+        first = len;
+      memcpy(_data + pos, text, first);
+      memcpy(_data, text + first, len - first);
+      release(&_head, head + len);
+      return true;
+    }
+
+    size_t used(void)
+    {
+      return acquire(&_head) - _tail;
+    }
+};
+
+// writes the records of every logging thread with writev(), when a
+// buffer is half full or the flush interval has passed
+class asyncWriter : public ost::Thread
+{
+  private:
+    enum {BATCH = 32, RECORD = logStruct::BUFF_SIZE + 128};
+
+    int           _fd;
+    size_t        _size;
+    timeout_t     _interval;
+    volatile bool _stop;
+    Conditional   _wakeup;
+    Conditional   _space;
+    Mutex         _lock;
+    asyncRing     *_rings;
+
+  protected:
+    void run(void);
+
+  public:
+    asyncWriter(const char *path, size_t size, timeout_t interval);
+    virtual ~asyncWriter();
+
+    inline bool isOpen(void) const
+      {return _fd > -1;}
+
+    void write(logStruct& log, const char *level, bool endOfLine);
+    void detach(logStruct& log);
+    void flush(void);
+    void wake(void);
+};
+
+asyncWriter::asyncWriter(const char *path, size_t size, timeout_t interval) :
+    Thread(), _size(64), _interval(interval), _stop(false), _rings(NULL)
+{
+  // rings are a power of two so positions wrap with a mask, and always
+  // hold the largest record or a thread would wait on it forever
+  while (_size < size || _size < RECORD)
+    _size <<= 1;
+
+  _fd = ::open(path, O_WRONLY | O_CREAT | O_APPEND, 0666);
+  if (_fd > -1)
+    start();
+}
+
+asyncWriter::~asyncWriter()
+{
+  if (_fd > -1)
+  {
+    _stop = true;
+    wake();
+    terminate();
+    flush();
+    ::close(_fd);
+  }
+
+  while (_rings)
+  {
+    asyncRing *next = _rings->_next;
+    delete _rings;
+    _rings = next;
+  }
+}
+
+void asyncWriter::wake(void)
+{
+  _wakeup.enterMutex();
+  _wakeup.signal(false);
+  _wakeup.leaveMutex();
+}
+
+void asyncWriter::run(void)
+{
+  while (!_stop)
+  {
+    _wakeup.wait(_interval);
+    flush();
+  }
+}
+
+void asyncWriter::detach(logStruct& log)
+{
+  // the writer releases the ring once it has been written out
+  if (log._ring)
+    log._ring->_detached = true;
+  log._ring = NULL;
+}
+
+void asyncWriter::write(logStruct& log, const char *level, bool endOfLine)
+{
+  struct timeval now;
+  char rec[RECORD];
+
+  if (!log._ring)
+  {
+    log._ring = new asyncRing(_size);
+    MutexLock lock(_lock);
+    log._ring->_next = _rings;
+    _rings = log._ring;
+  }
+
+  // the date and time is only converted once each second
+  gettimeofday(&now, NULL);
+  const char *stamp = log._stamp.set(&now);
+
+  int len;
+  if (log._ident.empty())
+    len = snprintf(rec, sizeof(rec), "%s [%s] %s%s", stamp,
+                   level, log._msgbuf, endOfLine ? "\n" : "");
+  else
+    len = snprintf(rec, sizeof(rec), "%s %s: [%s] %s%s", stamp,
+                   log._ident.c_str(), level,
+                   log._msgbuf, endOfLine ? "\n" : "");
+
+  if (len < 1)
+    return;
+  if (len >= (int)sizeof(rec))
+    len = sizeof(rec) - 1;
+
+  // a full ring waits for the writer to drain it rather than losing the
+  // record; the wait is timed in case the writer has stopped
+  if (!log._ring->put(rec, len))
+  {
+    _space.enterMutex();
+    while (!log._ring->put(rec, len))
+    {
+      wake();
+      _space.wait(_interval, true);
+    }
+    _space.leaveMutex();
+  }
+
+  size_t used = log._ring->used();
+  if (used >= _size / 2 && used - len < _size / 2)
+    wake();
+}
+
+void asyncWriter::flush(void)
+{
+  struct iovec iov[BATCH * 2];
+  asyncRing *list[BATCH];
+  size_t take[BATCH];
+
+  MutexLock lock(_lock);
+
+  // release rings of threads that unsubscribed once they are empty
+  asyncRing **prev = &_rings;
+  while (*prev)
+  {
+    asyncRing *ring = *prev;
+    if (ring->_detached && !ring->used())
+    {
+      *prev = ring->_next;
+      delete ring;
+    }
+    else
+      prev = &ring->_next;
+  }
+
+  asyncRing *ring = _rings;
+  while (ring)
+  {
+    int vecs = 0;
+    unsigned count = 0;
+
+    while (ring && count < BATCH)
+    {
+      size_t used = ring->used();
+      if (used)
+      {
+        size_t pos = ring->_tail & (ring->_size - 1);
+        size_t first = ring->_size - pos;
+        if (first > used)
+          first = used;
+        iov[vecs].iov_base = ring->_data + pos;
+        iov[vecs++].iov_len = first;
+        if (used > first)
+        {
+          iov[vecs].iov_base = ring->_data;
+          iov[vecs++].iov_len = used - first;
+        }
+        list[count] = ring;
+        take[count++] = used;
+      }
+      ring = ring->_next;
+    }
+
+    struct iovec *vp = iov;
+    while (vecs)
+    {
+      ssize_t result = ::writev(_fd, vp, vecs);
+      if (result < 0 && errno == EINTR)
+        continue;
+      if (result < 0)
+        break;
+
+      while (vecs && (size_t)result >= vp->iov_len)
+      {
+        result -= vp->iov_len;
+        ++vp;
+        --vecs;
+      }
+      if (vecs)
+      {
+        vp->iov_base = (char *)vp->iov_base + result;
+        vp->iov_len -= result;
+      }
+    }
+
+    // records that could not be written are dropped, not retried
+    for (unsigned pos = 0; pos < count; ++pos)
+      release(&list[pos]->_tail, list[pos]->_tail + take[pos]);
+  }
+
+  // threads waiting on a full ring may continue
+  _space.enterMutex();
+  _space.signal(true);
+  _space.leaveMutex();
+}
+
+#endif
+
 // mapping thread ID <-> logStruct (buffer)
 typedef std::map <cctid_t, logStruct> LogPrivateData;
 // map ident <-> levels
@@ -159,6 +469,10 @@ class __LOCAL AppLogPrivate
     bool           _logPipe;
     // log spooler
     logger         *_pLogger;
+#ifndef _MSWINDOWS_
+    // batched writer of per-thread buffers
+    asyncWriter    *_pWriter;
+#endif
 
     string        _nomeFile;
     Mutex         _lock;
@@ -167,12 +481,36 @@ class __LOCAL AppLogPrivate
     static const levelNamePair _values[];
     static LevelName           _assoc;
 
+#ifndef _MSWINDOWS_
+    AppLogPrivate() : _pLogger(NULL), _pWriter(NULL) {}
+#else
     AppLogPrivate() : _pLogger(NULL) {}
+#endif
+
+#ifndef _MSWINDOWS_
+    // buffers of the writer go away with it
+    void closeWriter(void)
+    {
+      if (!_pWriter)
+        return;
+
+      ost::MutexLock mtx(_subMutex);
+      LogPrivateData::iterator logIt;
+      for (logIt = _logs.begin(); logIt != _logs.end(); ++logIt)
+        logIt->second._ring = NULL;
+      delete _pWriter;
+      _pWriter = NULL;
+    }
+#endif
 
     ~AppLogPrivate()
     {
       if (_pLogger)
         delete _pLogger;
+#ifndef _MSWINDOWS_
+      if (_pWriter)
+        delete _pWriter;
+#endif
     }
 };
 
@@ -288,7 +626,7 @@ HEXdump::HEXdump(const unsigned char *buffer, int len, int max_len) : _str()
 #endif
 
 // class logger
-logger::logger(const char* logFileName, bool usePipe)  : ThreadQueue(NULL, 0, 0), _usePipe(usePipe), _closedByApplog(false)
+logger::logger(const char* logFileName, bool usePipe)  : ThreadQueue(NULL, 0, 0, 65536), _usePipe(usePipe), _closedByApplog(false)
 {
   _nomeFile = "";
 
@@ -300,8 +638,7 @@ logger::logger(const char* logFileName, bool usePipe)  : ThreadQueue(NULL, 0, 0)
 
 logger::~logger()
 {
-  Semaphore::post();
-  Thread::terminate();
+  stop();
 
   _logfs.flush();
   _logfs.close();
@@ -370,8 +707,12 @@ void logger::closeFile()
 // writes into filename enqueued messages
 void logger::runQueue(void * data)
 {
-  char *str = (char *) data;
+  runBatch(&data, 1);
+}
 
+// writes a batch of enqueued messages with one flush
+void logger::runBatch(void **list, unsigned count)
+{
   // if for some internal reasons file has been closed
   // reopen it
   try
@@ -387,7 +728,8 @@ void logger::runQueue(void * data)
   
   if (_logfs.is_open())
   {
-    _logfs << str;
+    for (unsigned pos = 0; pos < count; ++pos)
+      _logfs << (char *) list[pos];
     _logfs.flush();
   }
   
@@ -503,6 +845,13 @@ AppLog::AppLog(const char* logFileName, bool logDirectly) :
 
 AppLog::~AppLog()
 {
+  // the spooler writes out what is still queued before the log is closed
+  if (d && d->_pLogger)
+  {
+    delete d->_pLogger;
+    d->_pLogger = NULL;
+  }
+
   // if _logDirectly
   close();
   if (d) delete d;
@@ -538,6 +887,10 @@ void AppLog::unsubscribe()
     LogPrivateData::iterator logIt = d->_logs.find(tid);
     if (logIt != d->_logs.end())
     {
+#ifndef _MSWINDOWS_
+      if (d->_pWriter)
+        d->_pWriter->detach(logIt->second);
+#endif
       // unsubscribes thread
       d->_logs.erase(logIt);
     }
@@ -559,6 +912,9 @@ void AppLog::logFileName(const char* FileName, bool logDirectly)
   d->_lock.enterMutex();
   d->_nomeFile = FileName;
   close();
+#ifndef _MSWINDOWS_
+  d->closeWriter();
+#endif
   d->_logDirectly = logDirectly;
 #ifndef _MSWINDOWS_
   d->_logPipe = usePipe;
@@ -603,6 +959,41 @@ void AppLog::logFileName(const char* FileName, bool logDirectly)
   d->_lock.leaveMutex();
 }
 
+#ifndef _MSWINDOWS_
+void AppLog::logAsync(const char* FileName, size_t bufferSize, timeout_t flushTime)
+{
+  if (!FileName)
+  {
+    slog.error("Null file name!");
+    return;
+  }
+
+  d->_lock.enterMutex();
+  close();
+  if (d->_pLogger)
+  {
+    delete d->_pLogger;
+    d->_pLogger = NULL;
+  }
+
+  d->closeWriter();
+
+  d->_nomeFile = FileName;
+  d->_logDirectly = false;
+  d->_logPipe = false;
+  d->_pWriter = new asyncWriter(FileName, bufferSize, flushTime);
+  if (!d->_pWriter->isOpen())
+  {
+    delete d->_pWriter;
+    d->_pWriter = NULL;
+    d->_lock.leaveMutex();
+    THROW(AppLogException("Can't open log file name"));
+    return;
+  }
+  d->_lock.leaveMutex();
+}
+#endif
+
 // writes to log
 void AppLog::writeLog(bool endOfLine)
 {
@@ -615,8 +1006,14 @@ void AppLog::writeLog(bool endOfLine)
     if (logIt == d->_logs.end())
       return;
 
+#ifndef _MSWINDOWS_
+    bool async = (d->_pWriter != NULL);
+#else
+    bool async = false;
+#endif
+
     if ((d->_logDirectly && !d->_logfs.is_open() && !logIt->second._clogEnable) ||
-        (!d->_logDirectly && !d->_pLogger && !logIt->second._clogEnable))
+        (!d->_logDirectly && !d->_pLogger && !async && !logIt->second._clogEnable))
 
     {
       logIt->second._msgpos = 0;
@@ -626,14 +1023,6 @@ void AppLog::writeLog(bool endOfLine)
 
     if (logIt->second._enable)
     {
-      time_t now;
-      struct tm *dt;
-      time(&now);
-      struct timeval detail_time;
-      gettimeofday(&detail_time, NULL);
-      dt = localtime(&now);
-      char buf[50];
-
       const char *p = "unknown";
       switch (logIt->second._priority)
       {
@@ -663,11 +1052,24 @@ void AppLog::writeLog(bool endOfLine)
           break;
       }
 
-      snprintf(buf, sizeof(buf) - 1, "%04d-%02d-%02d %02d:%02d:%02d.%03d ",
-               dt->tm_year + 1900, dt->tm_mon + 1, dt->tm_mday,
-               dt->tm_hour, dt->tm_min, dt->tm_sec, (int)(detail_time.tv_usec / 1000));
+#ifndef _MSWINDOWS_
+      // the calling thread only formats into its own buffer
+      if (async)
+      {
+        d->_pWriter->write(logIt->second, p, endOfLine);
+        if (!logIt->second._clogEnable && !logIt->second._slogEnable)
+        {
+          logIt->second._msgpos = 0;
+          logIt->second._msgbuf[0] = '\0';
+          return;
+        }
+      }
+#endif
 
-      buf[sizeof(buf)-1] = 0;    // per sicurezza
+      char buf[50];
+      size_t len = ucommon::TimeStamp::format(buf, sizeof(buf) - 1);
+      buf[len++] = ' ';
+      buf[len] = 0;
 
       if (d->_logDirectly)
       {
@@ -711,6 +1113,8 @@ void AppLog::writeLog(bool endOfLine)
 
         d->_lock.enterMutex();
       }
+      else
+        d->_lock.enterMutex();
 
       // slog it if error level is right
       if (logIt->second._slogEnable && logIt->second._priority <= Slog::levelError)
@@ -753,6 +1157,10 @@ void AppLog::close(void)
   {
     if (d->_pLogger)
       d->_pLogger->closeFile();
+#ifndef _MSWINDOWS_
+    if (d->_pWriter)
+      d->_pWriter->flush();
+#endif
   }
 }
 
@@ -44,6 +44,8 @@
 #ifdef  __BORLANDC__
 #include <stdio.h>
 #include <stdarg.h>
+#include <limits.h>
+#include <wchar.h>
 #else
 #include <cstdio>
 #include <cstdarg>
@@ -53,6 +55,17 @@
 #include <syslog.h>
 #endif
 
+#if defined(HAVE_SYS_MMAN_H) && !defined(_MSWINDOWS_)
+#define SLOG_TRACE
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <ctype.h>
+#include <stdint.h>
+#endif
+
 namespace ost {
 using std::streambuf;
 using std::ofstream;
@@ -69,11 +82,13 @@ streambuf() ,ostream((streambuf *)this)
     _enable = true;
     _level = levelDebug;
     _clogEnable = true;
+    _trace = NULL;
     syslog = NULL;
 }
 
 Slog::~Slog(void)
 {
+    traceClose();
 #ifdef  HAVE_SYSLOG_H
     closelog();
 #else
@@ -337,10 +352,7 @@ int Slog::overflow(int c)
             ::syslog(priority, "%s", thread->msgbuf);
 #else
         {
-            time_t now;
-            struct tm *dt;
-            time(&now);
-            dt = localtime(&now);
+            char stamp[32];
             char buf[256];
             const char *p = "unknown";
             switch(priority) {
@@ -370,10 +382,8 @@ int Slog::overflow(int c)
                 break;
             }
 
-            snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d [%s] %s\n",
-                dt->tm_year + 1900, dt->tm_mon + 1, dt->tm_mday,
-                dt->tm_hour, dt->tm_min, dt->tm_sec,
-                p, thread->msgbuf);
+            ucommon::TimeStamp::format(stamp, sizeof(stamp), ucommon::TimeStamp::LOCAL, 0);
+            snprintf(buf, sizeof(buf), "%s [%s] %s\n", stamp, p, thread->msgbuf);
             if(syslog)
                 fputs(buf, syslog);
 //              syslog << "[" << priority << "] " << thread->msgbuf << endl;
@@ -505,5 +515,517 @@ Slog &Slog::operator()(void)
     return *this;
 }
 
+#ifdef  SLOG_TRACE
+
+#define TRACE_FORMATS   4096    // formats that may be interned
+#define TRACE_CACHE     256     // formats each thread remembers
+#define TRACE_ARGS      32      // arguments recorded of a format
+#define TRACE_EVENT     4096    // room kept for any one record
+
+// scan a printf format for the type of each argument it converts
+static unsigned signature(const char *format, char *sig)
+{
+    unsigned count = 0;
+
+    while(*format) {
+        if(*(format++) != '%')
+            continue;
+        if(*format == '%') {
+            ++format;
+            continue;
+        }
+        while(*format && strchr("-+ #0'", *format))
+            ++format;
+        if(*format == '*') {
+            if(count < TRACE_ARGS)
+                sig[count++] = 'i';
+            ++format;
+        }
+        while(isdigit(*format))
+            ++format;
+        if(*format == '.') {
+            ++format;
+            if(*format == '*') {
+                if(count < TRACE_ARGS)
+                    sig[count++] = 'i';
+                ++format;
+            }
+            while(isdigit(*format))
+                ++format;
+        }
+
+        char size = 'i';
+        switch(*format) {
+        case 'h':
+            while(*format == 'h')
+                ++format;
+            break;
+        case 'l':
+            size = 'l';
+            if(*(++format) == 'l') {
+                size = 'q';
+                ++format;
+            }
+            break;
+        case 'q':
+        case 'L':
+            size = 'q';
+            ++format;
+            break;
+        case 'j':
+        case 'z':
+        case 't':
+            size = *(format++);
+            break;
+        }
+
+        char type;
+        switch(*format) {
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            type = size;
+            break;
+        case 'c':
+        case 'C':
+            type = 'i';
+            break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            type = (size == 'q') ? 'D' : 'd';
+            break;
+        case 's':
+            type = (size == 'l') ? 'w' : 's';
+            break;
+        case 'S':
+            type = 'w';
+            break;
+        case 'p':
+        case 'n':
+            type = 'p';
+            break;
+        case 0:
+            return count;
+        default:
+            type = 0;
+        }
+        ++format;
+        if(type && count < TRACE_ARGS)
+            sig[count++] = type;
+    }
+    return count;
+}
+
+class Slog::tracelog
+{
+public:
+    typedef struct {
+        const char *format;
+        uint32_t id;
+        unsigned count;
+        char sig[TRACE_ARGS];
+    } entry_t;
+
+    // chunk a thread writes into and the formats it has used
+    class local
+    {
+    public:
+        tracelog *owner;
+        local *prev, *next;
+        char *pos, *end;
+        uint32_t thread;
+        unsigned long dropped;
+        entry_t *cache[TRACE_CACHE];
+    };
+
+    pthread_mutex_t lock;
+    pthread_key_t key;
+    int fd;
+    caddr_t map;
+    trace_header_t *header;
+    size_t size, chunk;
+    volatile bool full;
+    struct timespec started;
+    uint32_t threads, formats;
+    unsigned long dropped;
+    local *list;
+    entry_t table[TRACE_FORMATS];
+
+    tracelog(int fd, caddr_t map, size_t size, size_t chunk);
+    ~tracelog();
+
+    local *get(void);
+    bool reserve(local *lp);
+    entry_t *intern(local *lp, const char *format);
+
+    static void release(void *obj);
+
+    inline uint64_t now(void) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)(ts.tv_sec - started.tv_sec) * 1000000000ul +
+            ts.tv_nsec - started.tv_nsec;
+    }
+};
+
+Slog::tracelog::tracelog(int f, caddr_t addr, size_t s, size_t c)
+{
+    struct timeval tv;
+
+    fd = f;
+    map = addr;
+    size = s;
+    chunk = c;
+    full = false;
+    threads = formats = 0;
+    dropped = 0;
+    list = NULL;
+    memset(table, 0, sizeof(table));
+    pthread_mutex_init(&lock, NULL);
+    pthread_key_create(&key, &release);
+
+    gettimeofday(&tv, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    header = (trace_header_t *)map;
+    memcpy(header->magic, "slogtrc", 8);
+    header->version = 1;
+    header->chunk = (uint32_t)chunk;
+    header->size = size;
+    header->used = (sizeof(trace_header_t) + 63) & ~63;
+    header->seconds = tv.tv_sec;
+    header->nanoseconds = tv.tv_usec * 1000;
+    header->sizes[0] = sizeof(long);
+    header->sizes[1] = sizeof(long double);
+    header->sizes[2] = sizeof(void *);
+    header->sizes[3] = sizeof(intmax_t);
+}
+
+Slog::tracelog::~tracelog()
+{
+    pthread_key_delete(key);
+    while(list) {
+        local *lp = list;
+        list = lp->next;
+        dropped += lp->dropped;
+        delete lp;
+    }
+    header->dropped = dropped;
+    size_t used = (size_t)header->used;
+    munmap(map, size);
+    if(ftruncate(fd, used)) {
+        // the file is left at its mapped size
+    }
+    ::close(fd);
+    pthread_mutex_destroy(&lock);
+}
+
+void Slog::tracelog::release(void *obj)
+{
+    local *lp = (local *)obj;
+    tracelog *log = lp->owner;
+
+    pthread_mutex_lock(&log->lock);
+    if(lp->prev)
+        lp->prev->next = lp->next;
+    else
+        log->list = lp->next;
+    if(lp->next)
+        lp->next->prev = lp->prev;
+    log->dropped += lp->dropped;
+    pthread_mutex_unlock(&log->lock);
+    delete lp;
+}
+
+Slog::tracelog::local *Slog::tracelog::get(void)
+{
+    local *lp = (local *)pthread_getspecific(key);
+    if(lp)
+        return lp;
+
+    lp = new local;
+    memset(lp, 0, sizeof(local));
+    lp->owner = this;
+    pthread_mutex_lock(&lock);
+    lp->thread = ++threads;
+    lp->next = list;
+    if(list)
+        list->prev = lp;
+    list = lp;
+    pthread_mutex_unlock(&lock);
+    pthread_setspecific(key, lp);
+    return lp;
+}
+
+// called with the lock held
+bool Slog::tracelog::reserve(local *lp)
+{
+    if(full || header->used + chunk > size) {
+        full = true;
+        return false;
+    }
+    lp->pos = map + header->used;
+    lp->end = lp->pos + chunk;
+    header->used += chunk;
+    return true;
+}
+
+Slog::tracelog::entry_t *Slog::tracelog::intern(local *lp, const char *format)
+{
+    unsigned slot = (unsigned)(((uintptr_t)format >> 3) % TRACE_FORMATS);
+    unsigned probe = 0;
+    entry_t *entry = NULL;
+
+    pthread_mutex_lock(&lock);
+    while(probe++ < TRACE_FORMATS) {
+        entry = &table[slot];
+        if(!entry->format || entry->format == format)
+            break;
+        slot = (slot + 1) % TRACE_FORMATS;
+        entry = NULL;
+    }
+
+    if(entry && !entry->format) {
+        // new formats are saved in the chunk of the thread using them
+        size_t len = strlen(format) + 1;
+        if(len > TRACE_EVENT - sizeof(trace_record_t))
+            len = TRACE_EVENT - sizeof(trace_record_t);
+        if((lp->end - lp->pos < TRACE_EVENT) && !reserve(lp))
+            entry = NULL;
+        else {
+            entry->id = ++formats;
+            entry->count = signature(format, entry->sig);
+            entry->format = format;
+
+            trace_record_t *rec = (trace_record_t *)lp->pos;
+            memcpy(lp->pos + sizeof(trace_record_t), format, len);
+            lp->pos[sizeof(trace_record_t) + len - 1] = 0;
+            rec->type = traceFormat;
+            rec->level = 0;
+            rec->id = entry->id;
+            rec->thread = lp->thread;
+            rec->time = 0;
+            rec->size = (uint32_t)((sizeof(trace_record_t) + len + 7) & ~7);
+            lp->pos += rec->size;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    if(entry)
+        lp->cache[((uintptr_t)format >> 3) % TRACE_CACHE] = entry;
+    return entry;
+}
+
+bool Slog::traceOpen(const char *path, size_t size, size_t chunk)
+{
+    traceClose();
+
+    if(chunk < TRACE_EVENT * 4)
+        chunk = TRACE_EVENT * 4;
+    chunk = (chunk + 63) & ~((size_t)63);
+    if(size < chunk * 2)
+        size = chunk * 2;
+
+    int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0640);
+    if(fd < 0)
+        return false;
+
+    if(ftruncate(fd, size)) {
+        ::close(fd);
+        return false;
+    }
+
+    caddr_t map = (caddr_t)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(map == (caddr_t)MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    _trace = new tracelog(fd, map, size, chunk);
+    return true;
+}
+
+void Slog::traceClose(void)
+{
+    tracelog *log = _trace;
+    if(!log)
+        return;
+
+    _trace = NULL;
+    delete log;
+}
+
+void Slog::trace(Level level, const char *format, ...)
+{
+    tracelog *log = _trace;
+    if(!log || level > _level)
+        return;
+
+    tracelog::local *lp = log->get();
+    tracelog::entry_t *entry = lp->cache[((uintptr_t)format >> 3) % TRACE_CACHE];
+    if(!entry || entry->format != format) {
+        entry = log->intern(lp, format);
+        if(!entry) {
+            ++lp->dropped;
+            return;
+        }
+    }
+
+    if(lp->end - lp->pos < TRACE_EVENT) {
+        pthread_mutex_lock(&log->lock);
+        bool ok = log->reserve(lp);
+        pthread_mutex_unlock(&log->lock);
+        if(!ok) {
+            ++lp->dropped;
+            return;
+        }
+    }
+
+    trace_record_t *rec = (trace_record_t *)lp->pos;
+    char *pos = lp->pos + sizeof(trace_record_t);
+    size_t room = TRACE_EVENT - sizeof(trace_record_t) - TRACE_ARGS * 16;
+    va_list args;
+
+    va_start(args, format);
+    for(unsigned arg = 0; arg < entry->count; ++arg) {
+        switch(entry->sig[arg]) {
+        case 'i': {
+            int value = va_arg(args, int);
+            memcpy(pos, &value, sizeof(value));
+            pos += sizeof(value);
+            break;
+        }
+        case 'l': {
+            long value = va_arg(args, long);
+            memcpy(pos, &value, sizeof(value));
+            pos += sizeof(value);
+            break;
+        }
+        case 'q': {
+            long long value = va_arg(args, long long);
+            memcpy(pos, &value, sizeof(value));
+            pos += sizeof(value);
+            break;
+        }
+        case 'j': {
+            intmax_t value = va_arg(args, intmax_t);
+            memcpy(pos, &value, sizeof(value));
+            pos += sizeof(value);
+            break;
+        }
+        case 'z': {
+            size_t value = va_arg(args, size_t);
+            memcpy(pos, &value, sizeof(value));
+            pos += sizeof(value);
+            break;
+        }
+        case 't': {
+            ptrdiff_t value = va_arg(args, ptrdiff_t);
+            memcpy(pos, &value, sizeof(value));
+            pos += sizeof(value);
+            break;
+        }
+        case 'd': {
+            double value = va_arg(args, double);
+            memcpy(pos, &value, sizeof(value));
+            pos += sizeof(value);
+            break;
+        }
+        case 'D': {
+            long double value = va_arg(args, long double);
+            memcpy(pos, &value, sizeof(value));
+            pos += sizeof(value);
+            break;
+        }
+        case 'p': {
+            void *value = va_arg(args, void *);
+            memcpy(pos, &value, sizeof(value));
+            pos += sizeof(value);
+            break;
+        }
+        case 's': {
+            const char *str = va_arg(args, const char *);
+            if(!str)
+                str = "(null)";
+            size_t len = strlen(str);
+            if(len > room)
+                len = room;
+            if(len > 65535)
+                len = 65535;
+            room -= len;
+            uint16_t count = (uint16_t)len;
+            memcpy(pos, &count, sizeof(count));
+            memcpy(pos + sizeof(count), str, len);
+            pos += sizeof(count) + len;
+            break;
+        }
+        case 'w': {
+            // wide strings are kept as multibyte text in the locale
+            const wchar_t *str = va_arg(args, const wchar_t *);
+            if(!str)
+                str = L"(null)";
+            char *text = pos + sizeof(uint16_t);
+            char mb[MB_LEN_MAX];
+            mbstate_t state;
+            size_t len = 0;
+            memset(&state, 0, sizeof(state));
+            while(*str) {
+                size_t size = wcrtomb(mb, *(str++), &state);
+                if(size == (size_t)-1) {
+                    memset(&state, 0, sizeof(state));
+                    mb[0] = '?';
+                    size = 1;
+                }
+                if(size > room - len || len + size > 65535)
+                    break;
+                memcpy(text + len, mb, size);
+                len += size;
+            }
+            room -= len;
+            uint16_t count = (uint16_t)len;
+            memcpy(pos, &count, sizeof(count));
+            pos += sizeof(count) + len;
+            break;
+        }
+        }
+    }
+    va_end(args);
+
+    rec->type = traceEvent;
+    rec->level = (uint16_t)level;
+    rec->id = entry->id;
+    rec->thread = lp->thread;
+    rec->time = log->now();
+    rec->size = (uint32_t)(((pos - lp->pos) + 7) & ~7);
+    lp->pos += rec->size;
+}
+
+#else
+
+bool Slog::traceOpen(const char *path, size_t size, size_t chunk)
+{
+    return false;
+}
+
+void Slog::traceClose(void)
+{
+}
+
+void Slog::trace(Level level, const char *format, ...)
+{
+}
+
+#endif
+
 } // namespace ost
 
+
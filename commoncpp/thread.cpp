@@ -840,12 +840,51 @@ size_t FixedBuffer::onPeek(void *data)
     return objsize;
 }
 
+// ring records are kept whole and 8 byte aligned; a record that would
+// pass the end of the ring is placed at the start, after a skip marker.
+
+typedef struct {
+    unsigned len;
+    unsigned spare;
+}   record_t;
+
+#define RECORD_SKIP ((unsigned)~0)
+#define RECORD_BATCH 64
+
+static inline size_t record_size(unsigned len)
+{
+    return (sizeof(record_t) + len + 7) & ~((size_t)7);
+}
+
 ThreadQueue::ThreadQueue(const char *id, int pri, size_t stack) :
 Mutex(), Thread(pri, stack), Semaphore(0), name(id)
 {
     first = last = NULL;
     started = false;
     timeout = 0;
+    ring = NULL;
+    ringsize = head = tail = done = 0;
+    waiters = 0;
+    dropped = freed = 0;
+    overflow = queueBlock;
+    signalled = stopping = false;
+}
+
+ThreadQueue::ThreadQueue(const char *id, int pri, size_t stack, size_t size, Overflow mode) :
+Mutex(), Thread(pri, stack), Semaphore(0), name(id)
+{
+    first = last = NULL;
+    started = false;
+    timeout = 0;
+    ringsize = 64;
+    while(ringsize < size)
+        ringsize <<= 1;
+    ring = new char[ringsize];
+    head = tail = done = 0;
+    waiters = 0;
+    dropped = freed = 0;
+    overflow = mode;
+    signalled = stopping = false;
 }
 
 ThreadQueue::~ThreadQueue()
@@ -860,6 +899,8 @@ ThreadQueue::~ThreadQueue()
         delete[] data;
         data = next;
     }
+    if(ring)
+        delete[] ring;
 }
 
 void ThreadQueue::run(void)
@@ -868,15 +909,27 @@ void ThreadQueue::run(void)
     data_t *prev;
     started = true;
     for(;;) {
-        posted = Semaphore::wait(timeout);
+        // a queue without a timer sleeps until posted
+        wakeup.enterMutex();
+        while(!signalled) {
+            if(!timeout)
+                wakeup.wait(TIMEOUT_INF, true);
+            else if(!wakeup.wait(timeout, true))
+                break;
+        }
+        posted = signalled;
+        signalled = false;
+        wakeup.leaveMutex();
         if(!posted) {
             onTimer();
-            if(!first)
+            if(!first && head == tail && !stopping)
                 continue;
         }
         if(!started)
             sleep((timeout_t)~0);
         startQueue();
+        if(ring)
+            drain();
         while(first) {
             runQueue(first->data);
             enterMutex();
@@ -886,13 +939,83 @@ void ThreadQueue::run(void)
             if(!first)
                 last = NULL;
             leaveMutex();
-            if(first)
-                Semaphore::wait(); // demark semaphore
         }
         stopQueue();
+        if(stopping)
+            return;
+    }
+}
+
+void ThreadQueue::drain(void)
+{
+    void *list[RECORD_BATCH];
+    unsigned count;
+    size_t pos, offset;
+    record_t *rec;
+
+    for(;;) {
+        count = 0;
+        enterMutex();
+        pos = tail;
+        while(pos != head && count < RECORD_BATCH) {
+            offset = pos & (ringsize - 1);
+            rec = (record_t *)(ring + offset);
+            if(rec->len == RECORD_SKIP) {
+                pos += ringsize - offset;
+                continue;
+            }
+            list[count++] = (void *)(rec + 1);
+            pos += record_size(rec->len);
+        }
+        // records from done to tail are in use until the batch is run
+        tail = pos;
+        leaveMutex();
+
+        if(count)
+            runBatch(list, count);
+
+        enterMutex();
+        done = pos;
+        ++freed;
+        if(waiters) {
+            waiters = 0;
+            space.enterMutex();
+            space.signal(true);
+            space.leaveMutex();
+        }
+        leaveMutex();
+        if(!count)
+            return;
     }
 }
 
+void ThreadQueue::runBatch(void **list, unsigned count)
+{
+    for(unsigned pos = 0; pos < count; ++pos)
+        runQueue(list[pos]);
+}
+
+void ThreadQueue::notify(void)
+{
+    wakeup.enterMutex();
+    signalled = true;
+    wakeup.signal(false);
+    wakeup.leaveMutex();
+}
+
+void ThreadQueue::stop(void)
+{
+    enterMutex();
+    stopping = true;
+    leaveMutex();
+    // posters waiting for room would otherwise wait on a stopped queue
+    space.enterMutex();
+    space.signal(true);
+    space.leaveMutex();
+    notify();
+    Thread::terminate();
+}
+
 void ThreadQueue::final()
 {
 }
@@ -911,16 +1034,95 @@ void ThreadQueue::setTimer(timeout_t timed)
         started = true;
     }
     else if(!first)
-        Semaphore::post();
+        notify();
 }
 
-void ThreadQueue::post(const void *dp, unsigned len)
+bool ThreadQueue::post(const void *dp, unsigned len)
 {
+    if(ring) {
+        size_t need = record_size(len);
+        size_t offset, skip;
+        record_t *rec;
+        bool empty;
+
+        enterMutex();
+        if(need > ringsize) {
+            ++dropped;
+            leaveMutex();
+            return false;
+        }
+
+        for(;;) {
+            if(stopping) {
+                leaveMutex();
+                return false;
+            }
+            offset = head & (ringsize - 1);
+            skip = 0;
+            if(offset + need > ringsize)
+                skip = ringsize - offset;
+            if(head + skip + need - done <= ringsize)
+                break;
+            // the oldest record can only be discarded if not being run
+            if(overflow == queueOverwrite && done == tail && tail != head) {
+                offset = tail & (ringsize - 1);
+                rec = (record_t *)(ring + offset);
+                if(rec->len == RECORD_SKIP)
+                    tail += ringsize - offset;
+                else {
+                    tail += record_size(rec->len);
+                    ++dropped;
+                }
+                done = tail;
+                continue;
+            }
+            if(overflow == queueBlock && started && !stopping) {
+                unsigned long mark = freed;
+                ++waiters;
+                leaveMutex();
+                space.enterMutex();
+                while(freed == mark && !stopping)
+                    space.wait(TIMEOUT_INF, true);
+                space.leaveMutex();
+                enterMutex();
+                continue;
+            }
+            ++dropped;
+            leaveMutex();
+            return false;
+        }
+
+        empty = (head == tail);
+        if(skip) {
+            ((record_t *)(ring + offset))->len = RECORD_SKIP;
+            head += skip;
+            offset = 0;
+        }
+        rec = (record_t *)(ring + offset);
+        rec->len = len;
+        memcpy(rec + 1, dp, len);
+        head += need;
+        if(!started) {
+            start();
+            started = true;
+        }
+        leaveMutex();
+        // the queue thread runs everything posted once woken
+        if(empty)
+            notify();
+        return true;
+    }
+
     data_t *data = (data_t *)new char[sizeof(data_t) + len];
     memcpy(data->data, dp, len);
     data->len = len;
     data->next = NULL;
     enterMutex();
+    if(stopping) {
+        leaveMutex();
+        delete[] (char *)data;
+        return false;
+    }
     if(!first)
         first = data;
     if(last)
@@ -931,7 +1133,8 @@ void ThreadQueue::post(const void *dp, unsigned len)
         started = true;
     }
     leaveMutex();
-    Semaphore::post();
+    notify();
+    return true;
 }
 
 void ThreadQueue::startQueue(void)
@@ -19,23 +19,282 @@
 #include <ucommon-config.h>
 #include <ucommon/export.h>
 #include <ucommon/bitmap.h>
+#include <ucommon/cpr.h>
+#ifndef UCOMMON_SYSRUNTIME
+#include <ucommon/persist.h>
+#endif
 #include <stdlib.h>
+#include <string.h>
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BITMAP_X86
+#include <immintrin.h>
+#endif
 
 namespace ucommon {
 
+const size_t bitmap::npos;
+const size_t sparse_bitmap::npos;
+
+static bool bitmap_avx2 = false;
+static bool bitmap_popcnt = false;
+
+#ifdef  BITMAP_X86
+class __LOCAL bitmap_init
+{
+public:
+    bitmap_init();
+};
+
+bitmap_init::bitmap_init()
+{
+    __builtin_cpu_init();
+    bitmap_avx2 = __builtin_cpu_supports("avx2") != 0;
+    bitmap_popcnt = __builtin_cpu_supports("popcnt") != 0;
+}
+
+static bitmap_init bitmaps;
+#endif
+
+static inline unsigned lowbit(uint64_t value)
+{
+#ifdef  __GNUC__
+    return (unsigned)__builtin_ctzll(value);
+#else
+    unsigned bit = 0;
+    while(!(value & 1)) {
+        value >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+static inline unsigned popcount(uint64_t value)
+{
+#ifdef  __GNUC__
+    return (unsigned)__builtin_popcountll(value);
+#else
+    value = value - ((value >> 1) & 0x5555555555555555ull);
+    value = (value & 0x3333333333333333ull) + ((value >> 2) & 0x3333333333333333ull);
+    value = (value + (value >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (unsigned)((value * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+// skip whole words that cannot hold the bit searched for; a word of
+// "empty" has no bit of the wanted value.
+template<typename T>
+static size_t skip(const T *words, size_t index, size_t limit, T empty)
+{
+    while(index < limit && words[index] == empty)
+        ++index;
+    return index;
+}
+
+#ifdef  BITMAP_X86
+__attribute__((target("avx2")))
+static size_t skip_avx2(const uint64_t *words, size_t index, size_t limit, uint64_t empty)
+{
+    const __m256i match = _mm256_set1_epi64x((long long)empty);
+
+    while(index + 4 <= limit) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(words + index));
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi64(block, match)) != -1)
+            break;
+        index += 4;
+    }
+    return index;
+}
+
+__attribute__((target("avx2")))
+static size_t count_avx2(const uint64_t *words, size_t limit)
+{
+    const __m256i lut = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i total = _mm256_setzero_si256();
+    size_t index = 0;
+
+    while(index + 4 <= limit) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(words + index));
+        __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(block, nibble));
+        __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble));
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+        index += 4;
+    }
+
+    uint64_t sums[4];
+    _mm256_storeu_si256((__m256i *)sums, total);
+    size_t result = (size_t)(sums[0] + sums[1] + sums[2] + sums[3]);
+    while(index < limit)
+        result += (size_t)__builtin_popcountll(words[index++]);
+    return result;
+}
+
+__attribute__((target("popcnt")))
+static size_t count_popcnt(const uint64_t *words, size_t limit)
+{
+    size_t result = 0;
+    for(size_t index = 0; index < limit; ++index)
+        result += (size_t)__builtin_popcountll(words[index]);
+    return result;
+}
+#endif
+
+template<>
+size_t skip<uint64_t>(const uint64_t *words, size_t index, size_t limit, uint64_t empty)
+{
+#ifdef  BITMAP_X86
+    if(bitmap_avx2)
+        index = skip_avx2(words, index, limit, empty);
+#endif
+    while(index < limit && words[index] == empty)
+        ++index;
+    return index;
+}
+
+template<typename T>
+static size_t find_bit(const T *words, size_t size, size_t offset, bool value)
+{
+    const unsigned bits = sizeof(T) * 8;
+    const T empty = value ? (T)0 : (T)(~(T)0);
+    size_t limit = (size + bits - 1) / bits;
+    size_t index = offset / bits;
+
+    if(offset >= size)
+        return bitmap::npos;
+
+    // mask off bits below the offset in the first word
+    uint64_t word = (uint64_t)(T)(words[index] ^ empty);
+    word &= ~(uint64_t)0 << (offset % bits);
+    while(!word) {
+        index = skip<T>(words, index + 1, limit, empty);
+        if(index >= limit)
+            return bitmap::npos;
+        word = (uint64_t)(T)(words[index] ^ empty);
+    }
+
+    size_t pos = index * bits + lowbit(word);
+    return pos < size ? pos : bitmap::npos;
+}
+
+template<typename T>
+static void set_bits(T *words, size_t offset, size_t count, bool value)
+{
+    const unsigned bits = sizeof(T) * 8;
+    size_t index = offset / bits;
+    unsigned rem = offset % bits;
+
+    while(count) {
+        unsigned span = bits - rem;
+        if(span > count)
+            span = (unsigned)count;
+
+        // whole words are stored without reading them back
+        if(span == bits) {
+            words[index++] = value ? (T)(~(T)0) : (T)0;
+            count -= span;
+            continue;
+        }
+
+        T mask = (T)((((T)1 << span) - 1) << rem);
+        if(value)
+            words[index] |= mask;
+        else
+            words[index] &= (T)~mask;
+        count -= span;
+        rem = 0;
+        ++index;
+    }
+}
+
+template<typename T>
+static size_t count_bits(const T *words, size_t size)
+{
+    const unsigned bits = sizeof(T) * 8;
+    size_t limit = size / bits;
+    size_t result = 0;
+
+    for(size_t index = 0; index < limit; ++index)
+        result += popcount(words[index]);
+    if(size % bits)
+        result += popcount(words[limit] & (((T)1 << (size % bits)) - 1));
+    return result;
+}
+
+template<>
+size_t count_bits<uint64_t>(const uint64_t *words, size_t size)
+{
+    size_t limit = size / 64;
+    size_t result = 0;
+
+#ifdef  BITMAP_X86
+    if(bitmap_avx2)
+        result = count_avx2(words, limit);
+    else if(bitmap_popcnt)
+        result = count_popcnt(words, limit);
+    else
+#endif
+    for(size_t index = 0; index < limit; ++index)
+        result += popcount(words[index]);
+
+    if(size % 64)
+        result += popcount(words[limit] & ((1ull << (size % 64)) - 1));
+    return result;
+}
+
+template<typename T>
+static size_t acquire_bit(T *words, size_t size, size_t hint)
+{
+    const unsigned bits = sizeof(T) * 8;
+    size_t limit = (size + bits - 1) / bits;
+
+    if(hint >= size)
+        hint = 0;
+
+    // bits below the hint in its word are only tried after wrapping
+    size_t index = hint / bits;
+    T skipped = (T)(((T)1 << (hint % bits)) - 1);
+
+    for(size_t tries = 0; tries <= limit; ++tries) {
+        T word = __atomic_load_n(&words[index], __ATOMIC_RELAXED);
+        while((T)(word | skipped) != (T)(~(T)0)) {
+            unsigned bit = lowbit((uint64_t)(T)~(word | skipped));
+            if(index * bits + bit >= size)
+                break;
+            if(__atomic_compare_exchange_n(&words[index], &word, (T)(word | ((T)1 << bit)),
+                false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+                return index * bits + bit;
+        }
+        skipped = 0;
+        if(++index >= limit)
+            index = 0;
+    }
+    return bitmap::npos;
+}
+
+template<typename T>
+static void release_bit(T *words, size_t offset)
+{
+    const unsigned bits = sizeof(T) * 8;
+    __atomic_fetch_and(&words[offset / bits], (T)~((T)1 << (offset % bits)), __ATOMIC_RELEASE);
+}
+
 bitmap::bitmap(size_t count)
 {
-    size_t mem = count / 8;
+    size_t mem = (count + 63) / 64;
     size = count;
     bus = BMALLOC;
 
-    if(count % 8)
-        ++mem;
+    if(!mem)
+        mem = 1;
 
-    addr.a = ::malloc(mem);
+    addr.a = ::malloc(mem * sizeof(uint64_t));
+    crit(addr.a != NULL, "bitmap alloc failed");
     clear();
 }
 
@@ -44,6 +303,7 @@ bitmap::bitmap(void *ptr, size_t count, bus_t access)
     assert(ptr != NULL);
     assert(access >= BMIN && access <= BMAX);
     addr.a = ptr;
+    size = count;
     bus = access;
 }
 
@@ -57,6 +317,7 @@ bitmap::~bitmap()
 unsigned bitmap::memsize(void) const
 {
     switch(bus) {
+    case BMALLOC:
     case B64:
         return 64;
     case B32:
@@ -70,96 +331,1015 @@ unsigned bitmap::memsize(void) const
 
 void bitmap::set(size_t offset, bool bit)
 {
-    unsigned bs = memsize();
-    size_t pos = offset / bs;
-    unsigned rem = offset % bs;
-    uint64_t b64;
-    uint32_t b32;
-    uint16_t b16;
-    uint8_t b8;
-
     if(offset >= size)
         return;
 
     switch(bus) {
+    case BMALLOC:
     case B64:
-        b64 = ((uint64_t)(1))<<rem;
-        if(bit)
-            addr.d[pos] |= b64;
-        else
-            addr.d[pos] &= ~b64;
+        set_bits(addr.d, offset, 1, bit);
         break;
     case B32:
-        b32 = 1<<rem;
-        if(bit)
-            addr.l[pos] |= b32;
-        else
-            addr.l[pos] &= ~b32;
+        set_bits(addr.l, offset, 1, bit);
         break;
     case B16:
-        b16 = 1<<rem;
-        if(bit)
-            addr.w[pos] |= b16;
-        else
-            addr.w[pos] &= ~b16;
+        set_bits(addr.w, offset, 1, bit);
         break;
     default:
-        b8 = 1<<rem;
-        if(bit)
-            addr.b[pos] |= b8;
-        else
-            addr.b[pos] &= ~b8;
+        set_bits(addr.b, offset, 1, bit);
         break;
     }
 }
 
 bool bitmap::get(size_t offset) const
 {
-    unsigned bs = memsize();
-    size_t pos = offset / bs;
-    unsigned rem = offset % bs;
-
     if(offset >= size)
         return false;
 
     switch(bus) {
-#if !defined(_MSC_VER) || _MSC_VER >= 1400
+    case BMALLOC:
     case B64:
-        return (addr.d[pos] & 1ll<<rem) > 0;
-#endif
+        return (addr.d[offset / 64] >> (offset % 64)) & 1;
     case B32:
-        return (addr.l[pos] & 1l<<rem) > 0;
+        return (addr.l[offset / 32] >> (offset % 32)) & 1;
     case B16:
-        return (addr.w[pos] & 1<<rem) > 0;
+        return (addr.w[offset / 16] >> (offset % 16)) & 1;
     default:
-        return (addr.b[pos] & 1<<rem) > 0;
+        return (addr.b[offset / 8] >> (offset % 8)) & 1;
     }
 }
 
 void bitmap::clear(void)
 {
-    unsigned bs = memsize();
+    set(0, size, false);
+}
+
+void bitmap::set(size_t offset, size_t count, bool bit)
+{
+    if(offset >= size)
+        return;
 
-    if(size % bs)
-        ++size;
+    if(count > size - offset)
+        count = size - offset;
 
-    while(size--) {
-        switch(bus) {
-#if !defined(_MSC_VER) || _MSC_VER >= 1400
-        case B64:
-            *(addr.d++) = 0ll;
-            break;
-#endif
-        case B32:
-            *(addr.l++) = 0l;
+    switch(bus) {
+    case BMALLOC:
+    case B64:
+        set_bits(addr.d, offset, count, bit);
+        break;
+    case B32:
+        set_bits(addr.l, offset, count, bit);
+        break;
+    case B16:
+        set_bits(addr.w, offset, count, bit);
+        break;
+    default:
+        set_bits(addr.b, offset, count, bit);
+        break;
+    }
+}
+
+size_t bitmap::find(bool bit, size_t offset) const
+{
+    switch(bus) {
+    case BMALLOC:
+    case B64:
+        return find_bit(addr.d, size, offset, bit);
+    case B32:
+        return find_bit(addr.l, size, offset, bit);
+    case B16:
+        return find_bit(addr.w, size, offset, bit);
+    default:
+        return find_bit(addr.b, size, offset, bit);
+    }
+}
+
+size_t bitmap::count(void) const
+{
+    switch(bus) {
+    case BMALLOC:
+    case B64:
+        return count_bits(addr.d, size);
+    case B32:
+        return count_bits(addr.l, size);
+    case B16:
+        return count_bits(addr.w, size);
+    default:
+        return count_bits(addr.b, size);
+    }
+}
+
+size_t bitmap::acquire(size_t hint)
+{
+    switch(bus) {
+    case BMALLOC:
+    case B64:
+        return acquire_bit(addr.d, size, hint);
+    case B32:
+        return acquire_bit(addr.l, size, hint);
+    case B16:
+        return acquire_bit(addr.w, size, hint);
+    default:
+        return acquire_bit(addr.b, size, hint);
+    }
+}
+
+void bitmap::release(size_t offset)
+{
+    if(offset >= size)
+        return;
+
+    switch(bus) {
+    case BMALLOC:
+    case B64:
+        release_bit(addr.d, offset);
+        break;
+    case B32:
+        release_bit(addr.l, offset);
+        break;
+    case B16:
+        release_bit(addr.w, offset);
+        break;
+    default:
+        release_bit(addr.b, offset);
+        break;
+    }
+}
+
+#define SPARSE_ARRAY    0
+#define SPARSE_BITSET   1
+#define SPARSE_RUNS     2
+#define SPARSE_LIMIT    4096
+#define SPARSE_WORDS    1024
+#define SPARSE_IDS      65536
+
+// a chunk holds the low 16 bits of the ids sharing one high 16 bits.
+// arrays are sorted ids, with size their capacity; runs are pairs of
+// first and last id, with size the number of runs.  chunks are plain
+// data so the chunk list can be moved with memmove and realloc.
+class sparse_bitmap::chunk
+{
+public:
+    void *data;
+    uint32_t count;
+    uint32_t size;
+    uint16_t key;
+    uint16_t type;
+
+    inline uint16_t *ids(void) const {
+        return (uint16_t *)data;
+    }
+
+    inline uint64_t *words(void) const {
+        return (uint64_t *)data;
+    }
+
+    void create(uint16_t id);
+    void release(void);
+    void duplicate(const chunk& from);
+    size_t memory(void) const;
+    bool has(unsigned id) const;
+    unsigned next(unsigned id) const;
+    bool add(unsigned id);
+    bool remove(unsigned id);
+    uint64_t *expand(void);
+    void settle(void);
+    void fill(unsigned id, unsigned last);
+    void pack(void);
+    void merge(const chunk& from);
+    void intersect(const chunk& from);
+    void subtract(const chunk& from);
+
+private:
+    unsigned lower(unsigned id) const;
+    unsigned runs(void) const;
+    void filter(const chunk& from, bool keep);
+};
+
+void sparse_bitmap::chunk::create(uint16_t id)
+{
+    key = id;
+    type = SPARSE_ARRAY;
+    count = 0;
+    size = 4;
+    data = ::malloc(size * sizeof(uint16_t));
+    crit(data != NULL, "sparse bitmap alloc failed");
+}
+
+void sparse_bitmap::chunk::release(void)
+{
+    if(data)
+        ::free(data);
+    data = NULL;
+}
+
+size_t sparse_bitmap::chunk::memory(void) const
+{
+    switch(type) {
+    case SPARSE_BITSET:
+        return SPARSE_WORDS * sizeof(uint64_t);
+    case SPARSE_RUNS:
+        return size * 2 * sizeof(uint16_t);
+    default:
+        return size * sizeof(uint16_t);
+    }
+}
+
+void sparse_bitmap::chunk::duplicate(const chunk& from)
+{
+    *this = from;
+    size_t bytes = from.memory();
+    data = ::malloc(bytes);
+    crit(data != NULL, "sparse bitmap alloc failed");
+    memcpy(data, from.data, bytes);
+}
+
+// first array entry or run not below an id
+unsigned sparse_bitmap::chunk::lower(unsigned id) const
+{
+    const uint16_t *list = ids();
+    unsigned low = 0, high = (type == SPARSE_RUNS) ? size : count;
+    unsigned step = (type == SPARSE_RUNS) ? 2 : 1, offset = step - 1;
+
+    while(low < high) {
+        unsigned mid = (low + high) / 2;
+        if(list[mid * step + offset] < id)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+bool sparse_bitmap::chunk::has(unsigned id) const
+{
+    unsigned pos;
+
+    switch(type) {
+    case SPARSE_BITSET:
+        return (words()[id / 64] >> (id % 64)) & 1;
+    case SPARSE_RUNS:
+        pos = lower(id);
+        return pos < size && ids()[pos * 2] <= id;
+    default:
+        pos = lower(id);
+        return pos < count && ids()[pos] == id;
+    }
+}
+
+// next id in the chunk at or after an id, or SPARSE_IDS if none
+unsigned sparse_bitmap::chunk::next(unsigned id) const
+{
+    unsigned pos;
+    size_t found;
+
+    switch(type) {
+    case SPARSE_BITSET:
+        found = find_bit(words(), SPARSE_IDS, id, true);
+        return found == bitmap::npos ? SPARSE_IDS : (unsigned)found;
+    case SPARSE_RUNS:
+        pos = lower(id);
+        if(pos >= size)
+            return SPARSE_IDS;
+        return ids()[pos * 2] > id ? ids()[pos * 2] : id;
+    default:
+        pos = lower(id);
+        return pos < count ? ids()[pos] : SPARSE_IDS;
+    }
+}
+
+// convert to a dense bitset, which every chunk type can become
+uint64_t *sparse_bitmap::chunk::expand(void)
+{
+    if(type == SPARSE_BITSET)
+        return words();
+
+    uint64_t *bits = (uint64_t *)::malloc(SPARSE_WORDS * sizeof(uint64_t));
+    crit(bits != NULL, "sparse bitmap alloc failed");
+    memset(bits, 0, SPARSE_WORDS * sizeof(uint64_t));
+
+    const uint16_t *list = ids();
+    if(type == SPARSE_RUNS) {
+        for(unsigned pos = 0; pos < size; ++pos)
+            set_bits(bits, list[pos * 2], (size_t)list[pos * 2 + 1] - list[pos * 2] + 1, true);
+    }
+    else {
+        for(unsigned pos = 0; pos < count; ++pos)
+            bits[list[pos] / 64] |= (uint64_t)1 << (list[pos] % 64);
+    }
+
+    ::free(data);
+    data = bits;
+    type = SPARSE_BITSET;
+    size = SPARSE_WORDS;
+    return bits;
+}
+
+// recount a bitset, and return it to an array once small enough
+void sparse_bitmap::chunk::settle(void)
+{
+    if(type != SPARSE_BITSET)
+        return;
+
+    count = (uint32_t)count_bits(words(), SPARSE_IDS);
+    if(count > SPARSE_LIMIT)
+        return;
+
+    uint16_t *list = (uint16_t *)::malloc((count ? count : 1) * sizeof(uint16_t));
+    crit(list != NULL, "sparse bitmap alloc failed");
+    unsigned pos = 0;
+    const uint64_t *bits = words();
+    for(unsigned index = 0; index < SPARSE_WORDS; ++index) {
+        uint64_t word = bits[index];
+        while(word) {
+            list[pos++] = (uint16_t)(index * 64 + lowbit(word));
+            word &= word - 1;
+        }
+    }
+
+    ::free(data);
+    data = list;
+    type = SPARSE_ARRAY;
+    size = count ? count : 1;
+}
+
+bool sparse_bitmap::chunk::add(unsigned id)
+{
+    if(type == SPARSE_RUNS) {
+        if(has(id))
+            return false;
+        expand();
+        settle();
+    }
+
+    if(type == SPARSE_BITSET) {
+        uint64_t bit = (uint64_t)1 << (id % 64);
+        if(words()[id / 64] & bit)
+            return false;
+        words()[id / 64] |= bit;
+        ++count;
+        return true;
+    }
+
+    unsigned pos = lower(id);
+    if(pos < count && ids()[pos] == id)
+        return false;
+
+    if(count >= SPARSE_LIMIT) {
+        expand();
+        return add(id);
+    }
+
+    if(count >= size) {
+        unsigned grow = size * 2;
+        if(grow > SPARSE_LIMIT)
+            grow = SPARSE_LIMIT;
+        data = ::realloc(data, grow * sizeof(uint16_t));
+        crit(data != NULL, "sparse bitmap alloc failed");
+        size = grow;
+    }
+
+    uint16_t *list = ids();
+    memmove(list + pos + 1, list + pos, (count - pos) * sizeof(uint16_t));
+    list[pos] = (uint16_t)id;
+    ++count;
+    return true;
+}
+
+bool sparse_bitmap::chunk::remove(unsigned id)
+{
+    if(!has(id))
+        return false;
+
+    if(type == SPARSE_RUNS)
+        expand();
+
+    if(type == SPARSE_BITSET) {
+        words()[id / 64] &= ~((uint64_t)1 << (id % 64));
+        if(--count <= SPARSE_LIMIT)
+            settle();
+        return true;
+    }
+
+    unsigned pos = lower(id);
+    uint16_t *list = ids();
+    memmove(list + pos, list + pos + 1, (count - pos - 1) * sizeof(uint16_t));
+    --count;
+    return true;
+}
+
+// set every id of a chunk from id to last
+void sparse_bitmap::chunk::fill(unsigned id, unsigned last)
+{
+    if(!id && last == SPARSE_IDS - 1) {
+        uint16_t *list = (uint16_t *)::malloc(2 * sizeof(uint16_t));
+        crit(list != NULL, "sparse bitmap alloc failed");
+        list[0] = 0;
+        list[1] = SPARSE_IDS - 1;
+        ::free(data);
+        data = list;
+        type = SPARSE_RUNS;
+        size = 1;
+        count = SPARSE_IDS;
+        return;
+    }
+
+    set_bits(expand(), id, (size_t)last - id + 1, true);
+    settle();
+}
+
+// number of runs of ids in an array or bitset chunk
+unsigned sparse_bitmap::chunk::runs(void) const
+{
+    unsigned total = 0;
+
+    if(type == SPARSE_RUNS)
+        return size;
+
+    if(type == SPARSE_BITSET) {
+        const uint64_t *bits = words();
+        uint64_t carry = 0;
+        for(unsigned index = 0; index < SPARSE_WORDS; ++index) {
+            uint64_t word = bits[index];
+            total += popcount(word & ~((word << 1) | carry));
+            carry = word >> 63;
+        }
+        return total;
+    }
+
+    const uint16_t *list = ids();
+    for(unsigned pos = 0; pos < count; ++pos) {
+        if(!pos || list[pos] != list[pos - 1] + 1)
+            ++total;
+    }
+    return total;
+}
+
+// hold the chunk as runs where that is smallest, and trim arrays
+void sparse_bitmap::chunk::pack(void)
+{
+    if(type == SPARSE_RUNS)
+        return;
+
+    unsigned total = runs();
+    size_t current = (type == SPARSE_BITSET) ? SPARSE_WORDS * sizeof(uint64_t) : count * sizeof(uint16_t);
+    if(total * 2 * sizeof(uint16_t) >= current) {
+        if(type == SPARSE_ARRAY && size > count) {
+            data = ::realloc(data, count * sizeof(uint16_t));
+            crit(data != NULL, "sparse bitmap alloc failed");
+            size = count;
+        }
+        return;
+    }
+
+    uint16_t *list = (uint16_t *)::malloc(total * 2 * sizeof(uint16_t));
+    crit(list != NULL, "sparse bitmap alloc failed");
+    unsigned run = 0, id = next(0);
+    while(id < SPARSE_IDS) {
+        unsigned last = id;
+        if(type == SPARSE_BITSET) {
+            size_t end = find_bit(words(), SPARSE_IDS, id, false);
+            last = (end == bitmap::npos) ? SPARSE_IDS - 1 : (unsigned)end - 1;
+        }
+        else {
+            unsigned pos = lower(id);
+            while(pos + 1 < count && ids()[pos + 1] == last + 1) {
+                ++pos;
+                ++last;
+            }
+        }
+        list[run * 2] = (uint16_t)id;
+        list[run * 2 + 1] = (uint16_t)last;
+        ++run;
+        id = (last + 1 < SPARSE_IDS) ? next(last + 1) : SPARSE_IDS;
+    }
+
+    ::free(data);
+    data = list;
+    type = SPARSE_RUNS;
+    size = total;
+}
+
+void sparse_bitmap::chunk::merge(const chunk& from)
+{
+    if(count == SPARSE_IDS || !from.count)
+        return;
+
+    if(from.count == SPARSE_IDS) {
+        fill(0, SPARSE_IDS - 1);
+        return;
+    }
+
+    // small arrays are merged in order into a new array
+    if(type == SPARSE_ARRAY && from.type == SPARSE_ARRAY && count + from.count <= SPARSE_LIMIT) {
+        uint16_t *list = (uint16_t *)::malloc((count + from.count) * sizeof(uint16_t));
+        crit(list != NULL, "sparse bitmap alloc failed");
+        const uint16_t *left = ids(), *right = from.ids();
+        unsigned lp = 0, rp = 0, pos = 0;
+        while(lp < count || rp < from.count) {
+            if(rp >= from.count || (lp < count && left[lp] < right[rp]))
+                list[pos++] = left[lp++];
+            else if(lp >= count || right[rp] < left[lp])
+                list[pos++] = right[rp++];
+            else {
+                list[pos++] = left[lp++];
+                ++rp;
+            }
+        }
+        ::free(data);
+        data = list;
+        size = count + from.count;
+        count = pos;
+        return;
+    }
+
+    uint64_t *bits = expand();
+    const uint16_t *list = from.ids();
+    switch(from.type) {
+    case SPARSE_BITSET:
+        for(unsigned index = 0; index < SPARSE_WORDS; ++index)
+            bits[index] |= from.words()[index];
+        break;
+    case SPARSE_RUNS:
+        for(unsigned pos = 0; pos < from.size; ++pos)
+            set_bits(bits, list[pos * 2], (size_t)list[pos * 2 + 1] - list[pos * 2] + 1, true);
+        break;
+    default:
+        for(unsigned pos = 0; pos < from.count; ++pos)
+            bits[list[pos] / 64] |= (uint64_t)1 << (list[pos] % 64);
+    }
+    settle();
+}
+
+// keep array ids that are, or are not, in another chunk
+void sparse_bitmap::chunk::filter(const chunk& from, bool keep)
+{
+    uint16_t *list = ids();
+    unsigned pos = 0;
+
+    // two arrays are walked together rather than searched
+    if(from.type == SPARSE_ARRAY) {
+        const uint16_t *other = from.ids();
+        unsigned op = 0;
+        for(unsigned index = 0; index < count; ++index) {
+            while(op < from.count && other[op] < list[index])
+                ++op;
+            if((op < from.count && other[op] == list[index]) == keep)
+                list[pos++] = list[index];
+        }
+        count = pos;
+        return;
+    }
+
+    for(unsigned index = 0; index < count; ++index) {
+        if(from.has(list[index]) == keep)
+            list[pos++] = list[index];
+    }
+    count = pos;
+}
+
+void sparse_bitmap::chunk::intersect(const chunk& from)
+{
+    if(from.count == SPARSE_IDS)
+        return;
+
+    if(type != SPARSE_ARRAY && from.type == SPARSE_ARRAY) {
+        chunk other;
+        other.duplicate(from);
+        other.filter(*this, true);
+        release();
+        *this = other;
+        return;
+    }
+
+    if(type == SPARSE_ARRAY) {
+        filter(from, true);
+        return;
+    }
+
+    uint64_t *bits = expand();
+    if(from.type == SPARSE_BITSET) {
+        for(unsigned index = 0; index < SPARSE_WORDS; ++index)
+            bits[index] &= from.words()[index];
+    }
+    else {
+        // clear the gaps between runs
+        const uint16_t *list = from.ids();
+        unsigned id = 0;
+        for(unsigned pos = 0; pos < from.size; ++pos) {
+            if(list[pos * 2] > id)
+                set_bits(bits, id, list[pos * 2] - id, false);
+            id = (unsigned)list[pos * 2 + 1] + 1;
+        }
+        if(id < SPARSE_IDS)
+            set_bits(bits, id, SPARSE_IDS - id, false);
+    }
+    settle();
+}
+
+void sparse_bitmap::chunk::subtract(const chunk& from)
+{
+    if(type == SPARSE_ARRAY) {
+        filter(from, false);
+        return;
+    }
+
+    uint64_t *bits = expand();
+    const uint16_t *list = from.ids();
+    switch(from.type) {
+    case SPARSE_BITSET:
+        for(unsigned index = 0; index < SPARSE_WORDS; ++index)
+            bits[index] &= ~from.words()[index];
+        break;
+    case SPARSE_RUNS:
+        for(unsigned pos = 0; pos < from.size; ++pos)
+            set_bits(bits, list[pos * 2], (size_t)list[pos * 2 + 1] - list[pos * 2] + 1, false);
+        break;
+    default:
+        for(unsigned pos = 0; pos < from.count; ++pos)
+            bits[list[pos] / 64] &= ~((uint64_t)1 << (list[pos] % 64));
+    }
+    settle();
+}
+
+sparse_bitmap::sparse_bitmap()
+{
+    chunks = NULL;
+    used = max = 0;
+}
+
+sparse_bitmap::sparse_bitmap(const sparse_bitmap& from)
+{
+    chunks = NULL;
+    used = max = 0;
+    copy(from);
+}
+
+sparse_bitmap::~sparse_bitmap()
+{
+    clear();
+}
+
+sparse_bitmap& sparse_bitmap::operator=(const sparse_bitmap& from)
+{
+    if(&from != this) {
+        clear();
+        copy(from);
+    }
+    return *this;
+}
+
+void sparse_bitmap::copy(const sparse_bitmap& from)
+{
+    if(!from.used)
+        return;
+
+    chunk *list = (chunk *)::malloc(from.used * sizeof(chunk));
+    crit(list != NULL, "sparse bitmap alloc failed");
+    for(unsigned pos = 0; pos < from.used; ++pos)
+        list[pos].duplicate(from.chunks[pos]);
+    reset(list, from.used, from.used);
+}
+
+// replace the chunk list; chunks of the old list were moved or released
+void sparse_bitmap::reset(chunk *list, unsigned count, unsigned size)
+{
+    if(chunks)
+        ::free(chunks);
+    chunks = list;
+    used = count;
+    max = size;
+}
+
+void sparse_bitmap::clear(void)
+{
+    for(unsigned pos = 0; pos < used; ++pos)
+        chunks[pos].release();
+    reset(NULL, 0, 0);
+}
+
+unsigned sparse_bitmap::position(uint16_t key) const
+{
+    unsigned low = 0, high = used;
+
+    while(low < high) {
+        unsigned mid = (low + high) / 2;
+        if(chunks[mid].key < key)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+sparse_bitmap::chunk *sparse_bitmap::lookup(uint16_t key) const
+{
+    unsigned pos = position(key);
+    if(pos < used && chunks[pos].key == key)
+        return &chunks[pos];
+    return NULL;
+}
+
+sparse_bitmap::chunk *sparse_bitmap::insert(unsigned pos, uint16_t key)
+{
+    if(used >= max) {
+        max = max ? max * 2 : 8;
+        chunks = (chunk *)::realloc(chunks, max * sizeof(chunk));
+        crit(chunks != NULL, "sparse bitmap alloc failed");
+    }
+    memmove(&chunks[pos + 1], &chunks[pos], (used - pos) * sizeof(chunk));
+    ++used;
+    chunks[pos].create(key);
+    return &chunks[pos];
+}
+
+void sparse_bitmap::erase(unsigned pos)
+{
+    chunks[pos].release();
+    memmove(&chunks[pos], &chunks[pos + 1], (used - pos - 1) * sizeof(chunk));
+    --used;
+}
+
+bool sparse_bitmap::get(uint32_t id) const
+{
+    chunk *node = lookup((uint16_t)(id >> 16));
+    return node && node->has(id & 0xffff);
+}
+
+void sparse_bitmap::set(uint32_t id, bool value)
+{
+    uint16_t key = (uint16_t)(id >> 16);
+    unsigned pos = position(key);
+    chunk *node = (pos < used && chunks[pos].key == key) ? &chunks[pos] : NULL;
+
+    if(value) {
+        if(!node)
+            node = insert(pos, key);
+        node->add(id & 0xffff);
+    }
+    else if(node && node->remove(id & 0xffff) && !node->count)
+        erase(pos);
+}
+
+void sparse_bitmap::set(uint32_t offset, size_t count, bool value)
+{
+    uint64_t id = offset, end = (uint64_t)offset + count;
+
+    if(end > ((uint64_t)1 << 32))
+        end = (uint64_t)1 << 32;
+
+    while(id < end) {
+        uint16_t key = (uint16_t)(id >> 16);
+        unsigned first = (unsigned)(id & 0xffff);
+        unsigned last = SPARSE_IDS - 1;
+        if((end - 1) >> 16 == key)
+            last = (unsigned)((end - 1) & 0xffff);
+        id = ((uint64_t)key + 1) << 16;
+
+        unsigned pos = position(key);
+        chunk *node = (pos < used && chunks[pos].key == key) ? &chunks[pos] : NULL;
+        if(value) {
+            if(!node)
+                node = insert(pos, key);
+            node->fill(first, last);
+        }
+        else if(node && !first && last == SPARSE_IDS - 1)
+            erase(pos);
+        else if(node) {
+            set_bits(node->expand(), first, (size_t)last - first + 1, false);
+            node->settle();
+            if(!node->count)
+                erase(pos);
+        }
+    }
+}
+
+size_t sparse_bitmap::find(size_t offset) const
+{
+    if(offset > 0xffffffff)
+        return npos;
+
+    uint16_t key = (uint16_t)(offset >> 16);
+    for(unsigned pos = position(key); pos < used; ++pos) {
+        unsigned id = 0;
+        if(chunks[pos].key == key)
+            id = (unsigned)(offset & 0xffff);
+        id = chunks[pos].next(id);
+        if(id < SPARSE_IDS)
+            return ((size_t)chunks[pos].key << 16) | id;
+    }
+    return npos;
+}
+
+size_t sparse_bitmap::count(void) const
+{
+    size_t total = 0;
+    for(unsigned pos = 0; pos < used; ++pos)
+        total += chunks[pos].count;
+    return total;
+}
+
+size_t sparse_bitmap::memory(void) const
+{
+    size_t total = sizeof(sparse_bitmap) + max * sizeof(chunk);
+    for(unsigned pos = 0; pos < used; ++pos)
+        total += chunks[pos].memory();
+    return total;
+}
+
+void sparse_bitmap::optimize(void)
+{
+    for(unsigned pos = 0; pos < used; ++pos)
+        chunks[pos].pack();
+
+    if(used < max) {
+        chunk *list = used ? (chunk *)::realloc(chunks, used * sizeof(chunk)) : NULL;
+        crit(list != NULL || !used, "sparse bitmap alloc failed");
+        if(!used)
+            ::free(chunks);
+        chunks = list;
+        max = used;
+    }
+}
+
+sparse_bitmap& sparse_bitmap::operator|=(const sparse_bitmap& from)
+{
+    if(&from == this || !from.used)
+        return *this;
+
+    // merge both chunk lists in key order into a new list
+    chunk *list = (chunk *)::malloc((used + from.used) * sizeof(chunk));
+    crit(list != NULL, "sparse bitmap alloc failed");
+    unsigned lp = 0, rp = 0, pos = 0;
+    while(lp < used || rp < from.used) {
+        if(rp >= from.used || (lp < used && chunks[lp].key < from.chunks[rp].key))
+            list[pos++] = chunks[lp++];
+        else if(lp >= used || from.chunks[rp].key < chunks[lp].key)
+            list[pos++].duplicate(from.chunks[rp++]);
+        else {
+            list[pos] = chunks[lp++];
+            list[pos++].merge(from.chunks[rp++]);
+        }
+    }
+    reset(list, pos, used + from.used);
+    return *this;
+}
+
+sparse_bitmap& sparse_bitmap::operator&=(const sparse_bitmap& from)
+{
+    if(&from == this)
+        return *this;
+
+    unsigned rp = 0, pos = 0;
+    for(unsigned lp = 0; lp < used; ++lp) {
+        while(rp < from.used && from.chunks[rp].key < chunks[lp].key)
+            ++rp;
+        if(rp < from.used && from.chunks[rp].key == chunks[lp].key)
+            chunks[lp].intersect(from.chunks[rp]);
+        else
+            chunks[lp].count = 0;
+
+        if(chunks[lp].count)
+            chunks[pos++] = chunks[lp];
+        else
+            chunks[lp].release();
+    }
+    used = pos;
+    return *this;
+}
+
+sparse_bitmap& sparse_bitmap::operator-=(const sparse_bitmap& from)
+{
+    if(&from == this) {
+        clear();
+        return *this;
+    }
+
+    unsigned rp = 0, pos = 0;
+    for(unsigned lp = 0; lp < used; ++lp) {
+        while(rp < from.used && from.chunks[rp].key < chunks[lp].key)
+            ++rp;
+        if(rp < from.used && from.chunks[rp].key == chunks[lp].key)
+            chunks[lp].subtract(from.chunks[rp]);
+
+        if(chunks[lp].count)
+            chunks[pos++] = chunks[lp];
+        else
+            chunks[lp].release();
+    }
+    used = pos;
+    return *this;
+}
+
+#ifndef UCOMMON_SYSRUNTIME
+
+// chunks are written as key, type, count and size, then their data
+void sparse_bitmap::write(PersistEngine& archive) const
+{
+    archive << (uint32_t)used;
+    for(unsigned pos = 0; pos < used; ++pos) {
+        const chunk& node = chunks[pos];
+        archive << node.key << node.type << node.count;
+        switch(node.type) {
+        case SPARSE_BITSET:
+            archive << (uint32_t)SPARSE_WORDS;
+            archive.writeArray(node.words(), SPARSE_WORDS);
             break;
-        case B16:
-            *(addr.w++) = 0;
+        case SPARSE_RUNS:
+            archive << node.size;
+            archive.writeArray(node.ids(), node.size * 2);
             break;
         default:
-            *(addr.b++) = 0;
+            archive << node.count;
+            archive.writeArray(node.ids(), node.count);
+        }
+    }
+}
+
+void sparse_bitmap::read(PersistEngine& archive)
+{
+    uint32_t total, count, size;
+    uint16_t key, type;
+
+    clear();
+    archive >> total;
+    if(total > SPARSE_IDS)
+        throw(PersistException("Invalid sparse bitmap"));
+
+    // chunks are kept aside until all of them pass, so a refused archive
+    // leaves the bitmap empty
+    chunk *list = total ? (chunk *)::malloc(total * sizeof(chunk)) : NULL;
+    crit(list != NULL || !total, "sparse bitmap alloc failed");
+    unsigned loaded = 0;
+
+    try {
+        while(loaded < total) {
+            archive >> key >> type >> count >> size;
+            bool valid = (!loaded || key > list[loaded - 1].key) && count > 0 && count <= SPARSE_IDS;
+            switch(type) {
+            case SPARSE_BITSET:
+                valid = valid && size == SPARSE_WORDS;
+                break;
+            case SPARSE_RUNS:
+                valid = valid && size > 0 && size <= SPARSE_IDS / 2;
+                break;
+            case SPARSE_ARRAY:
+                valid = valid && size == count && count <= SPARSE_LIMIT;
+                break;
+            default:
+                valid = false;
+            }
+            if(!valid)
+                throw(PersistException("Invalid sparse bitmap"));
+
+            chunk& node = list[loaded];
+            node.key = key;
+            node.type = type;
+            node.count = count;
+            node.size = size;
+            node.data = ::malloc(node.memory());
+            crit(node.data != NULL, "sparse bitmap alloc failed");
+            ++loaded;
+
+            // the content must agree with its count, and be in order
+            uint32_t found = 0;
+            const uint16_t *ids = node.ids();
+            switch(type) {
+            case SPARSE_BITSET:
+                archive.readArray(node.words(), SPARSE_WORDS);
+                found = (uint32_t)count_bits(node.words(), SPARSE_IDS);
+                break;
+            case SPARSE_RUNS:
+                archive.readArray(node.ids(), size * 2);
+                for(unsigned pos = 0; pos < size; ++pos) {
+                    if(ids[pos * 2 + 1] < ids[pos * 2] || (pos && ids[pos * 2] <= ids[pos * 2 - 1] + 1))
+                        found = 0xffffffff;
+                    if(found != 0xffffffff)
+                        found += (uint32_t)ids[pos * 2 + 1] - ids[pos * 2] + 1;
+                }
+                break;
+            default:
+                archive.readArray(node.ids(), count);
+                found = count;
+                for(unsigned pos = 1; pos < count; ++pos) {
+                    if(ids[pos] <= ids[pos - 1])
+                        found = 0;
+                }
+            }
+            if(found != count)
+                throw(PersistException("Invalid sparse bitmap"));
         }
     }
+    catch(...) {
+        while(loaded)
+            list[--loaded].release();
+        if(list)
+            ::free(list);
+        throw;
+    }
+    reset(list, total, total);
 }
 
+#endif
+
 } // namespace ucommon
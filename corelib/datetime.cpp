@@ -1093,6 +1093,169 @@ final:
     return code;
 }
 
+static const char *months[] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+// days since the epoch of a civil date, to find the local time offset
+static long civil(int year, int month, int day)
+{
+    if(month <= 2)
+        --year;
+    long era = (year >= 0 ? year : year - 399) / 400;
+    long yoe = year - era * 400;
+    long doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097l + doe - 719468l;
+}
+
+TimeStamp::TimeStamp(format_t format, unsigned precision)
+{
+    mode = format;
+    digits = precision;
+    cache.length = 0;
+    buffer[0] = 0;
+}
+
+size_t TimeStamp::put(cache_t *cache, format_t format, unsigned digits,
+    const struct timeval *tv, char *buffer, size_t size)
+{
+    assert(cache != NULL && tv != NULL && buffer != NULL);
+
+    if(digits > 6)
+        digits = 6;
+
+    if(!cache->length || cache->second != tv->tv_sec) {
+        time_t sec = tv->tv_sec;
+        tm_t dt;
+        int len;
+
+        if(format == UTC) {
+#ifdef  HAVE_GMTIME_R
+            gmtime_r(&sec, &dt);
+#else
+            dt = *gmtime(&sec);
+#endif
+        }
+        else {
+#ifdef  HAVE_LOCALTIME_R
+            localtime_r(&sec, &dt);
+#else
+            dt = *localtime(&sec);
+#endif
+        }
+
+        cache->zone = 0;
+        switch(format) {
+        case SYSLOG:
+            len = snprintf(cache->prefix, sizeof(cache->prefix), "%s %2d %02d:%02d:%02d",
+                months[dt.tm_mon % 12], dt.tm_mday, dt.tm_hour, dt.tm_min, dt.tm_sec);
+            break;
+        case LOCAL:
+            len = snprintf(cache->prefix, sizeof(cache->prefix), "%04d-%02d-%02d %02d:%02d:%02d",
+                dt.tm_year + 1900, dt.tm_mon + 1, dt.tm_mday, dt.tm_hour, dt.tm_min, dt.tm_sec);
+            break;
+        default:
+            len = snprintf(cache->prefix, sizeof(cache->prefix), "%04d-%02d-%02dT%02d:%02d:%02d",
+                dt.tm_year + 1900, dt.tm_mon + 1, dt.tm_mday, dt.tm_hour, dt.tm_min, dt.tm_sec);
+            if(format == UTC) {
+                cache->suffix[0] = 'Z';
+                cache->zone = 1;
+                break;
+            }
+            long offset = civil(dt.tm_year + 1900, dt.tm_mon + 1, dt.tm_mday) * 86400l +
+                dt.tm_hour * 3600l + dt.tm_min * 60l + dt.tm_sec - (long)sec;
+            char sign = '+';
+            if(offset < 0) {
+                sign = '-';
+                offset = -offset;
+            }
+            // zone offsets are less than a day, kept to what fits hh:mm
+            if(offset < 0 || offset > 86399)
+                offset = 86399;
+            int minutes = (int)(offset / 60);
+            snprintf(cache->suffix, sizeof(cache->suffix), "%c%02d:%02d", sign, minutes / 60, minutes % 60);
+            cache->zone = 6;
+        }
+
+        if(len < 1 || len >= (int)sizeof(cache->prefix)) {
+            cache->length = 0;
+            if(size)
+                *buffer = 0;
+            return 0;
+        }
+        cache->length = len;
+        cache->second = tv->tv_sec;
+    }
+
+    size_t need = cache->length + cache->zone;
+    if(digits)
+        need += digits + 1;
+    if(size <= need) {
+        if(size)
+            *buffer = 0;
+        return 0;
+    }
+
+    char *out = buffer + cache->length;
+    memcpy(buffer, cache->prefix, cache->length);
+    if(digits) {
+        unsigned long fraction = (unsigned long)tv->tv_usec;
+        for(unsigned pos = digits; pos < 6; ++pos)
+            fraction /= 10;
+        *(out++) = '.';
+        for(unsigned pos = digits; pos > 0; --pos) {
+            out[pos - 1] = (char)('0' + fraction % 10);
+            fraction /= 10;
+        }
+        out += digits;
+    }
+    memcpy(out, cache->suffix, cache->zone);
+    out[cache->zone] = 0;
+    return need;
+}
+
+const char *TimeStamp::set(void)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    put(&cache, mode, digits, &now, buffer, sizeof(buffer));
+    return buffer;
+}
+
+const char *TimeStamp::set(const struct timeval *tv)
+{
+    put(&cache, mode, digits, tv, buffer, sizeof(buffer));
+    return buffer;
+}
+
+size_t TimeStamp::put(char *text, size_t size)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return put(&cache, mode, digits, &now, text, size);
+}
+
+size_t TimeStamp::put(char *text, size_t size, const struct timeval *tv)
+{
+    return put(&cache, mode, digits, tv, text, size);
+}
+
+size_t TimeStamp::format(char *text, size_t size, format_t format, unsigned digits)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+#if defined(__GNUC__) && !defined(_MSWINDOWS_)
+    static __thread cache_t local[4];
+    return put(&local[format & 3], format, digits, &now, text, size);
+#else
+    cache_t local;
+    local.length = 0;
+    return put(&local, format, digits, &now, text, size);
+#endif
+}
+
 extern "C" {
     long tzoffset(struct timezone *tz)
     {
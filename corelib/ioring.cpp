@@ -0,0 +1,671 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ucommon-config.h>
+#include <ucommon/export.h>
+#include <ucommon/timers.h>
+#include <ucommon/socket.h>
+#include <ucommon/fsys.h>
+#include <ucommon/ioring.h>
+
+#include <errno.h>
+#include <string.h>
+#ifdef  HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if defined(HAVE_LINUX_IO_URING_H) && defined(HAVE_SYS_MMAN_H)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <poll.h>
+// operations used here are all in kernels with fast poll
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_FAST_POLL)
+#define IORING_KERNEL
+#endif
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define IORING_FIXED    64
+#define IORING_DRAIN    100
+
+namespace ucommon {
+
+typedef enum {
+    OP_READ, OP_WRITE, OP_RECV, OP_SEND, OP_ACCEPT, OP_CONNECT
+} op_t;
+
+// requests performed in turn when submitted, where io_uring is missing
+class IORing::fallback
+{
+public:
+    typedef struct {
+        op_t op;
+        fsys *file;
+        socket_t so;
+        void *buffer;
+        size_t size;
+        fsys::offset_t offset;
+        const struct sockaddr *address;
+        void *user;
+    } request_t;
+
+    request_t *queue;
+    completion_t *done;
+    unsigned depth, queued, completed, head;
+
+    fallback(unsigned size);
+    ~fallback();
+
+    bool add(op_t op, fsys *file, socket_t so, void *buffer, size_t size,
+        fsys::offset_t offset, const struct sockaddr *address, void *user);
+
+    unsigned submit(void);
+    unsigned collect(completion_t *list, unsigned count);
+
+    static ssize_t perform(const request_t *req);
+};
+
+IORing::fallback::fallback(unsigned size)
+{
+    depth = size;
+    queue = new request_t[size];
+    done = new completion_t[size];
+    queued = completed = head = 0;
+}
+
+IORing::fallback::~fallback()
+{
+    delete[] queue;
+    delete[] done;
+}
+
+bool IORing::fallback::add(op_t op, fsys *file, socket_t so, void *buffer, size_t size,
+    fsys::offset_t offset, const struct sockaddr *address, void *user)
+{
+    if(queued + completed >= depth)
+        return false;
+
+    request_t *req = &queue[queued++];
+    req->op = op;
+    req->file = file;
+    req->so = so;
+    req->buffer = buffer;
+    req->size = size;
+    req->offset = offset;
+    req->address = address;
+    req->user = user;
+    return true;
+}
+
+ssize_t IORing::fallback::perform(const request_t *req)
+{
+    ssize_t result = -1;
+
+    switch(req->op) {
+    case OP_READ:
+#ifdef  _MSWINDOWS_
+        if(!req->file->seek(req->offset))
+            result = req->file->read(req->buffer, req->size);
+#else
+        result = ::pread(req->file->handle(), req->buffer, req->size, req->offset);
+#endif
+        break;
+    case OP_WRITE:
+#ifdef  _MSWINDOWS_
+        if(!req->file->seek(req->offset))
+            result = req->file->write(req->buffer, req->size);
+#else
+        result = ::pwrite(req->file->handle(), req->buffer, req->size, req->offset);
+#endif
+        break;
+    case OP_RECV:
+        result = ::recv(req->so, (caddr_t)req->buffer, req->size, 0);
+        break;
+    case OP_SEND:
+        result = ::send(req->so, (caddr_t)req->buffer, req->size, MSG_NOSIGNAL);
+        break;
+    case OP_ACCEPT:
+        result = (ssize_t)Socket::acceptfrom(req->so);
+        if(result == (ssize_t)INVALID_SOCKET)
+            result = -1;
+        break;
+    case OP_CONNECT:
+        result = ::connect(req->so, req->address, Socket::len(req->address));
+        break;
+    }
+
+    if(result < 0) {
+#ifdef  _MSWINDOWS_
+        result = -(ssize_t)Socket::error();
+#else
+        result = -(ssize_t)errno;
+#endif
+    }
+    return result;
+}
+
+unsigned IORing::fallback::submit(void)
+{
+    unsigned count = queued;
+    for(unsigned pos = 0; pos < queued; ++pos) {
+        completion_t *cp = &done[(head + completed++) % depth];
+        cp->user = queue[pos].user;
+        cp->result = perform(&queue[pos]);
+    }
+    queued = 0;
+    return count;
+}
+
+unsigned IORing::fallback::collect(completion_t *list, unsigned count)
+{
+    unsigned total = 0;
+    while(total < count && completed) {
+        list[total++] = done[head];
+        head = (head + 1) % depth;
+        --completed;
+    }
+    return total;
+}
+
+#ifdef  IORING_KERNEL
+
+static inline unsigned acquire(const unsigned *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline void release(unsigned *ptr, unsigned value)
+{
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+class IORing::engine
+{
+public:
+    int fd;
+    struct io_uring_params params;
+    caddr_t sqmap, cqmap;
+    size_t sqsize, cqsize;
+    struct io_uring_sqe *sqes;
+    unsigned *sqhead, *sqtail, *sqmask, *sqarray;
+    unsigned *cqhead, *cqtail, *cqmask;
+    struct io_uring_cqe *cqes;
+    unsigned queued, inflight;
+
+    int files[IORING_FIXED];
+    unsigned nfiles;
+    struct iovec buffers[IORING_FIXED];
+    unsigned nbuffers;
+
+    engine();
+    ~engine();
+
+    bool create(unsigned depth);
+
+    struct io_uring_sqe *get(int fd, bool cancel = false);
+    int buffer(const void *address, size_t size);
+    bool cancel(void);
+    unsigned submit(unsigned wait);
+    unsigned collect(IORing::completion_t *list, unsigned count);
+};
+
+IORing::engine::engine()
+{
+    fd = -1;
+    sqmap = cqmap = NULL;
+    sqes = NULL;
+    queued = inflight = 0;
+    nfiles = nbuffers = 0;
+}
+
+IORing::engine::~engine()
+{
+    if(sqes)
+        munmap(sqes, params.sq_entries * sizeof(struct io_uring_sqe));
+    if(cqmap && cqmap != sqmap)
+        munmap(cqmap, cqsize);
+    if(sqmap)
+        munmap(sqmap, sqsize);
+    if(fd > -1)
+        ::close(fd);
+}
+
+bool IORing::engine::create(unsigned depth)
+{
+    memset(&params, 0, sizeof(params));
+    fd = (int)syscall(__NR_io_uring_setup, depth, &params);
+    if(fd < 0 || !(params.features & IORING_FEAT_FAST_POLL))
+        return false;
+
+    sqsize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqsize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        if(cqsize > sqsize)
+            sqsize = cqsize;
+        cqsize = sqsize;
+    }
+
+    sqmap = (caddr_t)mmap(NULL, sqsize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if(sqmap == (caddr_t)MAP_FAILED) {
+        sqmap = NULL;
+        return false;
+    }
+
+    if(params.features & IORING_FEAT_SINGLE_MMAP)
+        cqmap = sqmap;
+    else {
+        cqmap = (caddr_t)mmap(NULL, cqsize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if(cqmap == (caddr_t)MAP_FAILED) {
+            cqmap = NULL;
+            return false;
+        }
+    }
+
+    sqes = (struct io_uring_sqe *)mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe),
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if(sqes == (struct io_uring_sqe *)MAP_FAILED) {
+        sqes = NULL;
+        return false;
+    }
+
+    sqhead = (unsigned *)(sqmap + params.sq_off.head);
+    sqtail = (unsigned *)(sqmap + params.sq_off.tail);
+    sqmask = (unsigned *)(sqmap + params.sq_off.ring_mask);
+    sqarray = (unsigned *)(sqmap + params.sq_off.array);
+    cqhead = (unsigned *)(cqmap + params.cq_off.head);
+    cqtail = (unsigned *)(cqmap + params.cq_off.tail);
+    cqmask = (unsigned *)(cqmap + params.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe *)(cqmap + params.cq_off.cqes);
+    return true;
+}
+
+struct io_uring_sqe *IORing::engine::get(int handle, bool cancel)
+{
+    // completions are never allowed to overflow the completion ring, and
+    // one is kept back to cancel requests with
+    if(queued + inflight + (cancel ? 0 : 1) >= params.cq_entries)
+        return NULL;
+
+    // a full submission ring that cannot be passed on has no room
+    if(queued >= params.sq_entries && (!submit(0) || queued >= params.sq_entries))
+        return NULL;
+
+    unsigned tail = *sqtail;
+    unsigned index = tail & *sqmask;
+    struct io_uring_sqe *sqe = &sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = handle;
+    for(unsigned pos = 0; pos < nfiles; ++pos) {
+        if(files[pos] == handle) {
+            sqe->fd = (int)pos;
+            sqe->flags |= IOSQE_FIXED_FILE;
+            break;
+        }
+    }
+
+    sqarray[index] = index;
+    release(sqtail, tail + 1);
+    ++queued;
+    return sqe;
+}
+
+int IORing::engine::buffer(const void *address, size_t size)
+{
+    const char *cp = (const char *)address;
+    for(unsigned pos = 0; pos < nbuffers; ++pos) {
+        const char *base = (const char *)buffers[pos].iov_base;
+        if(cp >= base && cp + size <= base + buffers[pos].iov_len)
+            return (int)pos;
+    }
+    return -1;
+}
+
+bool IORing::engine::cancel(void)
+{
+#ifdef  IORING_ASYNC_CANCEL_ANY
+    if(!inflight)
+        return false;
+
+    struct io_uring_sqe *sqe = get(-1, true);
+    if(!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+    return submit(0) > 0;
+#else
+    return false;
+#endif
+}
+
+unsigned IORing::engine::submit(unsigned wait)
+{
+    unsigned flags = 0;
+    if(wait)
+        flags |= IORING_ENTER_GETEVENTS;
+
+    if(!queued && !wait)
+        return 0;
+
+    int result;
+    do {
+        result = (int)syscall(__NR_io_uring_enter, fd, queued, wait, flags, NULL, 0);
+    } while(result < 0 && errno == EINTR);
+
+    if(result < 0)
+        return 0;
+
+    queued -= (unsigned)result;
+    inflight += (unsigned)result;
+    return (unsigned)result;
+}
+
+unsigned IORing::engine::collect(IORing::completion_t *list, unsigned count)
+{
+    unsigned head = *cqhead;
+    unsigned tail = acquire(cqtail);
+    unsigned total = 0;
+
+    while(head != tail && total < count) {
+        struct io_uring_cqe *cqe = &cqes[head & *cqmask];
+        list[total].user = (void *)(uintptr_t)cqe->user_data;
+        list[total].result = cqe->res;
+        ++total;
+        ++head;
+    }
+    release(cqhead, head);
+    inflight -= total;
+    return total;
+}
+
+#else
+
+class IORing::engine
+{
+};
+
+#endif
+
+IORing::IORing(unsigned depth)
+{
+    ring = NULL;
+    list = NULL;
+
+    if(depth < 2)
+        depth = 2;
+
+#ifdef  IORING_KERNEL
+    ring = new engine();
+    if(ring->create(depth))
+        return;
+
+    delete ring;
+    ring = NULL;
+#endif
+
+    list = new fallback(depth);
+}
+
+IORing::~IORing()
+{
+#ifdef  IORING_KERNEL
+    if(ring) {
+        // a receive or accept on an idle socket may never complete, so
+        // requests are cancelled and only waited for while they finish;
+        // closing the ring cancels anything that is left
+        completion_t done[16];
+        ring->submit(0);
+        ring->cancel();
+        while(ring->queued || ring->inflight) {
+            if(!wait(done, 16, IORING_DRAIN))
+                break;
+        }
+        delete ring;
+    }
+#endif
+    if(list)
+        delete list;
+}
+
+bool IORing::is_kernel(void) const
+{
+    return ring != NULL;
+}
+
+bool IORing::fixed(int fd)
+{
+#ifdef  IORING_KERNEL
+    if(!ring || ring->nfiles >= IORING_FIXED || fd < 0)
+        return false;
+
+    // a sparse table is registered first, and slots then filled in
+    if(!ring->nfiles) {
+        int table[IORING_FIXED];
+        for(unsigned pos = 0; pos < IORING_FIXED; ++pos)
+            table[pos] = -1;
+        if(syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_FILES, table, IORING_FIXED) < 0)
+            return false;
+    }
+
+    struct io_uring_files_update update;
+    memset(&update, 0, sizeof(update));
+    update.offset = ring->nfiles;
+    update.fds = (uintptr_t)&fd;
+    if(syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_FILES_UPDATE, &update, 1) < 1)
+        return false;
+
+    ring->files[ring->nfiles++] = fd;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool IORing::fixed(void *address, size_t size)
+{
+#ifdef  IORING_KERNEL
+    if(!ring || ring->nbuffers >= IORING_FIXED || !address || !size)
+        return false;
+
+    if(ring->nbuffers)
+        syscall(__NR_io_uring_register, ring->fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+
+    ring->buffers[ring->nbuffers].iov_base = address;
+    ring->buffers[ring->nbuffers].iov_len = size;
+    if(syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, ring->buffers, ring->nbuffers + 1) < 0) {
+        if(ring->nbuffers)
+            syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, ring->buffers, ring->nbuffers);
+        return false;
+    }
+    ++ring->nbuffers;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool IORing::read(fsys& file, void *buffer, size_t size, fsys::offset_t offset, void *user)
+{
+#ifdef  IORING_KERNEL
+    if(ring) {
+        struct io_uring_sqe *sqe = ring->get(file.handle());
+        if(!sqe)
+            return false;
+        int index = ring->buffer(buffer, size);
+        sqe->opcode = IORING_OP_READ;
+        if(index > -1) {
+            sqe->opcode = IORING_OP_READ_FIXED;
+            sqe->buf_index = (uint16_t)index;
+        }
+        sqe->addr = (uintptr_t)buffer;
+        sqe->len = (uint32_t)size;
+        sqe->off = (uint64_t)offset;
+        sqe->user_data = (uintptr_t)user;
+        return true;
+    }
+#endif
+    return list->add(OP_READ, &file, INVALID_SOCKET, buffer, size, offset, NULL, user);
+}
+
+bool IORing::write(fsys& file, const void *buffer, size_t size, fsys::offset_t offset, void *user)
+{
+#ifdef  IORING_KERNEL
+    if(ring) {
+        struct io_uring_sqe *sqe = ring->get(file.handle());
+        if(!sqe)
+            return false;
+        int index = ring->buffer(buffer, size);
+        sqe->opcode = IORING_OP_WRITE;
+        if(index > -1) {
+            sqe->opcode = IORING_OP_WRITE_FIXED;
+            sqe->buf_index = (uint16_t)index;
+        }
+        sqe->addr = (uintptr_t)buffer;
+        sqe->len = (uint32_t)size;
+        sqe->off = (uint64_t)offset;
+        sqe->user_data = (uintptr_t)user;
+        return true;
+    }
+#endif
+    return list->add(OP_WRITE, &file, INVALID_SOCKET, (void *)buffer, size, offset, NULL, user);
+}
+
+bool IORing::recv(socket_t so, void *buffer, size_t size, void *user)
+{
+#ifdef  IORING_KERNEL
+    if(ring) {
+        struct io_uring_sqe *sqe = ring->get((int)so);
+        if(!sqe)
+            return false;
+        sqe->opcode = IORING_OP_RECV;
+        sqe->addr = (uintptr_t)buffer;
+        sqe->len = (uint32_t)size;
+        sqe->user_data = (uintptr_t)user;
+        return true;
+    }
+#endif
+    return list->add(OP_RECV, NULL, so, buffer, size, 0, NULL, user);
+}
+
+bool IORing::send(socket_t so, const void *buffer, size_t size, void *user)
+{
+#ifdef  IORING_KERNEL
+    if(ring) {
+        struct io_uring_sqe *sqe = ring->get((int)so);
+        if(!sqe)
+            return false;
+        sqe->opcode = IORING_OP_SEND;
+        sqe->addr = (uintptr_t)buffer;
+        sqe->len = (uint32_t)size;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = (uintptr_t)user;
+        return true;
+    }
+#endif
+    return list->add(OP_SEND, NULL, so, (void *)buffer, size, 0, NULL, user);
+}
+
+bool IORing::accept(socket_t so, void *user)
+{
+#ifdef  IORING_KERNEL
+    if(ring) {
+        struct io_uring_sqe *sqe = ring->get((int)so);
+        if(!sqe)
+            return false;
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->user_data = (uintptr_t)user;
+        return true;
+    }
+#endif
+    return list->add(OP_ACCEPT, NULL, so, NULL, 0, 0, NULL, user);
+}
+
+bool IORing::connect(socket_t so, const struct sockaddr *address, void *user)
+{
+#ifdef  IORING_KERNEL
+    if(ring) {
+        struct io_uring_sqe *sqe = ring->get((int)so);
+        if(!sqe)
+            return false;
+        sqe->opcode = IORING_OP_CONNECT;
+        sqe->addr = (uintptr_t)address;
+        sqe->off = Socket::len(address);
+        sqe->user_data = (uintptr_t)user;
+        return true;
+    }
+#endif
+    return list->add(OP_CONNECT, NULL, so, NULL, 0, 0, address, user);
+}
+
+unsigned IORing::submit(void)
+{
+#ifdef  IORING_KERNEL
+    if(ring)
+        return ring->submit(0);
+#endif
+    return list->submit();
+}
+
+unsigned IORing::wait(completion_t *completions, unsigned count, timeout_t timeout)
+{
+    if(!completions || !count)
+        return 0;
+
+#ifdef  IORING_KERNEL
+    if(ring) {
+        unsigned total = ring->collect(completions, count);
+        if(total || (!ring->queued && !ring->inflight))
+            return total;
+
+        if(timeout == Timer::inf)
+            ring->submit(1);
+        else {
+            ring->submit(0);
+            total = ring->collect(completions, count);
+            if(total || !timeout)
+                return total;
+            struct pollfd pfd;
+            pfd.fd = ring->fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if(::poll(&pfd, 1, (int)timeout) < 1)
+                return 0;
+        }
+        return ring->collect(completions, count);
+    }
+#endif
+    list->submit();
+    return list->collect(completions, count);
+}
+
+unsigned IORing::pending(void) const
+{
+#ifdef  IORING_KERNEL
+    if(ring)
+        return ring->queued + ring->inflight;
+#endif
+    return list->queued + list->completed;
+}
+
+} // namespace ucommon
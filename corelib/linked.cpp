@@ -93,17 +93,6 @@ void MultiMap::enlist(unsigned path, MultiMap **root, caddr_t key, unsigned max,
     assert(key != NULL);
     assert(max > 0);
 
-    unsigned value = 0;
-
-    delist(path);
-    while(keysize && !key[0]) {
-        ++key;
-        --keysize;
-    }
-
-    while(keysize--)
-        value = (value << 1) ^ (*key++);
-
     enlist(path, &root[keyindex(key, max, keysize)]);
 
     if(!keysize)
@@ -260,6 +249,8 @@ OrderedObject()
                 prior->Next = node->getNext();
             else
                 root->head = node->getNext();
+            if(root->tail == node)
+                root->tail = prior;
             node->release();
             break;
         }
@@ -270,10 +261,9 @@ OrderedObject()
     Id = nid;
     if(!root->head)
         root->head = this;
-    if(!root->tail)
-        root->tail = this;
     else
         root->tail->Next = this;
+    root->tail = this;
 }
 
 // One thing to watch out for is that the id is freed in the destructor.
@@ -388,12 +378,29 @@ unsigned NamedObject::keyindex(const char *id, unsigned max)
     assert(id != NULL && *id != 0);
     assert(max > 1);
 
-    unsigned val = 0;
+    return keyhash(id) % max;
+}
 
-    while(*id)
-        val = (val << 1) ^ (*(id++) & 0x1f);
+unsigned NamedObject::keyhash(const char *id)
+{
+    assert(id != NULL);
+
+    uint32_t val = 2166136261u;
+
+    // fnv-1a over case folded text, then mixed so low bits are usable
+    while(*id) {
+        uint8_t ch = (uint8_t)*(id++);
+        if(ch >= 'A' && ch <= 'Z')
+            ch += 'a' - 'A';
+        val = (val ^ ch) * 16777619u;
+    }
 
-    return val % max;
+    val ^= val >> 16;
+    val *= 0x85ebca6bu;
+    val ^= val >> 13;
+    val *= 0xc2b2ae35u;
+    val ^= val >> 16;
+    return (unsigned)val;
 }
 
 int NamedObject::compare(const char *cid) const
@@ -567,6 +574,344 @@ NamedObject *NamedObject::remove(NamedObject **root, const char *id)
     return node;
 }
 
+HashIndex::HashIndex(unsigned size)
+{
+    table = NULL;
+    mask = used = 0;
+    if(size)
+        reserve(size);
+}
+
+HashIndex::~HashIndex()
+{
+    if(table)
+        free(table);
+}
+
+void HashIndex::resize(unsigned size)
+{
+    slot_t *prior = table;
+    unsigned slots = prior ? mask + 1 : 0;
+
+    table = (slot_t *)calloc(size, sizeof(slot_t));
+    crit(table != NULL, "hash index alloc failed");
+
+    mask = size - 1;
+    used = 0;
+
+    for(unsigned pos = 0; pos < slots; ++pos) {
+        if(prior[pos].node)
+            insert(prior[pos].node, prior[pos].hash);
+    }
+
+    if(prior)
+        free(prior);
+}
+
+void HashIndex::reserve(unsigned size)
+{
+    unsigned slots = 16;
+
+    // tables are kept no more than 7/8 full
+    while(slots - slots / 8 < size)
+        slots <<= 1;
+
+    if(!table || slots > mask + 1)
+        resize(slots);
+}
+
+void HashIndex::insert(NamedObject *node, unsigned hash)
+{
+    unsigned pos = hash & mask, dist = 0;
+
+    // robin hood: take the slot of any entry nearer its home than we are
+    for(;;) {
+        slot_t *slot = &table[pos];
+        if(!slot->node) {
+            slot->node = node;
+            slot->hash = hash;
+            ++used;
+            return;
+        }
+
+        unsigned other = (pos - (slot->hash & mask)) & mask;
+        if(other < dist) {
+            NamedObject *swap = slot->node;
+            unsigned value = slot->hash;
+            slot->node = node;
+            slot->hash = hash;
+            node = swap;
+            hash = value;
+            dist = other;
+        }
+        pos = (pos + 1) & mask;
+        ++dist;
+    }
+}
+
+HashIndex::slot_t *HashIndex::lookup(const char *id, unsigned hash) const
+{
+    if(!table)
+        return NULL;
+
+    unsigned pos = hash & mask, dist = 0;
+
+    for(;;) {
+        slot_t *slot = &table[pos];
+        if(!slot->node || ((pos - (slot->hash & mask)) & mask) < dist)
+            return NULL;
+        if(slot->hash == hash && slot->node->equal(id))
+            return slot;
+        pos = (pos + 1) & mask;
+        ++dist;
+    }
+}
+
+NamedObject *HashIndex::find(const char *id) const
+{
+    assert(id != NULL && *id != 0);
+
+    slot_t *slot = lookup(id, NamedObject::keyhash(id));
+    if(!slot)
+        return NULL;
+
+    return slot->node;
+}
+
+void HashIndex::add(NamedObject *node, char *id)
+{
+    assert(node != NULL);
+
+    if(id) {
+        node->clearId();
+        node->Id = id;
+    }
+
+    assert(node->Id != NULL && *node->Id != 0);
+
+    unsigned hash = NamedObject::keyhash(node->Id);
+    slot_t *slot = lookup(node->Id, hash);
+
+    if(slot) {
+        NamedObject *prior = slot->node;
+        slot->node = node;
+        if(prior != node)
+            prior->release();
+        return;
+    }
+
+    reserve(used + 1);
+    insert(node, hash);
+}
+
+NamedObject *HashIndex::remove(const char *id)
+{
+    assert(id != NULL && *id != 0);
+
+    slot_t *slot = lookup(id, NamedObject::keyhash(id));
+    if(!slot)
+        return NULL;
+
+    NamedObject *node = slot->node;
+    unsigned pos = (unsigned)(slot - table);
+
+    // shift following entries back rather than leave a tombstone
+    for(;;) {
+        unsigned after = (pos + 1) & mask;
+        slot_t *next = &table[after];
+        if(!next->node || ((after - (next->hash & mask)) & mask) == 0)
+            break;
+        table[pos] = *next;
+        pos = after;
+    }
+
+    table[pos].node = NULL;
+    table[pos].hash = 0;
+    --used;
+    return node;
+}
+
+NamedObject *HashIndex::next(NamedObject *current) const
+{
+    if(!table)
+        return NULL;
+
+    unsigned pos = 0;
+
+    if(current) {
+        slot_t *slot = lookup(current->Id, NamedObject::keyhash(current->Id));
+        if(!slot)
+            return NULL;
+        pos = (unsigned)(slot - table) + 1;
+    }
+
+    while(pos <= mask) {
+        if(table[pos].node)
+            return table[pos].node;
+        ++pos;
+    }
+    return NULL;
+}
+
+NamedObject **HashIndex::index(void) const
+{
+    NamedObject **op = new NamedObject *[used + 1];
+    unsigned count = 0;
+
+    for(unsigned pos = 0; table && pos <= mask; ++pos) {
+        if(table[pos].node)
+            op[count++] = table[pos].node;
+    }
+    op[count] = NULL;
+    return op;
+}
+
+void HashIndex::clear(void)
+{
+    if(table)
+        memset(table, 0, sizeof(slot_t) * (mask + 1));
+    used = 0;
+}
+
+void HashIndex::purge(void)
+{
+    for(unsigned pos = 0; table && pos <= mask; ++pos) {
+        if(table[pos].node)
+            table[pos].node->release();
+    }
+    clear();
+}
+
+// Indexes and path caches are only made or dropped by explicit calls, and
+// cache entries are filled under a lock, so lookups are safe for concurrent
+// readers.  A change below a node drops the path cache of that node and of
+// those above it, but leaves other trees alone.
+
+class NamedTree::lookup
+{
+public:
+    typedef struct {
+        char *path;
+        NamedTree *node;
+        unsigned hash;
+        unsigned long changes;
+    } entry_t;
+
+    HashIndex children;
+    bool active;
+    unsigned shadowed;
+    entry_t *paths;
+    unsigned mask;
+    unsigned long changes;
+    Mutex lock;
+
+    lookup();
+    ~lookup();
+
+    void attach(NamedTree *node, bool head);
+    void detach(NamedTree *parent, NamedTree *node);
+    void cache(unsigned size);
+};
+
+NamedTree::lookup::lookup() :
+children()
+{
+    active = false;
+    shadowed = 0;
+    paths = NULL;
+    mask = 0;
+    changes = 0;
+}
+
+NamedTree::lookup::~lookup()
+{
+    cache(0);
+}
+
+// the first child listed under a name is the one indexed, and others
+// sharing it are counted so they may be found again when it is removed.
+
+void NamedTree::lookup::attach(NamedTree *node, bool head)
+{
+    if(!active || !node->Id)
+        return;
+
+    NamedObject *prior = children.find(node->Id);
+    if(!prior) {
+        children.add(node);
+        return;
+    }
+
+    ++shadowed;
+    if(head) {
+        children.remove(node->Id);
+        children.add(node);
+    }
+}
+
+void NamedTree::lookup::detach(NamedTree *parent, NamedTree *node)
+{
+    if(!active || !node->Id)
+        return;
+
+    NamedObject *prior = children.find(node->Id);
+    if(prior != node) {
+        if(prior && shadowed)
+            --shadowed;
+        return;
+    }
+
+    children.remove(node->Id);
+    if(!shadowed)
+        return;
+
+    linked_pointer<NamedTree> child = parent->Child.begin();
+    while(child) {
+        if(*child != node && eq(child->Id, node->Id)) {
+            children.add(*child);
+            --shadowed;
+            return;
+        }
+        child.next();
+    }
+}
+
+void NamedTree::lookup::cache(unsigned size)
+{
+    for(unsigned pos = 0; paths && pos <= mask; ++pos) {
+        if(paths[pos].path)
+            free(paths[pos].path);
+    }
+
+    if(paths)
+        free(paths);
+
+    paths = NULL;
+    mask = 0;
+
+    if(!size)
+        return;
+
+    unsigned slots = 1;
+    while(slots < size)
+        slots <<= 1;
+
+    paths = (entry_t *)calloc(slots, sizeof(entry_t));
+    crit(paths != NULL, "path cache alloc failed");
+    mask = slots - 1;
+}
+
+void NamedTree::changed(NamedTree *node)
+{
+    while(node) {
+        if(node->Lookup && node->Lookup->paths) {
+            Mutex::autolock exclusive(&node->Lookup->lock);
+            ++node->Lookup->changes;
+        }
+        node = node->Parent;
+    }
+}
+
 // Like in NamedObject, the nid that is used will be deleted by the
 // destructor through calling purge.  Hence it should be passed from
 // a malloc'd or strdup'd string.
@@ -576,6 +921,7 @@ NamedObject(), Child()
 {
     Id = nid;
     Parent = NULL;
+    Lookup = NULL;
 }
 
 NamedTree::NamedTree(const NamedTree& source)
@@ -583,6 +929,7 @@ NamedTree::NamedTree(const NamedTree& source)
     Id = source.Id;
     Parent = NULL;
     Child = source.Child;
+    Lookup = NULL;
 }
 
 NamedTree::NamedTree(NamedTree *p, char *nid) :
@@ -594,10 +941,17 @@ NamedObject(), Child()
     enlistTail(&p->Child);
     Id = nid;
     Parent = p;
+    Lookup = NULL;
+    if(p->Lookup)
+        p->Lookup->attach(this, false);
+    changed(p);
 }
 
 NamedTree::~NamedTree()
 {
+    if(Parent && Parent->Lookup)
+        Parent->Lookup->detach(Parent, this);
+
     Id = NULL;
     purge();
 }
@@ -606,14 +960,55 @@ NamedTree *NamedTree::getChild(const char *tid) const
 {
     assert(tid != NULL && *tid != 0);
 
+    if(Lookup && Lookup->active)
+        return static_cast<NamedTree *>(Lookup->children.find(tid));
+
     linked_pointer<NamedTree> node = Child.begin();
 
     while(node) {
         if(eq(node->Id, tid))
-            return *node;
+            break;
+        node.next();
+    }
+    return *node;
+}
+
+void NamedTree::setCache(unsigned size)
+{
+    if(!Lookup && !size)
+        return;
+
+    if(!Lookup)
+        Lookup = new lookup();
+
+    Mutex::autolock exclusive(&Lookup->lock);
+    Lookup->cache(size);
+}
+
+void NamedTree::index(unsigned count)
+{
+    linked_pointer<NamedTree> node = Child.begin();
+    unsigned children = 0;
+
+    while(node) {
+        node->index(count);
+        ++children;
+        node.next();
+    }
+
+    if(!children || children < count || (Lookup && Lookup->active))
+        return;
+
+    if(!Lookup)
+        Lookup = new lookup();
+
+    Lookup->active = true;
+    Lookup->children.reserve(children);
+    node = Child.begin();
+    while(node) {
+        Lookup->attach(*node, false);
         node.next();
     }
-    return NULL;
 }
 
 void NamedTree::relistTail(NamedTree *trunk)
@@ -622,11 +1017,19 @@ void NamedTree::relistTail(NamedTree *trunk)
     if(Parent == trunk)
         return;
 
-    if(Parent)
+    if(Parent) {
+        if(Parent->Lookup)
+            Parent->Lookup->detach(Parent, this);
         delist(&Parent->Child);
+    }
+    changed(Parent);
     Parent = trunk;
-    if(Parent)
+    if(Parent) {
         enlistTail(&Parent->Child);
+        if(Parent->Lookup)
+            Parent->Lookup->attach(this, false);
+    }
+    changed(Parent);
 }
 
 void NamedTree::relistHead(NamedTree *trunk)
@@ -634,11 +1037,19 @@ void NamedTree::relistHead(NamedTree *trunk)
     if(Parent == trunk)
         return;
 
-    if(Parent)
+    if(Parent) {
+        if(Parent->Lookup)
+            Parent->Lookup->detach(Parent, this);
         delist(&Parent->Child);
+    }
+    changed(Parent);
     Parent = trunk;
-    if(Parent)
+    if(Parent) {
         enlistHead(&Parent->Child);
+        if(Parent->Lookup)
+            Parent->Lookup->attach(this, true);
+    }
+    changed(Parent);
 }
 
 NamedTree *NamedTree::path(const char *tid) const
@@ -653,6 +1064,21 @@ NamedTree *NamedTree::path(const char *tid) const
     if(!tid || !*tid)
         return const_cast<NamedTree*>(this);
 
+    lookup::entry_t *entry = NULL;
+    unsigned long changes = 0;
+    unsigned hash = 0;
+
+    if(Lookup && Lookup->paths && *tid != '.') {
+        Mutex::autolock exclusive(&Lookup->lock);
+        changes = Lookup->changes;
+        hash = NamedObject::keyhash(tid);
+        entry = &Lookup->paths[hash & Lookup->mask];
+        if(entry->path && entry->hash == hash && entry->changes == changes && eq(entry->path, tid))
+            return entry->node;
+    }
+
+    const char *from = tid;
+
     while(*tid == '.') {
         if(!node->Parent)
             return NULL;
@@ -673,6 +1099,16 @@ NamedTree *NamedTree::path(const char *tid) const
             tid = NULL;
         node = node->getChild(buf);
     }
+
+    if(entry) {
+        Mutex::autolock exclusive(&Lookup->lock);
+        if(entry->path)
+            free(entry->path);
+        entry->path = strdup(from);
+        entry->node = node;
+        entry->hash = hash;
+        entry->changes = changes;
+    }
     return node;
 }
 
@@ -680,6 +1116,13 @@ NamedTree *NamedTree::getLeaf(const char *tid) const
 {
     assert(tid != NULL && *tid != 0);
 
+    if(Lookup && Lookup->active && !Lookup->shadowed) {
+        NamedTree *node = static_cast<NamedTree *>(Lookup->children.find(tid));
+        if(node && node->is_leaf())
+            return node;
+        return NULL;
+    }
+
     linked_pointer<NamedTree> node = Child.begin();
 
     while(node) {
@@ -734,7 +1177,28 @@ void NamedTree::setId(char *nid)
 {
     assert(nid != NULL && *nid != 0);
 
+    lookup *parent = Parent ? Parent->Lookup : NULL;
+
+    if(parent)
+        parent->detach(Parent, this);
+
     Id = nid;
+
+    // we index ahead of a sibling of the same name if we are listed first
+    if(parent) {
+        NamedObject *prior = parent->children.find(Id);
+        bool head = false;
+        linked_pointer<NamedTree> node = Parent->Child.begin();
+        while(prior && node && *node != prior) {
+            if(*node == this) {
+                head = true;
+                break;
+            }
+            node.next();
+        }
+        parent->attach(this, head);
+    }
+    changed(Parent);
 }
 
 // If you remove the tree node, the id is NULL'd also.  This keeps the
@@ -742,10 +1206,14 @@ void NamedTree::setId(char *nid)
 
 void NamedTree::remove(void)
 {
-    if(Parent)
+    if(Parent) {
+        if(Parent->Lookup)
+            Parent->Lookup->detach(Parent, this);
         delist(&Parent->Child);
+    }
 
     Id = NULL;
+    changed(Parent);
 }
 
 void NamedTree::purge(void)
@@ -753,8 +1221,17 @@ void NamedTree::purge(void)
     linked_pointer<NamedTree> node = Child.begin();
     NamedTree *obj;
 
-    if(Parent)
+    if(Parent) {
+        if(Parent->Lookup)
+            Parent->Lookup->detach(Parent, this);
         delist(&Parent->Child);
+    }
+
+    if(Lookup) {
+        delete Lookup;
+        Lookup = NULL;
+    }
+    changed(Parent);
 
     while(node) {
         obj = *node;
@@ -62,6 +62,14 @@
 #include <sched.h>
 #endif
 
+#ifdef  HAVE_LINUX_FUTEX_H
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#if defined(SYS_futex)
+#define RING_FUTEX
+#endif
+#endif
+
 #if defined(__APPLE__) && defined(__MACH__)
 #define INSERT_OFFSET   16
 #endif
@@ -74,6 +82,10 @@
 #undef  HAVE_SHM_OPEN
 #endif
 
+#ifndef HUGETLB_PATH
+#define HUGETLB_PATH    "/dev/hugepages"
+#endif
+
 #if defined(__ANDROID__)
 
 #include <stdio.h>
@@ -203,6 +215,17 @@ MappedMemory::MappedMemory(const char *fn, size_t len)
     create(fn, size);
 }
 
+MappedMemory::MappedMemory(const char *fn, size_t len, unsigned placement, int node)
+{
+    assert(fn != NULL && *fn != 0);
+    assert(len > 0);
+
+    size = len;
+    erase = true;
+    String::set(idname, sizeof(idname), fn);
+    create(fn, size, placement, node);
+}
+
 MappedMemory::MappedMemory(const char *fn)
 {
     erase = false;
@@ -220,7 +243,7 @@ MappedMemory::MappedMemory()
 
 #if defined(_MSWINDOWS_)
 
-void MappedMemory::create(const char *fn, size_t len)
+void MappedMemory::create(const char *fn, size_t len, unsigned placement, int node)
 {
     assert(fn != NULL && *fn != 0);
 
@@ -265,6 +288,35 @@ void MappedMemory::create(const char *fn, size_t len)
         fault();
 }
 
+void MappedMemory::attach(const char *fn)
+{
+    assert(fn != NULL && *fn != 0);
+
+    MEMORY_BASIC_INFORMATION info;
+
+    size = 0;
+    used = 0;
+    map = NULL;
+
+    if(!use_mapping)
+        return;
+
+    if(*fn == '/')
+        ++fn;
+
+    fd = OpenFileMapping(FILE_MAP_ALL_ACCESS, FALSE, fn);
+    if(fd == INVALID_HANDLE_VALUE || fd == NULL)
+        return;
+
+    map = (caddr_t)MapViewOfFile(fd, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if(map && VirtualQuery(map, &info, sizeof(info))) {
+        size = info.RegionSize;
+        VirtualLock(map, size);
+    }
+    else
+        fault();
+}
+
 MappedMemory::~MappedMemory()
 {
     release();
@@ -298,13 +350,27 @@ void MappedMemory::release(void)
 
 #elif defined(HAVE_SHM_OPEN)
 
-void MappedMemory::create(const char *fn, size_t len)
+// segments on reserved huge pages are files in a hugetlbfs mount
+static void huge_path(const char *fn, char *buf, size_t max)
+{
+    snprintf(buf, max, "%s%s", HUGETLB_PATH, fn);
+}
+
+static int huge_open(const char *fn, int mode)
+{
+    char path[96];
+    huge_path(fn, path, sizeof(path));
+    return ::open(path, mode, 0664);
+}
+
+void MappedMemory::create(const char *fn, size_t len, unsigned placement, int node)
 {
     assert(fn != NULL && *fn != 0);
 
     int prot = PROT_READ;
     struct stat ino;
     char fbuf[80];
+    size_t total = len;
 
     size = 0;
     used = 0;
@@ -325,34 +391,60 @@ void MappedMemory::create(const char *fn, size_t len)
 
     if(len) {
         len += INSERT_OFFSET;
+        total = len;
         prot |= PROT_WRITE;
-        fd = shm_open(fn, O_RDWR | O_CREAT, 0664);
-        if(fd > -1) {
-            if(ftruncate(fd, len)) {
+        fd = -1;
+        if(placement & memalloc::HUGEPAGES) {
+            size_t huge = memalloc::hugepage();
+            total = ((len + huge - 1) / huge) * huge;
+            fd = huge_open(fn, O_RDWR | O_CREAT);
+            if(fd > -1 && ftruncate(fd, total)) {
                 ::close(fd);
                 fd = -1;
             }
+            if(fd > -1)
+                shm_unlink(fn);
+            else {
+                total = len;
+                placement |= memalloc::TRANSPARENT;
+            }
+        }
+        if(fd < 0) {
+            fd = shm_open(fn, O_RDWR | O_CREAT, 0664);
+            if(fd > -1) {
+                if(ftruncate(fd, len)) {
+                    ::close(fd);
+                    fd = -1;
+                }
+            }
         }
     }
     else {
         fd = shm_open(fn, O_RDONLY, 0664);
+        if(fd < 0)
+            fd = huge_open(fn, O_RDONLY);
         if(fd > -1) {
             fstat(fd, &ino);
-            len = ino.st_size;
+            len = total = ino.st_size;
         }
+        placement &= ~memalloc::PREFAULT;
     }
 
     if(fd < 0)
         return;
 
 
-    map = (caddr_t)mmap(NULL, len, prot, MAP_SHARED, fd, 0);
+    map = (caddr_t)mmap(NULL, total, prot, MAP_SHARED, fd, 0);
     if(!map)
         fault();
     ::close(fd);
     if(map != (caddr_t)MAP_FAILED) {
-        size = mapsize = len;
-        mlock(map, mapsize);
+        size = len;
+        mapsize = total;
+        if(placement)
+            memalloc::place(map, mapsize, placement, node);
+        else
+            mlock(map, mapsize);
 #if INSERT_OFFSET > 0
         if(prot & PROT_WRITE) {
             size -= INSERT_OFFSET;
@@ -365,6 +457,48 @@ void MappedMemory::create(const char *fn, size_t len)
     }
 }
 
+void MappedMemory::attach(const char *fn)
+{
+    assert(fn != NULL && *fn != 0);
+
+    struct stat ino;
+    char fbuf[80];
+
+    size = 0;
+    used = 0;
+
+    // a local heap cannot be shared with another process
+    if(!use_mapping)
+        return;
+
+    if(*fn != '/') {
+        snprintf(fbuf, sizeof(fbuf), "/%s", fn);
+        fn = fbuf;
+    }
+
+    fd = shm_open(fn, O_RDWR, 0664);
+    if(fd < 0)
+        fd = huge_open(fn, O_RDWR);
+    if(fd < 0)
+        return;
+
+    if(fstat(fd, &ino) || ino.st_size < INSERT_OFFSET + 1) {
+        ::close(fd);
+        return;
+    }
+
+    map = (caddr_t)mmap(NULL, ino.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(map != (caddr_t)MAP_FAILED) {
+        size = mapsize = ino.st_size;
+        mlock(map, mapsize);
+#if INSERT_OFFSET > 0
+        size = atol(map);
+        map += INSERT_OFFSET;
+#endif
+    }
+}
+
 MappedMemory::~MappedMemory()
 {
     release();
@@ -392,7 +526,7 @@ void MappedMemory::remove(const char *fn)
 {
     assert(fn != NULL && *fn != 0);
 
-    char fbuf[80];
+    char fbuf[80], hbuf[96];
 
     if(!use_mapping)
         return;
@@ -403,6 +537,8 @@ void MappedMemory::remove(const char *fn)
     }
 
     shm_unlink(fn);
+    huge_path(fn, hbuf, sizeof(hbuf));
+    ::unlink(hbuf);
 }
 
 #else
@@ -425,11 +561,12 @@ void MappedMemory::remove(const char *name)
     }
 }
 
-void MappedMemory::create(const char *name, size_t len)
+void MappedMemory::create(const char *name, size_t len, unsigned placement, int node)
 {
     assert(name != NULL && *name != 0);
 
     struct shmid_ds stat;
+    int flags = 0;
     size = 0;
     used = 0;
     key_t key;
@@ -443,10 +580,23 @@ void MappedMemory::create(const char *name, size_t len)
         return;
     }
 
+#ifdef  SHM_HUGETLB
+    if(placement & memalloc::HUGEPAGES) {
+        size_t huge = memalloc::hugepage();
+        if(!(len % huge))
+            flags = SHM_HUGETLB;
+    }
+#endif
+
     if(len) {
         key = createipc(name, 'S');
 remake:
-        fd = shmget(key, len, IPC_CREAT | IPC_EXCL | 0664);
+        fd = shmget(key, len, IPC_CREAT | IPC_EXCL | 0664 | flags);
+        if(fd == -1 && flags && errno != EEXIST) {
+            flags = 0;
+            placement |= memalloc::TRANSPARENT;
+            goto remake;
+        }
         if(fd == -1 && errno == EEXIST) {
             fd = shmget(key, 0, 0);
             if(fd > -1) {
@@ -471,12 +621,22 @@ remake:
     map = (caddr_t)shmat(fd, NULL, 0);
     if(!map)
         fault();
+    if(placement && size && map != (caddr_t)-1) {
+        memalloc::place(map, size, placement, node);
+        return;
+    }
 #ifdef  SHM_LOCK
     if(fd > -1)
         shmctl(fd, SHM_LOCK, NULL);
 #endif
 }
 
+void MappedMemory::attach(const char *name)
+{
+    // attached segments are always mapped for reading and writing
+    create(name, 0);
+}
+
 MappedMemory::~MappedMemory()
 {
     release();
@@ -653,4 +813,539 @@ ReusableObject *MappedReuse::getTimed(timeout_t timeout)
     return obj;
 }
 
+#define RING_MAGIC      0x52696e67
+#define RING_MULTIPLE   0x01
+#define RING_MINIMUM    64
+
+#define RECORD_READY    0x01
+#define RECORD_SKIP     0x02
+
+// the control block leads the segment, each index on its own cache line
+class MappedRing::control
+{
+public:
+    uint32_t magic, flags;
+    uint64_t size;
+    char pad1[48];
+    uint64_t head;              // end of space given to writers
+    char pad2[56];
+    uint64_t tail;              // end of space the reader is done with
+    char pad3[56];
+    uint32_t data, sleeping;    // the reader waits on data
+    char pad4[56];
+    uint32_t space, blocked;    // writers wait on space
+    char pad5[56];
+};
+
+typedef struct {
+    uint32_t size;
+    uint32_t mark;
+} record_t;
+
+static inline size_t record_size(size_t size)
+{
+    return sizeof(record_t) + ((size + 7) & ~((size_t)7));
+}
+
+static inline uint64_t acquire(const uint64_t *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline uint32_t acquire(const uint32_t *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline void publish(uint64_t *ptr, uint64_t value)
+{
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+static inline void publish(uint32_t *ptr, uint32_t value)
+{
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+static timeout_t remains(const Timer& expires, timeout_t timeout)
+{
+    if(timeout == Timer::inf)
+        return Timer::inf;
+    return expires.get();
+}
+
+// sleep until a futex word changes, or poll where there are no futexes
+static void sleep_on(uint32_t *word, uint32_t value, timeout_t timeout)
+{
+#ifdef  RING_FUTEX
+    struct timespec ts, *tp = NULL;
+    if(timeout != Timer::inf) {
+        ts.tv_sec = timeout / 1000l;
+        ts.tv_nsec = (timeout % 1000l) * 1000000l;
+        tp = &ts;
+    }
+    syscall(SYS_futex, word, FUTEX_WAIT, value, tp, NULL, 0);
+#else
+    if(acquire(word) == value)
+        Thread::sleep(1);
+#endif
+}
+
+static void wake_on(uint32_t *word)
+{
+    __atomic_fetch_add(word, 1, __ATOMIC_SEQ_CST);
+#ifdef  RING_FUTEX
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+MappedRing::MappedRing(const char *name, size_t bufsize, bool multiple) :
+MappedMemory()
+{
+    assert(name != NULL && *name != 0);
+    assert(bufsize > 0);
+
+    size_t len = RING_MINIMUM;
+    while(len < bufsize)
+        len <<= 1;
+
+    ctrl = NULL;
+    erase = true;
+    String::set(idname, sizeof(idname), name);
+    create(name, sizeof(control) + len);
+    if(size < sizeof(control) + len)
+        return;
+
+    control *cp = (control *)addr();
+    memset(cp, 0, sizeof(control) + len);
+    cp->size = len;
+    if(multiple)
+        cp->flags = RING_MULTIPLE;
+    publish(&cp->magic, RING_MAGIC);
+    setup();
+}
+
+MappedRing::MappedRing(const char *name) :
+MappedMemory()
+{
+    assert(name != NULL && *name != 0);
+
+    ctrl = NULL;
+    attach(name);
+    if(size < sizeof(control))
+        return;
+
+    control *cp = (control *)addr();
+    if(acquire(&cp->magic) != RING_MAGIC || sizeof(control) + cp->size > size)
+        return;
+
+    setup();
+}
+
+void MappedRing::setup(void)
+{
+    ctrl = (control *)addr();
+    data = addr() + sizeof(control);
+    mask = (size_t)(ctrl->size - 1);
+    posted = acquire(&ctrl->head);
+    reading = acquire(&ctrl->tail);
+}
+
+size_t MappedRing::limit(void) const
+{
+    if(!ctrl)
+        return 0;
+
+    // half the ring always fits, even when the next record must wrap
+    return (size_t)(ctrl->size / 2) - sizeof(record_t);
+}
+
+void *MappedRing::request(size_t len, timeout_t timeout)
+{
+    assert(len > 0);
+
+    if(len > limit())
+        return NULL;
+
+    bool multiple = (ctrl->flags & RING_MULTIPLE) != 0;
+    size_t need = record_size(len), offset, skip;
+    size_t ringsize = mask + 1;
+    uint64_t head, tail;
+    uint32_t seq;
+    record_t *rec;
+    Timer expires;
+
+    if(timeout && timeout != Timer::inf)
+        expires.set(timeout);
+
+    for(;;) {
+        head = multiple ? acquire(&ctrl->head) : posted;
+        tail = acquire(&ctrl->tail);
+        offset = (size_t)(head & mask);
+        skip = 0;
+        if(offset + need > ringsize)
+            skip = ringsize - offset;
+
+        if(head + skip + need - tail <= ringsize) {
+            if(!multiple) {
+                posted = head + skip + need;
+                break;
+            }
+            if(__atomic_compare_exchange_n(&ctrl->head, &head, head + skip + need,
+                false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+                break;
+            continue;
+        }
+
+        timeout_t remaining = timeout ? remains(expires, timeout) : 0;
+        if(!remaining)
+            return NULL;
+
+        // the reader wakes blocked writers as it frees space
+        seq = acquire(&ctrl->space);
+        __atomic_store_n(&ctrl->blocked, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if(acquire(&ctrl->tail) == tail)
+            sleep_on(&ctrl->space, seq, remaining);
+    }
+
+    if(skip) {
+        rec = (record_t *)(data + offset);
+        rec->size = (uint32_t)skip;
+        publish(&rec->mark, RECORD_SKIP);
+        offset = 0;
+    }
+
+    rec = (record_t *)(data + offset);
+    rec->size = (uint32_t)len;
+    return (void *)(rec + 1);
+}
+
+void MappedRing::commit(void *record)
+{
+    assert(record != NULL);
+
+    record_t *rec = ((record_t *)record) - 1;
+
+    if(ctrl->flags & RING_MULTIPLE)
+        publish(&rec->mark, RECORD_READY);
+    else {
+        rec->mark = RECORD_READY;
+        publish(&ctrl->head, posted);
+    }
+
+    // only a sleeping reader costs a system call, and only once
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(acquire(&ctrl->sleeping) && __atomic_exchange_n(&ctrl->sleeping, 0, __ATOMIC_SEQ_CST))
+        wake_on(&ctrl->data);
+}
+
+bool MappedRing::post(const void *record, size_t len, timeout_t timeout)
+{
+    assert(record != NULL);
+
+    void *rec = request(len, timeout);
+    if(!rec)
+        return false;
+
+    memcpy(rec, record, len);
+    commit(rec);
+    return true;
+}
+
+bool MappedRing::is_empty(void) const
+{
+    if(!ctrl)
+        return true;
+
+    uint64_t tail = acquire(&ctrl->tail);
+    if(ctrl->flags & RING_MULTIPLE) {
+        record_t *rec = (record_t *)(data + (tail & mask));
+        return acquire(&rec->mark) == 0;
+    }
+    return acquire(&ctrl->head) == tail;
+}
+
+const void *MappedRing::peek(size_t *len, timeout_t timeout)
+{
+    assert(len != NULL);
+
+    if(!ctrl)
+        return NULL;
+
+    bool multiple = (ctrl->flags & RING_MULTIPLE) != 0;
+    uint64_t tail = ctrl->tail;
+    uint32_t mark, seq;
+    record_t *rec;
+    Timer expires;
+
+    if(timeout && timeout != Timer::inf)
+        expires.set(timeout);
+
+    for(;;) {
+        rec = (record_t *)(data + (tail & mask));
+        if(multiple)
+            mark = acquire(&rec->mark);
+        else if(acquire(&ctrl->head) != tail)
+            mark = rec->mark;
+        else
+            mark = 0;
+
+        if(mark == RECORD_READY)
+            break;
+
+        // writers that wrap leave the end of the ring unused
+        if(mark == RECORD_SKIP) {
+            tail += rec->size;
+            if(multiple)
+                memset(rec, 0, rec->size);
+            publish(&ctrl->tail, tail);
+            continue;
+        }
+
+        timeout_t remaining = timeout ? remains(expires, timeout) : 0;
+        if(!remaining)
+            return NULL;
+
+        seq = acquire(&ctrl->data);
+        __atomic_store_n(&ctrl->sleeping, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if(multiple)
+            mark = acquire(&rec->mark);
+        else
+            mark = (acquire(&ctrl->head) != tail);
+        if(!mark)
+            sleep_on(&ctrl->data, seq, remaining);
+    }
+
+    *len = rec->size;
+    reading = tail + record_size(rec->size);
+    return (const void *)(rec + 1);
+}
+
+void MappedRing::next(void)
+{
+    if(!ctrl)
+        return;
+
+    uint64_t tail = ctrl->tail;
+    if(reading <= tail)
+        return;
+
+    // free space must read as zero to writers that share the ring
+    if(ctrl->flags & RING_MULTIPLE)
+        memset(data + (tail & mask), 0, (size_t)(reading - tail));
+
+    publish(&ctrl->tail, reading);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(acquire(&ctrl->blocked) && __atomic_exchange_n(&ctrl->blocked, 0, __ATOMIC_SEQ_CST))
+        wake_on(&ctrl->space);
+}
+
+size_t MappedRing::get(void *buffer, size_t bufsize, timeout_t timeout)
+{
+    assert(buffer != NULL);
+
+    size_t len;
+    const void *rec = peek(&len, timeout);
+    if(!rec)
+        return 0;
+
+    memcpy(buffer, rec, len < bufsize ? len : bufsize);
+    next();
+    return len;
+}
+
+#define HEAP_MAGIC      0x48656170
+#define HEAP_CLASSES    176
+#define HEAP_ALIGN      64
+
+#define BLOCK_USED      0x55736564
+#define BLOCK_FREE      0x46726565
+
+typedef struct {
+    uint32_t index, mark;
+} block_t;
+
+static inline unsigned class_index(size_t size)
+{
+    if(size <= 128)
+        return size ? (unsigned)((size + 15) / 16 - 1) : 0;
+
+    unsigned bits = 0;
+    size_t scan = size - 1;
+    while(scan >>= 1)
+        ++bits;
+
+    size_t page = (size_t)1 << bits;
+    return 8 + (bits - 7) * 4 + (unsigned)((size - 1 - page) / (page / 4));
+}
+
+static inline size_t class_size(unsigned index)
+{
+    if(index < 8)
+        return (index + 1) * 16;
+
+    size_t page = (size_t)1 << (7 + (index - 8) / 4);
+    return page + (page / 4) * ((index - 8) % 4 + 1);
+}
+
+void MappedLock::create(void)
+{
+#ifdef  _MSWINDOWS_
+    pthread_mutex_init(&mutex, NULL);
+#else
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+#ifdef  HAVE_PTHREAD_MUTEXATTR_SETROBUST
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+    pthread_mutex_init(&mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+#endif
+}
+
+bool MappedLock::acquire(void)
+{
+#if defined(HAVE_PTHREAD_MUTEXATTR_SETROBUST) && defined(EOWNERDEAD)
+    switch(pthread_mutex_lock(&mutex)) {
+    case 0:
+        break;
+    case EOWNERDEAD:
+        // what the owner was changing may be half done, so rather than
+        // mark it consistent the lock is left unusable to everyone
+        pthread_mutex_unlock(&mutex);
+        return false;
+    default:
+        return false;
+    }
+#else
+    pthread_mutex_lock(&mutex);
+#endif
+    return true;
+}
+
+void MappedLock::release(void)
+{
+    pthread_mutex_unlock(&mutex);
+}
+
+void MappedArena::create(size_t len)
+{
+    memset((void *)this, 0, sizeof(MappedArena));
+    size = len;
+    classes = HEAP_CLASSES;
+    top = (sizeof(MappedArena) + HEAP_ALIGN - 1) & ~((uint64_t)HEAP_ALIGN - 1);
+    mutex.create();
+    publish(&magic, HEAP_MAGIC);
+}
+
+void *MappedArena::alloc(size_t len)
+{
+    unsigned index = class_index(len);
+    block_t *block = NULL;
+
+    if(index >= HEAP_CLASSES || !mutex.acquire())
+        return NULL;
+
+    if(!free_list[index] && top + sizeof(block_t) + class_size(index) <= size) {
+        block = (block_t *)address((size_t)top);
+        block->index = index;
+        top += sizeof(block_t) + class_size(index);
+    }
+    else {
+        // take a larger block rather than fail while memory is free
+        while(index < HEAP_CLASSES && !free_list[index])
+            ++index;
+        if(index < HEAP_CLASSES) {
+            block = (block_t *)address((size_t)free_list[index]);
+            free_list[index] = *(uint64_t *)(block + 1);
+        }
+    }
+
+    if(block) {
+        block->mark = BLOCK_USED;
+        allocated += class_size(block->index);
+    }
+    mutex.release();
+    return block ? (void *)(block + 1) : NULL;
+}
+
+void MappedArena::free(void *memory)
+{
+    if(!memory)
+        return;
+
+    block_t *block = (block_t *)memory - 1;
+
+    if(!mutex.acquire())
+        return;
+
+    if(block->mark == BLOCK_USED) {
+        block->mark = BLOCK_FREE;
+        *(uint64_t *)memory = free_list[block->index];
+        free_list[block->index] = offset(block);
+        allocated -= class_size(block->index);
+    }
+    mutex.release();
+}
+
+size_t MappedArena::usable(const void *memory) const
+{
+    if(!memory)
+        return 0;
+
+    return class_size(((const block_t *)memory - 1)->index);
+}
+
+void *MappedArena::resize(void *memory, size_t len)
+{
+    size_t current = usable(memory);
+    if(memory && len <= current)
+        return memory;
+
+    void *block = alloc(len);
+    if(block && memory) {
+        memcpy(block, memory, current);
+        free(memory);
+    }
+    return block;
+}
+
+MappedHeap::MappedHeap(const char *name, size_t len, unsigned placement, int node) :
+MappedMemory()
+{
+    assert(name != NULL && *name != 0);
+    assert(len > sizeof(MappedArena));
+
+    heap = NULL;
+    erase = true;
+    String::set(idname, sizeof(idname), name);
+    create(name, len, placement, node);
+    if(size < len)
+        return;
+
+    heap = (MappedArena *)addr();
+    heap->create(len);
+}
+
+MappedHeap::MappedHeap(const char *name) :
+MappedMemory()
+{
+    assert(name != NULL && *name != 0);
+
+    heap = NULL;
+    attach(name);
+    if(size < sizeof(MappedArena))
+        return;
+
+    MappedArena *arena = (MappedArena *)addr();
+    if(acquire(&arena->magic) != HEAP_MAGIC || arena->classes != HEAP_CLASSES || arena->size > size)
+        return;
+
+    heap = arena;
+}
+
 } // namespace ucommon
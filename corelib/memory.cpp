@@ -30,6 +30,30 @@
 #include <string.h>
 #include <stdio.h>
 
+#ifdef HAVE_SYS_MMAN_H
+#undef  __EXTENSIONS__
+#define __EXTENSIONS__
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L
+#include <sys/mman.h>
+#undef  _POSIX_C_SOURCE
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+#if defined(HAVE_LINUX_MEMPOLICY_H) && defined(HAVE_SYS_MMAN_H)
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#if defined(SYS_mbind)
+#define MEMORY_NUMA
+#endif
+#endif
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS   MAP_ANON
+#endif
+
 namespace ucommon {
 
 extern "C" {
@@ -44,17 +68,23 @@ extern "C" {
     }
 }
 
-memalloc::memalloc(size_t ps)
+static size_t system_paging(void)
 {
 #ifdef  HAVE_SYSCONF
-    size_t paging = sysconf(_SC_PAGESIZE);
+    return sysconf(_SC_PAGESIZE);
 #elif defined(PAGESIZE)
-    size_t paging = PAGESIZE;
+    return PAGESIZE;
 #elif defined(PAGE_SIZE)
-    size_t paging = PAGE_SIZE;
+    return PAGE_SIZE;
 #else
-    size_t paging = 1024;
+    return 1024;
 #endif
+}
+
+memalloc::memalloc(size_t ps)
+{
+    size_t paging = system_paging();
+
     if(!ps)
         ps = paging;
     else if(ps > paging)
@@ -81,6 +111,8 @@ memalloc::memalloc(size_t ps)
     count = 0;
     limit = 0;
     page = NULL;
+    placing = 0;
+    node = -1;
 }
 
 memalloc::~memalloc()
@@ -112,7 +144,10 @@ void memalloc::purge(void)
     page_t *next;
     while(page) {
         next = page->next;
-        free(page);
+        if(placing)
+            unmap(page, pagesize);
+        else
+            free(page);
         page = next;
     }
     count = 0;
@@ -133,6 +168,11 @@ memalloc::page_t *memalloc::pager(void)
     if(limit && count >= limit)
         fault();
 
+    if(placing) {
+        npage = (page_t *)map(pagesize, placing, node);
+        goto use;
+    }
+
 #ifdef  HAVE_POSIX_MEMALIGN
     if(align && !posix_memalign(&addr, align, pagesize)) {
         npage = (page_t *)addr;
@@ -141,9 +181,7 @@ memalloc::page_t *memalloc::pager(void)
 #endif
     npage = (page_t *)malloc(pagesize);
 
-#ifdef  HAVE_POSIX_MEMALIGN
 use:
-#endif
     if(!npage)
         fault();
 
@@ -185,6 +223,167 @@ void *memalloc::_alloc(size_t size)
     return mem;
 }
 
+bool memalloc::placement(unsigned options, int numa)
+{
+    if(count)
+        return false;
+
+    if(options & HUGEPAGES) {
+        size_t huge = hugepage();
+        pagesize = ((pagesize + huge - 1) / huge) * huge;
+    }
+
+    placing = options;
+    node = numa;
+    return true;
+}
+
+size_t memalloc::hugepage(void)
+{
+    static size_t huge = 0;
+
+    if(huge)
+        return huge;
+
+    size_t size = 0;
+#ifdef  __linux__
+    char buf[80];
+    FILE *fp = fopen("/proc/meminfo", "r");
+    while(fp && fgets(buf, sizeof(buf), fp)) {
+        if(!strncmp(buf, "Hugepagesize:", 13)) {
+            size = atol(buf + 13) * 1024l;
+            break;
+        }
+    }
+    if(fp)
+        fclose(fp);
+#endif
+    if(!size)
+        size = system_paging();
+    huge = size;
+    return huge;
+}
+
+#if defined(_MSWINDOWS_)
+
+void *memalloc::map(size_t size, unsigned options, int numa)
+{
+    assert(size > 0);
+
+    void *addr = VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if(addr)
+        place(addr, size, options, numa);
+    return addr;
+}
+
+void memalloc::unmap(void *addr, size_t size)
+{
+    if(addr)
+        VirtualFree(addr, 0, MEM_RELEASE);
+}
+
+void memalloc::place(void *addr, size_t size, unsigned options, int numa)
+{
+    if(options & LOCKED)
+        VirtualLock(addr, size);
+}
+
+#elif defined(HAVE_SYS_MMAN_H) && defined(MAP_ANONYMOUS)
+
+void *memalloc::map(size_t size, unsigned options, int numa)
+{
+    assert(size > 0);
+
+    void *addr = MAP_FAILED;
+
+#ifdef  MAP_HUGETLB
+    // reserved huge pages are used only when the size is a multiple
+    if((options & HUGEPAGES) && !(size % hugepage()))
+        addr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+
+    if(addr == MAP_FAILED) {
+        if(options & HUGEPAGES)
+            options |= TRANSPARENT;
+        addr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+
+    if(addr == MAP_FAILED)
+        return NULL;
+
+    place(addr, size, options, numa);
+    return addr;
+}
+
+void memalloc::unmap(void *addr, size_t size)
+{
+    if(addr)
+        munmap(addr, size);
+}
+
+void memalloc::place(void *addr, size_t size, unsigned options, int numa)
+{
+    assert(addr != NULL && size > 0);
+
+#ifdef  MADV_HUGEPAGE
+    if(options & TRANSPARENT)
+        madvise(addr, size, MADV_HUGEPAGE);
+#endif
+
+#ifdef  MEMORY_NUMA
+    unsigned long mask[4];
+    unsigned bits = sizeof(unsigned long) * 8;
+    if(numa >= 0 && (unsigned)numa < sizeof(mask) * 8) {
+        memset(mask, 0, sizeof(mask));
+        mask[numa / bits] |= 1ul << (numa % bits);
+        syscall(SYS_mbind, addr, size, MPOL_BIND, mask,
+            (unsigned long)(sizeof(mask) * 8 + 1), MPOL_MF_MOVE);
+    }
+#endif
+
+    // faulted in after the policy is set so pages land where asked
+    if(options & PREFAULT) {
+#ifdef  MADV_POPULATE_WRITE
+        if(madvise(addr, size, MADV_POPULATE_WRITE))
+#endif
+        {
+            size_t paging = system_paging();
+            for(size_t pos = 0; pos < size; pos += paging) {
+#ifdef  __GNUC__
+                __sync_fetch_and_or((char *)addr + pos, 0);
+#else
+                *((volatile char *)addr + pos);
+#endif
+            }
+        }
+    }
+
+    if(options & LOCKED)
+        mlock(addr, size);
+}
+
+#else
+
+void *memalloc::map(size_t size, unsigned options, int numa)
+{
+    assert(size > 0);
+
+    return malloc(size);
+}
+
+void memalloc::unmap(void *addr, size_t size)
+{
+    free(addr);
+}
+
+void memalloc::place(void *addr, size_t size, unsigned options, int numa)
+{
+}
+
+#endif
+
 mempager::mempager(size_t ps) :
 memalloc(ps)
 {
@@ -860,31 +1059,28 @@ PagerObject *PagerPool::get(size_t size)
     return ptr;
 }
 
-keyassoc::keydata::keydata(keyassoc *assoc, const char *kid, unsigned max, unsigned bufsize) :
-NamedObject(assoc->root, strdup(kid), max)
+keyassoc::keydata::keydata(keyassoc *assoc, const char *kid, unsigned bufsize) :
+NamedObject()
 {
     assert(assoc != NULL);
     assert(kid != NULL && *kid != 0);
-    assert(max > 1);
 
     String::set(text, bufsize, kid);
     data = NULL;
     Id = text;
+    assoc->index.add(this);
 }
 
 keyassoc::keyassoc(unsigned pathmax, size_t strmax, size_t ps) :
-mempager(ps)
+mempager(ps), index(pathmax)
 {
     assert(pathmax > 1);
     assert(strmax > 1);
     assert(ps > 1);
 
-    paths = pathmax;
     keysize = strmax;
     keycount = 0;
 
-    root = (NamedObject **)_alloc(sizeof(NamedObject *) * pathmax);
-    memset(root, 0, sizeof(NamedObject *) * pathmax);
     if(keysize) {
         list = (LinkedObject **)_alloc(sizeof(LinkedObject *) * (keysize / 8));
         memset(list, 0, sizeof(LinkedObject *) * (keysize / 8));
@@ -900,9 +1096,10 @@ keyassoc::~keyassoc()
 
 void keyassoc::purge(void)
 {
+    index.clear();
     mempager::purge();
     list = NULL;
-    root = NULL;
+    keycount = 0;
 }
 
 void *keyassoc::locate(const char *id)
@@ -912,7 +1109,7 @@ void *keyassoc::locate(const char *id)
     keydata *kd;
 
     _lock();
-    kd = static_cast<keydata *>(NamedObject::map(root, id, paths));
+    kd = static_cast<keydata *>(index.find(id));
     _unlock();
     if(!kd)
         return NULL;
@@ -927,21 +1124,20 @@ void *keyassoc::remove(const char *id)
     keydata *kd;
     LinkedObject *obj;
     void *data;
-    unsigned path = NamedObject::keyindex(id, paths);
     unsigned size = strlen(id);
 
     if(!keysize || size >= keysize || !list)
         return NULL;
 
     _lock();
-    kd = static_cast<keydata *>(NamedObject::map(root, id, paths));
+    kd = static_cast<keydata *>(index.find(id));
     if(!kd) {
         _unlock();
         return NULL;
     }
     data = kd->data;
+    index.remove(id);
     obj = static_cast<LinkedObject*>(kd);
-    obj->delist((LinkedObject**)(&root[path]));
     obj->enlist(&list[size / 8]);
     --keycount;
     _unlock();
@@ -962,7 +1158,7 @@ void *keyassoc::allocate(const char *id, size_t dsize)
         return NULL;
 
     _lock();
-    kd = static_cast<keydata *>(NamedObject::map(root, id, paths));
+    kd = static_cast<keydata *>(index.find(id));
     if(kd) {
         _unlock();
         return NULL;
@@ -980,7 +1176,7 @@ void *keyassoc::allocate(const char *id, size_t dsize)
     }
     else
         dp = ((keydata *)(ptr))->data;
-    kd = new(ptr) keydata(this, id, paths, 8 + size * 8);
+    kd = new(ptr) keydata(this, id, 8 + size * 8);
     kd->data = dp;
     ++keycount;
     _unlock();
@@ -1000,7 +1196,7 @@ bool keyassoc::create(const char *id, void *data)
         return false;
 
     _lock();
-    kd = static_cast<keydata *>(NamedObject::map(root, id, paths));
+    kd = static_cast<keydata *>(index.find(id));
     if(kd) {
         _unlock();
         return false;
@@ -1014,7 +1210,7 @@ bool keyassoc::create(const char *id, void *data)
     }
     if(ptr == NULL)
         ptr = memalloc::_alloc(sizeof(keydata) + size * 8);
-    kd = new(ptr) keydata(this, id, paths, 8 + size * 8);
+    kd = new(ptr) keydata(this, id, 8 + size * 8);
     kd->data = data;
     ++keycount;
     _unlock();
@@ -1034,7 +1230,7 @@ bool keyassoc::assign(const char *id, void *data)
         return false;
 
     _lock();
-    kd = static_cast<keydata *>(NamedObject::map(root, id, paths));
+    kd = static_cast<keydata *>(index.find(id));
     if(!kd) {
         caddr_t ptr = NULL;
         size /= 8;
@@ -1045,7 +1241,7 @@ bool keyassoc::assign(const char *id, void *data)
         }
         if(ptr == NULL)
             ptr = (caddr_t)memalloc::_alloc(sizeof(keydata) + size * 8);
-        kd = new(ptr) keydata(this, id, paths, 8 + size * 8);
+        kd = new(ptr) keydata(this, id, 8 + size * 8);
         ++keycount;
     }
     kd->data = data;
@@ -0,0 +1,519 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ucommon-config.h>
+#include <ucommon/export.h>
+#include <ucommon/ordered.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace ucommon {
+
+// hashed paths keep an open addressed table of their objects with the
+// hash of each key beside it, probed robin hood, as in HashIndex.
+
+class MultiIndex::table
+{
+public:
+    typedef struct {
+        member *node;
+        unsigned hash;
+    } slot_t;
+
+    slot_t *slots;
+    unsigned mask, used, path;
+
+    table(unsigned id);
+    ~table();
+
+    void resize(unsigned size);
+    void insert(member *node, unsigned hash);
+    bool remove(member *node, unsigned hash);
+    member *find(const key& value, unsigned hash, member *after) const;
+
+    inline const link_t *linkof(const member *node) const {
+        return &((const link_t *)node->links)[path];
+    }
+};
+
+MultiIndex::table::table(unsigned id)
+{
+    path = id;
+    used = 0;
+    mask = 15;
+    slots = (slot_t *)calloc(mask + 1, sizeof(slot_t));
+    crit(slots != NULL, "multi index alloc failed");
+}
+
+MultiIndex::table::~table()
+{
+    free(slots);
+}
+
+void MultiIndex::table::resize(unsigned size)
+{
+    slot_t *prior = slots;
+    unsigned count = mask + 1;
+
+    slots = (slot_t *)calloc(size, sizeof(slot_t));
+    crit(slots != NULL, "multi index alloc failed");
+    mask = size - 1;
+    used = 0;
+
+    for(unsigned pos = 0; pos < count; ++pos) {
+        if(prior[pos].node)
+            insert(prior[pos].node, prior[pos].hash);
+    }
+    free(prior);
+}
+
+void MultiIndex::table::insert(member *node, unsigned hash)
+{
+    // tables are kept no more than 7/8 full
+    if(used + 1 > (mask + 1) - (mask + 1) / 8)
+        resize((mask + 1) * 2);
+
+    unsigned pos = hash & mask, dist = 0;
+
+    for(;;) {
+        slot_t *slot = &slots[pos];
+        if(!slot->node) {
+            slot->node = node;
+            slot->hash = hash;
+            ++used;
+            return;
+        }
+
+        unsigned other = (pos - (slot->hash & mask)) & mask;
+        if(other < dist) {
+            member *swap = slot->node;
+            unsigned value = slot->hash;
+            slot->node = node;
+            slot->hash = hash;
+            node = swap;
+            hash = value;
+            dist = other;
+        }
+        pos = (pos + 1) & mask;
+        ++dist;
+    }
+}
+
+bool MultiIndex::table::remove(member *node, unsigned hash)
+{
+    unsigned pos = hash & mask, dist = 0;
+
+    for(;;) {
+        slot_t *slot = &slots[pos];
+        if(!slot->node || ((pos - (slot->hash & mask)) & mask) < dist)
+            return false;
+        if(slot->node == node)
+            break;
+        pos = (pos + 1) & mask;
+        ++dist;
+    }
+
+    // shift following entries back rather than leave a tombstone
+    for(;;) {
+        unsigned next = (pos + 1) & mask;
+        slot_t *slot = &slots[next];
+        if(!slot->node || ((next - (slot->hash & mask)) & mask) == 0)
+            break;
+        slots[pos] = *slot;
+        pos = next;
+    }
+    slots[pos].node = NULL;
+    slots[pos].hash = 0;
+    --used;
+    return true;
+}
+
+MultiIndex::member *MultiIndex::table::find(const key& value, unsigned hash, member *after) const
+{
+    unsigned pos = hash & mask, dist = 0;
+
+    for(;;) {
+        const slot_t *slot = &slots[pos];
+        if(!slot->node || ((pos - (slot->hash & mask)) & mask) < dist)
+            return NULL;
+        if(slot->hash == hash && MultiIndex::equal(linkof(slot->node), value)) {
+            if(!after)
+                return slot->node;
+            if(slot->node == after)
+                after = NULL;
+        }
+        pos = (pos + 1) & mask;
+        ++dist;
+    }
+}
+
+static unsigned hash_key(const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    unsigned hash = 2166136261u;
+
+    while(size--) {
+        hash ^= *(bytes++);
+        hash *= 16777619u;
+    }
+
+    // finish so low bits depend on every byte of the key
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+MultiIndex::key::key()
+{
+    data = NULL;
+    size = 0;
+    number = 0;
+}
+
+MultiIndex::key::key(const char *text)
+{
+    data = text;
+    size = text ? strlen(text) : 0;
+    number = 0;
+}
+
+MultiIndex::key::key(const void *value, size_t len)
+{
+    data = value;
+    size = len;
+    number = 0;
+}
+
+MultiIndex::key::key(int64_t value)
+{
+    data = NULL;
+    size = 0;
+    number = value;
+}
+
+MultiIndex::member::member() :
+CountedObject()
+{
+    index = NULL;
+    prev = next = NULL;
+    links = NULL;
+}
+
+MultiIndex::member::~member()
+{
+    if(links)
+        free(links);
+}
+
+bool MultiIndex::order::operator<(const order& other) const
+{
+    int result = MultiIndex::compare(*this, other);
+    if(result)
+        return result < 0;
+
+    return (uintptr_t)node < (uintptr_t)other.node;
+}
+
+MultiIndex::MultiIndex(unsigned count)
+{
+    assert(count > 0);
+
+    paths = count;
+    used = 0;
+    first = last = NULL;
+    list = new path_t[count];
+    for(unsigned path = 0; path < count; ++path) {
+        list[path].options = HASHED;
+        list[path].hashed = new table(path);
+        list[path].ordered = NULL;
+    }
+}
+
+MultiIndex::~MultiIndex()
+{
+    clear();
+    for(unsigned path = 0; path < paths; ++path) {
+        delete list[path].hashed;
+        delete list[path].ordered;
+    }
+    delete[] list;
+}
+
+bool MultiIndex::setPath(unsigned path, unsigned options)
+{
+    assert(path < paths);
+
+    if(used)
+        return false;
+
+    delete list[path].hashed;
+    delete list[path].ordered;
+    list[path].hashed = NULL;
+    list[path].ordered = NULL;
+    list[path].options = options;
+    if(options & ORDERED)
+        list[path].ordered = new ordering();
+    else
+        list[path].hashed = new table(path);
+    return true;
+}
+
+void MultiIndex::set(link_t *link, const key& value)
+{
+    link->number = value.number;
+    link->text = NULL;
+    if(value.data) {
+        link->text = (text_t *)malloc(sizeof(text_t) + value.size);
+        crit(link->text != NULL, "multi index alloc failed");
+        link->text->refs = 1;
+        link->text->size = value.size;
+        memcpy(link->text->data, value.data, value.size);
+        link->text->data[value.size] = 0;
+        link->hash = hash_key(value.data, value.size);
+    }
+    else
+        link->hash = hash_key(&value.number, sizeof(value.number));
+}
+
+bool MultiIndex::equal(const link_t *link, const key& value)
+{
+    if(!value.data)
+        return !link->text && link->number == value.number;
+
+    return link->text && link->text->size == value.size && !memcmp(link->text->data, value.data, value.size);
+}
+
+int MultiIndex::compare(const order& key1, const order& key2)
+{
+    if(!key1.data && !key2.data) {
+        if(key1.number == key2.number)
+            return 0;
+        return key1.number < key2.number ? -1 : 1;
+    }
+
+    // numbers are ordered before text and data
+    if(!key1.data)
+        return -1;
+
+    if(!key2.data)
+        return 1;
+
+    size_t size = key1.size < key2.size ? key1.size : key2.size;
+    int result = memcmp(key1.data, key2.data, size);
+    if(result || key1.size == key2.size)
+        return result;
+
+    return key1.size < key2.size ? -1 : 1;
+}
+
+bool MultiIndex::before(const member *object, unsigned path, const key& value)
+{
+    assert(object != NULL && object->links != NULL);
+
+    const link_t *link = &((const link_t *)object->links)[path];
+    order current;
+    current.number = link->number;
+    if(link->text) {
+        current.data = link->text->data;
+        current.size = link->text->size;
+    }
+    return compare(current, order(value)) < 0;
+}
+
+bool MultiIndex::taken(unsigned path, const key& value, member *object) const
+{
+    if(!(list[path].options & UNIQUE))
+        return false;
+
+    member *prior = find(path, value);
+    while(prior == object && prior)
+        prior = find(path, value, prior);
+    return prior != NULL;
+}
+
+void MultiIndex::file(unsigned path, member *object)
+{
+    link_t *link = &((link_t *)object->links)[path];
+
+    if(list[path].ordered)
+        list[path].ordered->add(order(link, object), object);
+    else
+        list[path].hashed->insert(object, link->hash);
+}
+
+void MultiIndex::unfile(unsigned path, member *object)
+{
+    link_t *link = &((link_t *)object->links)[path];
+
+    if(list[path].ordered)
+        list[path].ordered->remove(order(link, object));
+    else
+        list[path].hashed->remove(object, link->hash);
+
+    release(link->text);
+    link->text = NULL;
+}
+
+bool MultiIndex::add(member *object)
+{
+    assert(object != NULL);
+
+    if(object->index)
+        return false;
+
+    for(unsigned path = 0; path < paths; ++path) {
+        if(taken(path, object->keyof(path), NULL))
+            return false;
+    }
+
+    link_t *links = (link_t *)malloc(sizeof(link_t) * paths);
+    crit(links != NULL, "multi index alloc failed");
+    if(object->links)
+        free(object->links);
+    object->links = links;
+
+    object->retain();
+    for(unsigned path = 0; path < paths; ++path) {
+        set(&links[path], object->keyof(path));
+        file(path, object);
+    }
+
+    object->index = this;
+    object->next = NULL;
+    object->prev = last;
+    if(last)
+        last->next = object;
+    else
+        first = object;
+    last = object;
+    ++used;
+    return true;
+}
+
+bool MultiIndex::update(member *object)
+{
+    assert(object != NULL);
+
+    if(object->index != this)
+        return false;
+
+    link_t *links = (link_t *)object->links;
+
+    for(unsigned path = 0; path < paths; ++path) {
+        key value = object->keyof(path);
+        if(!equal(&links[path], value) && taken(path, value, object))
+            return false;
+    }
+
+    for(unsigned path = 0; path < paths; ++path) {
+        key value = object->keyof(path);
+        if(equal(&links[path], value))
+            continue;
+        unfile(path, object);
+        set(&links[path], value);
+        file(path, object);
+    }
+    return true;
+}
+
+bool MultiIndex::remove(member *object)
+{
+    assert(object != NULL);
+
+    if(object->index != this)
+        return false;
+
+    for(unsigned path = 0; path < paths; ++path)
+        unfile(path, object);
+
+    if(object->prev)
+        object->prev->next = object->next;
+    else
+        first = object->next;
+    if(object->next)
+        object->next->prev = object->prev;
+    else
+        last = object->prev;
+
+    free(object->links);
+    object->links = NULL;
+    object->index = NULL;
+    object->prev = object->next = NULL;
+    --used;
+    object->release();
+    return true;
+}
+
+MultiIndex::member *MultiIndex::find(unsigned path, const key& value, member *after) const
+{
+    assert(path < paths);
+
+    if(list[path].hashed) {
+        unsigned hash;
+        if(value.data)
+            hash = hash_key(value.data, value.size);
+        else
+            hash = hash_key(&value.number, sizeof(value.number));
+        return list[path].hashed->find(value, hash, after);
+    }
+
+    iterator pos;
+    if(after && after->index == this) {
+        pos = from(path, value);
+        while(pos && *pos != after)
+            pos.next();
+        if(pos)
+            pos.next();
+    }
+    else if(!after)
+        pos = from(path, value);
+
+    if(pos && equal(&((const link_t *)pos->links)[path], value))
+        return *pos;
+    return NULL;
+}
+
+MultiIndex::iterator MultiIndex::begin(unsigned path) const
+{
+    assert(path < paths);
+
+    if(!list[path].ordered)
+        return iterator();
+
+    return iterator(list[path].ordered->begin());
+}
+
+MultiIndex::iterator MultiIndex::from(unsigned path, const key& value) const
+{
+    assert(path < paths);
+
+    if(!list[path].ordered)
+        return iterator();
+
+    return iterator(list[path].ordered->from(order(value)));
+}
+
+void MultiIndex::clear(void)
+{
+    while(first)
+        remove(first);
+}
+
+} // namespace ucommon
@@ -22,11 +22,35 @@
 #include <ucommon-config.h>
 #include <ucommon/export.h>
 #include <ucommon/persist.h>
+#include <string.h>
+#include <stdio.h>
+#ifdef  HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef  HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef  HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 namespace ucommon {
 
 const uint32_t NullObject = 0xffffffff;
 
+// size of the write combining buffer
+const uint32_t BufferSize = 65536;
+
+// indexed archive format version, header and trailer marks
+const uint32_t IndexVersion = 2;
+static const char IndexHeader[4] = {'U', 'C', 'P', 'A'};
+static const char IndexTrailer[4] = {'U', 'C', 'P', 'X'};
+
+// header, and trailer offset with mark
+const uint64_t HeaderSize = 8;
+const uint64_t TrailerSize = 12;
+
 PersistException::PersistException(const std::string& reason) :
 _what(reason)
 {
@@ -112,30 +136,464 @@ TypeManager::registration::~registration()
     TypeManager::remove(myName.c_str());
 }
 
-PersistEngine::PersistEngine(std::iostream& stream, EngineMode mode) throw(PersistException) :
-myUnderlyingStream(stream), myOperationalMode(mode)
+PersistEngine::PersistEngine(std::iostream& stream, EngineMode mode, bool indexed) throw(PersistException) :
+myUnderlyingStream(&stream), myOperationalMode(mode)
+{
+    myData = NULL;
+    mySize = myPosition = 0;
+    myMapped = false;
+    myBuffer = NULL;
+    myBuffered = 0;
+    myDepth = 0;
+    myIndexed = indexed;
+    myBase = myWritten = 0;
+
+    if(mode == modeWrite) {
+        myBuffer = new uint8_t[BufferSize];
+        if(indexed) {
+            writeBinary((const uint8_t *)IndexHeader, sizeof(IndexHeader));
+            write(IndexVersion);
+        }
+    }
+    else if(indexed) {
+        myBase = (uint64_t)stream.rdbuf()->pubseekoff(0, std::ios::cur, std::ios::in);
+        readIndex();
+    }
+}
+
+PersistEngine::PersistEngine(const uint8_t *data, size_t size) throw(PersistException) :
+myUnderlyingStream(NULL), myOperationalMode(modeRead)
+{
+    myData = data;
+    mySize = size;
+    myPosition = 0;
+    myMapped = false;
+    myBuffer = NULL;
+    myBuffered = 0;
+    myDepth = 0;
+    myIndexed = false;
+    myBase = myWritten = 0;
+
+    readIndex();
+}
+
+PersistEngine::PersistEngine(const char *path) throw(PersistException) :
+myUnderlyingStream(NULL), myOperationalMode(modeRead)
 {
+    myData = NULL;
+    mySize = myPosition = 0;
+    myMapped = false;
+    myBuffer = NULL;
+    myBuffered = 0;
+    myDepth = 0;
+    myIndexed = false;
+    myBase = myWritten = 0;
+
+#if defined(HAVE_SYS_MMAN_H) && !defined(_MSWINDOWS_)
+    struct stat ino;
+
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0)
+        throw(PersistException(std::string("Unable to open archive ") + path));
+
+    if(fstat(fd, &ino)) {
+        ::close(fd);
+        throw(PersistException(std::string("Unable to open archive ") + path));
+    }
+
+    mySize = (size_t)ino.st_size;
+    if(!mySize) {
+        ::close(fd);
+        return;
+    }
+
+    caddr_t map = (caddr_t)mmap(NULL, mySize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(map == (caddr_t)MAP_FAILED)
+        throw(PersistException(std::string("Unable to map archive ") + path));
+
+#ifdef  MADV_SEQUENTIAL
+    madvise(map, mySize, MADV_SEQUENTIAL);
+#endif
+
+    myData = (const uint8_t *)map;
+    myMapped = true;
+    readIndex();
+#else
+    FILE *fp = fopen(path, "rb");
+    if(!fp)
+        throw(PersistException(std::string("Unable to open archive ") + path));
+
+    fseek(fp, 0l, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0l, SEEK_SET);
+    if(size > 0) {
+        myBuffer = new uint8_t[size];
+        mySize = fread(myBuffer, 1, (size_t)size, fp);
+        myData = myBuffer;
+    }
+    fclose(fp);
+    readIndex();
+#endif
 }
 
 PersistEngine::~PersistEngine()
 {
-    if (myUnderlyingStream.good())
-        myUnderlyingStream.sync();
+    if(myIndexed && myOperationalMode == modeWrite && myUnderlyingStream->good()) {
+        try {
+            writeIndex();
+        }
+        catch(PersistException&) {
+        }
+    }
+
+    if(myUnderlyingStream) {
+        if(myBuffered && myUnderlyingStream->good())
+            myUnderlyingStream->write((const char *)myBuffer, myBuffered);
+        if (myUnderlyingStream->good())
+            myUnderlyingStream->sync();
+    }
+
+#ifdef  HAVE_SYS_MMAN_H
+    if(myMapped)
+        munmap((caddr_t)myData, mySize);
+#endif
+
+    if(myBuffer)
+        delete[] myBuffer;
+}
+
+void PersistEngine::flushBuffer(void) throw(PersistException)
+{
+    if(!myBuffered)
+        return;
+
+    myUnderlyingStream->write((const char *)myBuffer, myBuffered);
+    myBuffered = 0;
+    if(!myUnderlyingStream->good())
+        throw(PersistException("Unable to write to stream"));
+}
+
+void PersistEngine::flush(void) throw(PersistException)
+{
+    if(myOperationalMode != modeWrite)
+        return;
+
+    flushBuffer();
+    myUnderlyingStream->flush();
 }
 
 void PersistEngine::writeBinary(const uint8_t* data, const uint32_t size) throw(PersistException)
 {
   if(myOperationalMode != modeWrite)
-    throw("Cannot write to an input Engine");
-  myUnderlyingStream.write((const char *)data,size);
-}
+    throw(PersistException("Cannot write to an input Engine"));
+
+  if(size > BufferSize - myBuffered) {
+    flushBuffer();
+    // large blocks go straight to the stream
+    if(size >= BufferSize) {
+      myWritten += size;
+      myUnderlyingStream->write((const char *)data, size);
+      if(!myUnderlyingStream->good())
+        throw(PersistException("Unable to write to stream"));
+      return;
+    }
+  }
 
+  memcpy(myBuffer + myBuffered, data, size);
+  myBuffered += size;
+  myWritten += size;
+}
 
 void PersistEngine::readBinary(uint8_t* data, uint32_t size) throw(PersistException)
 {
   if(myOperationalMode != modeRead)
-    throw("Cannot read from an output Engine");
-  myUnderlyingStream.read((char *)data,size);
+    throw(PersistException("Cannot read from an output Engine"));
+
+  if(myUnderlyingStream) {
+    // go to the stream buffer directly, skipping the sentry of each read
+    if(myUnderlyingStream->rdbuf()->sgetn((char *)data, size) != (std::streamsize)size)
+      throw(PersistException("Unexpected end of archive"));
+    return;
+  }
+
+  if(size > mySize - myPosition)
+    throw(PersistException("Unexpected end of archive"));
+
+  memcpy(data, myData + myPosition, size);
+  myPosition += size;
+}
+
+// blocks larger than a single binary read or write are passed in parts
+void PersistEngine::readBlock(uint8_t *data, uint64_t size) throw(PersistException)
+{
+  while(size) {
+    uint32_t part = size > 0x40000000 ? 0x40000000 : (uint32_t)size;
+    readBinary(data, part);
+    data += part;
+    size -= part;
+  }
+}
+
+void PersistEngine::writeBlock(const uint8_t *data, uint64_t size) throw(PersistException)
+{
+  while(size) {
+    uint32_t part = size > 0x40000000 ? 0x40000000 : (uint32_t)size;
+    writeBinary(data, part);
+    data += part;
+    size -= part;
+  }
+}
+
+uint64_t PersistEngine::remaining(void) throw(PersistException)
+{
+  if(myOperationalMode != modeRead)
+    throw(PersistException("Cannot read from an output Engine"));
+
+  if(!myUnderlyingStream)
+    return mySize - myPosition;
+
+  std::streambuf *buf = myUnderlyingStream->rdbuf();
+  std::streampos pos = buf->pubseekoff(0, std::ios::cur, std::ios::in);
+  if(pos == std::streampos(-1))
+    return (uint64_t)(-1);
+
+  std::streampos end = buf->pubseekoff(0, std::ios::end, std::ios::in);
+  buf->pubseekpos(pos, std::ios::in);
+  if(end == std::streampos(-1) || end < pos)
+    return (uint64_t)(-1);
+  return (uint64_t)(end - pos);
+}
+
+uint64_t PersistEngine::tell(void) throw(PersistException)
+{
+  if(myOperationalMode == modeWrite)
+    return myWritten;
+
+  if(!myUnderlyingStream)
+    return myPosition;
+
+  std::streampos pos = myUnderlyingStream->rdbuf()->pubseekoff(0, std::ios::cur, std::ios::in);
+  if(pos == std::streampos(-1))
+    throw(PersistException("Archive stream is not seekable"));
+  return (uint64_t)pos - myBase;
+}
+
+void PersistEngine::seek(uint64_t offset) throw(PersistException)
+{
+  if(!myUnderlyingStream) {
+    if(offset > mySize)
+      throw(PersistException("Invalid archive offset"));
+    myPosition = (size_t)offset;
+    return;
+  }
+
+  if(myUnderlyingStream->rdbuf()->pubseekpos(std::streampos(myBase + offset), std::ios::in) == std::streampos(-1))
+    throw(PersistException("Archive stream is not seekable"));
+}
+
+void PersistEngine::readIndex(void) throw(PersistException)
+{
+  uint64_t size;
+  char mark[4];
+
+  if(myUnderlyingStream) {
+    std::streampos end = myUnderlyingStream->rdbuf()->pubseekoff(0, std::ios::end, std::ios::in);
+    if(end == std::streampos(-1))
+      throw(PersistException("Archive stream is not seekable"));
+    size = (uint64_t)end - myBase;
+  }
+  else {
+    // memory archives are only indexed if both marks are present
+    size = mySize;
+    if(size < HeaderSize + TrailerSize || memcmp(myData, IndexHeader, 4) || memcmp(myData + size - 4, IndexTrailer, 4))
+      return;
+    myIndexed = true;
+  }
+
+  if(size < HeaderSize + TrailerSize)
+    throw(PersistException("Invalid indexed archive"));
+
+  uint32_t version = 0;
+  seek(0);
+  readBinary((uint8_t *)mark, sizeof(mark));
+  read(version);
+  if(memcmp(mark, IndexHeader, sizeof(mark)))
+    throw(PersistException("Invalid indexed archive"));
+  if(version != IndexVersion)
+    throw(PersistException("Unsupported archive version"));
+
+  uint64_t start = 0;
+  seek(size - TrailerSize);
+  read(start);
+  readBinary((uint8_t *)mark, sizeof(mark));
+  if(memcmp(mark, IndexTrailer, sizeof(mark)) || start < HeaderSize || start > size - TrailerSize)
+    throw(PersistException("Invalid indexed archive"));
+
+  uint32_t count = 0;
+  seek(start);
+  read(count);
+  myClassVector.resize(count);
+  for(uint32_t pos = 0; pos < count; ++pos)
+    read(myClassVector[pos]);
+
+  read(count);
+  myIndex.resize(count);
+  for(uint32_t pos = 0; pos < count; ++pos) {
+    IndexEntry& entry = myIndex[pos];
+    read(entry.offset);
+    read(entry.length);
+    read(entry.type);
+    if(entry.offset < HeaderSize || entry.offset > start || entry.length > start - entry.offset || entry.type >= myClassVector.size())
+      throw(PersistException("Invalid archive index"));
+  }
+
+  myArchiveVector.assign(count, NULL);
+  seek(HeaderSize);
+}
+
+void PersistEngine::writeIndex(void) throw(PersistException)
+{
+  uint64_t start = myWritten;
+
+  ClassVector names(myClassMap.size());
+  for(ClassMap::const_iterator it = myClassMap.begin(); it != myClassMap.end(); ++it)
+    names[it->second] = it->first;
+
+  write((uint32_t)names.size());
+  for(uint32_t pos = 0; pos < names.size(); ++pos)
+    write(names[pos]);
+
+  write((uint32_t)myIndex.size());
+  for(uint32_t pos = 0; pos < myIndex.size(); ++pos) {
+    write(myIndex[pos].offset);
+    write(myIndex[pos].length);
+    write(myIndex[pos].type);
+  }
+
+  write(start);
+  writeBinary((const uint8_t *)IndexTrailer, sizeof(IndexTrailer));
+  flushBuffer();
+
+  // the trailer ends the archive
+  myIndexed = false;
+}
+
+PersistObject *PersistEngine::readRecord(uint32_t id, PersistObject *object) throw(PersistException)
+{
+  IndexEntry entry = myIndex[id];
+  const std::string& className = myClassVector[entry.type];
+
+  if(!object)
+    object = TypeManager::createInstanceOf(className.c_str());
+  if(!object)
+    throw(PersistException(std::string("Unable to instantiate object of class ")+className));
+
+  myArchiveVector[id] = object;
+  object->read(*this);
+  if(tell() != entry.offset + entry.length)
+    throw(PersistException("Object record size mismatch"));
+
+  return object;
+}
+
+PersistObject *PersistEngine::fetch(uint32_t id, PersistObject *object) throw(PersistException)
+{
+  if(id >= myIndex.size())
+    throw(PersistException("Invalid object reference"));
+
+  // records are written where the object is first referenced, and one
+  // already loaded out of order is skipped over
+  uint64_t pos = tell();
+  if(myArchiveVector[id]) {
+    if(pos == myIndex[id].offset)
+      seek(myIndex[id].offset + myIndex[id].length);
+    return myArchiveVector[id];
+  }
+
+  if(pos == myIndex[id].offset)
+    return readRecord(id, object);
+
+  seek(myIndex[id].offset);
+  object = readRecord(id, object);
+  seek(pos);
+  return object;
+}
+
+PersistObject *PersistEngine::resolve(uint32_t id, PersistObject *object) throw(PersistException)
+{
+  if(id == NullObject)
+    return NULL;
+
+  if(myIndexed)
+    return fetch(id, object);
+
+  // Do we already have this object in memory?
+  if (id < myArchiveVector.size())
+    return myArchiveVector[id];
+
+  // Okay - read the identifier for the class in...
+  std::string className = readClass();
+
+  // is the pointer already initialized? if so then no need to reallocate
+  if (object != NULL) {
+    readObject(object);
+    return object;
+  }
+
+  // Create the object (of the relevant type)
+  object = TypeManager::createInstanceOf(className.c_str());
+  if (object) {
+    // Okay then - we can make this object
+    readObject(object);
+  }
+  else
+    throw(PersistException(std::string("Unable to instantiate object of class ")+className));
+
+  return object;
+}
+
+PersistObject *PersistEngine::load(uint32_t id) throw(PersistException)
+{
+  if(myOperationalMode != modeRead)
+    throw(PersistException("Cannot read from an output Engine"));
+
+  if(myIndexed)
+    return fetch(id, NULL);
+
+  if(id < myArchiveVector.size())
+    return myArchiveVector[id];
+
+  return NULL;
+}
+
+bool PersistEngine::readReference(uint32_t& id) throw(PersistException)
+{
+  read(id);
+  if(id == NullObject)
+    return false;
+
+  if(!myIndexed) {
+    resolve(id, NULL);
+    return true;
+  }
+
+  if(id >= myIndex.size())
+    throw(PersistException("Invalid object reference"));
+
+  // skip over a record written here, it is read when used
+  if(tell() == myIndex[id].offset)
+    seek(myIndex[id].offset + myIndex[id].length);
+
+  return true;
+}
+
+size_t PersistEngine::objects(void) const
+{
+  if(myOperationalMode == modeWrite)
+    return myArchiveMap.size();
+
+  return myArchiveVector.size();
 }
 
 void PersistEngine::write(const PersistObject *object) throw(PersistException)
@@ -156,6 +614,26 @@ void PersistEngine::write(const PersistObject *object) throw(PersistException)
     uint32_t id = (uint32_t)myArchiveMap.size();
     myArchiveMap[object] = id; // bumps id automatically for next one
     write(id);
+    if(myIndexed) {
+      // the record is indexed by offset, and the class named in the trailer
+      ClassMap::const_iterator classItor = myClassMap.find(object->getPersistenceID());
+      uint32_t classId = (uint32_t)myClassMap.size();
+      if (classItor == myClassMap.end())
+        myClassMap[object->getPersistenceID()] = classId;
+      else
+        classId = classItor->second;
+      if (myIndex.size() <= id)
+        myIndex.resize(id + 1);
+      myIndex[id].offset = myWritten;
+      myIndex[id].type = classId;
+      ++myDepth;
+      object->write(*this);
+      --myDepth;
+      myIndex[id].length = myWritten - myIndex[id].offset;
+      if(!myDepth)
+        flushBuffer();
+      return;
+    }
     ClassMap::const_iterator classItor = myClassMap.find(object->getPersistenceID());
     if (classItor == myClassMap.end()) {
       uint32_t classId = (uint32_t)myClassMap.size();
@@ -169,9 +647,14 @@ void PersistEngine::write(const PersistObject *object) throw(PersistException)
     std::string majik;
     majik = "OBST";
     write(majik);
+    ++myDepth;
     object->write(*this);
+    --myDepth;
     majik = "OBEN";
     write(majik);
+    // a complete top level object is passed on to the stream
+    if(!myDepth)
+      flushBuffer();
   }
   else {
     // This object has been serialized, so just pop its ID out
@@ -184,7 +667,14 @@ void PersistEngine::read(PersistObject &object) throw(PersistException)
   uint32_t id = 0;
   read(id);
   if (id == NullObject)
-    throw("Object Id should not be NULL when un-persisting to a reference");
+    throw(PersistException("Object Id should not be NULL when un-persisting to a reference"));
+
+  if (myIndexed) {
+    PersistObject *found = fetch(id, &object);
+    if (found != &object)
+      object = *found;
+    return;
+  }
 
   // Do we already have this object in memory?
   if (id < myArchiveVector.size()) {
@@ -204,35 +694,7 @@ void PersistEngine::read(PersistObject *&object) throw(PersistException)
 {
   uint32_t id = 0;
   read(id);
-  // Is the ID a NULL object?
-  if (id == NullObject) {
-    object = NULL;
-    return;
-  }
-
-  // Do we already have this object in memory?
-  if (id < myArchiveVector.size()) {
-    object = myArchiveVector[id];
-    return;
-  }
-
-  // Okay - read the identifier for the class in...
-  std::string className = readClass();
-
-  // is the pointer already initialized? if so then no need to reallocate
-  if (object != NULL) {
-    readObject(object);
-    return;
-  }
-
-  // Create the object (of the relevant type)
-  object = TypeManager::createInstanceOf(className.c_str());
-  if (object) {
-    // Okay then - we can make this object
-    readObject(object);
-  }
-  else
-    throw(PersistException(std::string("Unable to instantiate object of class ")+className));
+  object = resolve(id, object);
 }
 
 void PersistEngine::readObject(PersistObject* object) throw(PersistException)
@@ -278,11 +740,16 @@ void PersistEngine::read(std::string& str) throw(PersistException)
 {
   uint32_t len = 0;
   read(len);
-  uint8_t *buffer = new uint8_t[len+1];
-  readBinary(buffer,len);
-  buffer[len] = 0;
-  str = (char*)buffer;
-  delete[] buffer;
+  if(!myUnderlyingStream && myOperationalMode == modeRead) {
+    if(len > mySize - myPosition)
+      throw(PersistException("Unexpected end of archive"));
+    str.assign((const char *)(myData + myPosition), len);
+    myPosition += len;
+    return;
+  }
+  str.resize(len);
+  if(len)
+    readBinary((uint8_t *)&str[0], len);
 }
 
 } // namespace ucommon
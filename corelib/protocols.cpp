@@ -170,6 +170,10 @@ bool BufferProtocol::_blocking(void)
     return false;
 }
 
+void BufferProtocol::_seterr(int)
+{
+}
+
 size_t BufferProtocol::put(const void *address, size_t size)
 {
     size_t count = 0;
@@ -222,6 +226,189 @@ size_t BufferProtocol::get(void *address, size_t size)
     return count;
 }
 
+const char *BufferProtocol::buffered(size_t& count)
+{
+    count = 0;
+    if(!input)
+        return NULL;
+
+    if(bufpos == insize) {
+        if(end)
+            return NULL;
+
+        insize = _pull(input, bufsize);
+        bufpos = 0;
+        if(insize == 0)
+            end = true;
+        else if(insize < bufsize && !_blocking())
+            end = true;
+
+        if(!insize)
+            return NULL;
+    }
+
+    count = insize - bufpos;
+    return input + bufpos;
+}
+
+void BufferProtocol::consume(size_t count)
+{
+    if(count > insize - bufpos)
+        count = insize - bufpos;
+
+    bufpos += count;
+}
+
+const char *BufferProtocol::nextline(size_t& size)
+{
+    size = 0;
+    if(!input)
+        return NULL;
+
+    size_t scan = bufpos;
+    for(;;) {
+        const char *line = input + bufpos;
+        const char *nl = (const char *)memchr(input + scan, '\n', insize - scan);
+        if(nl) {
+            size = (size_t)(nl - line);
+            bufpos = (size_t)(nl - input) + 1;
+            if(size && line[size - 1] == '\r')
+                --size;
+            return line;
+        }
+
+        // a partial last line, or a line that fills the whole buffer
+        if(end || (!bufpos && insize == bufsize)) {
+            if(bufpos == insize)
+                return NULL;
+            size = insize - bufpos;
+            bufpos = insize;
+            return line;
+        }
+
+        // keep the partial line and fill in after it
+        if(bufpos) {
+            insize -= bufpos;
+            memmove(input, line, insize);
+            bufpos = 0;
+        }
+
+        scan = insize;
+        size_t count = _pull(input + insize, bufsize - insize);
+        if(count == 0)
+            end = true;
+        else if(count < bufsize - insize && !_blocking())
+            end = true;
+        insize += count;
+    }
+}
+
+const char *BufferProtocol::nextreply(size_t& size, framing_t framing, void *user)
+{
+    size = 0;
+    if(!input || !framing)
+        return NULL;
+
+    for(;;) {
+        if(bufpos < insize) {
+            size_t len = framing(input + bufpos, insize - bufpos, user);
+            if(len > bufsize) {
+                _seterr(EMSGSIZE);
+                return NULL;
+            }
+            // a framing length past the data waiting reads the rest
+            if(len && len <= insize - bufpos) {
+                const char *reply = input + bufpos;
+                size = len;
+                bufpos += len;
+                return reply;
+            }
+        }
+
+        if(end)
+            return NULL;
+
+        // a reply not framed in a full buffer will never fit
+        if(!bufpos && insize == bufsize) {
+            _seterr(EMSGSIZE);
+            return NULL;
+        }
+
+        if(bufpos) {
+            insize -= bufpos;
+            memmove(input, input + bufpos, insize);
+            bufpos = 0;
+        }
+
+        // requests still queued are sent before waiting for their replies
+        if(outsize && !_flush())
+            return NULL;
+
+        size_t count = _pull(input + insize, bufsize - insize);
+        if(count == 0)
+            end = true;
+        else if(count < bufsize - insize && !_blocking())
+            end = true;
+        insize += count;
+    }
+}
+
+size_t BufferProtocol::lineframe(const char *data, size_t size, void *)
+{
+    const char *nl = (const char *)memchr(data, '\n', size);
+    if(!nl)
+        return 0;
+
+    return (size_t)(nl - data) + 1;
+}
+
+size_t BufferProtocol::getline(char *string, size_t size)
+{
+    // other line endings are matched a character at a time
+    if(!input || back || !eol || (!eq(eol, "\r\n") && !eq(eol, "\n")))
+        return CharacterProtocol::getline(string, size);
+
+    if(!string || size < 1)
+        return 0;
+
+    size_t count = 0;
+    while(count < size - 1) {
+        size_t len;
+        const char *data = buffered(len);
+        if(!data) {
+            string[count] = 0;
+            return count;
+        }
+
+        if(len > size - 1 - count)
+            len = size - 1 - count;
+
+        const char *nl = (const char *)memchr(data, '\n', len);
+        if(nl)
+            len = (size_t)(nl - data) + 1;
+
+        memcpy(string + count, data, len);
+        consume(len);
+        count += len;
+
+        if(nl) {
+            --count;
+            if(eol[0] == '\r' && count && string[count - 1] == '\r')
+                --count;
+            break;
+        }
+    }
+    string[count] = 0;
+    return count + 1;
+}
+
+size_t BufferProtocol::getline(String& s)
+{
+    size_t result = getline(s.c_mem(), s.size() + 1);
+    String::fix(s);
+    return result;
+}
+
 int BufferProtocol::_getch(void)
 {
     if(!input)
@@ -352,7 +539,7 @@ char *BufferProtocol::gather(size_t size)
         if(end)
             return NULL;
 
-        size_t adjust = outsize - bufpos;
+        size_t adjust = insize - bufpos;
         memmove(input, input + bufpos, adjust);
         insize = adjust +  _pull(input, bufsize - adjust);
         bufpos = 0;
@@ -387,12 +574,16 @@ size_t CharacterProtocol::putline(const char *string)
 {
     size_t count = 0;
 
-    while(string && *string && (EOF != _putch(*string)))
+    while(string && *string && (EOF != _putch(*string))) {
+        ++string;
         ++count;
+    }
 
     string = eol;
-    while(string && *string && (EOF != _putch(*string)))
+    while(string && *string && (EOF != _putch(*string))) {
+        ++string;
         ++count;
+    }
 
     return count;
 }
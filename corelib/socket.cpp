@@ -27,6 +27,7 @@
 #include <sys/un.h>
 #include <sys/ioctl.h>
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
 #else
 #define HAVE_GETADDRINFO 1
 #endif
@@ -1823,8 +1824,9 @@ void Socket::release(socket_t so)
 #ifdef  _MSWINDOWS_
     ::closesocket(so);
 #else
-    if(!::shutdown(so, SHUT_RDWR))
-        ::close(so);
+    // a peer that already hung up fails shutdown, but still must close
+    ::shutdown(so, SHUT_RDWR);
+    ::close(so);
 #endif
 }
 
@@ -2087,14 +2089,14 @@ ssize_t Socket::readline(socket_t so, char *data, size_t max, timeout_t timeout)
         if(nstat == 0)
             return max - nleft - 1;
 
-        for(c = 0; c < nstat; ++c) {
-            if(data[c] == '\n') {
-                if(c > 0 && data[c - 1] == '\r')
-                    crlf = true;
-                ++c;
-                nl = true;
-                break;
-            }
+        c = nstat;
+        const char *eol = (const char *)memchr(data, '\n', nstat);
+        if(eol) {
+            c = (int)(eol - data);
+            if(c > 0 && data[c - 1] == '\r')
+                crlf = true;
+            ++c;
+            nl = true;
         }
 
         nstat = _recv_(so, (caddr_t)data, c, 0);
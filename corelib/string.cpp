@@ -26,6 +26,9 @@
 #include <fcntl.h>
 #endif
 #include <limits.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
 
 namespace ucommon {
 
@@ -1981,6 +1984,256 @@ char *String::fill(char *str, size_t size, char fill)
     return str;
 }
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CODEC_X86
+#endif
+
+static const unsigned char alphabet[65] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static const char hexdigits[17] = "0123456789abcdef";
+
+#define CRC24_INIT 0xb704ceL
+#define CRC24_POLY 0x1864cfbL
+#define CRC32C_POLY 0x82f63b78L
+
+// codec tables are built once when the library is loaded, so no call has
+// to rebuild a decoder or shift through a polynomial bit at a time.
+static uint8_t b64_decoder[256];
+static uint8_t hex_decoder[256];
+static uint16_t crc16_table[8][256];
+static uint32_t crc24_table[8][256];
+static uint32_t crc32c_table[8][256];
+static bool codec_ssse3 = false;
+static bool codec_sse42 = false;
+
+class __LOCAL codec_init
+{
+public:
+    codec_init();
+};
+
+codec_init::codec_init()
+{
+    unsigned i, k;
+
+    for(i = 0; i < 256; ++i) {
+        b64_decoder[i] = 64;
+        if(i >= '0' && i <= '9')
+            hex_decoder[i] = (uint8_t)(i - '0');
+        else
+            hex_decoder[i] = (uint8_t)(toupper(i & 0x7f) - 'A' + 10);
+    }
+
+    for(i = 0; i < 64; ++i)
+        b64_decoder[alphabet[i]] = (uint8_t)i;
+
+    for(i = 0; i < 256; ++i) {
+        uint16_t c16 = (uint16_t)i;
+        uint32_t c24 = (uint32_t)i << 16;
+        uint32_t c32 = (uint32_t)i;
+        for(k = 0; k < 8; ++k) {
+            c16 = (c16 & 1) ? (uint16_t)((c16 >> 1) ^ 0xa001) : (uint16_t)(c16 >> 1);
+            c24 <<= 1;
+            if(c24 & 0x1000000)
+                c24 ^= CRC24_POLY;
+            c32 = (c32 & 1) ? (c32 >> 1) ^ CRC32C_POLY : (c32 >> 1);
+        }
+        crc16_table[0][i] = c16;
+        crc24_table[0][i] = c24 & 0xffffff;
+        crc32c_table[0][i] = c32;
+    }
+
+    // slice k is the effect of a byte followed by k zero bytes
+    for(k = 1; k < 8; ++k) {
+        for(i = 0; i < 256; ++i) {
+            uint16_t c16 = crc16_table[k - 1][i];
+            uint32_t c24 = crc24_table[k - 1][i];
+            uint32_t c32 = crc32c_table[k - 1][i];
+            crc16_table[k][i] = (uint16_t)((c16 >> 8) ^ crc16_table[0][c16 & 0xff]);
+            crc24_table[k][i] = ((c24 << 8) ^ crc24_table[0][(c24 >> 16) & 0xff]) & 0xffffff;
+            crc32c_table[k][i] = (c32 >> 8) ^ crc32c_table[0][c32 & 0xff];
+        }
+    }
+
+#ifdef  CODEC_X86
+    __builtin_cpu_init();
+    codec_ssse3 = __builtin_cpu_supports("ssse3") != 0;
+    codec_sse42 = __builtin_cpu_supports("sse4.2") != 0;
+#endif
+}
+
+static codec_init codecs;
+
+static inline uint32_t get32le(const uint8_t *p)
+{
+    return ((uint32_t)p[0]) | (((uint32_t)p[1]) << 8) |
+        (((uint32_t)p[2]) << 16) | (((uint32_t)p[3]) << 24);
+}
+
+#ifdef  CODEC_X86
+
+__attribute__((target("ssse3")))
+static void hexencode_ssse3(char *dest, const uint8_t *bin, size_t size)
+{
+    const __m128i lut = _mm_loadu_si128((const __m128i *)hexdigits);
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+
+    while(size >= 16) {
+        __m128i in = _mm_loadu_si128((const __m128i *)bin);
+        __m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(in, 4), nibble));
+        __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(in, nibble));
+        _mm_storeu_si128((__m128i *)dest, _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i *)(dest + 16), _mm_unpackhi_epi8(hi, lo));
+        bin += 16;
+        dest += 32;
+        size -= 16;
+    }
+
+    while(size--) {
+        *(dest++) = hexdigits[*bin >> 4];
+        *(dest++) = hexdigits[*(bin++) & 0x0f];
+    }
+}
+
+// encodes 12 input bytes (of 16 loaded) into 16 radix 64 characters.
+__attribute__((target("ssse3")))
+static inline __m128i b64encode_block(__m128i in)
+{
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    const __m128i index = _mm_or_si128(t1, t3);
+
+    // map each 6 bit index range onto the offset to its ascii character
+    const __m128i offsets = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+        '/' - 63, 'A', 0, 0);
+    __m128i range = _mm_subs_epu8(index, _mm_set1_epi8(51));
+    const __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), index);
+    range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+    return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), index);
+}
+
+__attribute__((target("ssse3")))
+static size_t b64encode_ssse3(char *dest, const uint8_t *bin, size_t size, size_t dsize)
+{
+    size_t count = 0;
+
+    // 16 bytes are loaded per block, so keep 4 bytes of slack in the source
+    while(size >= 16 && dsize > 16) {
+        _mm_storeu_si128((__m128i *)dest, b64encode_block(_mm_loadu_si128((const __m128i *)bin)));
+        bin += 12;
+        size -= 12;
+        count += 12;
+        dest += 16;
+        dsize -= 16;
+    }
+    return count;
+}
+
+// decodes 16 radix 64 characters into 12 bytes, false if any is invalid.
+__attribute__((target("ssse3")))
+static inline bool b64decode_block(__m128i in, uint8_t *dest)
+{
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    const __m128i hi = _mm_and_si128(_mm_srli_epi32(in, 4), nibble);
+    const __m128i lo = _mm_and_si128(in, nibble);
+    const __m128i offsets = _mm_setr_epi8(
+        0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i valid = _mm_setr_epi8(
+        (char)0xa8, (char)0xf8, (char)0xf8, (char)0xf8,
+        (char)0xf8, (char)0xf8, (char)0xf8, (char)0xf8,
+        (char)0xf8, (char)0xf8, (char)0xf0, (char)0x54,
+        (char)0x50, (char)0x50, (char)0x50, (char)0x54);
+    const __m128i bitpos = _mm_setr_epi8(
+        0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80,
+        0, 0, 0, 0, 0, 0, 0, 0);
+
+    const __m128i bits = _mm_and_si128(_mm_shuffle_epi8(valid, lo), _mm_shuffle_epi8(bitpos, hi));
+    if(_mm_movemask_epi8(_mm_cmpeq_epi8(bits, _mm_setzero_si128())))
+        return false;
+
+    const __m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+    const __m128i shift = _mm_or_si128(
+        _mm_andnot_si128(slash, _mm_shuffle_epi8(offsets, hi)),
+        _mm_and_si128(slash, _mm_set1_epi8(16)));
+    const __m128i values = _mm_add_epi8(in, shift);
+
+    const __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    const __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    const __m128i out = _mm_shuffle_epi8(quads, _mm_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+    uint8_t block[16];
+    _mm_storeu_si128((__m128i *)block, out);
+    memcpy(dest, block, 12);
+    return true;
+}
+
+__attribute__((target("ssse3")))
+static size_t b64decode_ssse3(uint8_t *dest, const char *src, size_t len, size_t size)
+{
+    size_t count = 0;
+
+    while(len >= 16 && size >= 12) {
+        if(!b64decode_block(_mm_loadu_si128((const __m128i *)src), dest))
+            break;
+        src += 16;
+        len -= 16;
+        dest += 12;
+        size -= 12;
+        count += 12;
+    }
+    return count;
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const uint8_t *bin, size_t size)
+{
+#ifdef  __x86_64__
+    uint64_t crc64 = crc;
+    while(size >= 8) {
+        uint64_t word;
+        memcpy(&word, bin, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        bin += 8;
+        size -= 8;
+    }
+    crc = (uint32_t)crc64;
+#else
+    while(size >= 4) {
+        uint32_t word;
+        memcpy(&word, bin, 4);
+        crc = _mm_crc32_u32(crc, word);
+        bin += 4;
+        size -= 4;
+    }
+#endif
+    while(size--)
+        crc = _mm_crc32_u8(crc, *(bin++));
+    return crc;
+}
+
+#endif
+
+static void hexencode(char *dest, const uint8_t *bin, size_t size)
+{
+#ifdef  CODEC_X86
+    if(codec_ssse3 && size >= 16) {
+        hexencode_ssse3(dest, bin, size);
+        return;
+    }
+#endif
+    while(size--) {
+        *(dest++) = hexdigits[*bin >> 4];
+        *(dest++) = hexdigits[*(bin++) & 0x0f];
+    }
+}
+
 unsigned String::hexsize(const char *format)
 {
     unsigned count = 0;
@@ -2006,12 +2259,10 @@ String String::hex(const unsigned char *binary, size_t size)
     strsize_t ssize = (strsize_t)(size * 2);
     String out(ssize, ' ');
     char *buf = out.c_mem();
-    while(size--) {
-        snprintf(buf, 3, "%02x", *(binary++));
-        buf += 2;
-    }
+    hexencode(buf, binary, size);
+    buf[ssize] = 0;
     return out;
-} 
+}
 
 unsigned String::hexdump(const unsigned char *binary, char *string, const char *format)
 {
@@ -2028,24 +2279,15 @@ unsigned String::hexdump(const unsigned char *binary, char *string, const char *
             skip = (unsigned)strtol(format, &ep, 10);
             format = ep;
             count += skip * 2;
-            while(skip--) {
-                snprintf(string, 3, "%02x", *(binary++));
-                string += 2;
-            }
+            hexencode(string, binary, skip);
+            binary += skip;
+            string += skip * 2;
         }
     }
     *string = 0;
     return count;
 }
 
-static unsigned hexcode(char ch)
-{
-    if(ch >= '0' && ch <= '9')
-        return ch - '0';
-    else
-        return toupper(ch) - 'A' + 10;
-}
-
 unsigned String::hexpack(unsigned char *binary, const char *string, const char *format)
 {
     unsigned count = 0;
@@ -2063,7 +2305,8 @@ unsigned String::hexpack(unsigned char *binary, const char *string, const char *
             format = ep;
             count += skip * 2;
             while(skip--) {
-                *(binary++) = hexcode(string[0]) * 16 + hexcode(string[1]);
+                *(binary++) = (unsigned char)((hex_decoder[(uint8_t)string[0]] << 4) +
+                    hex_decoder[(uint8_t)string[1]]);
                 string += 2;
             }
         }
@@ -2216,12 +2459,9 @@ String str(CharacterProtocol *p, strsize_t size)
     return temp;
 }
 
-static const unsigned char alphabet[65] =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
 String String::b64(const uint8_t *bin, size_t size)
 {
-    strsize_t dsize = (strsize_t)((size * 4 / 3) + 1);
+    strsize_t dsize = (strsize_t)(((size + 2) / 3) * 4 + 1);
     String out(dsize, String::eos);
 
     b64encode(out.c_mem(), bin, size);
@@ -2235,13 +2475,24 @@ size_t String::b64encode(char *dest, const uint8_t *bin, size_t size, size_t dsi
     size_t count = 0;
 
     if(!dsize)
-        dsize = (size * 4 / 3) + 1;
+        dsize = ((size + 2) / 3) * 4 + 1;
 
     if (!dsize || !size)
         goto end;
 
     unsigned bits;
 
+#ifdef  CODEC_X86
+    if(codec_ssse3) {
+        size_t done = b64encode_ssse3(dest, bin, size, dsize);
+        bin += done;
+        size -= done;
+        count += done;
+        dest += (done / 3) * 4;
+        dsize -= (done / 3) * 4;
+    }
+#endif
+
     while(size >= 3 && dsize > 4) {
         bits = (((unsigned)bin[0])<<16) | (((unsigned)bin[1])<<8)
             | ((unsigned)bin[2]);
@@ -2279,17 +2530,18 @@ end:
 
 size_t String::b64decode(uint8_t *dest, const char *src, size_t size)
 {
-    char decoder[256];
     unsigned long bits;
     uint8_t c;
-    unsigned i;
     size_t count = 0;
 
-    for (i = 0; i < 256; ++i)
-        decoder[i] = 64;
-
-    for (i = 0; i < 64 ; ++i)
-        decoder[alphabet[i]] = i;
+#ifdef  CODEC_X86
+    if(codec_ssse3) {
+        count = b64decode_ssse3(dest, src, strlen(src), size);
+        dest += count;
+        src += (count / 3) * 4;
+        size -= count;
+    }
+#endif
 
     bits = 1;
 
@@ -2311,9 +2563,9 @@ size_t String::b64decode(uint8_t *dest, const char *src, size_t size)
             break;
         }
         // end on invalid chars
-        if (decoder[c] == 64)
+        if (b64_decoder[c] == 64)
             break;
-        bits = (bits << 6) + decoder[c];
+        bits = (bits << 6) + b64_decoder[c];
         if (bits & 0x1000000) {
             if (size < 3)
                 break;
@@ -2328,40 +2580,70 @@ size_t String::b64decode(uint8_t *dest, const char *src, size_t size)
     return count;
 }
 
-#define CRC24_INIT 0xb704ceL
-#define CRC24_POLY 0x1864cfbL
-
 uint32_t String::crc24(uint8_t *binary, size_t size)
 {
     uint32_t crc = CRC24_INIT;
-    unsigned i;
-
-    while (size--) {
-        crc ^= (*binary++) << 16;
-        for (i = 0; i < 8; i++) {
-            crc <<= 1;
-            if (crc & 0x1000000)
-                crc ^= CRC24_POLY;
-        }
+
+    while(size >= 8) {
+        crc = crc24_table[7][binary[0] ^ (crc >> 16)] ^
+            crc24_table[6][binary[1] ^ ((crc >> 8) & 0xff)] ^
+            crc24_table[5][binary[2] ^ (crc & 0xff)] ^
+            crc24_table[4][binary[3]] ^ crc24_table[3][binary[4]] ^
+            crc24_table[2][binary[5]] ^ crc24_table[1][binary[6]] ^
+            crc24_table[0][binary[7]];
+        binary += 8;
+        size -= 8;
     }
+
+    while(size--)
+        crc = ((crc << 8) ^ crc24_table[0][((crc >> 16) ^ *(binary++)) & 0xff]) & 0xffffff;
+
     return crc & 0xffffffL;
 }
 
 uint16_t String::crc16(uint8_t *binary, size_t size)
 {
-    uint16_t crc = 0xffff;
-    unsigned i;
+    uint32_t crc = 0xffff;
 
-    while (size--) {
-        crc ^= (*binary++);
-        for (i = 0; i < 8; i++) {
-            if(crc & 1)
-                crc = (crc >> 1) ^ 0xa001;
-            else
-                crc = (crc >> 1);
-        }
+    while(size >= 8) {
+        uint32_t low = get32le(binary) ^ crc;
+        crc = crc16_table[7][low & 0xff] ^ crc16_table[6][(low >> 8) & 0xff] ^
+            crc16_table[5][(low >> 16) & 0xff] ^ crc16_table[4][low >> 24] ^
+            crc16_table[3][binary[4]] ^ crc16_table[2][binary[5]] ^
+            crc16_table[1][binary[6]] ^ crc16_table[0][binary[7]];
+        binary += 8;
+        size -= 8;
     }
-    return crc;
+
+    while(size--)
+        crc = (crc >> 8) ^ crc16_table[0][(crc ^ *(binary++)) & 0xff];
+
+    return (uint16_t)crc;
+}
+
+uint32_t String::crc32c(const uint8_t *binary, size_t size, uint32_t crc)
+{
+    crc = ~crc;
+
+#ifdef  CODEC_X86
+    if(codec_sse42)
+        return ~crc32c_sse42(crc, binary, size);
+#endif
+
+    while(size >= 8) {
+        uint32_t low = get32le(binary) ^ crc;
+        crc = crc32c_table[7][low & 0xff] ^ crc32c_table[6][(low >> 8) & 0xff] ^
+            crc32c_table[5][(low >> 16) & 0xff] ^ crc32c_table[4][low >> 24] ^
+            crc32c_table[3][binary[4]] ^ crc32c_table[2][binary[5]] ^
+            crc32c_table[1][binary[6]] ^ crc32c_table[0][binary[7]];
+        binary += 8;
+        size -= 8;
+    }
+
+    while(size--)
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *(binary++)) & 0xff];
+
+    return ~crc;
 }
 
 } // namespace ucommon
@@ -148,6 +148,11 @@ void TCPBuffer::_clear(void)
     ioerr = 0;
 }
 
+void TCPBuffer::_seterr(int error)
+{
+    ioerr = error;
+}
+
 bool TCPBuffer::_blocking(void)
 {
     if(iowait)
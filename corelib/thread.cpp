@@ -36,6 +36,8 @@ static int realtime_policy = SCHED_FIFO;
 
 static unsigned max_sharing = 0;
 
+static ucommon::Timer::clocking_t wait_clocking = ucommon::Timer::PRECISE;
+
 namespace ucommon {
 
 #if _POSIX_TIMERS > 0 && defined(POSIX_TIMERS)
@@ -191,14 +193,18 @@ void Conditional::set(struct timespec *ts, timeout_t msec)
 {
     assert(ts != NULL);
 
+    if(wait_clocking != Timer::PRECISE)
+        Timer::current(ts, wait_clocking);
+    else {
 #if _POSIX_TIMERS > 0 && defined(POSIX_TIMERS)
-    clock_gettime(_posix_clocking, ts);
+        clock_gettime(_posix_clocking, ts);
 #else
-    timeval tv;
-    gettimeofday(&tv, NULL);
-    ts->tv_sec = tv.tv_sec;
-    ts->tv_nsec = tv.tv_usec * 1000l;
+        timeval tv;
+        gettimeofday(&tv, NULL);
+        ts->tv_sec = tv.tv_sec;
+        ts->tv_nsec = tv.tv_usec * 1000l;
 #endif
+    }
     ts->tv_sec += msec / 1000;
     ts->tv_nsec += (msec % 1000) * 1000000l;
     while(ts->tv_nsec >= 1000000000l) {
@@ -207,6 +213,12 @@ void Conditional::set(struct timespec *ts, timeout_t msec)
     }
 }
 
+Timer::clocking_t Conditional::clocking(Timer::clocking_t source)
+{
+    wait_clocking = Timer::prepare(source);
+    return wait_clocking;
+}
+
 Semaphore::Semaphore(unsigned limit) :
 Conditional()
 {
@@ -104,6 +104,312 @@ namespace ucommon {
 #endif
 #endif
 
+#if defined(__x86_64__) && defined(__GNUC__) && defined(HAVE_CLOCK_GETTIME) && !defined(_MSWINDOWS_)
+#define CYCLE_CLOCK
+#endif
+
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC_COARSE) && defined(CLOCK_REALTIME_COARSE)
+#define COARSE_CLOCK
+#endif
+
+#ifdef  __GNUC__
+#define clock_load(x)       __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define clock_store(x, v)   __atomic_store_n(&(x), v, __ATOMIC_RELEASE)
+#else
+#define clock_load(x)       (x)
+#define clock_store(x, v)   ((x) = (v))
+#endif
+
+} // namespace ucommon
+
+#ifdef  CYCLE_CLOCK
+#include <cpuid.h>
+#endif
+
+namespace ucommon {
+
+static Timer::clocking_t timer_clocking = Timer::PRECISE;
+
+// loop time, written to the slot not being read and then published
+static struct timespec loop_time[2];
+static unsigned loop_gen = 0;
+
+static void system_clock(struct timespec *ts)
+{
+#if _POSIX_TIMERS > 0 && defined(POSIX_TIMERS)
+    clock_gettime(_posix_clocking, ts);
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    ts->tv_sec = tv.tv_sec;
+    ts->tv_nsec = tv.tv_usec * 1000l;
+#endif
+}
+
+#if defined(COARSE_CLOCK) || defined(CYCLE_CLOCK)
+// the clock the system clock reads, and its coarse counterpart
+static clockid_t system_clockid(bool coarse)
+{
+#if _POSIX_TIMERS > 0 && defined(POSIX_TIMERS)
+    if(_posix_clocking == CLOCK_MONOTONIC)
+        return coarse ? CLOCK_MONOTONIC_COARSE : CLOCK_MONOTONIC;
+#endif
+    return coarse ? CLOCK_REALTIME_COARSE : CLOCK_REALTIME;
+}
+#endif
+
+#ifdef  CYCLE_CLOCK
+
+// cycle counter reading and scale against the system clock.  The sequence
+// count is odd while a rebase rewrites the base, and readers copy the base
+// again if the count changed while they read it.
+typedef struct {
+    uint64_t cycles;
+    uint64_t nsec;
+    uint64_t scale;     // nanoseconds per cycle, as 32.32 fixed point
+    uint64_t limit;     // cycles until the next rebase
+    clockid_t clock;
+} cycles_t;
+
+static cycles_t cycle_base;
+static unsigned cycle_seq = 0;
+static unsigned cycle_busy = 0;
+static uint64_t cycle_last = 0;     // latest time handed out
+
+static inline uint64_t rdtsc(void)
+{
+    unsigned lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline uint64_t nsec(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// the system clock read between two counter readings, so a reading that
+// was preempted is known by its span and the narrowest of a few is kept
+static uint64_t stamp(clockid_t clock, uint64_t *cycles)
+{
+    uint64_t span = ~(uint64_t)0, at = 0;
+
+    for(unsigned tries = 0; tries < 4; ++tries) {
+        uint64_t before = rdtsc();
+        uint64_t when = nsec(clock);
+        uint64_t after = rdtsc();
+        if(after - before < span) {
+            span = after - before;
+            *cycles = before + span / 2;
+            at = when;
+        }
+    }
+    return at;
+}
+
+static void publish(const cycles_t *next, unsigned seq)
+{
+    __atomic_store_n(&cycle_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&cycle_base.cycles, next->cycles, __ATOMIC_RELAXED);
+    __atomic_store_n(&cycle_base.nsec, next->nsec, __ATOMIC_RELAXED);
+    __atomic_store_n(&cycle_base.scale, next->scale, __ATOMIC_RELAXED);
+    __atomic_store_n(&cycle_base.limit, next->limit, __ATOMIC_RELAXED);
+    clock_store(cycle_seq, seq + 2);
+}
+
+static void rebase(unsigned seq)
+{
+    if(__atomic_exchange_n(&cycle_busy, 1, __ATOMIC_ACQUIRE))
+        return;
+
+    // only the rebase holding the busy flag writes the base, so it can be
+    // read here directly
+    if(clock_load(cycle_seq) == seq) {
+        const cycles_t *prior = &cycle_base;
+        cycles_t next;
+        next.clock = prior->clock;
+        next.nsec = stamp(next.clock, &next.cycles);
+
+        // the scale is corrected over the whole span since the last base
+        uint64_t cycles = next.cycles - prior->cycles;
+        if(cycles && next.nsec > prior->nsec)
+            next.scale = (uint64_t)(((unsigned __int128)(next.nsec - prior->nsec) << 32) / cycles);
+        else
+            next.scale = prior->scale;
+        next.limit = (1000000000ull << 32) / next.scale;
+        publish(&next, seq);
+    }
+    __atomic_store_n(&cycle_busy, 0, __ATOMIC_RELEASE);
+}
+
+static bool calibrate(void)
+{
+    unsigned eax, ebx, ecx, edx;
+
+    if(clock_load(cycle_seq))
+        return true;
+
+    // only an invariant counter keeps one rate across power states
+    if(!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007)
+        return false;
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    if(!(edx & (1 << 8)))
+        return false;
+
+    if(__atomic_exchange_n(&cycle_busy, 1, __ATOMIC_ACQUIRE))
+        return false;
+
+    if(!clock_load(cycle_seq)) {
+        cycles_t base;
+        base.clock = system_clockid(false);
+        base.nsec = stamp(base.clock, &base.cycles);
+
+        // a short first span; the first rebase corrects it over a second
+        uint64_t end, cycles;
+        do {
+            end = stamp(base.clock, &cycles);
+        } while(end - base.nsec < 2000000ull);
+
+        base.scale = (uint64_t)(((unsigned __int128)(end - base.nsec) << 32) / (cycles - base.cycles));
+        base.limit = (1000000000ull << 32) / base.scale;
+        cycle_base.clock = base.clock;
+        publish(&base, 0);
+    }
+    __atomic_store_n(&cycle_busy, 0, __ATOMIC_RELEASE);
+    return true;
+}
+
+static void cycle_clock(struct timespec *ts)
+{
+    unsigned seq;
+    uint64_t base, stamp, scale, limit, cycles;
+
+    for(;;) {
+        seq = clock_load(cycle_seq);
+        if(seq & 1)
+            continue;
+        base = __atomic_load_n(&cycle_base.cycles, __ATOMIC_RELAXED);
+        stamp = __atomic_load_n(&cycle_base.nsec, __ATOMIC_RELAXED);
+        scale = __atomic_load_n(&cycle_base.scale, __ATOMIC_RELAXED);
+        limit = __atomic_load_n(&cycle_base.limit, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&cycle_seq, __ATOMIC_RELAXED) == seq)
+            break;
+    }
+
+    cycles = rdtsc() - base;
+    if((int64_t)cycles < 0)
+        cycles = 0;
+    else if(cycles > limit)
+        rebase(seq);
+
+    // a rebase may land a little behind the old scale; hold the clock
+    // until it catches up rather than step back
+    uint64_t now = stamp + (uint64_t)(((unsigned __int128)cycles * scale) >> 32);
+    uint64_t last = __atomic_load_n(&cycle_last, __ATOMIC_RELAXED);
+    while(now > last && !__atomic_compare_exchange_n(&cycle_last, &last, now, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    if(now < last)
+        now = last;
+
+    ts->tv_sec = (time_t)(now / 1000000000ull);
+    ts->tv_nsec = (long)(now % 1000000000ull);
+}
+
+#endif
+
+static void source_clock(struct timespec *ts, Timer::clocking_t source)
+{
+    assert(ts != NULL);
+
+    switch(source) {
+    case Timer::CACHED:
+        *ts = loop_time[clock_load(loop_gen) & 1];
+        return;
+#ifdef  CYCLE_CLOCK
+    case Timer::CYCLES:
+        cycle_clock(ts);
+        return;
+#endif
+#ifdef  COARSE_CLOCK
+    case Timer::COARSE:
+        clock_gettime(system_clockid(true), ts);
+        return;
+#endif
+    default:
+        system_clock(ts);
+    }
+}
+
+void Timer::current(struct timespec *ts, clocking_t source)
+{
+    source_clock(ts, source);
+}
+
+Timer::clocking_t Timer::prepare(clocking_t source)
+{
+    switch(source) {
+    case CACHED:
+        if(!clock_load(loop_gen))
+            refresh();
+        return CACHED;
+    case CYCLES:
+#ifdef  CYCLE_CLOCK
+        if(calibrate())
+            return CYCLES;
+#endif
+        // without a usable cycle counter the coarse clock is tried
+        return prepare(COARSE);
+    case COARSE:
+#ifdef  COARSE_CLOCK
+        return COARSE;
+#else
+        return PRECISE;
+#endif
+    default:
+        return PRECISE;
+    }
+}
+
+Timer::clocking_t Timer::clocking(clocking_t source)
+{
+    timer_clocking = prepare(source);
+    return timer_clocking;
+}
+
+Timer::clocking_t Timer::clocking(void)
+{
+    return timer_clocking;
+}
+
+void Timer::refresh(void)
+{
+    unsigned gen = loop_gen + 1;
+    system_clock(&loop_time[gen & 1]);
+    clock_store(loop_gen, gen);
+}
+
+static inline void now(struct timespec *ts)
+{
+    if(timer_clocking == Timer::PRECISE)
+        system_clock(ts);
+    else
+        source_clock(ts, timer_clocking);
+}
+
+#ifndef POSIX_TIMERS
+static inline void now(struct timeval *tv)
+{
+    struct timespec ts;
+    now(&ts);
+    tv->tv_sec = ts.tv_sec;
+    tv->tv_usec = ts.tv_nsec / 1000l;
+}
+#endif
+
 #if _MSC_VER > 1400        // windows broken dll linkage issue...
 #else
 const timeout_t Timer::inf = ((timeout_t)(-1));
@@ -245,11 +551,7 @@ void TimerQueue::event::detach(void)
 
 void Timer::set(void)
 {
-#if _POSIX_TIMERS > 0 && defined(POSIX_TIMERS)
-    clock_gettime(_posix_clocking, &timer);
-#else
-    gettimeofday(&timer, NULL);
-#endif
+    now(&timer);
     updated = true;
 }
 
@@ -289,7 +591,7 @@ timeout_t Timer::get(void) const
 #if _POSIX_TIMERS > 0 && POSIX_TIMERS
     struct timespec current;
 
-    clock_gettime(_posix_clocking, &current);
+    now(&current);
     adj(&current);
     if(current.tv_sec > timer.tv_sec)
         return 0;
@@ -299,7 +601,7 @@ timeout_t Timer::get(void) const
     diff += ((timer.tv_nsec - current.tv_nsec) / 1000000l);
 #else
     struct timeval current;
-    gettimeofday(&current, NULL);
+    now(&current);
     adj(&current);
     if(current.tv_sec > timer.tv_sec)
         return 0;
@@ -377,11 +679,7 @@ bool Timer::operator>=(const Timer& source) const
 
 Timer& Timer::operator=(timeout_t to)
 {
-#if _POSIX_TIMERS > 0 && defined(POSIX_TIMERS)
-    clock_gettime(_posix_clocking, &timer);
-#else
-    gettimeofday(&timer, NULL);
-#endif
+    now(&timer);
     operator+=(to);
     return *this;
 }
@@ -436,11 +734,7 @@ Timer& Timer::operator-=(time_t abs)
 
 Timer& Timer::operator=(time_t abs)
 {
-#if _POSIX_TIMERS > 0 && defined(POSIX_TIMERS)
-    clock_gettime(_posix_clocking, &timer);
-#else
-    gettimeofday(&timer, NULL);
-#endif
+    now(&timer);
     if(!abs)
         return *this;
 
@@ -22,6 +22,19 @@
 #include <ucommon/string.h>
 #include <ucommon/xml.h>
 #include <ctype.h>
+#ifdef  HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef  HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef  HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#ifdef  __SSE2__
+#include <emmintrin.h>
+#endif
 
 static bool isElement(char c)
 {
@@ -32,6 +45,7 @@ namespace ucommon {
 
 XMLParser::XMLParser(unsigned size)
 {
+    paused = stepping = false;
     state = NONE;
     bufpos = 0;
     bufsize = size;
@@ -47,106 +61,226 @@ XMLParser::~XMLParser()
     }
 }
 
-void XMLParser::putBuffer(char c)
+// find the next markup in character data, sixteen bytes at a time where
+// sse2 is available.
+static const char *markup(const char *data, const char *end)
 {
-    buffer[bufpos++] = c;
-    if(bufpos >= bufsize) {
-        if(ecount)
-            characters((caddr_t)buffer, bufpos);
-        bufpos = 0;
+#ifdef  __SSE2__
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i amp = _mm_set1_epi8('&');
+
+    while(end - data >= 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)data);
+        int mask = _mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(block, lt), _mm_cmpeq_epi8(block, amp)));
+        if(mask)
+            return data + __builtin_ctz(mask);
+        data += 16;
     }
+#endif
+    while(data < end && *data != '<' && *data != '&')
+        ++data;
+    return data;
 }
 
-void XMLParser::clearBuffer(void)
+void XMLParser::putComment(const char *text, size_t size)
 {
-    if(bufpos && ecount)
-        characters((caddr_t)buffer, bufpos);
-    bufpos = 0;
+    while(size) {
+        size_t count = bufsize - bufpos;
+        if(count > size)
+            count = size;
+        memcpy(buffer + bufpos, text, count);
+        bufpos += count;
+        text += count;
+        size -= count;
+
+        // keep the last two bytes back so a split "--" is still found
+        if(bufpos == bufsize) {
+            comment((caddr_t)buffer, bufpos - 2);
+            buffer[0] = buffer[bufpos - 2];
+            buffer[1] = buffer[bufpos - 1];
+            bufpos = 2;
+        }
+    }
 }
 
-bool XMLParser::parse(FILE *fp)
+const char *XMLParser::scan(const char *data, const char *end, bool document)
 {
-    state = NONE;
-    bufpos = 0;
-    ecount = dcount = 0;
-
-    int ch;
-    unsigned char cp;
-
-    while((ch = fgetc(fp)) != EOF) {
+    const char *cp;
+    unsigned char ch;
+    size_t len;
+
+    while(data < end) {
+        if(paused) {
+            paused = false;
+            return data;
+        }
         switch(state) {
+        case END:
+            // the next document starts with a tag
+            if(document)
+                return data;
+            // fallthrough
+        case NONE:
+            if(!ecount) {
+                cp = (const char *)memchr(data, '<', end - data);
+                if(!cp)
+                    return end;
+                data = ++cp;
+                state = TAG;
+                break;
+            }
+            // character data is passed in place from the input block
+            cp = markup(data, end);
+            if(cp > data)
+                characters((caddr_t)data, cp - data);
+            if(cp == end)
+                return end;
+            state = (*cp == '<') ? TAG : AMP;
+            data = ++cp;
+            break;
         case AMP:
+            ch = *(data++);
             if((!bufpos && ch == '#') || isElement(ch)) {
+                if(bufpos >= bufsize - 1)
+                    return NULL;
                 buffer[bufpos++] = ch;
                 break;
             }
             if(ch != ';')
-                return false;
+                return NULL;
             buffer[bufpos] = 0;
             if(buffer[0] == '#')
-                cp = atoi(buffer + 1);
+                ch = atoi(buffer + 1);
             else if(eq(buffer, "amp"))
-                cp = '&';
+                ch = '&';
             else if(eq(buffer, "lt"))
-                cp = '<';
+                ch = '<';
             else if(eq(buffer, "gt"))
-                cp = '>';
+                ch = '>';
             else if(eq(buffer, "apos"))
-                cp = '`';
+                ch = '`';
             else if(eq(buffer, "quot"))
-                cp = '\"';
+                ch = '\"';
             else
-                return false;
-            characters((caddr_t)&cp, 1);
+                return NULL;
+            buffer[0] = ch;
             bufpos = 0;
             state = NONE;
+            characters((caddr_t)buffer, 1);
             break;
         case TAG:
-            if(ch == '>') {
-                state = NONE;
-                if(!parseTag())
-                    return false;
-            }
-            else if(ch == '[' && bufpos == 7 && !strncmp(buffer, "![CDATA", 7)) {
-                state = CDATA;
+            // the opening of a "<!" tag decides if it is cdata or a comment...
+            if(bufpos < 9 && (bufpos ? buffer[0] : *data) == '!') {
+                ch = *(data++);
+                if(ch == '>') {
+                    state = NONE;
+                    if(!parseTag())
+                        return NULL;
+                }
+                else if(ch == '[' && bufpos == 7 && !strncmp(buffer, "![CDATA", 7)) {
+                    state = CDATA;
+                    bufpos = 0;
+                }
+                else if(ch == '-' && bufpos == 2 && !strncmp(buffer, "!-", 2)) {
+                    state = COMMENT;
+                    bufpos = 0;
+                }
+                else
+                    buffer[bufpos++] = ch;
+                break;
             }
-            else if(ch == '-' && bufpos == 2 && !strncmp(buffer, "!-", 2)) {
-                state = COMMENT;
-                bufpos = 0;
+            // ...after which the rest of it is collected in one copy
+            cp = data;
+            if(bufpos >= 9 && !strncmp(buffer, "!DOCTYPE ", 9)) {
+                while(cp < end && *cp != '>' && *cp != '[')
+                    ++cp;
             }
-            else if(ch == '[' && !strncmp(buffer, "!DOCTYPE ", 9)) {
+            else {
+                cp = (const char *)memchr(data, '>', end - data);
+                if(!cp)
+                    cp = end;
+            }
+            len = cp - data;
+            if(len >= bufsize - bufpos)
+                return NULL;
+            memcpy(buffer + bufpos, data, len);
+            bufpos += (unsigned)len;
+            if(cp == end)
+                return end;
+            data = ++cp;
+            if(cp[-1] == '[') {
                 state = DTD;
                 bufpos = 0;
+                break;
             }
-            else
-                putBuffer(ch);
+            state = NONE;
+            if(!parseTag())
+                return NULL;
             break;
         case COMMENT:
-            if(ch == '>' && bufpos >= 2 && !strncmp(&buffer[bufpos - 2], "--", 2)) {
+            cp = (const char *)memchr(data, '>', end - data);
+            if(!cp) {
+                putComment(data, end - data);
+                return end;
+            }
+            putComment(data, cp - data);
+            data = ++cp;
+            if(bufpos >= 2 && !strncmp(&buffer[bufpos - 2], "--", 2)) {
                 bufpos -= 2;
                 if(bufpos)
                     comment((caddr_t)buffer, bufpos);
                 bufpos = 0;
                 state = NONE;
             }
-            else {
-                buffer[bufpos++] = ch;
-                if(bufpos == bufsize) {
-                    comment((caddr_t)buffer, bufpos);
-                    bufpos = 0;
-                }
-            }
+            else
+                putComment(">", 1);
             break;
         case CDATA:
-            putBuffer(ch);
-            if(bufpos > 2)
-                if(eq(&buffer[bufpos - 3], "]]>")) {
-                    bufpos -= 3;
+            // buffer only ever holds a "]" or "]]" split from a prior block
+            if(bufpos) {
+                ch = *(data++);
+                if(ch == ']' && bufpos == 1)
+                    buffer[bufpos++] = ']';
+                else if(ch == ']') {
+                    if(ecount)
+                        characters((caddr_t)buffer, 1);
+                }
+                else if(ch == '>' && bufpos == 2) {
+                    bufpos = 0;
                     state = NONE;
-                    clearBuffer();
                 }
-            break;
+                else {
+                    if(ecount)
+                        characters((caddr_t)buffer, bufpos);
+                    bufpos = 0;
+                    --data;
+                }
+                break;
+            }
+            cp = data;
+            for(;;) {
+                cp = (const char *)memchr(cp, ']', end - cp);
+                if(!cp || (end - cp >= 3 && cp[1] == ']' && cp[2] == '>'))
+                    break;
+                if(end - cp < 3 && !strncmp(cp, "]]", end - cp))
+                    break;
+                ++cp;
+            }
+            if(!cp)
+                cp = end;
+            if(cp > data && ecount)
+                characters((caddr_t)data, cp - data);
+            if(end - cp >= 3) {
+                data = cp + 3;
+                state = NONE;
+                break;
+            }
+            while(cp < end)
+                buffer[bufpos++] = *(cp++);
+            return end;
         case DTD:
+            ch = *(data++);
             if(ch == '<')
                 ++dcount;
             else if(ch == '>' && dcount)
@@ -154,243 +288,165 @@ bool XMLParser::parse(FILE *fp)
             else if(ch == '>')
                 state = NONE;
             break;
-        case NONE:
-            if(ch == '<') {
-                clearBuffer();
-                state = TAG;
-            }
-            else if(ecount && ch == '&') {
-                clearBuffer();
-                state = AMP;
+        }
+    }
+    return end;
+}
+
+bool XMLParser::parse(FILE *fp)
+{
+    char block[16384];
+    const char *ep;
+    size_t len;
+    int ch;
+
+    reset();
+
+    // seekable files are read in blocks, and anything read beyond the end
+    // of the document is returned to the file for the next parse...
+    if(ftell(fp) >= 0) {
+        while((len = fread(block, 1, sizeof(block), fp)) > 0) {
+            ep = scan(block, block + len, true);
+            if(!ep)
+                return false;
+            if(state == END) {
+                if(ep < block + len)
+                    fseek(fp, -(long)(block + len - ep), SEEK_CUR);
+                return true;
             }
-            else if(ecount)
-                putBuffer(ch);
-            break;
-        case END:
-            return true;
         }
+        // eof before end of document...
+        return false;
+    }
+
+    // ...otherwise a document can only end on a '>', so read up to those
+    for(;;) {
+        len = 0;
+        while(len < sizeof(block) && (ch = getc(fp)) != EOF) {
+            block[len++] = (char)ch;
+            if(ch == '>')
+                break;
+        }
+        if(!len)
+            return false;
+        if(!scan(block, block + len, true))
+            return false;
         if(state == END)
             return true;
     }
-    // eof before end of ducument...
-    return false;
 }
 
-
 bool XMLParser::parse(CharacterProtocol& io)
 {
-    state = NONE;
-    bufpos = 0;
-    ecount = dcount = 0;
-
+    char block[16384];
+    size_t len;
     int ch;
-    unsigned char cp;
 
-    while((ch = io.getchar()) != EOF) {
-        switch(state) {
-        case AMP:
-            if((!bufpos && ch == '#') || isElement(ch)) {
-                buffer[bufpos++] = ch;
+    reset();
+
+    for(;;) {
+        len = 0;
+        while(len < sizeof(block) && (ch = io.getchar()) != EOF) {
+            block[len++] = (char)ch;
+            if(ch == '>')
                 break;
-            }
-            if(ch != ';')
-                return false;
-            buffer[bufpos] = 0;
-            if(buffer[0] == '#')
-                cp = atoi(buffer + 1);
-            else if(eq(buffer, "amp"))
-                cp = '&';
-            else if(eq(buffer, "lt"))
-                cp = '<';
-            else if(eq(buffer, "gt"))
-                cp = '>';
-            else if(eq(buffer, "apos"))
-                cp = '`';
-            else if(eq(buffer, "quot"))
-                cp = '\"';
-            else
-                return false;
-            characters((caddr_t)&cp, 1);
-            bufpos = 0;
-            state = NONE;
-            break;
-        case TAG:
-            if(ch == '>') {
-                state = NONE;
-                if(!parseTag())
-                    return false;
-            }
-            else if(ch == '[' && bufpos == 7 && !strncmp(buffer, "![CDATA", 7)) {
-                state = CDATA;
-            }
-            else if(ch == '-' && bufpos == 2 && !strncmp(buffer, "!-", 2)) {
-                state = COMMENT;
-                bufpos = 0;
-            }
-            else if(ch == '[' && !strncmp(buffer, "!DOCTYPE ", 9)) {
-                state = DTD;
-                bufpos = 0;
-            }
-            else
-                putBuffer(ch);
-            break;
-        case COMMENT:
-            if(ch == '>' && bufpos >= 2 && !strncmp(&buffer[bufpos - 2], "--", 2)) {
-                bufpos -= 2;
-                if(bufpos)
-                    comment((caddr_t)buffer, bufpos);
-                bufpos = 0;
-                state = NONE;
-            }
-            else {
-                buffer[bufpos++] = ch;
-                if(bufpos == bufsize) {
-                    comment((caddr_t)buffer, bufpos);
-                    bufpos = 0;
-                }
-            }
-            break;
-        case CDATA:
-            putBuffer(ch);
-            if(bufpos > 2)
-                if(eq(&buffer[bufpos - 3], "]]>")) {
-                    bufpos -= 3;
-                    state = NONE;
-                    clearBuffer();
-                }
-            break;
-        case DTD:
-            if(ch == '<')
-                ++dcount;
-            else if(ch == '>' && dcount)
-                --dcount;
-            else if(ch == '>')
-                state = NONE;
-            break;
-        case NONE:
-            if(ch == '<') {
-                clearBuffer();
-                state = TAG;
-            }
-            else if(ecount && ch == '&') {
-                clearBuffer();
-                state = AMP;
-            }
-            else if(ecount)
-                putBuffer(ch);
-            break;
-        case END:
-            return true;
         }
+        if(!len)
+            return false;
+        if(!scan(block, block + len, true))
+            return false;
+        if(state == END)
+            return true;
+    }
+}
+
+bool XMLParser::parse(BufferProtocol& io)
+{
+    const char *data, *ep;
+    size_t len;
+
+    reset();
+
+    while(NULL != (data = io.buffered(len))) {
+        ep = scan(data, data + len, true);
+        if(!ep)
+            return false;
+        io.consume(ep - data);
         if(state == END)
             return true;
     }
-    // eof before end of ducument...
+    // eof before end of document...
     return false;
 }
 
+bool XMLParser::load(const char *path)
+{
+#if defined(HAVE_SYS_MMAN_H) && !defined(_MSWINDOWS_)
+    struct stat ino;
+    caddr_t map;
+    bool result = false;
+
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    if(fstat(fd, &ino) || !ino.st_size) {
+        ::close(fd);
+        return false;
+    }
+
+    // a private writable mapping, so callbacks may still alter text in place
+    map = (caddr_t)mmap(NULL, ino.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(map == (caddr_t)MAP_FAILED)
+        return false;
+
+#ifdef  MADV_SEQUENTIAL
+    madvise(map, ino.st_size, MADV_SEQUENTIAL);
+#endif
+
+    reset();
+
+    if(scan(map, map + ino.st_size, true) && state == END)
+        result = true;
+
+    munmap(map, ino.st_size);
+    return result;
+#else
+    FILE *fp = fopen(path, "r");
+    if(!fp)
+        return false;
+
+    bool result = parse(fp);
+    fclose(fp);
+    return result;
+#endif
+}
+
+void XMLParser::reset(void)
+{
+    state = NONE;
+    bufpos = 0;
+    ecount = dcount = 0;
+}
+
 bool XMLParser::partial(const char *data, size_t len)
 {
-    if(state == END)
-        state = NONE;
+    return scan(data, data + len, false) != NULL;
+}
 
-    unsigned char cp;
-    while(len--) {
-        switch(state) {
-        case AMP:
-            if((!bufpos && *data == '#') || isElement(*data)) {
-                buffer[bufpos++] = *data;
-                break;
-            }
-            if(*data != ';')
-                return false;
-            buffer[bufpos] = 0;
-            if(buffer[0] == '#')
-                cp = atoi(buffer + 1);
-            else if(eq(buffer, "amp"))
-                cp = '&';
-            else if(eq(buffer, "lt"))
-                cp = '<';
-            else if(eq(buffer, "gt"))
-                cp = '>';
-            else if(eq(buffer, "apos"))
-                cp = '`';
-            else if(eq(buffer, "quot"))
-                cp = '\"';
-            else
-                return false;
-            characters((caddr_t)&cp, 1);
-            bufpos = 0;
-            state = NONE;
-            break;
-        case TAG:
-            if(*data == '>') {
-                state = NONE;
-                if(!parseTag())
-                    return false;
-            }
-            else if(*data == '[' && bufpos == 7 && !strncmp(buffer, "![CDATA", 7)) {
-                state = CDATA;
-            }
-            else if(*data == '-' && bufpos == 2 && !strncmp(buffer, "!-", 2)) {
-                state = COMMENT;
-                bufpos = 0;
-            }
-            else if(*data == '[' && !strncmp(buffer, "!DOCTYPE ", 9)) {
-                state = DTD;
-                bufpos = 0;
-            }
-            else
-                putBuffer(*data);
-            break;
-        case COMMENT:
-            if(*data == '>' && bufpos >= 2 && !strncmp(&buffer[bufpos - 2], "--", 2)) {
-                bufpos -= 2;
-                if(bufpos)
-                    comment((caddr_t)buffer, bufpos);
-                bufpos = 0;
-                state = NONE;
-            }
-            else {
-                buffer[bufpos++] = *data;
-                if(bufpos == bufsize) {
-                    comment((caddr_t)buffer, bufpos);
-                    bufpos = 0;
-                }
-            }
-            break;
-        case CDATA:
-            putBuffer(*data);
-            if(bufpos > 2)
-                if(eq(&buffer[bufpos - 3], "]]>")) {
-                    bufpos -= 3;
-                    state = NONE;
-                    clearBuffer();
-                }
-            break;
-        case DTD:
-            if(*data == '<')
-                ++dcount;
-            else if(*data == '>' && dcount)
-                --dcount;
-            else if(*data == '>')
-                state = NONE;
-            break;
-        case NONE:
-        case END:
-            if(*data == '<') {
-                clearBuffer();
-                state = TAG;
-            }
-            else if(ecount && *data == '&') {
-                clearBuffer();
-                state = AMP;
-            }
-            else if(ecount)
-                putBuffer(*data);
-        }
-        ++data;
+bool XMLParser::partial(const char *data, size_t len, size_t& used)
+{
+    stepping = true;
+    paused = false;
+    const char *ep = scan(data, data + len, false);
+    stepping = paused = false;
+
+    if(!ep) {
+        used = 0;
+        return false;
     }
+    used = ep - data;
     return true;
 }
 
@@ -534,6 +590,214 @@ ending:
     return true;
 }
 
+XMLReader::XMLReader(size_t size, unsigned tagsize) :
+XMLParser(tagsize)
+{
+    fp = NULL;
+    owned = false;
+    blocksize = size;
+    block = NULL;
+    clear();
+}
+
+XMLReader::~XMLReader()
+{
+    close();
+    if(block) {
+        delete[] block;
+        block = NULL;
+    }
+}
+
+void XMLReader::clear(void)
+{
+    input = NULL;
+    available = 0;
+    pending = failed = false;
+    event = DONE;
+    ename = etext = NULL;
+    esize = 0;
+    level = skipping = 0;
+    attrs[0] = attrs[1] = NULL;
+}
+
+void XMLReader::close(void)
+{
+    if(fp && owned)
+        fclose(fp);
+    fp = NULL;
+    owned = false;
+    reset();
+    clear();
+}
+
+bool XMLReader::open(const char *path)
+{
+    close();
+    fp = fopen(path, "r");
+    if(!fp)
+        return false;
+    owned = true;
+    return true;
+}
+
+void XMLReader::open(FILE *file)
+{
+    close();
+    fp = file;
+}
+
+void XMLReader::open(const char *address, size_t size)
+{
+    close();
+    input = address;
+    available = size;
+}
+
+bool XMLReader::fill(void)
+{
+    if(!fp)
+        return false;
+
+    if(!block)
+        block = new char[blocksize];
+
+    available = fread(block, 1, blocksize, fp);
+    input = block;
+    return available > 0;
+}
+
+void XMLReader::startElement(caddr_t name, caddr_t *attr)
+{
+    unsigned pos = 0;
+
+    ++level;
+    if(skipping)
+        return;
+
+    while(attr && attr[pos] && pos < 128) {
+        attrs[pos] = attr[pos];
+        attrs[pos + 1] = attr[pos + 1];
+        pos += 2;
+    }
+    attrs[pos] = attrs[pos + 1] = NULL;
+    ename = name;
+    event = START;
+    pause();
+}
+
+void XMLReader::endElement(caddr_t name)
+{
+    --level;
+    if(skipping) {
+        if(level < skipping) {
+            skipping = 0;
+            pause();
+        }
+        return;
+    }
+
+    // an empty element tag ends in the same callback as it starts
+    if(event == START) {
+        pending = true;
+        return;
+    }
+    ename = name;
+    event = END;
+    pause();
+}
+
+void XMLReader::characters(caddr_t text, size_t size)
+{
+    if(skipping)
+        return;
+
+    etext = text;
+    esize = size;
+    event = TEXT;
+    pause();
+}
+
+XMLReader::event_t XMLReader::next(void)
+{
+    size_t used;
+
+    if(failed)
+        return FAILED;
+
+    if(pending) {
+        pending = false;
+        attrs[0] = attrs[1] = NULL;
+        return event = END;
+    }
+
+    // done also marks that no event has been seen yet
+    event = DONE;
+    for(;;) {
+        if(end())
+            return DONE;
+
+        if(!available && !fill()) {
+            failed = true;
+            return event = FAILED;
+        }
+
+        if(!partial(input, available, used)) {
+            failed = true;
+            return event = FAILED;
+        }
+
+        input += used;
+        available -= used;
+        if(event != DONE)
+            return event;
+    }
+}
+
+bool XMLReader::skip(void)
+{
+    size_t used;
+
+    if(event != START)
+        return true;
+
+    // an empty element has already ended
+    if(pending) {
+        pending = false;
+        event = END;
+        return true;
+    }
+
+    skipping = level;
+    while(skipping) {
+        if(!available && !fill())
+            failed = true;
+        else if(!partial(input, available, used))
+            failed = true;
+
+        if(failed) {
+            event = FAILED;
+            return false;
+        }
+        input += used;
+        available -= used;
+    }
+    event = END;
+    return true;
+}
+
+const char *XMLReader::attribute(const char *id) const
+{
+    unsigned pos = 0;
+
+    while(attrs[pos]) {
+        if(eq(attrs[pos], id))
+            return attrs[pos + 1];
+        pos += 2;
+    }
+    return NULL;
+}
+
 // all our lovely base virtuals stubbed out so if we are lazy and forget to
 // implement something we want to ignore anyway (say comments...) we don't
 // bring whatever it is crashing down one day when we choose to add a
@@ -22,6 +22,9 @@
 #include <ucommon/secure.h>
 #include <gnutls/gnutls.h>
 #include <gnutls/crypto.h>
+#if GNUTLS_VERSION_NUMBER >= 0x030703
+#include <gnutls/socket.h>
+#endif
 
 #ifdef  _MSWINDOWS_
 #include <wincrypt.h>
@@ -38,11 +41,30 @@ public:
     gnutls_credentials_type_t xtype;
     gnutls_certificate_credentials_t xcred;
     gnutls_dh_params_t dh;
+    bool nodelay;
+
+    // client sessions by peer, or server sessions by id
+    sessions saved;
+    gnutls_datum_t ticket;
 
     static gnutls_priority_t priority_cache;
 
     static gnutls_session_t session(__context *ctx);
 
+    static gnutls_session_t renew(gnutls_session_t ssl);
+
+    static char *peer(const char *host, const char *service);
+
+    static void resume(gnutls_session_t ssl, const char *peer);
+
+    static int negotiate(gnutls_session_t ssl, const char *peer);
+
+    static int handshake(gnutls_session_t ssl, const char *peer);
+
+    static void options(gnutls_session_t ssl);
+
+    static void save(gnutls_session_t ssl, const char *peer);
+
     static int map_digest(const char *type);
     static int map_cipher(const char *type);
     static int map_hmac(const char *type);
@@ -18,14 +18,46 @@
 
 #include "local.h"
 
+namespace ucommon {
+
 extern "C" {
     static void secure_shutdown(void)
     {
         gnutls_global_deinit();
     }
-}
 
-namespace ucommon {
+    static int session_store(void *ptr, gnutls_datum_t key, gnutls_datum_t data)
+    {
+        __context *ctx = (__context *)ptr;
+        ctx->saved.put(key.data, key.size, data.data, data.size);
+        return 0;
+    }
+
+    static gnutls_datum_t session_retrieve(void *ptr, gnutls_datum_t key)
+    {
+        __context *ctx = (__context *)ptr;
+        gnutls_datum_t result = {NULL, 0};
+        size_t size;
+
+        void *data = ctx->saved.get(key.data, key.size, size);
+        if(data) {
+            result.data = (unsigned char *)gnutls_malloc(size);
+            if(result.data) {
+                memcpy(result.data, data, size);
+                result.size = (unsigned)size;
+            }
+            ::free(data);
+        }
+        return result;
+    }
+
+    static int session_remove(void *ptr, gnutls_datum_t key)
+    {
+        __context *ctx = (__context *)ptr;
+        ctx->saved.remove(key.data, key.size);
+        return 0;
+    }
+}
 
 gnutls_priority_t __context::priority_cache;
 
@@ -62,7 +94,11 @@ secure::server_t secure::server(const char *certfile, const char *ca)
     ctx->xtype = GNUTLS_CRD_CERTIFICATE;
     ctx->xcred = NULL;
     ctx->dh = NULL;
+    ctx->nodelay = false;
+    ctx->ticket.data = NULL;
+    ctx->ticket.size = 0;
     gnutls_certificate_allocate_credentials(&ctx->xcred);
+    secure::cache(ctx, 1024);
 
     gnutls_certificate_set_x509_key_file(ctx->xcred, certfile, certfile, GNUTLS_X509_FMT_PEM);
 
@@ -89,7 +125,11 @@ secure::client_t secure::client(const char *ca)
     ctx->xtype = GNUTLS_CRD_CERTIFICATE;
     ctx->xcred = NULL;
     ctx->dh = NULL;
+    ctx->nodelay = false;
+    ctx->ticket.data = NULL;
+    ctx->ticket.size = 0;
     gnutls_certificate_allocate_credentials(&ctx->xcred);
+    secure::cache(ctx, 1024);
 
     if(!ca)
         return ctx;
@@ -102,8 +142,46 @@ secure::client_t secure::client(const char *ca)
     return ctx;
 }
 
+void secure::cache(secure *scontext, size_t size, time_t timeout)
+{
+    __context *ctx = (__context *)scontext;
+    if(!ctx)
+        return;
+
+    ctx->saved.setup(size, timeout);
+
+    if(ctx->ticket.data) {
+        memset(ctx->ticket.data, 0, ctx->ticket.size);
+        gnutls_free(ctx->ticket.data);
+        ctx->ticket.data = NULL;
+        ctx->ticket.size = 0;
+    }
+
+    // gnutls rotates the keys it derives from this at the ticket lifetime
+    if(size && ctx->connect == GNUTLS_SERVER)
+        gnutls_session_ticket_key_generate(&ctx->ticket);
+}
+
+bool secure::offload(secure *, bool)
+{
+    // gnutls enables ktls from the system crypto policy, not per context
+    return false;
+}
+
+void secure::nodelay(secure *scontext, bool enable)
+{
+    __context *ctx = (__context *)scontext;
+    if(ctx)
+        ctx->nodelay = enable;
+}
+
 __context::~__context()
 {
+    if(ticket.data) {
+        memset(ticket.data, 0, ticket.size);
+        gnutls_free(ticket.data);
+    }
+
     if(dh)
         gnutls_dh_params_deinit(dh);
 
@@ -130,7 +208,8 @@ gnutls_session_t __context::session(__context *ctx)
 {
     SSL ssl = NULL;
     if(ctx && ctx->xcred && ctx->err() == secure::OK) {
-        gnutls_init(&ssl, ctx->connect);
+        if(gnutls_init(&ssl, ctx->connect) != GNUTLS_E_SUCCESS)
+            return NULL;
         switch(ctx->connect) {
         case GNUTLS_CLIENT:
             gnutls_priority_set_direct(ssl, "PERFORMANCE", NULL);
@@ -143,8 +222,113 @@ gnutls_session_t __context::session(__context *ctx)
             break;
         }
         gnutls_credentials_set(ssl, ctx->xtype, ctx->xcred);
+        gnutls_session_set_ptr(ssl, ctx);
+
+        if(ctx->connect == GNUTLS_SERVER && ctx->saved.size()) {
+            gnutls_db_set_retrieve_function(ssl, session_retrieve);
+            gnutls_db_set_store_function(ssl, session_store);
+            gnutls_db_set_remove_function(ssl, session_remove);
+            gnutls_db_set_ptr(ssl, ctx);
+            gnutls_db_set_cache_expiration(ssl, (int)ctx->saved.expires());
+            if(ctx->ticket.data)
+                gnutls_session_ticket_enable_server(ssl, &ctx->ticket);
+        }
     }
     return ssl;
 }
 
+gnutls_session_t __context::renew(gnutls_session_t ssl)
+{
+    __context *ctx = (__context *)gnutls_session_get_ptr(ssl);
+    if(!ctx)
+        return ssl;
+
+    // if a new session cannot be made we keep the one we have
+    gnutls_session_t fresh = session(ctx);
+    if(!fresh)
+        return ssl;
+
+    gnutls_deinit(ssl);
+    return fresh;
+}
+
+char *__context::peer(const char *host, const char *service)
+{
+    if(!service)
+        service = "";
+
+    size_t size = strlen(host) + strlen(service) + 2;
+    char *id = (char *)::malloc(size);
+    snprintf(id, size, "%s:%s", host, service);
+    return id;
+}
+
+void __context::resume(gnutls_session_t ssl, const char *peer)
+{
+    __context *ctx = (__context *)gnutls_session_get_ptr(ssl);
+    void *data = NULL;
+    size_t size;
+
+    if(peer && ctx)
+        data = ctx->saved.get(peer, strlen(peer), size);
+
+    if(data) {
+        gnutls_session_set_data(ssl, data, size);
+        ::free(data);
+    }
+}
+
+int __context::negotiate(gnutls_session_t ssl, const char *peer)
+{
+    __context *ctx = (__context *)gnutls_session_get_ptr(ssl);
+
+    int result = gnutls_handshake(ssl);
+    if(result < 0 || !ctx)
+        return result;
+
+    if(gnutls_session_is_resumed(ssl))
+        ++ctx->resumed;
+    else
+        ++ctx->negotiated;
+
+    save(ssl, peer);
+    return result;
+}
+
+void __context::options(gnutls_session_t ssl)
+{
+    __context *ctx = (__context *)gnutls_session_get_ptr(ssl);
+    if(ctx && ctx->nodelay)
+        Socket::nodelay((socket_t)(intptr_t)gnutls_transport_get_ptr(ssl));
+}
+
+int __context::handshake(gnutls_session_t ssl, const char *peer)
+{
+    options(ssl);
+    resume(ssl, peer);
+    return negotiate(ssl, peer);
+}
+
+void __context::save(gnutls_session_t ssl, const char *peer)
+{
+    __context *ctx = (__context *)gnutls_session_get_ptr(ssl);
+    gnutls_datum_t data;
+
+    if(!peer || !ctx || !ctx->saved.size())
+        return;
+
+#if GNUTLS_VERSION_NUMBER >= 0x030600
+    // tls 1.3 sessions resume from a ticket sent after the handshake
+    if(gnutls_protocol_get_version(ssl) == GNUTLS_TLS1_3 &&
+      !(gnutls_session_get_flags(ssl) & GNUTLS_SFLAGS_SESSION_TICKET))
+        return;
+#endif
+
+    if(gnutls_session_get_data2(ssl, &data) < 0)
+        return;
+
+    ctx->saved.put(peer, strlen(peer), data.data, data.size);
+    gnutls_free(data.data);
+}
+
 } // namespace ucommon
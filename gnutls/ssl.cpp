@@ -25,13 +25,15 @@ TCPBuffer(tcp, size)
 {
     ssl = __context::session((__context *)scontext);
     bio = NULL;
+    peer = NULL;
     server = true;
+    async = false;
 
     if(!is_open() || !ssl)
         return;
 
     gnutls_transport_set_ptr((SSL)ssl, reinterpret_cast<gnutls_transport_ptr_t>( so));
-    int result = gnutls_handshake((SSL)ssl);
+    int result = __context::handshake((SSL)ssl, NULL);
 
     if(result >= 0)
         bio = ssl;
@@ -43,7 +45,9 @@ TCPBuffer()
 {
     ssl = __context::session((__context *)scontext);
     bio = NULL;
+    peer = NULL;
     server = false;
+    async = false;
 }
 
 SSLBuffer::~SSLBuffer()
@@ -64,19 +68,195 @@ void SSLBuffer::open(const char *host, const char *service, size_t size)
     }
 
     close();
+    async = false;
 
     TCPBuffer::open(host, service, size);
 
     if(!is_open() || !ssl)
         return;
 
+    // a session can only be used for one connection
+    ssl = __context::renew((SSL)ssl);
+    if(!ssl)
+        return;
+
     gnutls_transport_set_ptr((SSL)ssl, reinterpret_cast<gnutls_transport_ptr_t>(so));
-    int result = gnutls_handshake((SSL)ssl);
+    peer = __context::peer(host, service);
+    int result = __context::handshake((SSL)ssl, peer);
 
     if(result >= 0)
         bio = ssl;
 }
 
+static SSLBuffer::state_t status(SSL ssl, int result)
+{
+    if(result == GNUTLS_E_AGAIN || result == GNUTLS_E_INTERRUPTED) {
+        if(gnutls_record_get_direction(ssl))
+            return SSLBuffer::WANT_WRITE;
+        return SSLBuffer::WANT_READ;
+    }
+
+    // warning alerts and other non-fatal results are waited through
+    if(!gnutls_error_is_fatal(result))
+        return SSLBuffer::WANT_READ;
+
+    return SSLBuffer::FAILED;
+}
+
+SSLBuffer::state_t SSLBuffer::connect(const char *host, const char *service, size_t size)
+{
+    if(server) {
+        ioerr = EBADF;
+        return FAILED;
+    }
+
+    close();
+    TCPBuffer::open(host, service, size);
+
+    if(!is_open() || !ssl)
+        return FAILED;
+
+    ssl = __context::renew((SSL)ssl);
+    if(!ssl)
+        return FAILED;
+
+    async = true;
+    Socket::blocking(so, false);
+    gnutls_transport_set_ptr((SSL)ssl, reinterpret_cast<gnutls_transport_ptr_t>(so));
+    __context::options((SSL)ssl);
+    peer = __context::peer(host, service);
+    __context::resume((SSL)ssl, peer);
+    return handshake();
+}
+
+SSLBuffer::state_t SSLBuffer::accept(const TCPServer *tcp, size_t size)
+{
+    if(server) {
+        ioerr = EBADF;
+        return FAILED;
+    }
+
+    close();
+    TCPBuffer::open(tcp, size);
+
+    if(!is_open() || !ssl)
+        return FAILED;
+
+    ssl = __context::renew((SSL)ssl);
+    if(!ssl)
+        return FAILED;
+
+    async = true;
+    Socket::blocking(so, false);
+    gnutls_transport_set_ptr((SSL)ssl, reinterpret_cast<gnutls_transport_ptr_t>(so));
+    __context::options((SSL)ssl);
+    return handshake();
+}
+
+SSLBuffer::state_t SSLBuffer::handshake(void)
+{
+    if(bio)
+        return READY;
+
+    if(!ssl || !is_open())
+        return FAILED;
+
+    int result = __context::negotiate((SSL)ssl, peer);
+    if(result >= 0) {
+        bio = ssl;
+        return READY;
+    }
+
+    state_t state = status((SSL)ssl, result);
+    if(state == FAILED)
+        ioerr = EIO;
+    return state;
+}
+
+SSLBuffer::state_t SSLBuffer::recv(char *data, size_t size, size_t& count)
+{
+    count = 0;
+
+    state_t state = handshake();
+    if(state != READY)
+        return state;
+
+    ssize_t result;
+    do {
+        result = gnutls_record_recv((SSL)ssl, data, size);
+    } while((result == GNUTLS_E_AGAIN || result == GNUTLS_E_INTERRUPTED) &&
+        gnutls_record_check_pending((SSL)ssl));
+
+    if(result > 0) {
+        count = (size_t)result;
+        return READY;
+    }
+
+    if(result == 0)
+        return CLOSED;
+
+    state = status((SSL)ssl, (int)result);
+    if(state == FAILED)
+        ioerr = EIO;
+    return state;
+}
+
+SSLBuffer::state_t SSLBuffer::send(const char *data, size_t size, size_t& count)
+{
+    count = 0;
+
+    state_t state = handshake();
+    if(state != READY)
+        return state;
+
+    ssize_t result = gnutls_record_send((SSL)ssl, data, size);
+    if(result >= 0) {
+        count = (size_t)result;
+        return READY;
+    }
+
+    state = status((SSL)ssl, (int)result);
+    if(state == FAILED)
+        ioerr = EIO;
+    return state;
+}
+
+size_t SSLBuffer::sendfile(fsys& file, fsys::offset_t offset, size_t size)
+{
+    if(!flush())
+        return 0;
+
+#if GNUTLS_VERSION_NUMBER >= 0x030703 && !defined(_MSWINDOWS_)
+    if(is_offloaded()) {
+        off_t pos = (off_t)offset;
+        size_t total = 0;
+        while(total < size) {
+            ssize_t result = gnutls_record_send_file((SSL)ssl, file.handle(), &pos, size - total);
+            if(result == GNUTLS_E_AGAIN || result == GNUTLS_E_INTERRUPTED)
+                continue;
+            if(result < 1) {
+                if(result < 0)
+                    ioerr = EIO;
+                break;
+            }
+            total += (size_t)result;
+        }
+        return total;
+    }
+#endif
+
+    return copyfile(file, offset, size);
+}
+
+bool SSLBuffer::is_offloaded(void) const
+{
+#if GNUTLS_VERSION_NUMBER >= 0x030703
+    if(bio && (gnutls_transport_is_ktls_enabled((SSL)ssl) & GNUTLS_KTLS_SEND))
+        return true;
+#endif
+    return false;
+}
+
 void SSLBuffer::close(void)
 {
     if(server) {
@@ -84,9 +264,17 @@ void SSLBuffer::close(void)
         return;
     }
 
-    if(bio)
-        gnutls_bye((SSL)ssl, GNUTLS_SHUT_RDWR);
+    if(bio) {
+        __context::save((SSL)ssl, peer);
+        // a non-blocking session only sends its close notify
+        gnutls_bye((SSL)ssl, async ? GNUTLS_SHUT_WR : GNUTLS_SHUT_RDWR);
+    }
     bio = NULL;
+
+    if(peer) {
+        ::free(peer);
+        peer = NULL;
+    }
     TCPBuffer::close();
 }
 
@@ -110,7 +298,26 @@ size_t SSLBuffer::_push(const char *address, size_t size)
     if(!bio)
         return TCPBuffer::_push(address, size);
 
+    // buffered writes on a non-blocking session wait until all is sent
+    if(async) {
+        size_t total = 0;
+        while(total < size) {
+            size_t count;
+            state_t state = send(address + total, size - total, count);
+            total += count;
+            if(state != READY && !waitfor(state))
+                break;
+        }
+        return total;
+    }
+
     int result = gnutls_record_send((SSL)ssl, address, size);
+    while(result == GNUTLS_E_AGAIN || result == GNUTLS_E_INTERRUPTED) {
+        if(result == GNUTLS_E_AGAIN && !waitfor(status((SSL)ssl, result)))
+            break;
+        result = gnutls_record_send((SSL)ssl, address, size);
+    }
+
     if(result < 0) {
         result = 0;
         ioerr = EIO;
@@ -123,7 +330,28 @@ size_t SSLBuffer::_pull(char *address, size_t size)
     if(!bio)
         return TCPBuffer::_pull(address, size);
 
+    // buffered reads on a non-blocking session wait for data or close
+    if(async) {
+        for(;;) {
+            size_t count;
+            state_t state = recv(address, size, count);
+            if(state == READY)
+                return count;
+            if(!waitfor(state))
+                return 0;
+        }
+    }
+
+    // a resumable session may be handed a ticket after the handshake,
+    // which gnutls reports as a retry even on a blocking socket
     int result = gnutls_record_recv((SSL)ssl, address, size);
+    while(result == GNUTLS_E_AGAIN || result == GNUTLS_E_INTERRUPTED) {
+        if(result == GNUTLS_E_AGAIN && !gnutls_record_check_pending((SSL)ssl) &&
+            !waitfor(status((SSL)ssl, result)))
+            break;
+        result = gnutls_record_recv((SSL)ssl, address, size);
+    }
+
     if(result < 0) {
         result = 0;
         ioerr = EIO;
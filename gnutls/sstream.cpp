@@ -27,6 +27,7 @@ tcpstream()
 {
     ssl = __context::session((__context *)scontext);
     bio = NULL;
+    peer = NULL;
     server = false;
 }
 
@@ -36,13 +37,14 @@ tcpstream(tcp, size)
 
     ssl = __context::session((__context *)scontext);
     bio = NULL;
+    peer = NULL;
     server = true;
 
     if(!is_open() || !ssl)
         return;
 
     gnutls_transport_set_ptr((SSL)ssl, reinterpret_cast<gnutls_transport_ptr_t>( so));
-    int result = gnutls_handshake((SSL)ssl);
+    int result = __context::handshake((SSL)ssl, NULL);
 
     if(result >= 0)
         bio = ssl;
@@ -64,8 +66,14 @@ void sstream::open(const char *host, const char *service, size_t bufsize)
     if(!is_open() || !ssl)
         return;
 
+    // a session can only be used for one connection
+    ssl = __context::renew((SSL)ssl);
+    if(!ssl)
+        return;
+
     gnutls_transport_set_ptr((SSL)ssl, reinterpret_cast<gnutls_transport_ptr_t>(so));
-    int result = gnutls_handshake((SSL)ssl);
+    peer = __context::peer(host, service);
+    int result = __context::handshake((SSL)ssl, peer);
 
     if(result >= 0)
         bio = ssl;
@@ -77,10 +85,16 @@ void sstream::close(void)
         return;
 
     if(bio) {
+        __context::save((SSL)ssl, peer);
         gnutls_bye((SSL)ssl, GNUTLS_SHUT_RDWR);
         bio = NULL;
     }
 
+    if(peer) {
+        ::free(peer);
+        peer = NULL;
+    }
+
     tcpstream::close();
 }
 
@@ -100,7 +114,11 @@ ssize_t sstream::_write(const char *address, size_t size)
     if(!bio)
         return tcpstream::_write(address, size);
 
-    return gnutls_record_send((SSL)ssl, address, size);
+    ssize_t result;
+    do {
+        result = gnutls_record_send((SSL)ssl, address, size);
+    } while(result == GNUTLS_E_AGAIN || result == GNUTLS_E_INTERRUPTED);
+    return result;
 }
 
 ssize_t sstream::_read(char *address, size_t size)
@@ -108,7 +126,11 @@ ssize_t sstream::_read(char *address, size_t size)
     if(!bio)
         return tcpstream::_read(address, size);
 
-    return gnutls_record_recv((SSL)ssl, address, size);
+    ssize_t result;
+    do {
+        result = gnutls_record_recv((SSL)ssl, address, size);
+    } while(result == GNUTLS_E_AGAIN || result == GNUTLS_E_INTERRUPTED);
+    return result;
 }
 
 bool sstream::_wait(void)
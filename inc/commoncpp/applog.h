@@ -281,8 +281,22 @@ class __EXPORT AppLog : protected streambuf, public ostream
      */
     void logFileName(const char* FileName, bool logDirectly = false);
 #endif
+#ifndef _MSWINDOWS_
+    /**
+     * Log to a file through a buffer for each subscribed thread.  A
+     * writer thread writes out the records of all threads together,
+     * when a buffer is half full or at least every flush interval.
+     * A thread whose buffer is full waits for the writer.
+     * @param FileName log file name.
+     * @param bufferSize size of each thread's buffer, at least 1k.
+     * @param flushTime longest time in milliseconds a record is held.
+     */
+    void logAsync(const char* FileName, size_t bufferSize = 65536, timeout_t flushTime = 100);
+#endif
+
     /**
-     * if logDirectly is set it closes the file.
+     * if logDirectly is set it closes the file.  Records of an async log
+     * are written out.
      */
     void close(void);
 
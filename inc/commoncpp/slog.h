@@ -131,13 +131,58 @@ public:
         levelDebug
     } Level;
 
+    /**
+     * Kinds of record in a binary trace file.
+     */
+    typedef enum Trace {
+        traceFormat = 1,    /**< format string text for an id */
+        traceEvent          /**< raw arguments of one event */
+    } Trace;
+
+    /**
+     * Header of a binary trace file.  The file is in host order and is
+     * decoded offline, by slogdump, on a similar host.  Records follow
+     * in chunks, each written by one thread, and a record of zero size
+     * ends the part of a chunk that was used.
+     */
+    typedef struct {
+        char magic[8];          /**< "slogtrc" */
+        uint32_t version;
+        uint32_t chunk;         /**< bytes given to a thread at a time */
+        uint64_t size;          /**< size the file was mapped at */
+        uint64_t used;          /**< end of the last chunk given out */
+        uint64_t dropped;       /**< events lost when the file was full */
+        int64_t seconds;        /**< realtime the trace was opened */
+        uint32_t nanoseconds;
+        uint8_t sizes[4];       /**< long, long double, pointer, intmax_t */
+        uint8_t reserved[8];
+    } trace_header_t;
+
+    /**
+     * Header of each record in a binary trace file.  A format record is
+     * followed by the text of the format, and an event record by the
+     * raw value of each argument the format converts.  Strings are kept
+     * as a 16 bit length followed by the text.
+     */
+    typedef struct {
+        uint32_t size;          /**< record bytes, 8 byte aligned */
+        uint16_t type;          /**< format or event */
+        uint16_t level;         /**< level of an event */
+        uint32_t id;            /**< format id */
+        uint32_t thread;        /**< serial number of the thread */
+        uint64_t time;          /**< nanoseconds after trace opened */
+    } trace_record_t;
+
 private:
+    class tracelog;
+
     mutable pthread_mutex_t lock;
     FILE *syslog;
     int priority;
     Level  _level;
     bool _enable;
     bool _clogEnable;
+    tracelog *_trace;
 
 protected:
     /**
@@ -245,6 +290,34 @@ public:
      */
     void info(const char *format, ...);
 
+    /**
+     * Start a binary trace to a memory mapped file.  Events recorded
+     * with trace() keep the format and raw arguments rather than text,
+     * and the file is rendered into text later by slogdump.
+     *
+     * @param path of trace file, which is replaced.
+     * @param size of trace file; events are dropped once it is full.
+     * @param chunk of file each thread writes into at a time.
+     * @return true if the trace file was created.
+     */
+    bool traceOpen(const char *path, size_t size = 16777216, size_t chunk = 65536);
+
+    /**
+     * End a binary trace and trim the file to what was used.  Threads
+     * should have stopped tracing first.
+     */
+    void traceClose(void);
+
+    /**
+     * Record a binary trace event if the level is being logged.  The
+     * format should be a string constant, since it is remembered by
+     * its address, and each thread keeps the formats it has used.
+     *
+     * @param level of event.
+     * @param format string.
+     */
+    void trace(Level level, const char *format, ...) __PRINTF(3, 4);
+
     /**
      * Sets the logging level.
      * @param enable is the logging level to use for further output
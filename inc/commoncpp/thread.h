@@ -809,8 +809,29 @@ public:
  */
 class __EXPORT ThreadQueue : public Mutex, public Thread, public Semaphore
 {
+public:
+    /**
+     * What post() does when a ring backed queue is full.
+     */
+    typedef enum Overflow {
+        queueBlock,     /**< wait for room in the ring */
+        queueDrop,      /**< discard the new data */
+        queueOverwrite  /**< discard the oldest data not yet dequeued */
+    } Overflow;
+
 private:
     void run(void);         // private run method
+    void drain(void);       // dequeue ring in batches
+    void notify(void);      // wake queue thread
+
+    char *ring;
+    size_t ringsize, head, tail, done;
+    unsigned waiters;
+    unsigned long dropped;
+    volatile unsigned long freed;
+    Overflow overflow;
+    ost::Conditional wakeup, space;
+    volatile bool signalled, stopping;
 
 protected:
     typedef struct _data {
@@ -859,6 +880,16 @@ protected:
      */
     virtual void runQueue(void *data) = 0;
 
+    /**
+     * Virtual callback method to handle a batch of data items taken
+     * from the ring together.  The items remain in the ring until this
+     * returns.  By default runQueue() is called for each item.
+     *
+     * @param list of data items being dequeued.
+     * @param count of data items.
+     */
+    virtual void runBatch(void **list, unsigned count);
+
 public:
     /**
      * Create instance of our queue and give it a process priority.
@@ -869,6 +900,19 @@ public:
      */
     ThreadQueue(const char *id, int pri, size_t stack = 0);
 
+    /**
+     * Create a queue whose data is copied into a ring allocated once,
+     * rather than into memory allocated for each item.  The ring is
+     * dequeued by the queue thread in batches.
+     *
+     * @param id queue ID.
+     * @param pri process priority.
+     * @param stack stack size.
+     * @param size of ring in bytes, rounded up to a power of two.
+     * @param mode of posting when the ring is full.
+     */
+    ThreadQueue(const char *id, int pri, size_t stack, size_t size, Overflow mode = queueBlock);
+
     /**
      * Destroy the queue.
      */
@@ -890,8 +934,24 @@ public:
      *
      * @param data pointer to data.
      * @param len size of data.
+     * @return false if the data was dropped or the queue is stopped.
+     */
+    bool post(const void *data, unsigned len);
+
+    /**
+     * Dequeue any data still waiting and stop the queue thread.  This
+     * is used by the destructor of a derived queue.  Posters waiting
+     * for room in the ring are released and their data is dropped.
+     */
+    void stop(void);
+
+    /**
+     * Get the number of items discarded because the ring was full.
+     *
+     * @return items dropped or overwritten.
      */
-    void post(const void *data, unsigned len);
+    inline unsigned long getDropped(void) const
+        {return dropped;}
 };
 
 
@@ -20,7 +20,8 @@
  * A simple class to perform bitmap manipulation.
  * Bitmaps are used to manage bit-aligned objects, such as network cidr
  * addresses.  This header introduces a common bitmap management class
- * for the ucommon library.
+ * for the ucommon library, and a compressed bitmap for large sparse
+ * sets of 32 bit ids.
  * @file ucommon/bitmap.h
  */
 
@@ -33,6 +34,8 @@
 
 namespace ucommon {
 
+class PersistEngine;
+
 /**
  * A class to access bit fields in external bitmaps.  The actual bitmap this
  * object manipulates may not be stored in the object.  Bitmaps may be
@@ -44,9 +47,10 @@ namespace ucommon {
  * where performing reference and manipulations may change the state of the
  * device and hence must be aligned with the device register being effected.
  *
- * This class offers only the most basic bit manipulations, getting and
- * setting individual bits in the bitmap.  More advanced bit manipulations
- * and other operations can be created in derived classes.
+ * Besides getting and setting individual bits, the bitmap can search for
+ * the first set or clear bit, set or clear a range, count set bits, and
+ * allocate free bits atomically.  These work a whole bus word at a time,
+ * and locally created bitmaps use 64 bit words.
  * @author David Sugar <dyfet@gnutelephony.org>
  */
 class __EXPORT bitmap
@@ -85,6 +89,52 @@ protected:
     unsigned memsize(void) const;
 
 public:
+    /**
+     * Offset returned when no matching bit is found.
+     */
+    static const size_t npos = (size_t)(-1);
+
+    /**
+     * Iterate the offsets of set bits in a bitmap.  The bitmap may be
+     * changed while iterating; bits set behind the iterator are skipped.
+     */
+    class iterator
+    {
+    private:
+        const bitmap *map;
+        size_t pos;
+
+    public:
+        inline iterator(const bitmap& source, size_t offset = 0) {
+            map = &source;
+            pos = source.find(true, offset);
+        }
+
+        inline operator size_t() const {
+            return pos;
+        }
+
+        inline size_t operator*() const {
+            return pos;
+        }
+
+        inline void next(void) {
+            pos = map->find(true, pos + 1);
+        }
+
+        inline void operator++() {
+            next();
+        }
+
+        inline operator bool() const {
+            return pos != npos;
+        }
+
+        inline bool operator!() const {
+            return pos == npos;
+        }
+    };
+
     /**
      * Create an object to reference the specified bitmap.
      * @param addr of the bitmap in mapped memory.
@@ -125,6 +175,236 @@ public:
      * @param value to change specified bit to.
      */
     void set(size_t offset, bool value);
+
+    /**
+     * Set or clear a range of bits.  The range is clipped to the bitmap.
+     * @param offset to first bit to change.
+     * @param count of bits to change.
+     * @param value to change bits to.
+     */
+    void set(size_t offset, size_t count, bool value);
+
+    /**
+     * Find the first bit of a value at or after an offset.
+     * @param value of bit to look for.
+     * @param offset to start search from.
+     * @return offset of bit found or npos.
+     */
+    size_t find(bool value, size_t offset = 0) const;
+
+    /**
+     * Count the set bits in the bitmap.
+     * @return number of bits set.
+     */
+    size_t count(void) const;
+
+    /**
+     * Atomically find and set a clear bit, for allocating slots from a
+     * bitmap shared between threads.  The search starts at a hint and
+     * wraps around, so callers can spread their allocations.
+     * @param hint offset to start search from.
+     * @return offset of bit allocated or npos if all are set.
+     */
+    size_t acquire(size_t hint = 0);
+
+    /**
+     * Atomically clear a bit that was allocated with acquire.
+     * @param offset of bit to release.
+     */
+    void release(size_t offset);
+
+    /**
+     * Get the length of the bitmap.
+     * @return length in bits.
+     */
+    inline size_t getSize(void) const {
+        return size;
+    }
+};
+
+/**
+ * A compressed bitmap of 32 bit ids.  The id space is split into chunks
+ * of 65536 ids, and only chunks holding ids are kept.  A chunk is held as
+ * a sorted array of ids while it has 4096 or fewer, as a dense bitmap
+ * when it has more, or as a list of runs when optimized and that is
+ * smaller.  This is much like a roaring bitmap, and is meant for sets of
+ * subscribers or slot ids spread over a range far too large for a dense
+ * bitmap.  Sets can be merged, intersected, and subtracted a chunk at a
+ * time, and saved and restored through the persistence engine.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+class __EXPORT sparse_bitmap
+{
+private:
+    class chunk;
+
+    chunk *chunks;
+    unsigned used, max;
+
+    unsigned position(uint16_t key) const;
+    chunk *lookup(uint16_t key) const;
+    chunk *insert(unsigned pos, uint16_t key);
+    void erase(unsigned pos);
+    void copy(const sparse_bitmap& from);
+    void reset(chunk *list, unsigned count, unsigned size);
+
+public:
+    /**
+     * Offset returned when no id is found.
+     */
+    static const size_t npos = (size_t)(-1);
+
+    /**
+     * Iterate the ids held in a compressed bitmap, in order.
+     */
+    class iterator
+    {
+    private:
+        const sparse_bitmap *map;
+        size_t pos;
+
+    public:
+        inline iterator(const sparse_bitmap& source, size_t offset = 0) {
+            map = &source;
+            pos = source.find(offset);
+        }
+
+        inline operator size_t() const {
+            return pos;
+        }
+
+        inline size_t operator*() const {
+            return pos;
+        }
+
+        inline void next(void) {
+            pos = map->find(pos + 1);
+        }
+
+        inline void operator++() {
+            next();
+        }
+
+        inline operator bool() const {
+            return pos != npos;
+        }
+
+        inline bool operator!() const {
+            return pos == npos;
+        }
+    };
+
+    /**
+     * Create an empty compressed bitmap.
+     */
+    sparse_bitmap();
+
+    /**
+     * Create a copy of a compressed bitmap.
+     * @param from bitmap to copy.
+     */
+    sparse_bitmap(const sparse_bitmap& from);
+
+    /**
+     * Destroy bitmap and release its chunks.
+     */
+    ~sparse_bitmap();
+
+    /**
+     * Assign a copy of another compressed bitmap.
+     * @param from bitmap to copy.
+     * @return this bitmap.
+     */
+    sparse_bitmap& operator=(const sparse_bitmap& from);
+
+    /**
+     * Remove all ids from the bitmap.
+     */
+    void clear(void);
+
+    /**
+     * Test if an id is in the bitmap.
+     * @param id to test.
+     * @return true if id is set.
+     */
+    bool get(uint32_t id) const;
+
+    /**
+     * Add or remove an id.
+     * @param id to change.
+     * @param value true to add, false to remove.
+     */
+    void set(uint32_t id, bool value);
+
+    /**
+     * Add or remove a range of ids.  The range is clipped to 32 bits.
+     * @param offset of first id to change.
+     * @param count of ids to change.
+     * @param value true to add, false to remove.
+     */
+    void set(uint32_t offset, size_t count, bool value);
+
+    /**
+     * Find the first id at or after an offset.
+     * @param offset to start search from.
+     * @return id found or npos.
+     */
+    size_t find(size_t offset = 0) const;
+
+    /**
+     * Count the ids in the bitmap.
+     * @return number of ids set.
+     */
+    size_t count(void) const;
+
+    /**
+     * Memory held by the bitmap, including its chunks.
+     * @return size in bytes.
+     */
+    size_t memory(void) const;
+
+    /**
+     * Convert chunks to runs where that is smaller, and trim arrays to
+     * fit.  This is best done once a set is built.  Chunks held as runs
+     * are expanded again when changed.
+     */
+    void optimize(void);
+
+    /**
+     * Add all ids of another bitmap.
+     * @param from bitmap to merge.
+     * @return this bitmap.
+     */
+    sparse_bitmap& operator|=(const sparse_bitmap& from);
+
+    /**
+     * Keep only ids also in another bitmap.
+     * @param from bitmap to intersect with.
+     * @return this bitmap.
+     */
+    sparse_bitmap& operator&=(const sparse_bitmap& from);
+
+    /**
+     * Remove all ids found in another bitmap.
+     * @param from bitmap to subtract.
+     * @return this bitmap.
+     */
+    sparse_bitmap& operator-=(const sparse_bitmap& from);
+
+#ifndef UCOMMON_SYSRUNTIME
+    /**
+     * Save bitmap to a persistence engine.
+     * @param archive to write to.
+     */
+    void write(PersistEngine& archive) const;
+
+    /**
+     * Restore bitmap from a persistence engine.  A bitmap that is not
+     * well formed throws a persistence exception.
+     * @param archive to read from.
+     */
+    void read(PersistEngine& archive);
+#endif
 };
 
 } // namespace ucommon
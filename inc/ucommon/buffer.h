@@ -65,6 +65,7 @@ protected:
     virtual size_t _pull(char *address, size_t size);
     int _err(void) const;
     void _clear(void);
+    void _seterr(int error);
     bool _blocking(void);
 
     /**
@@ -962,6 +962,113 @@ public:
     void set(mode_t string);
 };
 
+/**
+ * A fast formatter of timestamps for the current time.  The date and
+ * time up to the second, and the timezone offset with it, are formed
+ * only when the second changes, so most stamps only format their
+ * sub-second digits.  This is meant for logging many records a second.
+ * An instance keeps its own cache and is used from one thread at a time,
+ * while the static format() keeps a cache for each thread where the
+ * compiler supports thread local storage.
+ *
+ * @author David Sugar <dyfet@gnutelephony.org>
+ * @short cached timestamp formatting for logging.
+ */
+class __EXPORT TimeStamp
+{
+public:
+    /**
+     * Timestamp formats.
+     */
+    typedef enum {
+        LOCAL,      /**< 2015-06-01 12:34:56.789 in local time */
+        ISO8601,    /**< 2015-06-01T12:34:56.789+02:00 in local time */
+        UTC,        /**< 2015-06-01T12:34:56.789Z */
+        SYSLOG      /**< Jun  1 12:34:56 in local time */
+    } format_t;
+
+private:
+    typedef struct {
+        time_t second;
+        unsigned length, zone;
+        char prefix[24];
+        char suffix[8];
+    } cache_t;
+
+    cache_t cache;
+    format_t mode;
+    unsigned digits;
+    char buffer[48];
+
+    static size_t put(cache_t *cache, format_t format, unsigned digits,
+        const struct timeval *time, char *buffer, size_t size);
+
+public:
+    /**
+     * Create a timestamp formatter.
+     * @param format of stamps.
+     * @param digits of sub-second precision, from 0 to 6.
+     */
+    TimeStamp(format_t format = LOCAL, unsigned digits = 3);
+
+    /**
+     * Stamp the current time.
+     * @return formatted stamp.
+     */
+    const char *set(void);
+
+    /**
+     * Stamp a specific time.
+     * @param time to stamp.
+     * @return formatted stamp.
+     */
+    const char *set(const struct timeval *time);
+
+    /**
+     * Stamp the current time into a buffer.
+     * @param buffer to save into.
+     * @param size of buffer.
+     * @return length of stamp.
+     */
+    size_t put(char *buffer, size_t size);
+
+    /**
+     * Stamp a specific time into a buffer.
+     * @param buffer to save into.
+     * @param size of buffer.
+     * @param time to stamp.
+     * @return length of stamp.
+     */
+    size_t put(char *buffer, size_t size, const struct timeval *time);
+
+    /**
+     * Get the last stamp.
+     * @return formatted stamp.
+     */
+    inline const char *c_str(void) const {
+        return buffer;
+    }
+
+    /**
+     * Get the last stamp.
+     * @return formatted stamp.
+     */
+    inline operator const char *(void) const {
+        return buffer;
+    }
+
+    /**
+     * Stamp the current time into a buffer using a cache kept for each
+     * thread.
+     * @param buffer to save into.
+     * @param size of buffer.
+     * @param format of stamp.
+     * @param digits of sub-second precision, from 0 to 6.
+     * @return length of stamp.
+     */
+    static size_t format(char *buffer, size_t size, format_t format = LOCAL, unsigned digits = 3);
+};
+
 /**
  * A number class that manipulates a string buffer that is also a date.
  *
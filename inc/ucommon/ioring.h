@@ -0,0 +1,194 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+/**
+ * Batched submission and completion of file and socket i/o.  Requests for
+ * fsys and socket handles are queued, submitted together, and completed
+ * later.  On linux this uses io_uring where the kernel offers it.
+ * @file ucommon/ioring.h
+ */
+
+#ifndef _UCOMMON_IORING_H_
+#define _UCOMMON_IORING_H_
+
+#ifndef _UCOMMON_TIMERS_H_
+#include <ucommon/timers.h>
+#endif
+
+#ifndef _UCOMMON_SOCKET_H_
+#include <ucommon/socket.h>
+#endif
+
+#ifndef _UCOMMON_FSYS_H_
+#include <ucommon/fsys.h>
+#endif
+
+namespace ucommon {
+
+/**
+ * A submission and completion engine for file and socket i/o.  Reads,
+ * writes, receives, sends, accepts, and connects are queued, passed to
+ * the kernel together by submit(), and their results collected by wait()
+ * in the order they complete.  Where io_uring is available handles and
+ * buffers may also be registered with the kernel ahead of time, so they
+ * are not looked up and mapped again for each request.  Otherwise queued
+ * requests are performed in turn when submitted, and their results kept
+ * to be collected by wait() the same way.  The buffers and addresses
+ * passed with a request must remain valid until it completes.  An engine
+ * is used from one thread at a time.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+class __EXPORT IORing
+{
+public:
+    /**
+     * Result of a completed request.
+     */
+    typedef struct {
+        void *user;         /**< user data given with the request */
+        ssize_t result;     /**< bytes, accepted socket, or -errno */
+    } completion_t;
+
+private:
+    class engine;
+    class fallback;
+
+    engine *ring;
+    fallback *list;
+
+public:
+    /**
+     * Create an i/o engine.
+     * @param depth of requests that may be queued at once.
+     */
+    IORing(unsigned depth = 64);
+
+    /**
+     * Release engine.  Requests still in progress are cancelled, and
+     * their buffers should remain valid until this returns.
+     */
+    ~IORing();
+
+    /**
+     * Check if requests are passed to the kernel through io_uring.
+     * @return true if using io_uring.
+     */
+    bool is_kernel(void) const;
+
+    /**
+     * Register a file or socket handle with the kernel.  Later requests
+     * for the handle use the registered copy.
+     * @param fd to register.
+     * @return true if registered, false if not supported or full.
+     */
+    bool fixed(int fd);
+
+    /**
+     * Register a buffer with the kernel.  Later file reads and writes
+     * into memory inside the buffer use the registered pages.  Buffers
+     * should be registered before requests are queued.
+     * @param address of buffer.
+     * @param size of buffer.
+     * @return true if registered, false if not supported or full.
+     */
+    bool fixed(void *address, size_t size);
+
+    /**
+     * Queue a read from a file at an offset.
+     * @param file to read from.
+     * @param buffer to read into.
+     * @param size of read.
+     * @param offset in file.
+     * @param user data for completion.
+     * @return true if queued, false if the engine is full.
+     */
+    bool read(fsys& file, void *buffer, size_t size, fsys::offset_t offset, void *user = NULL);
+
+    /**
+     * Queue a write to a file at an offset.
+     * @param file to write to.
+     * @param buffer to write from.
+     * @param size of write.
+     * @param offset in file.
+     * @param user data for completion.
+     * @return true if queued, false if the engine is full.
+     */
+    bool write(fsys& file, const void *buffer, size_t size, fsys::offset_t offset, void *user = NULL);
+
+    /**
+     * Queue a receive from a connected socket.
+     * @param socket to receive from.
+     * @param buffer to receive into.
+     * @param size of buffer.
+     * @param user data for completion.
+     * @return true if queued, false if the engine is full.
+     */
+    bool recv(socket_t socket, void *buffer, size_t size, void *user = NULL);
+
+    /**
+     * Queue a send to a connected socket.
+     * @param socket to send to.
+     * @param buffer to send from.
+     * @param size of data.
+     * @param user data for completion.
+     * @return true if queued, false if the engine is full.
+     */
+    bool send(socket_t socket, const void *buffer, size_t size, void *user = NULL);
+
+    /**
+     * Queue accepting a connection from a listening socket.  The result
+     * is the new socket.
+     * @param socket listening.
+     * @param user data for completion.
+     * @return true if queued, false if the engine is full.
+     */
+    bool accept(socket_t socket, void *user = NULL);
+
+    /**
+     * Queue connecting a socket to an address.
+     * @param socket to connect.
+     * @param address to connect to.
+     * @param user data for completion.
+     * @return true if queued, false if the engine is full.
+     */
+    bool connect(socket_t socket, const struct sockaddr *address, void *user = NULL);
+
+    /**
+     * Pass queued requests to the kernel.
+     * @return number of requests submitted.
+     */
+    unsigned submit(void);
+
+    /**
+     * Collect completed requests.  Queued requests are submitted first.
+     * @param list of completions to fill.
+     * @param count of completions wanted at most.
+     * @param timeout to wait for at least one completion.
+     * @return number of completions.
+     */
+    unsigned wait(completion_t *list, unsigned count, timeout_t timeout = Timer::inf);
+
+    /**
+     * Get the number of requests queued or in progress.
+     * @return requests not yet collected.
+     */
+    unsigned pending(void) const;
+};
+
+} // namespace ucommon
+
+#endif
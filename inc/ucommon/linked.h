@@ -411,6 +411,8 @@ private:
 class __EXPORT NamedObject : public OrderedObject
 {
 protected:
+    friend class HashIndex;
+
     char *Id;
 
     /**
@@ -533,6 +535,15 @@ public:
      */
     static unsigned keyindex(const char *name, unsigned size);
 
+    /**
+     * Compute the full hash value of a name.  Letters are folded to one
+     * case so that objects which compare names without case are still
+     * found through the hash.
+     * @param name to hash.
+     * @return hash value of name.
+     */
+    static unsigned keyhash(const char *name);
+
     /**
      * Sort an array of named objects in alphabetical order.  This would
      * typically be used to sort a list created and returned by index().
@@ -595,15 +606,133 @@ public:
     }
 };
 
+/**
+ * A growable hash index of named objects.  Objects are held in an open
+ * addressed table using robin hood probing, with the full hash of each
+ * name kept beside it so most mismatches are passed over without comparing
+ * names.  The table doubles in size as it fills, so lookups stay short no
+ * matter how many objects are indexed.  Unlike a hash map table of linked
+ * lists, the objects are not linked through their next pointers, and an
+ * index may be used with any number of objects without choosing a size
+ * in advance.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+class __EXPORT HashIndex
+{
+private:
+    typedef struct {
+        NamedObject *node;
+        unsigned hash;
+    } slot_t;
+
+    slot_t *table;
+    unsigned mask, used;
+
+    void resize(unsigned size);
+    slot_t *lookup(const char *name, unsigned hash) const;
+    void insert(NamedObject *node, unsigned hash);
+
+public:
+    /**
+     * Create an empty hash index.
+     * @param size of objects expected, so the table need not grow.
+     */
+    HashIndex(unsigned size = 0);
+
+    /**
+     * Destroy hash index.  Objects still indexed are not released.
+     */
+    ~HashIndex();
+
+    /**
+     * Find a named object in the index.
+     * @param name of object to find.
+     * @return object pointer or NULL if not found.
+     */
+    NamedObject *find(const char *name) const;
+
+    /**
+     * Add a named object to the index.  Any object already indexed under
+     * the same name is replaced and released.
+     * @param object to add.
+     * @param name to assign the object, or NULL to keep its current id.
+     */
+    void add(NamedObject *object, char *name = NULL);
+
+    /**
+     * Remove a named object from the index.
+     * @param name of object to remove.
+     * @return object that is removed or NULL if not found.
+     */
+    NamedObject *remove(const char *name);
+
+    /**
+     * Iterate through the index.  Objects must not be added or removed
+     * while iterating.
+     * @param current object we iterated or NULL to find the first.
+     * @return next object in index or NULL if no more objects.
+     */
+    NamedObject *next(NamedObject *current = NULL) const;
+
+    /**
+     * Convert the index into a linear object pointer array.  The array is
+     * created from the heap and must be deleted when no longer used.
+     * @return array of named object pointers.
+     */
+    NamedObject **index(void) const;
+
+    /**
+     * Remove all objects from the index without releasing them.
+     */
+    void clear(void);
+
+    /**
+     * Remove and release all objects in the index.
+     */
+    void purge(void);
+
+    /**
+     * Reserve room for a number of objects so the table need not grow.
+     * @param size of objects expected.
+     */
+    void reserve(unsigned size);
+
+    /**
+     * Get the number of objects in the index.
+     * @return count of objects.
+     */
+    inline unsigned count(void) const {
+        return used;
+    }
+
+    /**
+     * Get the number of slots in the table.
+     * @return size of table.
+     */
+    inline unsigned size(void) const {
+        return table ? mask + 1 : 0;
+    }
+};
+
 /**
  * The named tree class is used to form a tree oriented list of associated
  * objects.  Typical uses for such data structures might be to form a
  * parsed XML document, or for forming complex configuration management
- * systems or for forming system resource management trees.
+ * systems or for forming system resource management trees.  Nodes with
+ * many children may be indexed so child and path lookups need not walk
+ * every sibling, and a node may also keep a cache of recent path lookups
+ * made from it.  Both are asked for explicitly, so lookups never change
+ * the tree and may be made by concurrent readers.
  * @author David Sugar <dyfet@gnutelephony.org>
  */
 class __EXPORT NamedTree : public NamedObject
 {
+private:
+    class lookup;
+    lookup *Lookup;
+
+    static void changed(NamedTree *node);
+
 protected:
     NamedTree *Parent;
     OrderedIndex Child;
@@ -675,6 +804,8 @@ public:
 
     /**
      * Find a direct child of our node which matches the specified name.
+     * When more than one child has the name, the first is found.  The
+     * hash index of children is used if the node has been indexed.
      * @param name of child node to find.
      * @return tree node object of child or NULL.
      */
@@ -716,13 +847,34 @@ public:
     }
 
     /**
-     * Get the ordered index of our child nodes.
+     * Get the ordered index of our child nodes.  Children should be added
+     * and removed through the tree rather than this list, so that the
+     * child index and path caches are kept current.
      * @return ordered index of our children.
      */
     inline OrderedIndex *getIndex(void) const {
         return const_cast<OrderedIndex*>(&Child);
     }
 
+    /**
+     * Keep a cache of path lookups made from this node.  Paths leading
+     * up through a parent are not cached.  Entries are dropped whenever
+     * the subtree below this node changes, so the cache is best used on
+     * trees that are mostly read, such as parsed configurations.
+     * @param size of cache in paths, or 0 to drop the cache.
+     */
+    void setCache(unsigned size);
+
+    /**
+     * Keep a hash index of the children of this node and of the nodes
+     * below it that have at least the given number of children.  An
+     * index is kept current as children are added, moved, renamed or
+     * removed.  Nodes added below an unindexed node are not indexed
+     * until this is called again.
+     * @param count of children a node needs to be indexed.
+     */
+    void index(unsigned count = 16);
+
     /**
      * Test if this node has a name.
      * @return true if name is set.
@@ -1973,6 +2125,143 @@ public:
     typedef linked_pointer<T> iterator;
 };
 
+/**
+ * A template class for a growable hash map.  This provides a typed front
+ * end to a hash index of objects derived from NamedObject, offering the
+ * same operations as a keymap without a fixed table size.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+template <class T>
+class hashmap : private HashIndex
+{
+public:
+    /**
+     * Create a hash map.
+     * @param size of objects expected, so the table need not grow.
+     */
+    inline hashmap(unsigned size = 0) : HashIndex(size) {}
+
+    /**
+     * Destroy the hash map by purging its objects.
+     */
+    inline ~hashmap() {
+        HashIndex::purge();
+    }
+
+    /**
+     * Find a typed object derived from NamedObject in the hash map by name.
+     * @param name to search for.
+     * @return typed object if found or NULL.
+     */
+    inline T *get(const char *name) const {
+        return static_cast<T*>(HashIndex::find(name));
+    }
+
+    /**
+     * Find a typed object derived from NamedObject in the hash map by name.
+     * @param name to search for.
+     * @return typed object if found or NULL.
+     */
+    inline T *operator[](const char *name) const {
+        return static_cast<T*>(HashIndex::find(name));
+    }
+
+    /**
+     * Add a typed object derived from NamedObject to the hash map by name.
+     * @param name to add, which is assumed to be a dup'd string.
+     * @param object to add.
+     */
+    inline void add(char *name, T& object) {
+        HashIndex::add(&object, name);
+    }
+
+    /**
+     * Add a typed object derived from NamedObject to the hash map by name.
+     * @param name to add, which is assumed to be a dup'd string.
+     * @param object to add.
+     */
+    inline void add(char *name, T *object) {
+        HashIndex::add(object, name);
+    }
+
+    /**
+     * Add a typed object that already has a name to the hash map.
+     * @param object to add.
+     */
+    inline void add(T *object) {
+        HashIndex::add(object);
+    }
+
+    /**
+     * Remove a typed object derived from NamedObject from the hash map.
+     * @param name to remove.
+     * @return object removed if found or NULL.
+     */
+    inline T *remove(const char *name) {
+        return static_cast<T*>(HashIndex::remove(name));
+    }
+
+    /**
+     * Find first typed object in hash map to iterate.
+     * @return first typed object or NULL if nothing in map.
+     */
+    inline T *begin(void) const {
+        return static_cast<T*>(HashIndex::next(NULL));
+    }
+
+    /**
+     * Find next typed object in hash map for iteration.
+     * @param current typed object we are referencing.
+     * @return next iterative object or NULL if past end of map.
+     */
+    inline T *next(T *current) const {
+        return static_cast<T*>(HashIndex::next(current));
+    }
+
+    /**
+     * Count the number of typed objects in our hash map.
+     * @return count of typed objects.
+     */
+    inline unsigned count(void) const {
+        return HashIndex::count();
+    }
+
+    /**
+     * Reserve room for a number of objects so the table need not grow.
+     * @param size of objects expected.
+     */
+    inline void reserve(unsigned size) {
+        HashIndex::reserve(size);
+    }
+
+    /**
+     * Remove and release all objects in the hash map.
+     */
+    inline void purge(void) {
+        HashIndex::purge();
+    }
+
+    /**
+     * Convert our hash map into a linear object pointer array.  The
+     * object pointer array is created from the heap and must be deleted
+     * when no longer used.
+     * @return array of typed named object pointers.
+     */
+    inline T **index(void) const {
+        return reinterpret_cast<T**>(HashIndex::index());
+    }
+
+    /**
+     * Convert our hash map into an alphabetically sorted linear object
+     * pointer array.  The object pointer array is created from the heap
+     * and must be deleted when no longer used.
+     * @return sorted array of typed named object pointers.
+     */
+    inline T **sort(void) const {
+        return reinterpret_cast<T**>(NamedObject::sort(HashIndex::index()));
+    }
+};
+
 /**
  * A template for ordered index of typed name key mapped objects.
  * This is used to hold an iterable linked list of typed named objects
@@ -72,11 +72,21 @@ protected:
 
     /**
      * Supporting function to construct a new or access an existing
-     * shared memory segment.  Used by primary constructors.
+     * shared memory segment.  Used by primary constructors.  Without
+     * placement options the segment is locked in memory if possible.
      * @param name of segment to create or access.
      * @param size of segment if creating new.  Use 0 for read-only access.
+     * @param placement options from memalloc::placement_t.
+     * @param node to bind segment to, or -1 for any numa node.
      */
-    void create(const char *name, size_t size = (size_t)0);
+    void create(const char *name, size_t size = (size_t)0, unsigned placement = 0, int node = -1);
+
+    /**
+     * Supporting function to access an existing shared memory segment
+     * for both reading and writing.
+     * @param name of segment to access.
+     */
+    void attach(const char *name);
 
     /**
      * Handler to invoke in derived class when accessing outside the
@@ -98,6 +108,17 @@ public:
      */
     MappedMemory(const char *name, size_t size);
 
+    /**
+     * Construct a read/write access mapped shared segment of memory with
+     * placement options.  Huge pages use a hugetlbfs mount if there is
+     * one, and otherwise ask for transparent huge pages.
+     * @param name of segment.
+     * @param size of segment.
+     * @param placement options from memalloc::placement_t.
+     * @param node to bind segment to, or -1 for any numa node.
+     */
+    MappedMemory(const char *name, size_t size, unsigned placement, int node = -1);
+
     /**
      * Provide read-only mapped access to an existing named shared memory
      * segment.  The size of the map is found by the size of the already
@@ -268,6 +289,321 @@ public:
     void removeLocked(ReusableObject *object);
 };
 
+/**
+ * A ring of variable length records held in a named shared memory segment.
+ * This is used to pass messages between processes without sockets or
+ * process local locks.  The head and tail of the ring are kept in the
+ * segment itself and are only changed atomically, and a reader or writer
+ * that has to wait sleeps on a futex in the segment where supported, so
+ * no system call is made while records are flowing.  A ring has one
+ * reader, and either one writer or, if created for multiple writers, any
+ * number of writing threads or processes.  The creating process owns the
+ * segment; other processes attach to it by name.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+class __EXPORT MappedRing : protected MappedMemory
+{
+private:
+    class control;
+
+    control *ctrl;
+    caddr_t data;
+    size_t mask;
+    uint64_t posted, reading;
+
+    void setup(void);
+
+public:
+    /**
+     * Create a named ring.  The space for records is rounded up to a
+     * power of two.
+     * @param name of segment to create.
+     * @param size of space for records.
+     * @param multiple writers if true, else only one writer.
+     */
+    MappedRing(const char *name, size_t size, bool multiple = false);
+
+    /**
+     * Attach to a named ring created by another process.
+     * @param name of existing segment.
+     */
+    MappedRing(const char *name);
+
+    /**
+     * Reserve space for a record to write in place.  The record is not
+     * seen by the reader until committed.
+     * @param size of record.
+     * @param timeout to wait for space in milliseconds, 0 to not wait.
+     * @return address of record or NULL if no space.
+     */
+    void *request(size_t size, timeout_t timeout = 0);
+
+    /**
+     * Pass a record written in place to the reader.
+     * @param record from request.
+     */
+    void commit(void *record);
+
+    /**
+     * Copy a record into the ring.
+     * @param record to post.
+     * @param size of record.
+     * @param timeout to wait for space in milliseconds, 0 to not wait.
+     * @return true if posted, false if no space.
+     */
+    bool post(const void *record, size_t size, timeout_t timeout = 0);
+
+    /**
+     * Examine the next record in place without removing it.
+     * @param size of record returned.
+     * @param timeout to wait for a record in milliseconds, 0 to not wait.
+     * @return address of record or NULL if none.
+     */
+    const void *peek(size_t *size, timeout_t timeout = 0);
+
+    /**
+     * Remove the record last examined with peek.
+     */
+    void next(void);
+
+    /**
+     * Copy the next record out of the ring and remove it.  A record
+     * larger than the buffer is truncated.
+     * @param buffer to copy record into.
+     * @param size of buffer.
+     * @param timeout to wait for a record in milliseconds, 0 to not wait.
+     * @return size of record or 0 if none.
+     */
+    size_t get(void *buffer, size_t size, timeout_t timeout = 0);
+
+    /**
+     * Test if no records are waiting.
+     * @return true if ring empty.
+     */
+    bool is_empty(void) const;
+
+    /**
+     * Get largest record that may be posted.
+     * @return largest record size.
+     */
+    size_t limit(void) const;
+
+    /**
+     * Test if ring is mapped.
+     * @return true if mapped.
+     */
+    inline operator bool() const
+        {return ctrl != NULL;}
+
+    /**
+     * Test if ring is not mapped.
+     * @return true if not mapped.
+     */
+    inline bool operator!() const
+        {return ctrl == NULL;}
+};
+
+/**
+ * A mutex placed in mapped memory and shared by processes.  The lock is
+ * recursive, and where robust mutexes are supported a process that dies
+ * while holding it does not leave others waiting forever.  As what the
+ * lock guards may have been left half changed, the lock is then made
+ * unusable, and every later attempt to acquire it fails.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+class __EXPORT MappedLock
+{
+private:
+    pthread_mutex_t mutex;
+
+public:
+    /**
+     * Initialize the lock.  This is done once, by the process that
+     * creates the mapped memory holding it.
+     */
+    void create(void);
+
+    /**
+     * Acquire the lock.  The lock is not held when this fails.
+     * @return false if an owner died while holding it.
+     */
+    bool acquire(void);
+
+    /**
+     * Release the lock.
+     */
+    void release(void);
+};
+
+/**
+ * A heap laid out in a shared memory segment.  Blocks are found by their
+ * offset from the arena, so the heap works wherever each process maps the
+ * segment.  Freed blocks are kept on free lists by size class, with four
+ * classes for each power of two, and are reused for requests of the same
+ * class.  The arena is locked by a process shared robust mutex, and if a
+ * process dies while holding it the arena fails every later call.  Blocks
+ * are aligned to 8 bytes.  An arena is only made by MappedHeap.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+class __EXPORT MappedArena
+{
+private:
+    friend class MappedHeap;
+
+    uint32_t magic, classes;
+    uint64_t size, top, allocated, first;
+    MappedLock mutex;
+    uint64_t free_list[176];
+
+    MappedArena();
+    MappedArena(const MappedArena& copy);
+
+    void create(size_t size);
+
+public:
+    /**
+     * Allocate a block from the arena.
+     * @param size of block.
+     * @return address of block or NULL if arena exhausted or unusable.
+     */
+    void *alloc(size_t size);
+
+    /**
+     * Change the size of a block.  The block is moved when it does not fit
+     * its size class, and the contents are copied byte for byte.
+     * @param memory block to resize, or NULL to allocate.
+     * @param size of block.
+     * @return address of block, or NULL if arena exhausted.
+     */
+    void *resize(void *memory, size_t size);
+
+    /**
+     * Return a block to the arena.
+     * @param memory block to free.
+     */
+    void free(void *memory);
+
+    /**
+     * Get usable size of a block.
+     * @param memory block to examine.
+     * @return usable size of block.
+     */
+    size_t usable(const void *memory) const;
+
+    /**
+     * Get offset of memory in the arena, for use by another process.
+     * @param memory in arena, or NULL.
+     * @return offset of memory, 0 if NULL.
+     */
+    inline size_t offset(const void *memory) const
+        {return memory ? (size_t)((const char *)memory - (const char *)this) : 0;}
+
+    /**
+     * Get address of memory in the arena from its offset.
+     * @param offset of memory, 0 for NULL.
+     * @return address of memory.
+     */
+    inline void *address(size_t offset) const
+        {return offset ? (void *)((char *)this + offset) : NULL;}
+
+    /**
+     * Get the root object of the arena.  The root is how processes that
+     * attach find what the creating process set up.
+     * @return root object or NULL if not set.
+     */
+    inline void *root(void) const
+        {return address((size_t)first);}
+
+    /**
+     * Set the root object of the arena.
+     * @param object to use as root.
+     */
+    inline void root(void *object)
+        {first = offset(object);}
+
+    /**
+     * Get number of bytes held by allocated blocks.
+     * @return bytes allocated.
+     */
+    inline size_t inuse(void) const
+        {return (size_t)allocated;}
+
+    /**
+     * Get size of arena.
+     * @return size of arena.
+     */
+    inline size_t len(void) const
+        {return (size_t)size;}
+};
+
+/**
+ * Construct or attach a heap in a named shared memory segment.  The heap
+ * itself is a MappedArena at the start of the segment.  Pointers between
+ * objects kept in the heap should use mapped_pointer or offsets, as each
+ * process may map the segment at a different address.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+class __EXPORT MappedHeap : protected MappedMemory
+{
+private:
+    MappedArena *heap;
+
+public:
+    /**
+     * Create a named heap.
+     * @param name of segment to create.
+     * @param size of heap.
+     * @param placement options from memalloc::placement_t.
+     * @param node to bind heap to, or -1 for any numa node.
+     */
+    MappedHeap(const char *name, size_t size, unsigned placement = 0, int node = -1);
+
+    /**
+     * Attach to a named heap created by another process.
+     * @param name of existing segment.
+     */
+    MappedHeap(const char *name);
+
+    /**
+     * Get the arena of the heap.
+     * @return arena or NULL if not mapped.
+     */
+    inline MappedArena *arena(void) const
+        {return heap;}
+
+    inline MappedArena *operator->() const
+        {return heap;}
+
+    /**
+     * Allocate a block from the heap.
+     * @param size of block.
+     * @return address of block or NULL if heap exhausted.
+     */
+    inline void *alloc(size_t size)
+        {return heap ? heap->alloc(size) : NULL;}
+
+    /**
+     * Return a block to the heap.
+     * @param memory block to free.
+     */
+    inline void free(void *memory)
+        {heap->free(memory);}
+
+    /**
+     * Test if heap is mapped.
+     * @return true if mapped.
+     */
+    inline operator bool() const
+        {return heap != NULL;}
+
+    /**
+     * Test if heap is not mapped.
+     * @return true if not mapped.
+     */
+    inline bool operator!() const
+        {return heap == NULL;}
+};
+
 /**
  * Template class to map typed vector into shared memory.  This is used to
  * construct a typed read/write vector of objects that are held in a named
@@ -508,6 +844,406 @@ public:
         {return (unsigned)(size / sizeof(T));}
 };
 
+/**
+ * Pointer that may be kept in shared memory.  The pointer holds the
+ * distance from itself to the object it points to, so it stays valid
+ * in every process that maps the segment, wherever the segment is mapped,
+ * so long as both the pointer and the object are in the same segment.
+ * Objects kept in a MappedHeap must use this rather than raw pointers.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+template <class T>
+class mapped_pointer
+{
+private:
+    intptr_t diff;
+
+public:
+    inline mapped_pointer()
+        {diff = 0;}
+
+    inline mapped_pointer(T *object)
+        {set(object);}
+
+    inline mapped_pointer(const mapped_pointer& copy)
+        {set(copy.get());}
+
+    /**
+     * Set the object pointed to.
+     * @param object to point to, or NULL.
+     */
+    inline void set(T *object)
+        {diff = object ? (intptr_t)((char *)object - (char *)this) : 0;}
+
+    /**
+     * Get the object pointed to.
+     * @return object or NULL.
+     */
+    inline T *get(void) const
+        {return diff ? (T *)((char *)this + diff) : NULL;}
+
+    inline mapped_pointer& operator=(T *object)
+        {set(object); return *this;}
+
+    inline mapped_pointer& operator=(const mapped_pointer& copy)
+        {set(copy.get()); return *this;}
+
+    inline operator T*() const
+        {return get();}
+
+    inline T* operator->() const
+        {return get();}
+
+    inline T& operator*() const
+        {return *get();}
+
+    inline bool operator!() const
+        {return diff == 0;}
+};
+
+/**
+ * Typed vector kept in a MappedHeap and shared by processes.  The vector
+ * finds its heap and its members by offset, so each process can use it
+ * where it maps the heap.  Members are copy constructed when the vector
+ * grows, so they must not hold raw pointers; use mapped_pointer instead.
+ * Changes are locked by a process shared lock that callers may also hold
+ * to keep the vector steady while reading it.  If a process dies holding
+ * the lock, every later change fails.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+template <class T>
+class mapped_vector
+{
+private:
+    uint64_t self, data, used, alloc;
+    MappedLock mutex;
+
+    inline mapped_vector(MappedArena *arena)
+        {self = arena->offset(this); data = used = alloc = 0; mutex.create();}
+
+    mapped_vector(const mapped_vector& copy);
+    mapped_vector& operator=(const mapped_vector& copy);
+
+    inline MappedArena *arena(void) const
+        {return (MappedArena *)((char *)this - self);}
+
+    inline T *members(void) const
+        {return (T *)arena()->address((size_t)data);}
+
+public:
+    /**
+     * Create a vector in a heap.
+     * @param arena of heap to create in.
+     * @return vector or NULL if heap exhausted.
+     */
+    static mapped_vector *create(MappedArena *arena) {
+        caddr_t mem = (caddr_t)arena->alloc(sizeof(mapped_vector));
+        return mem ? new(mem) mapped_vector(arena) : NULL;
+    }
+
+    /**
+     * Destroy the vector and return its memory to the heap.
+     */
+    void destroy(void) {
+        MappedArena *heap = arena();
+        clear();
+        heap->free(members());
+        heap->free(this);
+    }
+
+    /**
+     * Make room for a number of members.
+     * @param count of members to make room for.
+     * @return false if heap exhausted.
+     */
+    bool reserve(size_t count) {
+        bool result = true;
+        if(!mutex.acquire())
+            return false;
+        if(count > alloc) {
+            T *list = (T *)arena()->alloc(count * sizeof(T));
+            T *prior = members();
+            if(!list)
+                result = false;
+            else {
+                for(size_t pos = 0; pos < used; ++pos) {
+                    new((caddr_t)&list[pos]) T(prior[pos]);
+                    prior[pos].~T();
+                }
+                arena()->free(prior);
+                data = arena()->offset(list);
+                alloc = count;
+            }
+        }
+        mutex.release();
+        return result;
+    }
+
+    /**
+     * Add a member to the end of the vector.
+     * @param object to copy into the vector.
+     * @return false if heap exhausted.
+     */
+    bool push(const T& object) {
+        bool result = true;
+        if(!mutex.acquire())
+            return false;
+        if(used >= alloc)
+            result = reserve(alloc ? (size_t)alloc * 2 : 16);
+        if(result) {
+            new((caddr_t)&members()[used]) T(object);
+            ++used;
+        }
+        mutex.release();
+        return result;
+    }
+
+    /**
+     * Remove all members.  Memory reserved is kept.
+     */
+    void clear(void) {
+        if(!mutex.acquire())
+            return;
+        T *list = members();
+        for(size_t pos = 0; pos < used; ++pos)
+            list[pos].~T();
+        used = 0;
+        mutex.release();
+    }
+
+    /**
+     * Get number of members.
+     * @return count of members.
+     */
+    inline size_t size(void) const
+        {return (size_t)used;}
+
+    /**
+     * Reference a member.  The reference is valid until the vector grows.
+     * @param index of member.
+     * @return member reference.
+     */
+    inline T& operator[](size_t index) const
+        {return members()[index];}
+
+    /**
+     * Lock the vector to keep it steady while reading it.
+     * @return false if a process died holding the lock, and the vector
+     * is not locked.
+     */
+    inline bool lock(void)
+        {return mutex.acquire();}
+
+    /**
+     * Unlock the vector.
+     */
+    inline void unlock(void)
+        {mutex.release();}
+};
+
+/**
+ * Hash map of named objects kept in a MappedHeap and shared by processes.
+ * Each entry is a value initialized object of type T stored with its
+ * key in one block of the heap, and the buckets hold offsets, so the map
+ * is valid wherever each process maps the heap.  Entries do not move when
+ * the map grows, so a returned object stays valid until it is removed.
+ * Objects must not hold raw pointers; use mapped_pointer instead.  The map
+ * is locked by a process shared lock that callers may also hold while
+ * they update an entry in place.  If a process dies holding the lock,
+ * every later lookup and change fails.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+template <class T>
+class mapped_hashmap
+{
+private:
+    class node
+    {
+    public:
+        uint64_t next;
+        unsigned hash;
+        T value;
+        char id[1];
+    };
+
+    uint64_t self, table, buckets, total;
+    MappedLock mutex;
+
+    inline mapped_hashmap(MappedArena *arena)
+        {self = arena->offset(this); table = buckets = total = 0; mutex.create();}
+
+    mapped_hashmap(const mapped_hashmap& copy);
+    mapped_hashmap& operator=(const mapped_hashmap& copy);
+
+    inline MappedArena *arena(void) const
+        {return (MappedArena *)((char *)this - self);}
+
+    inline uint64_t *index(void) const
+        {return (uint64_t *)arena()->address((size_t)table);}
+
+    inline node *entry(uint64_t offset) const
+        {return (node *)arena()->address((size_t)offset);}
+
+    node *find(const char *key, unsigned hash) const {
+        if(!buckets)
+            return NULL;
+        node *item = entry(index()[hash & (buckets - 1)]);
+        while(item) {
+            if(item->hash == hash && eq(item->id, key))
+                return item;
+            item = entry(item->next);
+        }
+        return NULL;
+    }
+
+    bool grow(void) {
+        uint64_t count = buckets ? buckets * 2 : 64;
+        uint64_t *list = (uint64_t *)arena()->alloc((size_t)count * sizeof(uint64_t));
+        uint64_t *prior = index();
+        if(!list)
+            return false;
+        memset(list, 0, (size_t)count * sizeof(uint64_t));
+        for(uint64_t pos = 0; pos < buckets; ++pos) {
+            uint64_t offset = prior[pos];
+            while(offset) {
+                node *item = entry(offset);
+                uint64_t next = item->next;
+                item->next = list[item->hash & (count - 1)];
+                list[item->hash & (count - 1)] = offset;
+                offset = next;
+            }
+        }
+        arena()->free(prior);
+        table = arena()->offset(list);
+        buckets = count;
+        return true;
+    }
+
+public:
+    /**
+     * Create a hash map in a heap.
+     * @param arena of heap to create in.
+     * @return map or NULL if heap exhausted.
+     */
+    static mapped_hashmap *create(MappedArena *arena) {
+        caddr_t mem = (caddr_t)arena->alloc(sizeof(mapped_hashmap));
+        return mem ? new(mem) mapped_hashmap(arena) : NULL;
+    }
+
+    /**
+     * Destroy the map and all its entries, returning memory to the heap.
+     */
+    void destroy(void) {
+        MappedArena *heap = arena();
+        if(mutex.acquire()) {
+            for(uint64_t pos = 0; pos < buckets; ++pos) {
+                node *item = entry(index()[pos]);
+                while(item) {
+                    node *next = entry(item->next);
+                    item->value.~T();
+                    heap->free(item);
+                    item = next;
+                }
+            }
+            mutex.release();
+        }
+        heap->free(index());
+        heap->free(this);
+    }
+
+    /**
+     * Find an entry by key.
+     * @param key to find.
+     * @return object or NULL if not found.
+     */
+    T *get(const char *key) {
+        if(!mutex.acquire())
+            return NULL;
+        node *item = find(key, NamedObject::keyhash(key));
+        mutex.release();
+        return item ? &item->value : NULL;
+    }
+
+    /**
+     * Find or add an entry by key.  A new entry is value initialized.
+     * @param key of entry.
+     * @return object or NULL if heap exhausted.
+     */
+    T *add(const char *key) {
+        unsigned hash = NamedObject::keyhash(key);
+        if(!mutex.acquire())
+            return NULL;
+        node *item = find(key, hash);
+        if(!item && (total < buckets || grow())) {
+            size_t len = strlen(key);
+            caddr_t mem = (caddr_t)arena()->alloc(sizeof(node) + len);
+            if(mem) {
+                item = new(mem) node();
+                memcpy(item->id, key, len + 1);
+                item->hash = hash;
+                item->next = index()[hash & (buckets - 1)];
+                index()[hash & (buckets - 1)] = arena()->offset(item);
+                ++total;
+            }
+        }
+        mutex.release();
+        return item ? &item->value : NULL;
+    }
+
+    /**
+     * Remove an entry by key and return its memory to the heap.
+     * @param key of entry.
+     * @return true if found.
+     */
+    bool remove(const char *key) {
+        unsigned hash = NamedObject::keyhash(key);
+        bool result = false;
+        if(!mutex.acquire())
+            return false;
+        if(buckets) {
+            uint64_t *link = &index()[hash & (buckets - 1)];
+            while(*link) {
+                node *item = entry(*link);
+                if(item->hash == hash && eq(item->id, key)) {
+                    *link = item->next;
+                    item->value.~T();
+                    arena()->free(item);
+                    --total;
+                    result = true;
+                    break;
+                }
+                link = &item->next;
+            }
+        }
+        mutex.release();
+        return result;
+    }
+
+    /**
+     * Get number of entries.
+     * @return count of entries.
+     */
+    inline size_t count(void) const
+        {return (size_t)total;}
+
+    inline T *operator[](const char *key)
+        {return get(key);}
+
+    /**
+     * Lock the map while updating entries in place.
+     * @return false if a process died holding the lock, and the map is
+     * not locked.
+     */
+    inline bool lock(void)
+        {return mutex.acquire();}
+
+    /**
+     * Unlock the map.
+     */
+    inline void unlock(void)
+        {mutex.release();}
+};
+
 } // namespace ucommon
 
 #endif
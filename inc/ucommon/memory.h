@@ -64,7 +64,8 @@ private:
     friend class bufpager;
 
     size_t pagesize, align;
-    unsigned count;
+    unsigned count, placing;
+    int node;
 
     typedef struct mempage {
         struct mempage *next;
@@ -91,6 +92,16 @@ protected:
     virtual void fault(void) const;
 
 public:
+    /**
+     * Placement options for large blocks of memory.  These may be combined.
+     */
+    typedef enum {
+        HUGEPAGES = 0x01,   /**< reserved huge pages, else transparent */
+        TRANSPARENT = 0x02, /**< transparent huge pages */
+        PREFAULT = 0x04,    /**< map every page in advance */
+        LOCKED = 0x08       /**< lock pages in memory */
+    } placement_t;
+
     /**
      * Construct a memory pager.
      * @param page size to use or 0 for OS allocation size.
@@ -151,6 +162,49 @@ public:
      * @return allocated memory or NULL if not possible.
      */
     virtual void *_alloc(size_t size);
+
+    /**
+     * Set placement of heap pages.  Pages are then mapped directly from
+     * the system rather than the heap.  Huge pages round the page size up
+     * to the size of a huge page.  This can only be set before any pages
+     * are allocated.
+     * @param options of placement.
+     * @param node to bind pages to, or -1 for any numa node.
+     * @return true if set.
+     */
+    bool placement(unsigned options, int node = -1);
+
+    /**
+     * Map a block of private memory with placement options.
+     * @param size of block.
+     * @param options of placement.
+     * @param node to bind block to, or -1 for any numa node.
+     * @return address of block or NULL if cannot map.
+     */
+    static void *map(size_t size, unsigned options, int node = -1);
+
+    /**
+     * Release a block of memory from map.
+     * @param address of block.
+     * @param size of block.
+     */
+    static void unmap(void *address, size_t size);
+
+    /**
+     * Apply placement options to memory already mapped.  Transparent huge
+     * pages and the numa node are set before pages are faulted in.
+     * @param address of mapped memory.
+     * @param size of mapped memory.
+     * @param options of placement.
+     * @param node to bind memory to, or -1 for any numa node.
+     */
+    static void place(void *address, size_t size, unsigned options, int node = -1);
+
+    /**
+     * Get size of a huge page.
+     * @return huge page size, or system page size if none.
+     */
+    static size_t hugepage(void);
 };
 
 /**
@@ -951,15 +1005,14 @@ private:
         void *data;
         char text[8];
 
-        keydata(keyassoc *assoc, const char *id, unsigned max, unsigned bufsize);
+        keydata(keyassoc *assoc, const char *id, unsigned bufsize);
     };
 
     friend class keydata;
 
     unsigned keycount;
-    unsigned paths;
     size_t keysize;
-    NamedObject **root;
+    HashIndex index;
     LinkedObject **list;
 
 protected:
@@ -973,8 +1026,9 @@ protected:
 
 public:
     /**
-     * Create a key associated memory pointer table.
-     * @param indexing size for hash map.
+     * Create a key associated memory pointer table.  The hash index
+     * grows as names are added.
+     * @param indexing size of names expected.
      * @param max size of a string name if names are in reusable managed memory.
      * @param page size of memory pager.
      */
@@ -0,0 +1,1108 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+/**
+ * Ordered maps of managed objects kept in arrays.  Keys are held in
+ * contiguous arrays rather than in linked objects, so lookups and range
+ * scans stay in cache rather than chasing pointers across the heap, and
+ * objects come out in key order without sorting.  Objects held are
+ * retained when added and released when removed.  A multi-key index of
+ * objects by several hashed and ordered keys at once is also offered.
+ * @file ucommon/ordered.h
+ */
+
+#ifndef _UCOMMON_ORDERED_H_
+#define _UCOMMON_ORDERED_H_
+
+#ifndef _UCOMMON_OBJECT_H_
+#include <ucommon/object.h>
+#endif
+
+namespace ucommon {
+
+/**
+ * An ordered map of managed objects held in a sorted array.  Lookups are
+ * a binary search of one array of keys, and iteration walks the array in
+ * key order.  Adding or removing a key moves the keys after it, so this
+ * suits maps that are built once and read often, or that are small.  Keys
+ * are copied into the map and ordered by their less than operator.  The
+ * object type must be derived from ObjectProtocol.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+template <typename K, class T>
+class sortedmap
+{
+private:
+    K *keys;
+    T **objects;
+    unsigned used, alloc;
+
+    sortedmap(const sortedmap& copy);
+    sortedmap& operator=(const sortedmap& copy);
+
+    unsigned lower(const K& key) const {
+        unsigned low = 0, high = used;
+        while(low < high) {
+            unsigned mid = (low + high) / 2;
+            if(keys[mid] < key)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        return low;
+    }
+
+    inline bool match(unsigned pos, const K& key) const {
+        return pos < used && !(key < keys[pos]);
+    }
+
+public:
+    /**
+     * Iterator for an ordered map, used like a linked_pointer.
+     */
+    class iterator
+    {
+    private:
+        const sortedmap *map;
+        unsigned pos;
+
+    public:
+        inline iterator(const sortedmap *source = NULL, unsigned index = 0) {
+            map = source;
+            pos = index;
+        }
+
+        inline T* operator->() const {
+            return map->objects[pos];
+        }
+
+        inline T* operator*() const {
+            return map->objects[pos];
+        }
+
+        inline operator T*() const {
+            return (map && pos < map->used) ? map->objects[pos] : NULL;
+        }
+
+        /**
+         * Get key of current object.
+         * @return key of object.
+         */
+        inline const K& key(void) const {
+            return map->keys[pos];
+        }
+
+        inline void next(void) {
+            ++pos;
+        }
+
+        inline void operator++() {
+            ++pos;
+        }
+
+        inline operator bool() const {
+            return map && pos < map->used;
+        }
+
+        inline bool operator!() const {
+            return !map || pos >= map->used;
+        }
+    };
+
+    /**
+     * Create an empty map.
+     * @param size of objects to reserve room for.
+     */
+    inline sortedmap(unsigned size = 0) {
+        keys = NULL;
+        objects = NULL;
+        used = alloc = 0;
+        if(size)
+            reserve(size);
+    }
+
+    /**
+     * Release all objects and destroy the map.
+     */
+    inline ~sortedmap() {
+        clear();
+        delete[] keys;
+        delete[] objects;
+    }
+
+    /**
+     * Reserve room for a number of objects.
+     * @param size of objects to reserve room for.
+     */
+    void reserve(unsigned size) {
+        if(size <= alloc)
+            return;
+
+        K *list = new K[size];
+        T **ptrs = new T*[size];
+        for(unsigned pos = 0; pos < used; ++pos) {
+            list[pos] = keys[pos];
+            ptrs[pos] = objects[pos];
+        }
+        delete[] keys;
+        delete[] objects;
+        keys = list;
+        objects = ptrs;
+        alloc = size;
+    }
+
+    /**
+     * Add an object under a key.  An object already held under the key is
+     * replaced and released.
+     * @param key of object.
+     * @param object to add.
+     * @return true if the key is new.
+     */
+    bool add(const K& key, T *object) {
+        unsigned pos = lower(key);
+        object->retain();
+        if(match(pos, key)) {
+            objects[pos]->release();
+            objects[pos] = object;
+            return false;
+        }
+
+        if(used >= alloc)
+            reserve(alloc ? alloc * 2 : 16);
+
+        for(unsigned move = used; move > pos; --move) {
+            keys[move] = keys[move - 1];
+            objects[move] = objects[move - 1];
+        }
+        keys[pos] = key;
+        objects[pos] = object;
+        ++used;
+        return true;
+    }
+
+    /**
+     * Find object by key.
+     * @param key to find.
+     * @return object or NULL if not found.
+     */
+    inline T *find(const K& key) const {
+        unsigned pos = lower(key);
+        return match(pos, key) ? objects[pos] : NULL;
+    }
+
+    inline T *operator[](const K& key) const {
+        return find(key);
+    }
+
+    /**
+     * Remove and release object by key.
+     * @param key of object to remove.
+     * @return true if found.
+     */
+    bool remove(const K& key) {
+        unsigned pos = lower(key);
+        if(!match(pos, key))
+            return false;
+
+        objects[pos]->release();
+        while(++pos < used) {
+            keys[pos - 1] = keys[pos];
+            objects[pos - 1] = objects[pos];
+        }
+        keys[--used] = K();
+        return true;
+    }
+
+    /**
+     * Release all objects in the map.
+     */
+    void clear(void) {
+        for(unsigned pos = 0; pos < used; ++pos) {
+            objects[pos]->release();
+            keys[pos] = K();
+        }
+        used = 0;
+    }
+
+    /**
+     * Get first object in key order.
+     * @return iterator at first object.
+     */
+    inline iterator begin(void) const {
+        return iterator(this, 0);
+    }
+
+    /**
+     * Get first object at or after a key, to scan a range of keys.
+     * @param key to start from.
+     * @return iterator at object.
+     */
+    inline iterator from(const K& key) const {
+        return iterator(this, lower(key));
+    }
+
+    /**
+     * Get number of objects in map.
+     * @return count of objects.
+     */
+    inline unsigned count(void) const {
+        return used;
+    }
+};
+
+/**
+ * An ordered map of managed objects held in a b+tree.  Keys and objects
+ * are kept in arrays of up to S entries in each node, and the leaf nodes
+ * are linked in key order, so lookups touch one node for each level of
+ * the tree and range scans walk leaves one array at a time.  Unlike the
+ * sorted map, adding and removing keys only moves entries in one node.
+ * Nodes are freed when they empty, but are not merged.  Keys are copied
+ * into the map and ordered by their less than operator.  The object type
+ * must be derived from ObjectProtocol.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+template <typename K, class T, unsigned S = 32>
+class btreemap
+{
+private:
+    class node
+    {
+    public:
+        unsigned used;
+        bool leaf;
+        K keys[S];
+    };
+
+    class branch : public node
+    {
+    public:
+        node *child[S + 1];
+
+        inline branch() {
+            this->used = 0;
+            this->leaf = false;
+        }
+    };
+
+    class leafnode : public node
+    {
+    public:
+        T *objects[S];
+        leafnode *prev, *next;
+
+        inline leafnode() {
+            this->used = 0;
+            this->leaf = true;
+            prev = next = NULL;
+        }
+    };
+
+    // result of removing a key from a node
+    enum {REMOVE_NONE = 0, REMOVE_KEY, REMOVE_NODE};
+
+    node *root;
+    leafnode *first;
+    unsigned total;
+
+    btreemap(const btreemap& copy);
+    btreemap& operator=(const btreemap& copy);
+
+    static unsigned lower(const node *np, const K& key) {
+        unsigned low = 0, high = np->used;
+        while(low < high) {
+            unsigned mid = (low + high) / 2;
+            if(np->keys[mid] < key)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        return low;
+    }
+
+    static unsigned upper(const node *np, const K& key) {
+        unsigned low = 0, high = np->used;
+        while(low < high) {
+            unsigned mid = (low + high) / 2;
+            if(key < np->keys[mid])
+                high = mid;
+            else
+                low = mid + 1;
+        }
+        return low;
+    }
+
+    leafnode *search(const K& key) const {
+        node *np = root;
+        while(np && !np->leaf)
+            np = static_cast<branch *>(np)->child[upper(np, key)];
+        return static_cast<leafnode *>(np);
+    }
+
+    // insert into node, returning a new right sibling if it was split
+    node *insert(node *np, const K& key, T *object, K& split, bool& added) {
+        if(np->leaf) {
+            leafnode *lp = static_cast<leafnode *>(np);
+            unsigned pos = lower(lp, key);
+            if(pos < lp->used && !(key < lp->keys[pos])) {
+                lp->objects[pos]->release();
+                lp->objects[pos] = object;
+                return NULL;
+            }
+
+            added = true;
+            if(lp->used < S) {
+                for(unsigned move = lp->used; move > pos; --move) {
+                    lp->keys[move] = lp->keys[move - 1];
+                    lp->objects[move] = lp->objects[move - 1];
+                }
+                lp->keys[pos] = key;
+                lp->objects[pos] = object;
+                ++lp->used;
+                return NULL;
+            }
+
+            leafnode *rp = new leafnode();
+            unsigned half = (S + 1) / 2;
+            for(unsigned index = S + 1, from = S; index-- > half;) {
+                if(index == pos) {
+                    rp->keys[index - half] = key;
+                    rp->objects[index - half] = object;
+                }
+                else {
+                    --from;
+                    rp->keys[index - half] = lp->keys[from];
+                    rp->objects[index - half] = lp->objects[from];
+                }
+            }
+            if(pos < half) {
+                for(unsigned move = half - 1; move > pos; --move) {
+                    lp->keys[move] = lp->keys[move - 1];
+                    lp->objects[move] = lp->objects[move - 1];
+                }
+                lp->keys[pos] = key;
+                lp->objects[pos] = object;
+            }
+            for(unsigned index = half; index < S; ++index)
+                lp->keys[index] = K();
+            lp->used = half;
+            rp->used = S + 1 - half;
+            rp->next = lp->next;
+            rp->prev = lp;
+            if(lp->next)
+                lp->next->prev = rp;
+            lp->next = rp;
+            split = rp->keys[0];
+            return rp;
+        }
+
+        branch *bp = static_cast<branch *>(np);
+        unsigned pos = upper(bp, key);
+        K sep;
+        node *right = insert(bp->child[pos], key, object, sep, added);
+        if(!right)
+            return NULL;
+
+        if(bp->used < S) {
+            for(unsigned move = bp->used; move > pos; --move) {
+                bp->keys[move] = bp->keys[move - 1];
+                bp->child[move + 1] = bp->child[move];
+            }
+            bp->keys[pos] = sep;
+            bp->child[pos + 1] = right;
+            ++bp->used;
+            return NULL;
+        }
+
+        // split a full branch around its middle key
+        K keys[S + 1];
+        node *child[S + 2];
+        for(unsigned index = 0, from = 0; index <= S; ++index) {
+            if(index == pos)
+                keys[index] = sep;
+            else
+                keys[index] = bp->keys[from++];
+        }
+        for(unsigned index = 0, from = 0; index <= S + 1; ++index) {
+            if(index == pos + 1)
+                child[index] = right;
+            else
+                child[index] = bp->child[from++];
+        }
+
+        branch *rp = new branch();
+        unsigned half = (S + 1) / 2;
+        bp->used = half;
+        for(unsigned index = 0; index < half; ++index) {
+            bp->keys[index] = keys[index];
+            bp->child[index] = child[index];
+        }
+        bp->child[half] = child[half];
+        for(unsigned index = half; index < S; ++index)
+            bp->keys[index] = K();
+        split = keys[half];
+        rp->used = S - half;
+        for(unsigned index = 0; index < rp->used; ++index) {
+            rp->keys[index] = keys[half + 1 + index];
+            rp->child[index] = child[half + 1 + index];
+        }
+        rp->child[rp->used] = child[S + 1];
+        return rp;
+    }
+
+    int erase(node *np, const K& key) {
+        if(np->leaf) {
+            leafnode *lp = static_cast<leafnode *>(np);
+            unsigned pos = lower(lp, key);
+            if(pos >= lp->used || key < lp->keys[pos])
+                return REMOVE_NONE;
+
+            lp->objects[pos]->release();
+            while(++pos < lp->used) {
+                lp->keys[pos - 1] = lp->keys[pos];
+                lp->objects[pos - 1] = lp->objects[pos];
+            }
+            lp->keys[--lp->used] = K();
+            if(lp->used)
+                return REMOVE_KEY;
+
+            if(lp->prev)
+                lp->prev->next = lp->next;
+            else
+                first = lp->next;
+            if(lp->next)
+                lp->next->prev = lp->prev;
+            delete lp;
+            return REMOVE_NODE;
+        }
+
+        branch *bp = static_cast<branch *>(np);
+        unsigned pos = upper(bp, key);
+        int result = erase(bp->child[pos], key);
+        if(result != REMOVE_NODE)
+            return result;
+
+        if(!bp->used) {
+            delete bp;
+            return REMOVE_NODE;
+        }
+
+        // drop the emptied child and the key that separated it
+        unsigned drop = pos ? pos - 1 : 0;
+        for(unsigned move = drop; move + 1 < bp->used; ++move)
+            bp->keys[move] = bp->keys[move + 1];
+        for(unsigned move = pos; move < bp->used; ++move)
+            bp->child[move] = bp->child[move + 1];
+        bp->keys[--bp->used] = K();
+        return REMOVE_KEY;
+    }
+
+    void purge(node *np) {
+        if(np->leaf) {
+            leafnode *lp = static_cast<leafnode *>(np);
+            for(unsigned pos = 0; pos < lp->used; ++pos)
+                lp->objects[pos]->release();
+            delete lp;
+            return;
+        }
+
+        branch *bp = static_cast<branch *>(np);
+        for(unsigned pos = 0; pos <= bp->used; ++pos)
+            purge(bp->child[pos]);
+        delete bp;
+    }
+
+public:
+    /**
+     * Iterator for an ordered map, used like a linked_pointer.
+     */
+    class iterator
+    {
+    private:
+        const leafnode *lp;
+        unsigned pos;
+
+    public:
+        inline iterator(const leafnode *leaf = NULL, unsigned index = 0) {
+            lp = leaf;
+            pos = index;
+            if(lp && pos >= lp->used)
+                next();
+        }
+
+        inline T* operator->() const {
+            return lp->objects[pos];
+        }
+
+        inline T* operator*() const {
+            return lp->objects[pos];
+        }
+
+        inline operator T*() const {
+            return lp ? lp->objects[pos] : NULL;
+        }
+
+        /**
+         * Get key of current object.
+         * @return key of object.
+         */
+        inline const K& key(void) const {
+            return lp->keys[pos];
+        }
+
+        inline void next(void) {
+            if(++pos >= lp->used) {
+                lp = lp->next;
+                pos = 0;
+            }
+        }
+
+        inline void operator++() {
+            next();
+        }
+
+        inline operator bool() const {
+            return lp != NULL;
+        }
+
+        inline bool operator!() const {
+            return lp == NULL;
+        }
+    };
+
+    /**
+     * Create an empty map.
+     */
+    inline btreemap() {
+        root = NULL;
+        first = NULL;
+        total = 0;
+    }
+
+    /**
+     * Release all objects and destroy the map.
+     */
+    inline ~btreemap() {
+        clear();
+    }
+
+    /**
+     * Add an object under a key.  An object already held under the key is
+     * replaced and released.
+     * @param key of object.
+     * @param object to add.
+     * @return true if the key is new.
+     */
+    bool add(const K& key, T *object) {
+        bool added = false;
+        K split;
+
+        object->retain();
+        if(!root) {
+            first = new leafnode();
+            root = first;
+        }
+
+        node *right = insert(root, key, object, split, added);
+        if(right) {
+            branch *bp = new branch();
+            bp->used = 1;
+            bp->keys[0] = split;
+            bp->child[0] = root;
+            bp->child[1] = right;
+            root = bp;
+        }
+        if(added)
+            ++total;
+        return added;
+    }
+
+    /**
+     * Find object by key.
+     * @param key to find.
+     * @return object or NULL if not found.
+     */
+    T *find(const K& key) const {
+        const leafnode *lp = search(key);
+        if(!lp)
+            return NULL;
+
+        unsigned pos = lower(lp, key);
+        if(pos < lp->used && !(key < lp->keys[pos]))
+            return lp->objects[pos];
+        return NULL;
+    }
+
+    inline T *operator[](const K& key) const {
+        return find(key);
+    }
+
+    /**
+     * Remove and release object by key.
+     * @param key of object to remove.
+     * @return true if found.
+     */
+    bool remove(const K& key) {
+        if(!root)
+            return false;
+
+        int result = erase(root, key);
+        if(result == REMOVE_NONE)
+            return false;
+
+        --total;
+        if(result == REMOVE_NODE)
+            root = NULL;
+
+        // a branch left with one child is replaced by it
+        while(root && !root->leaf && !root->used) {
+            branch *bp = static_cast<branch *>(root);
+            root = bp->child[0];
+            delete bp;
+        }
+        return true;
+    }
+
+    /**
+     * Release all objects in the map.
+     */
+    void clear(void) {
+        if(root)
+            purge(root);
+        root = NULL;
+        first = NULL;
+        total = 0;
+    }
+
+    /**
+     * Get first object in key order.
+     * @return iterator at first object.
+     */
+    inline iterator begin(void) const {
+        return iterator(first, 0);
+    }
+
+    /**
+     * Get first object at or after a key, to scan a range of keys.
+     * @param key to start from.
+     * @return iterator at object.
+     */
+    inline iterator from(const K& key) const {
+        const leafnode *lp = search(key);
+        return iterator(lp, lp ? lower(lp, key) : 0);
+    }
+
+    /**
+     * Get number of objects in map.
+     * @return count of objects.
+     */
+    inline unsigned count(void) const {
+        return total;
+    }
+};
+
+/**
+ * An index of objects by several keys at once.  Each path of the index is
+ * either hashed, for finding objects by exact key, or ordered, for finding
+ * and scanning objects in key order, and a path may require keys to be
+ * unique.  Objects supply their own keys for each path, and the index
+ * keeps a copy of the keys it filed them under, so that an object can be
+ * refiled when its keys change, or removed, without searching for it.
+ * Unlike MultiMap, the hash tables of each path grow as they fill.  Keys
+ * are text, binary data, or numbers; ordered paths sort numbers by value
+ * and text and data by their bytes.  Objects are retained while indexed.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+class __EXPORT MultiIndex
+{
+public:
+    /**
+     * Options for a path of the index.
+     */
+    typedef enum {HASHED = 0, ORDERED = 1, UNIQUE = 2} option_t;
+
+    /**
+     * A key value for a path.  Text keys are NULL terminated strings, and
+     * a key made without data is a number.  Keys passed to the index are
+     * copied, so they need only be valid for the call.
+     */
+    class __EXPORT key
+    {
+    public:
+        const void *data;
+        size_t size;
+        int64_t number;
+
+        key();
+        key(const char *text);
+        key(const void *data, size_t size);
+        key(int64_t number);
+    };
+
+    /**
+     * Base class for objects kept in a multi-key index.
+     */
+    class __EXPORT member : public CountedObject
+    {
+    private:
+        friend class MultiIndex;
+
+        MultiIndex *index;
+        member *prev, *next;
+        void *links;
+
+    protected:
+        member();
+        virtual ~member();
+
+    public:
+        /**
+         * Get key of our object for a path of the index.
+         * @param path of index.
+         * @return key of object for path.
+         */
+        virtual key keyof(unsigned path) const = 0;
+
+        /**
+         * Get the index we are filed in.
+         * @return index or NULL if not indexed.
+         */
+        inline MultiIndex *getIndex(void) const {
+            return index;
+        }
+
+        /**
+         * Get next object in the index, in the order added.
+         * @return next object or NULL if last.
+         */
+        inline member *getNext(void) const {
+            return next;
+        }
+    };
+
+private:
+    // key text is shared with the ordered paths, which may keep copies
+    // of keys to separate their nodes after the object is removed.
+    typedef struct {
+        unsigned refs;
+        size_t size;
+        char data[1];
+    } text_t;
+
+    typedef struct {
+        int64_t number;
+        text_t *text;
+        unsigned hash;
+    } link_t;
+
+    class table;
+
+    class order
+    {
+    public:
+        int64_t number;
+        const char *data;
+        size_t size;
+        text_t *text;
+        const member *node;
+
+        inline order() {
+            number = 0;
+            data = NULL;
+            size = 0;
+            text = NULL;
+            node = NULL;
+        }
+
+        inline order(const link_t *link, const member *object) {
+            number = link->number;
+            text = link->text;
+            data = text ? text->data : NULL;
+            size = text ? text->size : 0;
+            node = object;
+            if(text)
+                ++text->refs;
+        }
+
+        inline order(const key& value) {
+            number = value.number;
+            data = (const char *)value.data;
+            size = value.size;
+            text = NULL;
+            node = NULL;
+        }
+
+        inline order(const order& copy) {
+            number = copy.number;
+            data = copy.data;
+            size = copy.size;
+            text = copy.text;
+            node = copy.node;
+            if(text)
+                ++text->refs;
+        }
+
+        inline ~order() {
+            MultiIndex::release(text);
+        }
+
+        inline order& operator=(const order& copy) {
+            if(copy.text)
+                ++copy.text->refs;
+            MultiIndex::release(text);
+            number = copy.number;
+            data = copy.data;
+            size = copy.size;
+            text = copy.text;
+            node = copy.node;
+            return *this;
+        }
+
+        bool operator<(const order& other) const;
+    };
+
+    static inline void release(text_t *text) {
+        if(text && !--text->refs)
+            ::free(text);
+    }
+
+    typedef btreemap<order, member> ordering;
+
+    typedef struct {
+        unsigned options;
+        table *hashed;
+        ordering *ordered;
+    } path_t;
+
+    path_t *list;
+    unsigned paths, used;
+    member *first, *last;
+
+    MultiIndex(const MultiIndex& copy);
+    MultiIndex& operator=(const MultiIndex& copy);
+
+    static void set(link_t *link, const key& value);
+    static bool equal(const link_t *link, const key& value);
+    static int compare(const order& key1, const order& key2);
+
+    bool taken(unsigned path, const key& value, member *object) const;
+    void file(unsigned path, member *object);
+    void unfile(unsigned path, member *object);
+
+public:
+    /**
+     * Iterator through an ordered path, used like a linked_pointer.
+     */
+    class iterator
+    {
+    private:
+        ordering::iterator pos;
+
+    public:
+        inline iterator() {}
+
+        inline iterator(const ordering::iterator& from) :
+            pos(from) {}
+
+        inline member *operator->() const {
+            return *pos;
+        }
+
+        inline member *operator*() const {
+            return *pos;
+        }
+
+        inline operator member*() const {
+            return pos ? *pos : NULL;
+        }
+
+        inline void next(void) {
+            pos.next();
+        }
+
+        inline void operator++() {
+            pos.next();
+        }
+
+        inline operator bool() const {
+            return (bool)pos;
+        }
+
+        inline bool operator!() const {
+            return !pos;
+        }
+    };
+
+    /**
+     * Create an index with a number of paths.  All paths are hashed
+     * unless set otherwise before objects are added.
+     * @param count of paths.
+     */
+    MultiIndex(unsigned count);
+
+    /**
+     * Release all objects and destroy the index.
+     */
+    virtual ~MultiIndex();
+
+    /**
+     * Set options for a path.  This may only be done while empty.
+     * @param path to set.
+     * @param options of path, from option_t.
+     * @return false if index is not empty.
+     */
+    bool setPath(unsigned path, unsigned options);
+
+    /**
+     * Add an object to the index under its keys.
+     * @param object to add.
+     * @return false if already indexed or a unique key is taken.
+     */
+    bool add(member *object);
+
+    /**
+     * Refile an object after its keys have changed.  Only paths whose
+     * keys have changed are updated.
+     * @param object to refile.
+     * @return false if not in this index or a unique key is taken, in
+     * which case the object stays filed under its old keys.
+     */
+    bool update(member *object);
+
+    /**
+     * Remove and release an object.
+     * @param object to remove.
+     * @return false if not in this index.
+     */
+    bool remove(member *object);
+
+    /**
+     * Find an object by key.  Where several objects share a key, any
+     * one of them may be found first, and the rest found by passing the
+     * last one found.
+     * @param path to search.
+     * @param value of key to find.
+     * @param after object last found, or NULL to find first.
+     * @return object or NULL if not found.
+     */
+    member *find(unsigned path, const key& value, member *after = NULL) const;
+
+    /**
+     * Get first object of an ordered path.
+     * @param path to scan.
+     * @return iterator at first object.
+     */
+    iterator begin(unsigned path) const;
+
+    /**
+     * Get first object at or after a key in an ordered path.
+     * @param path to scan.
+     * @param value of key to start from.
+     * @return iterator at object.
+     */
+    iterator from(unsigned path, const key& value) const;
+
+    /**
+     * Test if the key an object is filed under in a path is before a
+     * value, to end an ordered scan.
+     * @param object in index.
+     * @param path of key.
+     * @param value to compare with.
+     * @return true if object key is before value.
+     */
+    static bool before(const member *object, unsigned path, const key& value);
+
+    /**
+     * Remove and release all objects.
+     */
+    void clear(void);
+
+    /**
+     * Get first object in the order added.
+     * @return first object or NULL if empty.
+     */
+    inline member *begin(void) const {
+        return first;
+    }
+
+    /**
+     * Get number of objects in index.
+     * @return count of objects.
+     */
+    inline unsigned count(void) const {
+        return used;
+    }
+};
+
+/**
+ * A typed multi-key index.  The object type must be derived from
+ * MultiIndex::member.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+template <class T>
+class multiindex : public MultiIndex
+{
+public:
+    /**
+     * Typed iterator through an ordered path.
+     */
+    class iterator : public MultiIndex::iterator
+    {
+    public:
+        inline iterator() : MultiIndex::iterator() {}
+
+        inline iterator(const MultiIndex::iterator& from) :
+            MultiIndex::iterator(from) {}
+
+        inline T *operator->() const {
+            return static_cast<T*>(MultiIndex::iterator::operator->());
+        }
+
+        inline T *operator*() const {
+            return static_cast<T*>(MultiIndex::iterator::operator*());
+        }
+
+        inline operator T*() const {
+            return static_cast<T*>(MultiIndex::iterator::operator member*());
+        }
+    };
+
+    inline multiindex(unsigned count) : MultiIndex(count) {}
+
+    inline T *find(unsigned path, const key& value, T *after = NULL) const {
+        return static_cast<T*>(MultiIndex::find(path, value, after));
+    }
+
+    inline iterator begin(unsigned path) const {
+        return iterator(MultiIndex::begin(path));
+    }
+
+    inline iterator from(unsigned path, const key& value) const {
+        return iterator(MultiIndex::from(path, value));
+    }
+
+    inline T *begin(void) const {
+        return static_cast<T*>(MultiIndex::begin());
+    }
+
+    inline T *next(T *current) const {
+        return static_cast<T*>(current->getNext());
+    }
+};
+
+} // namespace ucommon
+
+#endif
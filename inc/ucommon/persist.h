@@ -30,6 +30,10 @@
 #include <ucommon/platform.h>
 #endif
 
+#ifndef _UCOMMON_BITMAP_H_
+#include <ucommon/bitmap.h>
+#endif
+
 #include <iostream>
 #include <string>
 #include <vector>
@@ -108,7 +112,7 @@ public:
     friend ucommon::PersistEngine& operator<<( ucommon::PersistEngine& ar, ClassType const &ob);    \
     friend ucommon::PersistObject *createNew##ClassType();                \
     virtual const char* getPersistenceID() const;           \
-    static ucommon::TypeManager::Registration registrationFor##ClassType;
+    static ucommon::TypeManager::registration registrationFor##ClassType;
 
 #define IMPLEMENT_PERSISTENCE(ClassType, FullyQualifiedName)              \
   ucommon::PersistObject *createNew##ClassType() { return new ClassType; }              \
@@ -119,7 +123,7 @@ public:
     { ar >> (ucommon::PersistObject *&) ob; return ar; }                    \
   ucommon::PersistEngine& operator<<(ucommon::PersistEngine& ar, ClassType const &ob)                 \
     { ar << (ucommon::PersistObject const *)&ob; return ar; }               \
-  ucommon::TypeManager::Registration                             \
+  ucommon::TypeManager::registration                             \
     ClassType::registrationFor##ClassType(FullyQualifiedName,         \
                           createNew##ClassType);
 
@@ -183,7 +187,19 @@ public:
  * Stream serialization of persistent classes.
  * This class constructs on a standard C++ STL stream and then
  * operates in the mode specified. The stream passed into the
- * constructor must be a binary mode to function properly.
+ * constructor must be a binary mode to function properly.  Output
+ * is gathered in an internal buffer and passed to the stream when
+ * full, when a top level object has been written, on flush(), and
+ * when the engine is destroyed.  An archive may also be read directly
+ * from memory or from a mapped file without using a stream at all.
+ *
+ * An indexed archive starts with a versioned header and ends with a
+ * trailer holding the class table and the offset and length of every
+ * object record.  Objects are numbered in the order they are first
+ * written, and may be read in any order with load().  References read
+ * through persist_pointer skip the object record and only read the object
+ * when it is first used.  Indexed reading needs a seekable stream, or an
+ * archive in memory or in a file, where the format is detected.
  *
  * @author Daniel Silverstone
  */
@@ -202,11 +218,66 @@ public:
      * Constructs a Persistence::Engine with the specified stream in
      * the given mode. The stream must be initialized properly prior
      * to this call or problems will ensue.
+     * @param stream to use.
+     * @param mode of engine.
+     * @param indexed if archive uses the indexed format.
+     */
+    PersistEngine(std::iostream& stream, EngineMode mode, bool indexed = false) throw(PersistException);
+
+    /**
+     * Constructs a read engine over an archive already held in memory.
+     * The memory must remain valid for the life of the engine.
+     * @param data of archive.
+     * @param size of archive in bytes.
+     */
+    PersistEngine(const uint8_t *data, size_t size) throw(PersistException);
+
+    /**
+     * Constructs a read engine over an archive file.  The file is
+     * mapped into memory where supported, and read in whole otherwise.
+     * @param path of archive file.
      */
-    PersistEngine(std::iostream& stream, EngineMode mode) throw(PersistException);
+    PersistEngine(const char *path) throw(PersistException);
 
     virtual ~PersistEngine();
 
+    /**
+     * Pass any buffered output to the underlying stream.
+     */
+    void flush(void) throw(PersistException);
+
+    /**
+     * Get an object by number, reading it from an indexed archive if it
+     * has not already been read.  Objects read this way belong to the
+     * caller.  Other archives can only return objects already read.
+     * @param id of object, in the order objects were written.
+     * @return object, or NULL for an object not yet read.
+     */
+    PersistObject *load(uint32_t id) throw(PersistException);
+
+    /**
+     * Read an object reference without reading the object.  In an
+     * indexed archive the object record is skipped over, and can be
+     * read later with load().
+     * @param id of object referenced.
+     * @return false if a null reference.
+     */
+    bool readReference(uint32_t& id) throw(PersistException);
+
+    /**
+     * Number of objects known to the engine.  For an indexed archive
+     * being read this is the number of objects in the archive.
+     * @return object count.
+     */
+    size_t objects(void) const;
+
+    /**
+     * Test if reading an indexed archive.
+     * @return true if indexed.
+     */
+    inline bool is_indexed(void) const
+        {return myIndexed;}
+
     // Write operations
 
     /**
@@ -229,6 +300,8 @@ public:
     inline void write(uint16_t i) throw(PersistException) { CCXX_ENGINEWRITE_REF(i); }
     inline void write(int32_t i)  throw(PersistException) { CCXX_ENGINEWRITE_REF(i); }
     inline void write(uint32_t i) throw(PersistException) { CCXX_ENGINEWRITE_REF(i); }
+    inline void write(int64_t i)  throw(PersistException) { CCXX_ENGINEWRITE_REF(i); }
+    inline void write(uint64_t i) throw(PersistException) { CCXX_ENGINEWRITE_REF(i); }
     inline void write(float i)  throw(PersistException) { CCXX_ENGINEWRITE_REF(i); }
     inline void write(double i) throw(PersistException) { CCXX_ENGINEWRITE_REF(i); }
     inline void write(bool i) throw(PersistException) { CCXX_ENGINEWRITE_REF(i); }
@@ -239,6 +312,16 @@ public:
     // Every write operation boils down to one or more of these
     void writeBinary(const uint8_t* data, const uint32_t size) throw(PersistException);
 
+    /**
+     * Writes an array of a primitive type as a single block.  This
+     * has the same archive layout as writing each element in turn.
+     * @param array of values.
+     * @param count of elements in array.
+     */
+    template<typename T>
+    inline void writeArray(const T *array, uint32_t count) throw(PersistException)
+        {writeBlock((const uint8_t *)array, (uint64_t)count * sizeof(T));}
+
     // Read Operations
 
     /**
@@ -260,6 +343,8 @@ public:
     inline void read(uint16_t& i) throw(PersistException) { CCXX_ENGINEREAD_REF(i); }
     inline void read(int32_t& i) throw(PersistException) { CCXX_ENGINEREAD_REF(i); }
     inline void read(uint32_t& i) throw(PersistException) { CCXX_ENGINEREAD_REF(i); }
+    inline void read(int64_t& i) throw(PersistException) { CCXX_ENGINEREAD_REF(i); }
+    inline void read(uint64_t& i) throw(PersistException) { CCXX_ENGINEREAD_REF(i); }
     inline void read(float& i)  throw(PersistException) { CCXX_ENGINEREAD_REF(i); }
     inline void read(double& i) throw(PersistException) { CCXX_ENGINEREAD_REF(i); }
     inline void read(bool &i) throw(PersistException) { CCXX_ENGINEREAD_REF(i); }
@@ -270,6 +355,45 @@ public:
     // Every read operation boiled down to one or more of these
     void readBinary(uint8_t* data, uint32_t size) throw(PersistException);
 
+    /**
+     * Reads an array of a primitive type as a single block.
+     * @param array to fill.
+     * @param count of elements to read.
+     */
+    template<typename T>
+    inline void readArray(T *array, uint32_t count) throw(PersistException)
+        {readBlock((uint8_t *)array, (uint64_t)count * sizeof(T));}
+
+    /**
+     * Reads a vector of a primitive type written as a count and a block.
+     * A count larger than what is left in the archive is an error, and
+     * is found before the vector is sized.  Where a stream cannot tell
+     * what is left, the vector is grown as it is read.
+     * @param vector to fill.
+     * @param count of elements to read.
+     */
+    template<typename T>
+    void readVector(std::vector<T>& vector, uint32_t count) throw(PersistException) {
+        uint64_t left = remaining();
+        if(count > left / sizeof(T))
+            throw(PersistException("Array exceeds archive"));
+        uint32_t block = count;
+        if(left == (uint64_t)(-1))
+            block = (uint32_t)(65536 / sizeof(T));
+        vector.clear();
+        for(uint32_t pos = 0; pos < count; pos += block) {
+            uint32_t part = (count - pos < block) ? count - pos : block;
+            vector.resize(pos + part);
+            readArray(&vector[pos], part);
+        }
+    }
+
+    /**
+     * Number of bytes left to read.
+     * @return bytes left, or the largest value if a stream cannot tell.
+     */
+    uint64_t remaining(void) throw(PersistException);
+
 private:
     /**
      * reads the actual object data into a pre-instantiated object pointer
@@ -284,9 +408,73 @@ private:
 
 
     /**
-     * The underlying stream
+     * Resolve an object reference, reading the object if needed.
+     */
+    PersistObject *resolve(uint32_t id, PersistObject *object) throw(PersistException);
+
+    /**
+     * Read an object from an indexed archive, seeking to its record
+     * if it is not at the current position.
+     */
+    PersistObject *fetch(uint32_t id, PersistObject *object) throw(PersistException);
+
+    /**
+     * Read the indexed object record at the current position.
+     */
+    PersistObject *readRecord(uint32_t id, PersistObject *object) throw(PersistException);
+
+    /**
+     * Read the header and trailer of an indexed archive.
+     */
+    void readIndex(void) throw(PersistException);
+
+    /**
+     * Write the trailer of an indexed archive.
+     */
+    void writeIndex(void) throw(PersistException);
+
+    /**
+     * Position within the archive.
+     */
+    uint64_t tell(void) throw(PersistException);
+    void seek(uint64_t offset) throw(PersistException);
+
+    /**
+     * Write buffered output to the stream.
+     */
+    void flushBuffer(void) throw(PersistException);
+    void readBlock(uint8_t *data, uint64_t size) throw(PersistException);
+    void writeBlock(const uint8_t *data, uint64_t size) throw(PersistException);
+
+    /**
+     * The underlying stream, or NULL for a memory archive
+     */
+    std::iostream *myUnderlyingStream;
+
+    /**
+     * Memory archive being read and the current read position
+     */
+    const uint8_t *myData;
+    size_t mySize, myPosition;
+    bool myMapped;
+
+    /**
+     * Write combining buffer and how much of it is used
+     */
+    uint8_t *myBuffer;
+    uint32_t myBuffered;
+
+    /**
+     * Depth of nested object writes
+     */
+    unsigned myDepth;
+
+    /**
+     * Indexed archive state; stream offset of the archive, and bytes
+     * written so far
      */
-    std::iostream& myUnderlyingStream;
+    bool myIndexed;
+    uint64_t myBase, myWritten;
 
     /**
      * The mode of the engine. read or write
@@ -305,6 +493,82 @@ private:
     ArchiveMap myArchiveMap;
     ClassVector myClassVector;
     ClassMap myClassMap;
+
+    /**
+     * Index of object records in an indexed archive
+     */
+    typedef struct {
+        uint64_t offset;
+        uint64_t length;
+        uint32_t type;
+    } IndexEntry;
+    typedef std::vector<IndexEntry> IndexVector;
+
+    IndexVector myIndex;
+};
+
+/**
+ * A pointer to a persistent object that is read when first used.  When
+ * read from an indexed archive only the object number is kept, and the
+ * object is loaded from the engine the first time it is used, so the
+ * engine must remain valid until then.  Objects are owned by the caller,
+ * as with plain object pointers.
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+template<class T>
+class persist_pointer
+{
+private:
+    PersistEngine *engine;
+    uint32_t id;
+    mutable T *object;
+
+public:
+    inline persist_pointer()
+        {engine = NULL; id = 0; object = NULL;}
+
+    inline persist_pointer(T *pointer)
+        {engine = NULL; id = 0; object = pointer;}
+
+    inline persist_pointer& operator=(T *pointer)
+        {engine = NULL; object = pointer; return *this;}
+
+    /**
+     * Get the object, loading it if not yet read.
+     * @return object or NULL.
+     */
+    inline T *get(void) const {
+        if(!object && engine)
+            object = static_cast<T *>(engine->load(id));
+        return object;
+    }
+
+    /**
+     * Test if the object has been read.
+     * @return true if loaded or null.
+     */
+    inline bool is_loaded(void) const
+        {return object != NULL || engine == NULL;}
+
+    inline T* operator->() const
+        {return get();}
+
+    inline T& operator*() const
+        {return *get();}
+
+    inline operator T*() const
+        {return get();}
+
+    inline bool operator!() const
+        {return !object && !engine;}
+
+    inline void read(PersistEngine& ar) throw(PersistException) {
+        object = NULL;
+        engine = ar.readReference(id) ? &ar : NULL;
+    }
+
+    inline void write(PersistEngine& ar) const throw(PersistException)
+        {ar.write(static_cast<const PersistObject *>(get()));}
 };
 
 #define CCXX_RE(ar,ob)   ar.read(ob); return ar
@@ -350,6 +614,16 @@ inline PersistEngine& operator >>( PersistEngine& ar, uint32_t& ob) throw(Persis
 /** @relates PersistEngine */
 inline PersistEngine& operator <<( PersistEngine& ar, uint32_t ob)  throw(PersistException) {CCXX_WE(ar,ob);}
 
+/** @relates PersistEngine */
+inline PersistEngine& operator >>( PersistEngine& ar, int64_t& ob) throw(PersistException) {CCXX_RE(ar,ob);}
+/** @relates PersistEngine */
+inline PersistEngine& operator <<( PersistEngine& ar, int64_t ob)  throw(PersistException) {CCXX_WE(ar,ob);}
+
+/** @relates PersistEngine */
+inline PersistEngine& operator >>( PersistEngine& ar, uint64_t& ob) throw(PersistException) {CCXX_RE(ar,ob);}
+/** @relates PersistEngine */
+inline PersistEngine& operator <<( PersistEngine& ar, uint64_t ob)  throw(PersistException) {CCXX_WE(ar,ob);}
+
 /** @relates PersistEngine */
 inline PersistEngine& operator >>( PersistEngine& ar, float& ob) throw(PersistException) {CCXX_RE(ar,ob);}
 /** @relates PersistEngine */
@@ -408,6 +682,81 @@ PersistEngine& operator >>( PersistEngine& ar, typename std::vector<T>& ob) thro
     return ar;
 }
 
+/*
+ * Vectors of primitive types are contiguous, and have the same layout
+ * in the archive whether written element by element or as one block.
+ */
+#define CCXX_BULK_VECTOR(T) \
+inline PersistEngine& operator <<( PersistEngine& ar, std::vector<T> const& ob) throw(PersistException) \
+{ \
+    ar << (uint32_t)ob.size(); \
+    if(ob.size()) \
+        ar.writeArray(&ob[0], (uint32_t)ob.size()); \
+    return ar; \
+} \
+inline PersistEngine& operator >>( PersistEngine& ar, std::vector<T>& ob) throw(PersistException) \
+{ \
+    uint32_t siz; \
+    ar >> siz; \
+    ar.readVector(ob, siz); \
+    return ar; \
+}
+
+CCXX_BULK_VECTOR(int8_t)
+CCXX_BULK_VECTOR(uint8_t)
+CCXX_BULK_VECTOR(int16_t)
+CCXX_BULK_VECTOR(uint16_t)
+CCXX_BULK_VECTOR(int32_t)
+CCXX_BULK_VECTOR(uint32_t)
+CCXX_BULK_VECTOR(int64_t)
+CCXX_BULK_VECTOR(uint64_t)
+CCXX_BULK_VECTOR(float)
+CCXX_BULK_VECTOR(double)
+
+#undef CCXX_BULK_VECTOR
+
+/**
+ * @relates persist_pointer
+ * serialize a reference to an object.
+ */
+template<class T>
+PersistEngine& operator <<( PersistEngine& ar, persist_pointer<T> const& ob) throw(PersistException)
+{
+    ob.write(ar);
+    return ar;
+}
+
+/**
+ * @relates persist_pointer
+ * deserialize a reference to an object, which is read when first used.
+ */
+template<class T>
+PersistEngine& operator >>( PersistEngine& ar, persist_pointer<T>& ob) throw(PersistException)
+{
+    ob.read(ar);
+    return ar;
+}
+
+/**
+ * @relates sparse_bitmap
+ * serialize a compressed bitmap to the engine.
+ */
+inline PersistEngine& operator <<( PersistEngine& ar, sparse_bitmap const& ob) throw(PersistException)
+{
+    ob.write(ar);
+    return ar;
+}
+
+/**
+ * @relates sparse_bitmap
+ * deserialize a compressed bitmap from the engine.
+ */
+inline PersistEngine& operator >>( PersistEngine& ar, sparse_bitmap& ob) throw(PersistException)
+{
+    ob.read(ar);
+    return ar;
+}
+
 /**
  * @relates PersistEngine
  * serialize a deque of some serializable content to
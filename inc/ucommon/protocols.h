@@ -294,6 +294,13 @@ class __EXPORT BufferProtocol : public CharacterProtocol
 public:
     typedef enum {RDONLY, WRONLY, RDWR} mode_t;
 
+    /**
+     * Reply framing function for pipelined protocols.  It is given the
+     * input waiting in the buffer and returns the size of the first
+     * complete reply found, or 0 if more input is needed.
+     */
+    typedef size_t (*framing_t)(const char *data, size_t size, void *user);
+
 private:
     char *buffer;
     char *input, *output;
@@ -384,6 +391,13 @@ protected:
      */
     virtual void _clear(void) = 0;
 
+    /**
+     * Method to set an error found above the low level i/o, such as a
+     * reply too large for the buffer.  By default it is not kept.
+     * @param error to set.
+     */
+    virtual void _seterr(int error);
+
     /**
      * Return true if blocking.
      */
@@ -439,6 +453,74 @@ public:
      */
     size_t get(void *address, size_t count);
 
+    /**
+     * Access input waiting in the buffer without copying or consuming it.
+     * If the buffer is empty it is first refilled from physical I/O.  This
+     * is used with consume() to parse input in place.
+     * @param count of characters available, set to 0 at end of input.
+     * @return pointer to waiting input or NULL if none.
+     */
+    const char *buffered(size_t& count);
+
+    /**
+     * Consume input that was examined in place through buffered().
+     * @param count of characters to consume.
+     */
+    void consume(size_t count);
+
+    /**
+     * Get the next line of input in place, without copying it.  The input
+     * buffer is filled with as much as one read returns and searched for a
+     * newline, so many short lines are taken from a single read.  The
+     * newline, and a carriage return before it, are not part of the line.
+     * A line longer than the buffer is returned in buffer sized parts.  The
+     * line remains valid until the next input operation.
+     * @param size of line returned.
+     * @return pointer to line or NULL if at end of data.
+     */
+    const char *nextline(size_t& size);
+
+    /**
+     * Get text as a line of input from the buffer.  This searches the
+     * buffer for the end of line rather than reading a character at a
+     * time when the eol is a newline or carriage return and newline.
+     * @param string to save input into.
+     * @param size limit of string to save.
+     * @return count of characters actually read or 0 if at end of data.
+     */
+    size_t getline(char *string, size_t size);
+
+    /**
+     * Get a string as a line of input from the buffer.
+     * @param buffer to save input into.
+     * @return count of characters actually read or 0 if at end of data.
+     */
+    size_t getline(String& buffer);
+
+    /**
+     * Get the next reply to a pipelined request in place, without copying
+     * it.  Many requests may be queued with put() or putline() and sent
+     * together, and their replies then taken in order.  Output that is
+     * still queued is flushed before waiting for input.  A reply must fit
+     * in the buffer, and remains valid until the next input operation.
+     * A reply larger than the buffer fails with the EMSGSIZE error.
+     * @param size of reply returned.
+     * @param framing function that finds the end of a reply.
+     * @param user data passed to the framing function.
+     * @return pointer to reply or NULL if at end of data or error.
+     */
+    const char *nextreply(size_t& size, framing_t framing, void *user = NULL);
+
+    /**
+     * Framing function for replies that are a single line of text.  The
+     * reply includes the newline.
+     * @param data waiting in the buffer.
+     * @param size of data waiting.
+     * @param user data, not used.
+     * @return size of line or 0 if not complete.
+     */
+    static size_t lineframe(const char *data, size_t size, void *user);
+
     /**
      * Print formatted string to the buffer.  The maximum output size is
      * the buffer size, and the operation flushes the buffer.
@@ -74,6 +74,52 @@ protected:
      */
     error_t error;
 
+    /**
+     * Handshakes that resumed a session, and that did not.
+     */
+    atomic::counter resumed, negotiated;
+
+    /**
+     * Serialized sessions kept by a context for resumption, by peer for
+     * clients and by session id for servers.  Entries expire after the
+     * timeout, and the least recently used is replaced when full.
+     */
+    class __LOCAL sessions
+    {
+    private:
+        struct entry;
+
+        entry *list;
+        unsigned count, limit;
+        time_t timeout;
+        Mutex lock;
+
+    public:
+        sessions();
+        ~sessions();
+
+        void setup(size_t size, time_t expires);
+
+        void put(const void *key, size_t keysize, const void *data, size_t size);
+
+        /**
+         * Get a copy of a session.
+         * @param key of session.
+         * @param keysize of key.
+         * @param size of session data returned.
+         * @return session data to free, or NULL if not found.
+         */
+        void *get(const void *key, size_t keysize, size_t& size);
+
+        void remove(const void *key, size_t keysize);
+
+        inline unsigned size(void) const
+            {return limit;}
+
+        inline time_t expires(void) const
+            {return timeout;}
+    };
+
     inline secure() {error = OK;}
 
 public:
@@ -173,6 +219,54 @@ public:
      */
     static void cipher(secure *context, const char *ciphers);
 
+    /**
+     * Set session resumption for a context.  Client contexts keep the
+     * last session to each host and service for reuse on the next
+     * connection.  Server contexts keep a session cache shared by all
+     * connections, and issue session tickets with keys rotated at the
+     * session timeout.  Contexts are created with a cache of 1024
+     * sessions and a 300 second timeout.
+     * @param context to set cache for.
+     * @param size of cache, 0 to disable resumption.
+     * @param timeout of sessions in seconds.
+     */
+    static void cache(secure *context, size_t size, time_t timeout = 300);
+
+    /**
+     * Offload record encryption of a context's connections to the kernel.
+     * This is used when both the kernel and the tls library support it,
+     * and sessions otherwise continue to encrypt in userspace.  GnuTLS
+     * takes kernel tls from the system crypto policy rather than per
+     * context, so it is unsupported there.
+     * @param context to offload.
+     * @param enable kernel tls if true.
+     * @return false if the tls library cannot offload a context.
+     */
+    static bool offload(secure *context, bool enable = true);
+
+    /**
+     * Disable Nagle on the sockets of a context's connections.  A short
+     * resumed handshake otherwise can wait on delayed acks.  Contexts are
+     * created with this off, leaving the socket options alone.
+     * @param context to set.
+     * @param enable tcp nodelay if true.
+     */
+    static void nodelay(secure *context, bool enable = true);
+
+    /**
+     * Number of handshakes that resumed an existing session.
+     * @return resumed handshake count.
+     */
+    inline unsigned long hits(void) const
+        {return (unsigned long)resumed.get();}
+
+    /**
+     * Number of handshakes that negotiated a new session.
+     * @return full handshake count.
+     */
+    inline unsigned long misses(void) const
+        {return (unsigned long)negotiated.get();}
+
     /**
      * Determine if the current security context is valid.
      * @return true if valid, -1 if not.
@@ -216,11 +310,40 @@ public:
  */
 class __SHARED SSLBuffer : public TCPBuffer
 {
+public:
+    /**
+     * State of a non-blocking connection.  When a handshake or i/o
+     * operation cannot complete, it reports if the socket must become
+     * readable or writable before the operation is tried again.
+     */
+    typedef enum {READY = 0, WANT_READ, WANT_WRITE, CLOSED, FAILED} state_t;
+
 protected:
     secure::session_t ssl;
     secure::bufio_t bio;
     bool server;
     bool verify;
+    bool async;
+    char *peer;
+
+    size_t copyfile(fsys& file, fsys::offset_t offset, size_t size);
+
+    /**
+     * Wait for the socket to be ready for a state reported by a handshake
+     * or i/o operation.  Buffered reads and writes on a non-blocking
+     * session wait here, so a would-block is retried rather than taken
+     * as a disconnect.
+     * @param state to wait for.
+     * @return true if ready, false if failed, closed, or timed out.
+     */
+    inline bool waitfor(state_t state) {
+        timeout_t timeout = iowait ? iowait : Timer::inf;
+        if(state == WANT_READ)
+            return Socket::wait(so, timeout);
+        if(state == WANT_WRITE)
+            return waitSending(timeout);
+        return false;
+    }
 
 public:
     SSLBuffer(secure::client_t context);
@@ -236,6 +359,76 @@ public:
      */
     void open(const char *host, const char *service, size_t size = 536);
 
+    /**
+     * Connect a non-blocking ssl client session.  The tcp connection is
+     * made first, and then the socket is made non-blocking and the
+     * handshake is started.  The handshake is completed by calling
+     * handshake(), recv(), or send() as the socket becomes ready.
+     * @param host we are connecting to.
+     * @param service to connect to.
+     * @param size of buffer and tcp fragments.
+     * @return state of handshake.
+     */
+    state_t connect(const char *host, const char *service, size_t size = 536);
+
+    /**
+     * Accept a non-blocking ssl server session from a listener.  The
+     * buffer is made with SSLBuffer(context) from a server context, not
+     * with the accepting constructor, and may be re-used for another
+     * client once closed.
+     * @param server to accept from.
+     * @param size of buffer and tcp fragments.
+     * @return state of handshake.
+     */
+    state_t accept(const TCPServer *server, size_t size = 536);
+
+    /**
+     * Continue a non-blocking handshake.
+     * @return READY when secured, or the socket state to wait for.
+     */
+    state_t handshake(void);
+
+    /**
+     * Receive data from a non-blocking session.  An unfinished handshake
+     * is continued first.  Data may already be decoded and held in the
+     * session, so recv should be called until it wants to read.
+     * @param data to receive into.
+     * @param size of data buffer.
+     * @param count of bytes received.
+     * @return READY if data was received, or state to wait for.
+     */
+    state_t recv(char *data, size_t size, size_t& count);
+
+    /**
+     * Send data on a non-blocking session.  An unfinished handshake is
+     * continued first.  Partial sends are reported in count, and after
+     * WANT_WRITE the same data must be offered again.
+     * @param data to send.
+     * @param size of data to send.
+     * @param count of bytes sent.
+     * @return READY if data was sent, or state to wait for.
+     */
+    state_t send(const char *data, size_t size, size_t& count);
+
+    /**
+     * Send part of a file over a blocking connection.  Pending buffered
+     * output is flushed first.  When the kernel performs tls record
+     * encryption, or for plain tcp, the file is sent from the kernel
+     * without copying it through userspace.  Otherwise it is read and
+     * sent in record sized blocks.
+     * @param file to send from.
+     * @param offset in file to start from.
+     * @param size of data to send.
+     * @return number of bytes sent.
+     */
+    size_t sendfile(fsys& file, fsys::offset_t offset, size_t size);
+
+    /**
+     * Check if record encryption is offloaded to the kernel.
+     * @return true if kernel tls is used for sending.
+     */
+    bool is_offloaded(void) const;
+
     void close(void);
 
     void release(void);
@@ -250,6 +443,16 @@ public:
 
     inline bool is_secure(void) const
         {return bio != NULL;}
+
+    inline bool is_async(void) const
+        {return async;}
+
+    /**
+     * Get the socket to wait on in an event loop.
+     * @return socket of connection.
+     */
+    inline socket_t handle(void) const
+        {return so;}
 };
 
 /**
@@ -794,6 +997,7 @@ protected:
     secure::bufio_t bio;
     bool server;
     bool verify;
+    char *peer;
 
 private:
     // kill copy constructor
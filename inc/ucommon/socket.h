@@ -1170,7 +1170,8 @@ public:
      * Read a newline of text data from the socket and save in NULL terminated
      * string.  This uses an optimized I/O method that takes advantage of
      * socket peeking.  As such, it has to be rewritten to be used in a ssl
-     * layer socket.
+     * layer socket.  Since nothing past the line may be consumed, each
+     * read is peeked first.  A TCPBuffer reads many lines at once instead.
      * @param socket to read from.
      * @param data to save input line.
      * @param size of input line buffer.
@@ -1392,6 +1392,16 @@ public:
      */
     static uint16_t crc16(uint8_t *binary, size_t size);
 
+    /**
+     * Castagnoli 32 bit crc (crc32c) for binary data.  This uses the
+     * sse4.2 crc instruction when the processor supports it.
+     * @param binary data to sum.
+     * @param size of binary data to sum.
+     * @param crc of prior data to continue from.
+     * @return 32 bit crc.
+     */
+    static uint32_t crc32c(const uint8_t *binary, size_t size, uint32_t crc = 0);
+
     /**
      * Convert binary data buffer into hex string.
      * @param binary data to convert.
@@ -232,6 +232,14 @@ public:
      * @param timeout to convert.
      */
     static void set(struct timespec *hires, timeout_t timeout);
+
+    /**
+     * Select the clock source timed waits compute their deadline from.
+     * A clock that lags the system clock makes waits end early by as much.
+     * @param source to use for timed waits.
+     * @return source actually used.
+     */
+    static Timer::clocking_t clocking(Timer::clocking_t source);
 };
 
 /**
@@ -45,10 +45,24 @@ namespace ucommon {
  * Timer class to use when scheduling realtime events.  The timer generally
  * uses millisecond values but has a microsecond accuracy.  On platforms that
  * support it, the timer uses posix realtime monotonic clock extensions,
- * otherwise lower accuracy timer systems might be used.
+ * otherwise lower accuracy timer systems might be used.  Timers may also be
+ * read from a cheaper clock source, such as the coarse system clock, a
+ * calibrated cpu cycle counter, or a loop time an event loop refreshes once
+ * for each pass.
  */
 class __EXPORT Timer
 {
+public:
+    /**
+     * Clock sources timers and timed waits may read the time from.
+     */
+    typedef enum {
+        PRECISE = 0,    /**< system clock, read on each use */
+        COARSE,         /**< coarse system clock, updated each kernel tick */
+        CYCLES,         /**< calibrated invariant cpu cycle counter */
+        CACHED          /**< loop time last stored by refresh() */
+    } clocking_t;
+
 private:
     friend class Conditional;
     friend class Semaphore;
@@ -62,6 +76,9 @@ private:
 #endif
     bool updated;
 
+    static void current(struct timespec *ts, clocking_t source);
+    static clocking_t prepare(clocking_t source);
+
 protected:
     /**
      * Check if timer has been updated since last check.
@@ -256,6 +273,28 @@ public:
      * @return timer ticks in 100ns resolution.
      */
     static tick_t ticks(void);
+
+    /**
+     * Select the clock source timers and timer queues are read from.  A
+     * source this platform lacks falls back to the nearest one it has.
+     * The coarse clock may lag by a kernel tick, and the cached clock by
+     * however long since it was last refreshed.
+     * @param source to use for timers.
+     * @return source actually used.
+     */
+    static clocking_t clocking(clocking_t source);
+
+    /**
+     * Get the clock source timers are read from.
+     * @return source used for timers.
+     */
+    static clocking_t clocking(void);
+
+    /**
+     * Store the current time as the loop time read by the cached clock.
+     * An event loop would call this once at the top of each pass.
+     */
+    static void refresh(void);
 };
 
 /**
@@ -93,6 +93,7 @@
 #include <ucommon/counter.h>
 #include <ucommon/numbers.h>
 #include <ucommon/vector.h>
+#include <ucommon/ordered.h>
 #include <ucommon/linked.h>
 #include <ucommon/timers.h>
 #include <ucommon/access.h>
@@ -110,6 +111,7 @@
 #include <ucommon/buffer.h>
 #include <ucommon/shell.h>
 #include <ucommon/xml.h>
+#include <ucommon/ioring.h>
 
 #ifndef  UCOMMON_SYSRUNTIME
 #include <ucommon/stream.h>
@@ -49,12 +49,13 @@ class __EXPORT XMLParser
 {
 private:
     int ecount, dcount;
+    bool paused, stepping;
     enum {TAG, CDATA, COMMENT, DTD, AMP, NONE, END} state;
     char *buffer;
     unsigned bufpos, bufsize;
     __LOCAL bool parseTag(void);
-    __LOCAL void putBuffer(char c);
-    __LOCAL void clearBuffer(void);
+    __LOCAL void putComment(const char *text, size_t size);
+    __LOCAL const char *scan(const char *data, const char *end, bool document);
 
 protected:
     /**
@@ -77,6 +78,9 @@ protected:
 
     /**
      * Virtual to receive character text extracted from the document.
+     * Text is passed in place from the block being parsed where possible,
+     * so it is only valid for the duration of the call, and a run of text
+     * may be delivered over several calls.
      * @param text received.
      * @param size of text received.
      */
@@ -110,12 +114,37 @@ protected:
      * used to externally drive data into the XML parser.  The return
      * status can be used to determine when a document has been fully
      * parsed.  This can be called multiple times to push stream data
-     * into the parser.
+     * into the parser.  Parser state carries over between calls, so each
+     * chunk is only scanned once no matter where it splits the document.
      * @param address of data to parse.
      * @param size of data to parse.
      */
     bool partial(const char *address, size_t size);
 
+    /**
+     * Parse part of a chunk of data, stopping early if a callback asks to
+     * pause.  This is used to drive the parser one event at a time, as
+     * text and element names passed to the last callback remain valid
+     * until the parser is resumed with the rest of the data.
+     * @param address of data to parse.
+     * @param size of data to parse.
+     * @param used set to number of bytes consumed.
+     * @return false if invalid.
+     */
+    bool partial(const char *address, size_t size, size_t& used);
+
+    /**
+     * Reset parser to begin a new document, discarding any partial one.
+     */
+    void reset(void);
+
+    /**
+     * Pause a partial parse after the current callback returns.  This only
+     * has effect for partial() with a used count.
+     */
+    inline void pause(void)
+        {paused = stepping;}
+
     /**
      * Parse a stream buffer and return parser document completion flag.
      * This is used to scan a stream buffer for a complete XML document.
@@ -138,6 +167,23 @@ protected:
      */
     bool parse(FILE *file);
 
+    /**
+     * Parse a buffered stream and return parser document completion flag.
+     * The waiting input buffer is scanned in place, and only the data
+     * that is part of the document is consumed from the stream.
+     * @param stream buffer to parse.
+     * @return true if parse complete, false if invalid or EOF.
+     */
+    bool parse(BufferProtocol& stream);
+
+    /**
+     * Parse an xml document file.  Where supported the file is mapped
+     * into memory and parsed in place rather than read through a buffer.
+     * @param path of file to parse.
+     * @return true if parse complete, false if invalid or missing.
+     */
+    bool load(const char *path);
+
     /**
      * End of document check.
      * @return true if end of document.
@@ -147,6 +193,153 @@ protected:
     }
 };
 
+/**
+ * XML pull parser.  This reads a document one event at a time from a
+ * file or memory, using the XMLParser tokenizer, rather than requiring
+ * a derived class to receive callbacks.  Input is read through a fixed
+ * size block, so very large documents are processed in constant memory,
+ * and subtrees which are of no interest can be skipped without their
+ * text ever being collected.  Element names, attributes, and text are
+ * only valid until the next event is read.
+ *
+ * @author David Sugar <dyfet@gnutelephony.org>
+ */
+class __EXPORT XMLReader : protected XMLParser
+{
+public:
+    /**
+     * Events returned from reading the document.
+     */
+    typedef enum {START, END, TEXT, DONE, FAILED} event_t;
+
+private:
+    FILE *fp;
+    bool owned, pending, failed;
+    char *block;
+    size_t blocksize;
+    const char *input;
+    size_t available;
+    event_t event;
+    const char *ename;
+    const char *etext;
+    size_t esize;
+    unsigned level, skipping;
+    caddr_t attrs[130];
+
+    __LOCAL bool fill(void);
+    __LOCAL void clear(void);
+
+protected:
+    void startElement(caddr_t name, caddr_t *attr);
+    void endElement(caddr_t name);
+    void characters(caddr_t text, size_t size);
+
+public:
+    /**
+     * Create xml pull parser.
+     * @param size of input block to read documents through.
+     * @param tagsize of largest tag supported.
+     */
+    XMLReader(size_t size = 65536, unsigned tagsize = 8192);
+
+    /**
+     * Destroy pull parser and close any open document.
+     */
+    virtual ~XMLReader();
+
+    /**
+     * Open an xml document file to read.
+     * @param path of file to open.
+     * @return true if opened.
+     */
+    bool open(const char *path);
+
+    /**
+     * Read an xml document from an already open file.  The file is not
+     * closed by the reader.
+     * @param file to read from.
+     */
+    void open(FILE *file);
+
+    /**
+     * Read an xml document held in memory.  The memory is parsed in place
+     * and must remain valid while the document is read.
+     * @param address of document.
+     * @param size of document.
+     */
+    void open(const char *address, size_t size);
+
+    /**
+     * Close the document being read.
+     */
+    void close(void);
+
+    /**
+     * Read the next event from the document.  Text may be delivered in
+     * several successive text events.
+     * @return event read.
+     */
+    event_t next(void);
+
+    /**
+     * Skip the remainder of the current element.  If the last event was
+     * the start of an element, everything up to and including its end is
+     * passed over without being reported.
+     * @return false if the document is invalid or incomplete.
+     */
+    bool skip(void);
+
+    /**
+     * Get value of an attribute of the current element by name.
+     * @param id of attribute to find.
+     * @return attribute value or NULL if not present.
+     */
+    const char *attribute(const char *id) const;
+
+    /**
+     * Get the list of attributes of the current element.  This is a
+     * NULL terminated list of name and value pairs.
+     * @return attribute list.
+     */
+    inline caddr_t *attributes(void) const
+        {return (caddr_t *)attrs;}
+
+    /**
+     * Get name of the element for the current start or end event.
+     * @return element name.
+     */
+    inline const char *name(void) const
+        {return ename;}
+
+    /**
+     * Get text of the current text event.  This is not NULL terminated.
+     * @return text of event.
+     */
+    inline const char *text(void) const
+        {return etext;}
+
+    /**
+     * Get size of text of the current text event.
+     * @return size of text.
+     */
+    inline size_t size(void) const
+        {return esize;}
+
+    /**
+     * Get nesting depth of current element, 1 for the document root.
+     * @return element depth.
+     */
+    inline unsigned depth(void) const
+        {return level;}
+
+    /**
+     * Get the last event read.
+     * @return last event.
+     */
+    inline event_t operator*() const
+        {return event;}
+};
+
 } // namespace ucommon
 
 #endif
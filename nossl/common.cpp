@@ -18,6 +18,10 @@
 
 #include "local.h"
 
+#ifdef  HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
 namespace ucommon {
 
 Digest::Digest()
@@ -260,6 +264,190 @@ String secure::uuid(void)
     return String(buf);
 }
 
+struct secure::sessions::entry
+{
+    uint32_t hash;
+    time_t created, used;
+    size_t keysize, size;
+    uint8_t *data;          // key followed by session data
+};
+
+static uint32_t session_hash(const void *key, size_t keysize)
+{
+    const uint8_t *kp = (const uint8_t *)key;
+    uint32_t hash = 2166136261u;
+
+    while(keysize--) {
+        hash ^= *(kp++);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+secure::sessions::sessions()
+{
+    list = NULL;
+    count = limit = 0;
+    timeout = 0;
+}
+
+secure::sessions::~sessions()
+{
+    setup(0, 0);
+}
+
+void secure::sessions::setup(size_t size, time_t expires)
+{
+    lock.acquire();
+    while(count)
+        ::free(list[--count].data);
+    if(list)
+        delete[] list;
+
+    list = NULL;
+    limit = (unsigned)size;
+    timeout = expires;
+    if(limit)
+        list = new entry[limit];
+    lock.release();
+}
+
+void secure::sessions::put(const void *key, size_t keysize, const void *data, size_t size)
+{
+    uint32_t hash = session_hash(key, keysize);
+    time_t now;
+    unsigned pos, oldest = 0;
+
+    time(&now);
+    lock.acquire();
+    if(!limit) {
+        lock.release();
+        return;
+    }
+
+    for(pos = 0; pos < count; ++pos) {
+        entry *node = &list[pos];
+        if(node->hash == hash && node->keysize == keysize && !memcmp(node->data, key, keysize))
+            break;
+        if(node->used < list[oldest].used)
+            oldest = pos;
+    }
+
+    // replace the existing entry, a free one, or the least recently used
+    if(pos == count && count < limit)
+        ++count;
+    else if(pos == count)
+        pos = oldest;
+    else
+        ::free(list[pos].data);
+
+    entry *node = &list[pos];
+    node->hash = hash;
+    node->created = node->used = now;
+    node->keysize = keysize;
+    node->size = size;
+    node->data = (uint8_t *)::malloc(keysize + size);
+    memcpy(node->data, key, keysize);
+    memcpy(node->data + keysize, data, size);
+    lock.release();
+}
+
+void *secure::sessions::get(const void *key, size_t keysize, size_t& size)
+{
+    uint32_t hash = session_hash(key, keysize);
+    void *data = NULL;
+    time_t now;
+
+    size = 0;
+    time(&now);
+    lock.acquire();
+    for(unsigned pos = 0; pos < count; ++pos) {
+        entry *node = &list[pos];
+        if(node->hash != hash || node->keysize != keysize || memcmp(node->data, key, keysize))
+            continue;
+
+        if(now - node->created >= timeout) {
+            ::free(node->data);
+            list[pos] = list[--count];
+            break;
+        }
+
+        node->used = now;
+        size = node->size;
+        data = ::malloc(size);
+        memcpy(data, node->data + keysize, size);
+        break;
+    }
+    lock.release();
+    return data;
+}
+
+void secure::sessions::remove(const void *key, size_t keysize)
+{
+    uint32_t hash = session_hash(key, keysize);
+
+    lock.acquire();
+    for(unsigned pos = 0; pos < count; ++pos) {
+        entry *node = &list[pos];
+        if(node->hash == hash && node->keysize == keysize && !memcmp(node->data, key, keysize)) {
+            ::free(node->data);
+            list[pos] = list[--count];
+            break;
+        }
+    }
+    lock.release();
+}
+
+size_t SSLBuffer::copyfile(fsys& file, fsys::offset_t offset, size_t size)
+{
+    size_t total = 0;
+
+#ifdef  HAVE_SYS_SENDFILE_H
+    // plain tcp goes from the file to the socket within the kernel
+    if(!bio) {
+        off_t pos = (off_t)offset;
+        while(total < size) {
+            ssize_t result = ::sendfile(so, file.handle(), &pos, size - total);
+            if(result < 1) {
+                if(result < 0 && errno == EINTR)
+                    continue;
+                if(result < 0)
+                    ioerr = errno;
+                break;
+            }
+            total += (size_t)result;
+        }
+        return total;
+    }
+#endif
+
+    // otherwise copied through in blocks of the largest tls record
+    char buf[16384];
+
+    if(file.seek(offset))
+        return 0;
+
+    while(total < size) {
+        size_t count = size - total;
+        if(count > sizeof(buf))
+            count = sizeof(buf);
+
+        ssize_t result = file.read(buf, count);
+        if(result < 1)
+            break;
+
+        size_t pos = 0;
+        while(pos < (size_t)result) {
+            size_t sent = _push(buf + pos, (size_t)result - pos);
+            if(!sent)
+                return total + pos;
+            pos += sent;
+        }
+        total += (size_t)result;
+    }
+    return total;
+}
+
 HMAC::HMAC()
 {
     hmactype = NULL;
@@ -68,4 +68,17 @@ void secure::cipher(secure *context, const char *ciphers)
 {
 }
 
+void secure::cache(secure *context, size_t size, time_t timeout)
+{
+}
+
+bool secure::offload(secure *context, bool enable)
+{
+    return false;
+}
+
+void secure::nodelay(secure *context, bool enable)
+{
+}
+
 } // namespace ucommon
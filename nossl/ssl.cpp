@@ -25,7 +25,9 @@ TCPBuffer()
 {
     ssl = NULL;
     bio = NULL;
+    peer = NULL;
     server = false;
+    async = false;
 }
 
 SSLBuffer::SSLBuffer(const TCPServer *tcp, secure::server_t context, size_t size) :
@@ -33,7 +35,9 @@ TCPBuffer(tcp, size)
 {
     ssl = NULL;
     bio = NULL;
+    peer = NULL;
     server = true;
+    async = false;
 }
 
 
@@ -48,9 +52,103 @@ void SSLBuffer::open(const char *host, const char *service, size_t bufsize)
         return;
     }
 
+    async = false;
     TCPBuffer::open(host, service, bufsize);
 }
 
+// without ssl the non-blocking interface is plain tcp
+
+static SSLBuffer::state_t status(ssize_t result)
+{
+    if(result > 0)
+        return SSLBuffer::READY;
+
+    if(result == 0)
+        return SSLBuffer::CLOSED;
+
+    switch(Socket::error()) {
+    case EAGAIN:
+#if defined(EWOULDBLOCK) && EWOULDBLOCK != EAGAIN
+    case EWOULDBLOCK:
+#endif
+    case EINTR:
+        return SSLBuffer::WANT_READ;
+    default:
+        return SSLBuffer::FAILED;
+    }
+}
+
+SSLBuffer::state_t SSLBuffer::connect(const char *host, const char *service, size_t bufsize)
+{
+    if(server) {
+        ioerr = EBADF;
+        return FAILED;
+    }
+
+    TCPBuffer::close();
+    TCPBuffer::open(host, service, bufsize);
+    if(!is_open())
+        return FAILED;
+
+    async = true;
+    Socket::blocking(so, false);
+    return READY;
+}
+
+SSLBuffer::state_t SSLBuffer::accept(const TCPServer *tcp, size_t bufsize)
+{
+    if(server) {
+        ioerr = EBADF;
+        return FAILED;
+    }
+
+    TCPBuffer::open(tcp, bufsize);
+    if(!is_open())
+        return FAILED;
+
+    async = true;
+    Socket::blocking(so, false);
+    return READY;
+}
+
+SSLBuffer::state_t SSLBuffer::handshake(void)
+{
+    if(!is_open())
+        return FAILED;
+
+    return READY;
+}
+
+SSLBuffer::state_t SSLBuffer::recv(char *data, size_t size, size_t& count)
+{
+    count = 0;
+    if(!is_open())
+        return FAILED;
+
+    ssize_t result = Socket::recvfrom(so, data, size);
+    if(result > 0)
+        count = (size_t)result;
+    return status(result);
+}
+
+SSLBuffer::state_t SSLBuffer::send(const char *data, size_t size, size_t& count)
+{
+    count = 0;
+    if(!is_open())
+        return FAILED;
+
+    ssize_t result = Socket::sendto(so, data, size);
+    if(result >= 0) {
+        count = (size_t)result;
+        return READY;
+    }
+
+    state_t state = status(result);
+    if(state == WANT_READ)
+        return WANT_WRITE;
+    return state;
+}
+
 void SSLBuffer::close(void)
 {
     if(server) {
@@ -66,14 +164,49 @@ void SSLBuffer::release(void)
     TCPBuffer::close();
 }
 
+size_t SSLBuffer::sendfile(fsys& file, fsys::offset_t offset, size_t size)
+{
+    if(!flush())
+        return 0;
+
+    return copyfile(file, offset, size);
+}
+
+bool SSLBuffer::is_offloaded(void) const
+{
+    return false;
+}
+
 size_t SSLBuffer::_push(const char *address, size_t size)
 {
-    return TCPBuffer::_push(address, size);
+    if(!async)
+        return TCPBuffer::_push(address, size);
+
+    // buffered writes on a non-blocking socket wait until all is sent
+    size_t total = 0;
+    while(total < size) {
+        size_t count;
+        state_t state = send(address + total, size - total, count);
+        total += count;
+        if(state != READY && !waitfor(state))
+            break;
+    }
+    return total;
 }
 
 size_t SSLBuffer::_pull(char *address, size_t size)
 {
-    return TCPBuffer::_pull(address, size);
+    if(!async)
+        return TCPBuffer::_pull(address, size);
+
+    for(;;) {
+        size_t count;
+        state_t state = recv(address, size, count);
+        if(state == READY)
+            return count;
+        if(!waitfor(state))
+            return 0;
+    }
 }
 
 bool SSLBuffer::_pending(void)
@@ -27,6 +27,7 @@ tcpstream()
 {
     ssl = NULL;
     bio = NULL;
+    peer = NULL;
     server = false;
 }
 
@@ -35,6 +36,7 @@ tcpstream(tcp, size)
 {
     ssl = NULL;
     bio = NULL;
+    peer = NULL;
     server = true;
 }
 
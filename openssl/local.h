@@ -28,6 +28,13 @@
 #include <openssl/hmac.h>
 #include <openssl/rand.h>
 
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+typedef EVP_MAC_CTX ticket_mac_t;
+#else
+typedef HMAC_CTX ticket_mac_t;
+#endif
+
 #ifdef  _MSWINDOWS_
 #include <wincrypt.h>
 #endif
@@ -40,6 +47,36 @@ public:
     ~__context();
 
     SSL_CTX *ctx;
+    bool server;
+    bool nodelay;
+
+    // client sessions by peer
+    sessions saved;
+
+    // current and prior ticket keys of a server
+    typedef struct {
+        unsigned char name[16];
+        unsigned char aes[32];
+        unsigned char hmac[32];
+        time_t created;
+    } ticket_t;
+
+    ticket_t keys[2];
+    Mutex keylock;
+
+    int ticket(unsigned char *name, unsigned char *iv, EVP_CIPHER_CTX *cipher, ticket_mac_t *mac, int enc);
+
+    static __context *get(SSL *ssl);
+
+    static char *peer(const char *host, const char *service);
+
+    static void resume(SSL *ssl, const char *peer);
+
+    static int negotiate(SSL *ssl, const char *peer);
+
+    static int handshake(SSL *ssl, const char *peer);
+
+    static void options(SSL *ssl);
 };
 
 } // namespace ucommon
@@ -43,6 +43,36 @@ extern "C" {
         return (long)Thread::self();
 #endif
     }
+
+    static int ssl_session(SSL *ssl, SSL_SESSION *session)
+    {
+        __context *ctx = __context::get(ssl);
+        const char *peer = (const char *)SSL_get_app_data(ssl);
+
+        if(!ctx || !peer)
+            return 0;
+
+        int size = i2d_SSL_SESSION(session, NULL);
+        if(size <= 0)
+            return 0;
+
+        unsigned char *data = (unsigned char *)::malloc(size);
+        unsigned char *dp = data;
+        i2d_SSL_SESSION(session, &dp);
+        ctx->saved.put(peer, strlen(peer), data, size);
+        ::free(data);
+        return 0;
+    }
+
+    static int ssl_ticket(SSL *ssl, unsigned char *name, unsigned char *iv, EVP_CIPHER_CTX *cipher, ticket_mac_t *mac, int enc)
+    {
+        __context *ctx = __context::get(ssl);
+
+        if(!ctx)
+            return -1;
+
+        return ctx->ticket(name, iv, cipher, mac, enc);
+    }
 }
 
 bool secure::fips(void)
@@ -103,6 +133,9 @@ secure::client_t secure::client(const char *ca)
         return NULL;
 
     ctx->error = secure::OK;
+    ctx->server = false;
+    ctx->nodelay = false;
+    memset(ctx->keys, 0, sizeof(ctx->keys));
 
     ctx->ctx = SSL_CTX_new(SSLv23_client_method());
 
@@ -111,6 +144,9 @@ secure::client_t secure::client(const char *ca)
         return ctx;
     }
 
+    SSL_CTX_set_app_data(ctx->ctx, ctx);
+    secure::cache(ctx, 1024);
+
     if(!ca)
         return ctx;
 
@@ -134,6 +170,9 @@ secure::server_t secure::server(const char *certfile, const char *ca)
 
     secure::init();
     ctx->error = secure::OK;
+    ctx->server = true;
+    ctx->nodelay = false;
+    memset(ctx->keys, 0, sizeof(ctx->keys));
     ctx->ctx = SSL_CTX_new(SSLv23_server_method());
 
     if(!ctx->ctx) {
@@ -141,6 +180,9 @@ secure::server_t secure::server(const char *certfile, const char *ca)
         return ctx;
     }
 
+    SSL_CTX_set_app_data(ctx->ctx, ctx);
+    secure::cache(ctx, 1024);
+
     if(!SSL_CTX_use_certificate_chain_file(ctx->ctx, certfile)) {
         ctx->error = secure::MISSING_CERTIFICATE;
         return ctx;
@@ -170,6 +212,75 @@ secure::server_t secure::server(const char *certfile, const char *ca)
     return ctx;
 }
 
+void secure::cache(secure *scontext, size_t size, time_t timeout)
+{
+    __context *ctx = (__context *)scontext;
+    if(!ctx || !ctx->ctx)
+        return;
+
+    SSL_CTX_set_timeout(ctx->ctx, (long)timeout);
+
+    // clients keep their own sessions by peer
+    if(!ctx->server) {
+        ctx->saved.setup(size, timeout);
+        if(!size) {
+            SSL_CTX_set_session_cache_mode(ctx->ctx, SSL_SESS_CACHE_OFF);
+            return;
+        }
+        SSL_CTX_set_session_cache_mode(ctx->ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(ctx->ctx, ssl_session);
+        return;
+    }
+
+    // the server cache is shared by all sessions of the context
+    ctx->saved.setup(0, timeout);
+    ctx->keylock.acquire();
+    memset(ctx->keys, 0, sizeof(ctx->keys));
+    ctx->keylock.release();
+
+    if(!size) {
+        SSL_CTX_set_session_cache_mode(ctx->ctx, SSL_SESS_CACHE_OFF);
+        SSL_CTX_set_options(ctx->ctx, SSL_OP_NO_TICKET);
+        return;
+    }
+
+    SSL_CTX_clear_options(ctx->ctx, SSL_OP_NO_TICKET);
+    SSL_CTX_set_session_cache_mode(ctx->ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(ctx->ctx, (long)size);
+    SSL_CTX_set_session_id_context(ctx->ctx, (const unsigned char *)"ucommon", 7);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx->ctx, ssl_ticket);
+#else
+    SSL_CTX_set_tlsext_ticket_key_cb(ctx->ctx, ssl_ticket);
+#endif
+}
+
+bool secure::offload(secure *scontext, bool enable)
+{
+    __context *ctx = (__context *)scontext;
+    if(!ctx || !ctx->ctx)
+        return false;
+
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+    // used only when the kernel accepts the negotiated cipher
+    if(enable)
+        SSL_CTX_set_options(ctx->ctx, SSL_OP_ENABLE_KTLS);
+    else
+        SSL_CTX_clear_options(ctx->ctx, SSL_OP_ENABLE_KTLS);
+    return true;
+#else
+    (void)enable;
+    return false;
+#endif
+}
+
+void secure::nodelay(secure *scontext, bool enable)
+{
+    __context *ctx = (__context *)scontext;
+    if(ctx)
+        ctx->nodelay = enable;
+}
+
 secure::error_t secure::verify(session_t session, const char *peername)
 {
     SSL *ssl = (SSL *)session;
@@ -204,6 +315,144 @@ __context::~__context()
 {
     if(ctx)
         SSL_CTX_free(ctx);
+
+    memset(keys, 0, sizeof(keys));
+}
+
+__context *__context::get(SSL *ssl)
+{
+    return (__context *)SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+}
+
+char *__context::peer(const char *host, const char *service)
+{
+    if(!service)
+        service = "";
+
+    size_t size = strlen(host) + strlen(service) + 2;
+    char *id = (char *)::malloc(size);
+    snprintf(id, size, "%s:%s", host, service);
+    return id;
+}
+
+static bool ticket_mac(ticket_mac_t *mac, unsigned char *key, size_t size)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    OSSL_PARAM params[2];
+
+    params[0] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, (char *)"SHA256", 0);
+    params[1] = OSSL_PARAM_construct_end();
+    return EVP_MAC_CTX_set_params(mac, params) > 0 && EVP_MAC_init(mac, key, size, NULL) > 0;
+#else
+    return HMAC_Init_ex(mac, key, (int)size, EVP_sha256(), NULL) > 0;
+#endif
+}
+
+int __context::ticket(unsigned char *name, unsigned char *iv, EVP_CIPHER_CTX *cipher, ticket_mac_t *mac, int enc)
+{
+    time_t now, timeout = saved.expires();
+    int result = 0;
+
+    time(&now);
+    keylock.acquire();
+    if(enc) {
+        // keys rotate at the session timeout, the prior key stays valid
+        if(!keys[0].created || now - keys[0].created >= timeout) {
+            keys[1] = keys[0];
+            if(RAND_bytes(keys[0].name, sizeof(keys[0].name)) < 1 ||
+              RAND_bytes(keys[0].aes, sizeof(keys[0].aes)) < 1 ||
+              RAND_bytes(keys[0].hmac, sizeof(keys[0].hmac)) < 1) {
+                memset(keys, 0, sizeof(keys));
+                keylock.release();
+                return -1;
+            }
+            keys[0].created = now;
+        }
+        if(RAND_bytes(iv, EVP_MAX_IV_LENGTH) < 1 ||
+          EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), NULL, keys[0].aes, iv) < 1 ||
+          !ticket_mac(mac, keys[0].hmac, sizeof(keys[0].hmac)))
+            result = -1;
+        else {
+            memcpy(name, keys[0].name, sizeof(keys[0].name));
+            result = 1;
+        }
+    }
+    else for(unsigned pos = 0; pos < 2; ++pos) {
+        if(!keys[pos].created || memcmp(name, keys[pos].name, sizeof(keys[pos].name)))
+            continue;
+
+        if(now - keys[pos].created >= timeout * 2)
+            break;
+
+        if(!ticket_mac(mac, keys[pos].hmac, sizeof(keys[pos].hmac)) ||
+          EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), NULL, keys[pos].aes, iv) < 1)
+            result = -1;
+        else
+            result = pos ? 2 : 1;   // tickets from the prior key are renewed
+        break;
+    }
+    keylock.release();
+    return result;
+}
+
+void __context::resume(SSL *ssl, const char *peer)
+{
+    __context *ctx = get(ssl);
+    size_t size;
+    void *data = NULL;
+
+    if(!peer)
+        return;
+
+    // a cleared session keeps its last session, which is only reused
+    // when still in the cache
+    SSL_set_session(ssl, NULL);
+    SSL_set_app_data(ssl, (char *)peer);
+    if(ctx)
+        data = ctx->saved.get(peer, strlen(peer), size);
+
+    if(data) {
+        const unsigned char *dp = (const unsigned char *)data;
+        SSL_SESSION *session = d2i_SSL_SESSION(NULL, &dp, (long)size);
+        if(session) {
+            SSL_set_session(ssl, session);
+            SSL_SESSION_free(session);
+        }
+        ::free(data);
+    }
+}
+
+int __context::negotiate(SSL *ssl, const char *peer)
+{
+    __context *ctx = get(ssl);
+    int result;
+
+    if(peer)
+        result = SSL_connect(ssl);
+    else
+        result = SSL_accept(ssl);
+
+    if(result > 0 && ctx) {
+        if(SSL_session_reused(ssl))
+            ++ctx->resumed;
+        else
+            ++ctx->negotiated;
+    }
+    return result;
+}
+
+void __context::options(SSL *ssl)
+{
+    __context *ctx = get(ssl);
+    if(ctx && ctx->nodelay)
+        Socket::nodelay((socket_t)SSL_get_fd(ssl));
+}
+
+int __context::handshake(SSL *ssl, const char *peer)
+{
+    options(ssl);
+    resume(ssl, peer);
+    return negotiate(ssl, peer);
 }
 
 } // namespace ucommon
@@ -26,7 +26,9 @@ TCPBuffer()
     __context *ctx = (__context *)scontext;
     ssl = NULL;
     bio = NULL;
+    peer = NULL;
     server = false;
+    async = false;
 
     if(ctx && ctx->ctx && ctx->err() == secure::OK)
         ssl = SSL_new(ctx->ctx);
@@ -38,7 +40,9 @@ TCPBuffer(tcp, size)
     __context *ctx = (__context *)scontext;
     ssl = NULL;
     bio = NULL;
+    peer = NULL;
     server = true;
+    async = false;
 
     if(ctx && ctx->ctx && ctx->err() == secure::OK)
         ssl = SSL_new(ctx->ctx);
@@ -48,7 +52,7 @@ TCPBuffer(tcp, size)
 
     SSL_set_fd((SSL *)ssl, getsocket());
 
-    if(SSL_accept((SSL *)ssl) > 0)
+    if(__context::handshake((SSL *)ssl, NULL) > 0)
         bio = SSL_get_wbio((SSL *)ssl);
 }
 
@@ -65,17 +69,174 @@ void SSLBuffer::open(const char *host, const char *service, size_t size)
     }
 
     close();
+    async = false;
     TCPBuffer::open(host, service, size);
 
     if(!is_open() || !ssl)
         return;
 
+    // a session object is reset for each new connection
+    SSL_clear((SSL *)ssl);
     SSL_set_fd((SSL *)ssl, getsocket());
+    peer = __context::peer(host, service);
 
-    if(SSL_connect((SSL *)ssl) > 0)
+    if(__context::handshake((SSL *)ssl, peer) > 0)
         bio = SSL_get_wbio((SSL *)ssl);
 }
 
+static SSLBuffer::state_t status(SSL *ssl, int result)
+{
+    switch(SSL_get_error(ssl, result)) {
+    case SSL_ERROR_WANT_READ:
+        return SSLBuffer::WANT_READ;
+    case SSL_ERROR_WANT_WRITE:
+        return SSLBuffer::WANT_WRITE;
+    case SSL_ERROR_ZERO_RETURN:
+        return SSLBuffer::CLOSED;
+    default:
+        return SSLBuffer::FAILED;
+    }
+}
+
+SSLBuffer::state_t SSLBuffer::connect(const char *host, const char *service, size_t size)
+{
+    if(server) {
+        ioerr = EBADF;
+        return FAILED;
+    }
+
+    close();
+    TCPBuffer::open(host, service, size);
+
+    if(!is_open() || !ssl)
+        return FAILED;
+
+    async = true;
+    Socket::blocking(so, false);
+    SSL_clear((SSL *)ssl);
+    SSL_set_fd((SSL *)ssl, getsocket());
+    SSL_set_mode((SSL *)ssl, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    __context::options((SSL *)ssl);
+    peer = __context::peer(host, service);
+    __context::resume((SSL *)ssl, peer);
+    return handshake();
+}
+
+SSLBuffer::state_t SSLBuffer::accept(const TCPServer *tcp, size_t size)
+{
+    if(server) {
+        ioerr = EBADF;
+        return FAILED;
+    }
+
+    close();
+    TCPBuffer::open(tcp, size);
+
+    if(!is_open() || !ssl)
+        return FAILED;
+
+    async = true;
+    Socket::blocking(so, false);
+    SSL_clear((SSL *)ssl);
+    SSL_set_fd((SSL *)ssl, getsocket());
+    SSL_set_mode((SSL *)ssl, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    __context::options((SSL *)ssl);
+    return handshake();
+}
+
+SSLBuffer::state_t SSLBuffer::handshake(void)
+{
+    if(bio)
+        return READY;
+
+    if(!ssl || !is_open())
+        return FAILED;
+
+    int result = __context::negotiate((SSL *)ssl, peer);
+    if(result > 0) {
+        bio = SSL_get_wbio((SSL *)ssl);
+        return READY;
+    }
+
+    state_t state = status((SSL *)ssl, result);
+    if(state == FAILED)
+        ioerr = EIO;
+    return state;
+}
+
+SSLBuffer::state_t SSLBuffer::recv(char *data, size_t size, size_t& count)
+{
+    count = 0;
+
+    state_t state = handshake();
+    if(state != READY)
+        return state;
+
+    int result = SSL_read((SSL *)ssl, data, size);
+    if(result > 0) {
+        count = (size_t)result;
+        return READY;
+    }
+
+    state = status((SSL *)ssl, result);
+    if(state == FAILED)
+        ioerr = EIO;
+    return state;
+}
+
+SSLBuffer::state_t SSLBuffer::send(const char *data, size_t size, size_t& count)
+{
+    count = 0;
+
+    state_t state = handshake();
+    if(state != READY)
+        return state;
+
+    int result = SSL_write((SSL *)ssl, data, size);
+    if(result > 0) {
+        count = (size_t)result;
+        return READY;
+    }
+
+    state = status((SSL *)ssl, result);
+    if(state == FAILED)
+        ioerr = EIO;
+    return state;
+}
+
+size_t SSLBuffer::sendfile(fsys& file, fsys::offset_t offset, size_t size)
+{
+    if(!flush())
+        return 0;
+
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+    if(is_offloaded()) {
+        size_t total = 0;
+        while(total < size) {
+            ossl_ssize_t result = SSL_sendfile((SSL *)ssl, file.handle(), (off_t)(offset + total), size - total, 0);
+            if(result < 1) {
+                if(status((SSL *)ssl, (int)result) == FAILED)
+                    ioerr = EIO;
+                break;
+            }
+            total += (size_t)result;
+        }
+        return total;
+    }
+#endif
+
+    return copyfile(file, offset, size);
+}
+
+bool SSLBuffer::is_offloaded(void) const
+{
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+    if(bio && BIO_get_ktls_send(SSL_get_wbio((SSL *)ssl)))
+        return true;
+#endif
+    return false;
+}
+
 void SSLBuffer::close(void)
 {
     if(server) {
@@ -88,6 +249,12 @@ void SSLBuffer::close(void)
         bio = NULL;
     }
 
+    if(peer) {
+        SSL_set_app_data((SSL *)ssl, NULL);
+        ::free(peer);
+        peer = NULL;
+    }
+
     TCPBuffer::close();
 }
 
@@ -106,6 +273,19 @@ size_t SSLBuffer::_push(const char *address, size_t size)
     if(!bio)
         return TCPBuffer::_push(address, size);
 
+    // buffered writes on a non-blocking session wait until all is sent
+    if(async) {
+        size_t total = 0;
+        while(total < size) {
+            size_t count;
+            state_t state = send(address + total, size - total, count);
+            total += count;
+            if(state != READY && !waitfor(state))
+                break;
+        }
+        return total;
+    }
+
     int result = SSL_write((SSL *)ssl, address, size);
     if(result < 0) {
         result = 0;
@@ -136,6 +316,18 @@ size_t SSLBuffer::_pull(char *address, size_t size)
     if(!bio)
         return TCPBuffer::_pull(address, size);
 
+    // buffered reads on a non-blocking session wait for data or close
+    if(async) {
+        for(;;) {
+            size_t count;
+            state_t state = recv(address, size, count);
+            if(state == READY)
+                return count;
+            if(!waitfor(state))
+                return 0;
+        }
+    }
+
     if(SSL_pending((SSL *)ssl) == 0 && iowait && iowait != Timer::inf && !Socket::wait(so, iowait))
         return 0;
 
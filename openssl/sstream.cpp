@@ -28,6 +28,7 @@ tcpstream()
     __context *ctx = (__context *)scontext;
     ssl = NULL;
     bio = NULL;
+    peer = NULL;
     server = false;
 
     if(ctx && ctx->ctx && ctx->err() == secure::OK)
@@ -40,6 +41,7 @@ tcpstream(tcp, size)
     __context *ctx = (__context *)scontext;
     ssl = NULL;
     bio = NULL;
+    peer = NULL;
     server = true;
 
     if(ctx && ctx->ctx && ctx->err() == secure::OK)
@@ -50,7 +52,7 @@ tcpstream(tcp, size)
 
     SSL_set_fd((SSL *)ssl, getsocket());
 
-    if(SSL_accept((SSL *)ssl) > 0)
+    if(__context::handshake((SSL *)ssl, NULL) > 0)
         bio = SSL_get_wbio((SSL *)ssl);
 }
 
@@ -70,9 +72,12 @@ void sstream::open(const char *host, const char *service, size_t size)
     if(!is_open() || !ssl)
         return;
 
+    // a session object is reset for each new connection
+    SSL_clear((SSL *)ssl);
     SSL_set_fd((SSL *)ssl, getsocket());
+    peer = __context::peer(host, service);
 
-    if(SSL_connect((SSL *)ssl) > 0)
+    if(__context::handshake((SSL *)ssl, peer) > 0)
         bio = SSL_get_wbio((SSL *)ssl);
 }
 
@@ -86,6 +91,12 @@ void sstream::close(void)
         bio = NULL;
     }
 
+    if(peer) {
+        SSL_set_app_data((SSL *)ssl, NULL);
+        ::free(peer);
+        peer = NULL;
+    }
+
     tcpstream::close();
 }
 
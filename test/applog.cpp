@@ -0,0 +1,96 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DEBUG
+#define DEBUG
+#endif
+
+#ifndef UCOMMON_SYSRUNTIME
+#include <ucommon/ucommon.h>
+#include <commoncpp/applog.h>
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace ost;
+
+#define MESSAGES    100
+
+static char text[420];
+
+class testLogger : public Thread
+{
+public:
+    AppLog *applog;
+
+    testLogger(AppLog *log) : Thread() {
+        applog = log;
+    }
+
+    void run(void) {
+        applog->subscribe();
+        applog->level(Slog::levelDebug);
+        applog->open("test");
+        for(unsigned pos = 0; pos < MESSAGES; ++pos)
+            applog->info("%u %s\n", pos, pos % 10 ? "short" : text);
+        applog->unsubscribe();
+    }
+};
+
+extern "C" int main()
+{
+    char line[1024];
+    unsigned count = 0, longest = 0;
+
+    memset(text, 'x', sizeof(text) - 1);
+    text[sizeof(text) - 1] = 0;
+
+    // records larger than the requested buffer must still be written
+    remove("applog.log");
+    AppLog *applog = new AppLog();
+    applog->logAsync("applog.log", 64, 50);
+
+    testLogger *logger = new testLogger(applog);
+    logger->start();
+    logger->join();
+    delete logger;
+    delete applog;
+
+    FILE *fp = fopen("applog.log", "r");
+    assert(fp != NULL);
+    while(fgets(line, sizeof(line), fp)) {
+        assert(line[strlen(line) - 1] == '\n');
+        if(strlen(line) > longest)
+            longest = (unsigned)strlen(line);
+        ++count;
+    }
+    fclose(fp);
+    remove("applog.log");
+
+    assert(count == MESSAGES);
+    assert(longest > 400);
+    return 0;
+}
+
+#else
+
+int main()
+{
+    return 0;
+}
+
+#endif
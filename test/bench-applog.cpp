@@ -0,0 +1,127 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef UCOMMON_SYSRUNTIME
+#include <ucommon/ucommon.h>
+#include <commoncpp/applog.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ost;
+
+#define THREADS     32
+#define MESSAGES    10000
+
+static AppLog *applog;
+
+class benchLogger : public Thread
+{
+public:
+    unsigned count;
+
+    benchLogger(unsigned messages) : Thread() {
+        count = messages;
+    }
+
+    void run(void) {
+        applog->subscribe();
+        applog->level(Slog::levelDebug);
+        applog->open("bench");
+        for(unsigned pos = 0; pos < count; ++pos)
+            applog->info("message %u from a busy thread\n", pos);
+        applog->unsubscribe();
+    }
+};
+
+static unsigned lines(void)
+{
+    unsigned count = 0;
+    FILE *fp = fopen("bench.log", "r");
+    if(fp) {
+        int ch;
+        while((ch = fgetc(fp)) != EOF) {
+            if(ch == '\n')
+                ++count;
+        }
+        fclose(fp);
+    }
+    return count;
+}
+
+static void report(const char *id, ucommon::Timer::tick_t start, unsigned messages)
+{
+    double secs = (double)(ucommon::Timer::ticks() - start) / 10000000.0;
+    if(secs <= 0.0)
+        secs = 0.0000001;
+
+    unsigned count = lines();
+    remove("bench.log");
+    printf("%-16s %10.0f messages/s%s\n", id, (double)messages / secs,
+        count == messages ? "" : " (failed)");
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    unsigned threads = THREADS;
+    unsigned count = MESSAGES;
+    benchLogger *loggers[THREADS * 4];
+
+    if(argc > 1)
+        count = atoi(argv[1]);
+
+    if(argc > 2)
+        threads = atoi(argv[2]);
+
+    if(threads > THREADS * 4)
+        threads = THREADS * 4;
+
+    remove("bench.log");
+    static const char *modes[] = {"direct", "spooled", "async"};
+    for(unsigned mode = 0; mode < 3; ++mode) {
+        if(mode == 2) {
+            applog = new AppLog();
+            applog->logAsync("bench.log");
+        }
+        else
+            applog = new AppLog("bench.log", mode == 0);
+
+        ucommon::Timer::tick_t start = ucommon::Timer::ticks();
+        for(unsigned pos = 0; pos < threads; ++pos) {
+            loggers[pos] = new benchLogger(count);
+            loggers[pos]->start();
+        }
+        for(unsigned pos = 0; pos < threads; ++pos) {
+            loggers[pos]->join();
+            delete loggers[pos];
+        }
+
+        // the spooler and async writer finish writing out when deleted
+        delete applog;
+        report(modes[mode], start, count * threads);
+    }
+    return 0;
+}
+
+#else
+
+int main(int argc, char **argv)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,203 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ucommon;
+
+#define BITS        1000000
+#define PASSES      20
+#define WORDPASSES  2000
+#define THREADS     4
+
+static double elapsed(Timer::tick_t start)
+{
+    double secs = (double)(Timer::ticks() - start) / 10000000.0;
+    if(secs <= 0.0)
+        secs = 0.0000001;
+    return secs;
+}
+
+// rates are in bits covered per second, or slots allocated per second
+static void report(const char *id, double ops, Timer::tick_t start, bool ok)
+{
+    printf("%-16s %10.0f ops/s%s\n", id, ops / elapsed(start), ok ? "" : " (failed)");
+}
+
+static bitmap *slots;
+static Mutex guard;
+static size_t bits = BITS;
+
+class benchWorker : public JoinableThread
+{
+public:
+    unsigned count;
+    size_t hint;
+
+    benchWorker(unsigned allocs, size_t start) : JoinableThread() {
+        count = allocs;
+        hint = start;
+    }
+
+    ~benchWorker() {}
+
+    inline void finish(void) {
+        join();
+    }
+};
+
+// slot allocation as it had to be done, one bit at a time under a lock
+class benchLocked : public benchWorker
+{
+public:
+    benchLocked(unsigned allocs, size_t start) : benchWorker(allocs, start) {}
+
+    void run(void) {
+        for(unsigned pos = 0; pos < count; ++pos) {
+            guard.acquire();
+            size_t slot = hint;
+            while(slots->get(slot)) {
+                if(++slot >= bits)
+                    slot = 0;
+            }
+            slots->set(slot, true);
+            guard.release();
+            hint = slot;
+        }
+    }
+};
+
+class benchAtomic : public benchWorker
+{
+public:
+    benchAtomic(unsigned allocs, size_t start) : benchWorker(allocs, start) {}
+
+    void run(void) {
+        for(unsigned pos = 0; pos < count; ++pos)
+            hint = slots->acquire(hint);
+    }
+};
+
+extern "C" int main(int argc, char **argv)
+{
+    if(argc > 1)
+        bits = atoi(argv[1]);
+
+    bitmap map(bits);
+    Timer::tick_t start;
+    size_t total = 0, found = 0;
+    bool ok = true;
+
+    printf("%lu bit maps\n", (unsigned long)bits);
+
+    start = Timer::ticks();
+    for(unsigned pass = 0; pass < PASSES; ++pass) {
+        for(size_t pos = 0; pos < bits; ++pos)
+            map.set(pos, (pass & 1) == 0);
+    }
+    report("bit fill", (double)bits * PASSES, start, map.get(0) == false);
+
+    start = Timer::ticks();
+    for(unsigned pass = 0; pass < WORDPASSES; ++pass)
+        map.set(0, bits, (pass & 1) == 0);
+    report("range fill", (double)bits * WORDPASSES, start, map.get(0) == false);
+
+    // one bit in a hundred set, as a sparse table of active slots
+    for(size_t pos = 0; pos < bits; pos += 100)
+        map.set(pos, true);
+
+    start = Timer::ticks();
+    for(unsigned pass = 0; pass < PASSES; ++pass) {
+        total = 0;
+        for(size_t pos = 0; pos < bits; ++pos) {
+            if(map.get(pos))
+                ++total;
+        }
+    }
+    report("bit count", (double)bits * PASSES, start, total == (bits + 99) / 100);
+
+    start = Timer::ticks();
+    for(unsigned pass = 0; pass < WORDPASSES; ++pass)
+        total = map.count();
+    report("word count", (double)bits * WORDPASSES, start, total == (bits + 99) / 100);
+
+    start = Timer::ticks();
+    for(unsigned pass = 0; pass < WORDPASSES; ++pass) {
+        found = 0;
+        for(bitmap::iterator pos(map); pos; ++pos)
+            ++found;
+    }
+    report("iterate", (double)bits * WORDPASSES, start, found == total);
+
+    // find the last bit of an otherwise empty map
+    map.clear();
+    map.set(bits - 1, true);
+    start = Timer::ticks();
+    for(unsigned pass = 0; pass < PASSES; ++pass) {
+        found = 0;
+        while(found < bits && !map.get(found))
+            ++found;
+    }
+    report("bit scan", (double)bits * PASSES, start, found == bits - 1);
+
+    start = Timer::ticks();
+    for(unsigned pass = 0; pass < WORDPASSES; ++pass)
+        found = map.find(true);
+    report("find set", (double)bits * WORDPASSES, start, found == bits - 1);
+
+    map.set(0, bits, true);
+    map.set(bits - 1, false);
+    start = Timer::ticks();
+    for(unsigned pass = 0; pass < WORDPASSES; ++pass)
+        found = map.find(false);
+    report("find clear", (double)bits * WORDPASSES, start, found == bits - 1);
+
+    // threads allocate every slot of the map between them
+    unsigned threads = THREADS;
+    if(argc > 2)
+        threads = atoi(argv[2]);
+    if(threads < 1 || threads > 64)
+        threads = THREADS;
+
+    unsigned allocs = (unsigned)(bits / threads);
+    benchWorker *workers[64];
+    slots = &map;
+    for(unsigned mode = 0; mode < 2; ++mode) {
+        map.clear();
+        start = Timer::ticks();
+        for(unsigned pos = 0; pos < threads; ++pos) {
+            size_t hint = (bits / threads) * pos;
+            if(mode)
+                workers[pos] = new benchAtomic(allocs, hint);
+            else
+                workers[pos] = new benchLocked(allocs, hint);
+            workers[pos]->start();
+        }
+        for(unsigned pos = 0; pos < threads; ++pos) {
+            workers[pos]->finish();
+            delete workers[pos];
+        }
+        ok = map.count() == (size_t)allocs * threads;
+        report(mode ? "atomic acquire" : "locked alloc", (double)allocs * threads, start, ok);
+    }
+
+    return 0;
+}
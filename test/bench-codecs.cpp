@@ -0,0 +1,107 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ucommon;
+
+#define PAYLOAD 65536
+#define PASSES  2000
+
+static uint8_t payload[PAYLOAD];
+static uint8_t decoded[PAYLOAD];
+static char encoded[PAYLOAD * 2 + 1];
+static volatile uint32_t sink;
+
+// the original bit at a time reflected crc-16/ibm (0xa001, seeded as in
+// modbus), for comparison
+static uint16_t bitwise_crc16(const uint8_t *binary, size_t size)
+{
+    uint16_t crc = 0xffff;
+    while(size--) {
+        crc ^= *(binary++);
+        for(unsigned i = 0; i < 8; ++i)
+            crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xa001) : (uint16_t)(crc >> 1);
+    }
+    return crc;
+}
+
+static void report(const char *id, Timer::tick_t start, unsigned passes)
+{
+    double secs = (double)(Timer::ticks() - start) / 10000000.0;
+    if(secs <= 0.0)
+        secs = 0.0000001;
+    printf("%-16s %10.1f MB/s\n", id, ((double)PAYLOAD * passes) / secs / 1048576.0);
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    unsigned passes = PASSES;
+    unsigned pass;
+    Timer::tick_t start;
+
+    if(argc > 1)
+        passes = atoi(argv[1]);
+
+    for(unsigned pos = 0; pos < PAYLOAD; ++pos)
+        payload[pos] = (uint8_t)rand();
+
+    start = Timer::ticks();
+    for(pass = 0; pass < passes; ++pass)
+        String::b64encode(encoded, payload, PAYLOAD, sizeof(encoded));
+    report("b64encode", start, passes);
+
+    start = Timer::ticks();
+    for(pass = 0; pass < passes; ++pass)
+        sink = (uint32_t)String::b64decode(decoded, encoded, PAYLOAD);
+    report("b64decode", start, passes);
+
+    start = Timer::ticks();
+    for(pass = 0; pass < passes; ++pass)
+        String::hexdump(payload, encoded, "65536");
+    report("hexdump", start, passes);
+
+    start = Timer::ticks();
+    for(pass = 0; pass < passes; ++pass)
+        String::hexpack(decoded, encoded, "65536");
+    report("hexpack", start, passes);
+
+    start = Timer::ticks();
+    for(pass = 0; pass < passes / 10 + 1; ++pass)
+        sink = bitwise_crc16(payload, PAYLOAD);
+    report("crc16 bitwise", start, passes / 10 + 1);
+
+    start = Timer::ticks();
+    for(pass = 0; pass < passes; ++pass)
+        sink = String::crc16(payload, PAYLOAD);
+    report("crc16", start, passes);
+
+    start = Timer::ticks();
+    for(pass = 0; pass < passes; ++pass)
+        sink = String::crc24(payload, PAYLOAD);
+    report("crc24", start, passes);
+
+    start = Timer::ticks();
+    for(pass = 0; pass < passes; ++pass)
+        sink = String::crc32c(payload, PAYLOAD);
+    report("crc32c", start, passes);
+
+    return 0;
+}
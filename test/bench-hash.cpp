@@ -0,0 +1,167 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ucommon;
+
+#define BUCKETS     177
+#define LOOKUPS     1000000
+#define CHAINED     100000
+
+class benchNode : public NamedObject
+{
+public:
+    inline benchNode() : NamedObject() {}
+
+    inline benchNode(NamedObject **root, char *name, unsigned max) :
+        NamedObject(root, name, max) {}
+};
+
+static void report(const char *id, unsigned keys, Timer::tick_t start, unsigned count, bool ok)
+{
+    double secs = (double)(Timer::ticks() - start) / 10000000.0;
+    if(secs <= 0.0)
+        secs = 0.0000001;
+    printf("%-16s %8u keys %12.0f ops/s%s\n", id, keys, (double)count / secs, ok ? "" : " (failed)");
+}
+
+// the hash keyindex used before, to compare how keys spread out
+static unsigned legacy(const char *id, unsigned max)
+{
+    unsigned val = 0;
+    while(*id)
+        val = (val << 1) ^ (*(id++) & 0x1f);
+    return val % max;
+}
+
+static void spread(char **names, unsigned keys)
+{
+    unsigned max = 65536;
+    unsigned char *used = new unsigned char[max];
+    unsigned old = 0, now = 0;
+
+    memset(used, 0, max);
+    for(unsigned pos = 0; pos < keys; ++pos) {
+        unsigned path = legacy(names[pos], max);
+        if(!used[path]++)
+            ++old;
+    }
+    memset(used, 0, max);
+    for(unsigned pos = 0; pos < keys; ++pos) {
+        unsigned path = NamedObject::keyindex(names[pos], max);
+        if(!used[path]++)
+            ++now;
+    }
+    printf("%-16s %8u keys %6u old %6u new of %u\n", "buckets used", keys, old, now, max);
+    delete[] used;
+}
+
+static void run(unsigned keys)
+{
+    char **names = new char *[keys];
+    char name[32];
+    unsigned *order = new unsigned[LOOKUPS];
+    unsigned found;
+    Timer::tick_t start;
+
+    for(unsigned pos = 0; pos < keys; ++pos) {
+        snprintf(name, sizeof(name), "session-%08x", pos * 2654435761u);
+        names[pos] = strdup(name);
+    }
+    srand(keys);
+    for(unsigned pos = 0; pos < LOOKUPS; ++pos)
+        order[pos] = (unsigned)rand() % keys;
+
+    spread(names, keys);
+
+    // a fixed table of chains, as keymap uses, is too slow to fill far
+    unsigned chained = keys;
+    if(chained > CHAINED)
+        chained = CHAINED;
+    NamedObject *chains[BUCKETS];
+    memset(chains, 0, sizeof(chains));
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < chained; ++pos)
+        new benchNode(chains, strdup(names[pos]), BUCKETS);
+    report("chained add", chained, start, chained, true);
+
+    unsigned lookups = 1000000000 / chained;
+    if(lookups > LOOKUPS)
+        lookups = LOOKUPS;
+    found = 0;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < lookups; ++pos) {
+        if(NamedObject::map(chains, names[order[pos] % chained], BUCKETS))
+            ++found;
+    }
+    report("chained find", chained, start, lookups, found == lookups);
+    NamedObject::purge(chains, BUCKETS);
+
+    hashmap<benchNode> map;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < keys; ++pos)
+        map.add(strdup(names[pos]), new benchNode());
+    report("hashmap add", keys, start, keys, map.count() == keys);
+
+    found = 0;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < LOOKUPS; ++pos) {
+        if(map.get(names[order[pos]]))
+            ++found;
+    }
+    report("hashmap find", keys, start, LOOKUPS, found == LOOKUPS);
+
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < keys; ++pos)
+        delete map.remove(names[pos]);
+    report("hashmap remove", keys, start, keys, map.count() == 0);
+
+    keyassoc assoc(BUCKETS, 32);
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < keys; ++pos)
+        assoc.create(names[pos], names[pos]);
+    report("keyassoc create", keys, start, keys, assoc.count() == keys);
+
+    found = 0;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < LOOKUPS; ++pos) {
+        if(assoc.locate(names[order[pos]]) == names[order[pos]])
+            ++found;
+    }
+    report("keyassoc locate", keys, start, LOOKUPS, found == LOOKUPS);
+
+    for(unsigned pos = 0; pos < keys; ++pos)
+        free(names[pos]);
+    delete[] names;
+    delete[] order;
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    if(argc > 1) {
+        run(atoi(argv[1]));
+        return 0;
+    }
+
+    run(1000);
+    run(1000000);
+    return 0;
+}
@@ -0,0 +1,200 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ucommon;
+
+#define FILESIZE    (64l * 1048576l)
+#define BLOCK       4096
+#define READS       100000
+#define BATCH       32
+#define PAIRS       32
+#define MESSAGE     64
+#define MESSAGES    100000
+
+static void report(const char *id, Timer::tick_t start, unsigned count, const char *units, bool ok)
+{
+    double secs = (double)(Timer::ticks() - start) / 10000000.0;
+    if(secs <= 0.0)
+        secs = 0.0000001;
+    printf("%-16s %10.0f %s%s\n", id, (double)count / secs, units, ok ? "" : " (failed)");
+}
+
+static bool verify(const char *block, fsys::offset_t offset)
+{
+    return *(const uint32_t *)block == (uint32_t)(offset / BLOCK);
+}
+
+static void files(unsigned reads)
+{
+    char *block = new char[BLOCK * BATCH];
+    fsys::offset_t *offsets = new fsys::offset_t[reads];
+    unsigned blocks = (unsigned)(FILESIZE / BLOCK);
+
+    fsys out("bench.dat", 0640, fsys::REWRITE);
+    for(unsigned pos = 0; pos < blocks; ++pos) {
+        memset(block, 0, BLOCK);
+        *(uint32_t *)block = pos;
+        out.write(block, BLOCK);
+    }
+    out.close();
+
+    srand(1);
+    for(unsigned pos = 0; pos < reads; ++pos)
+        offsets[pos] = (fsys::offset_t)(rand() % blocks) * BLOCK;
+
+    fsys in("bench.dat", fsys::RANDOM);
+    bool ok = true;
+    Timer::tick_t start = Timer::ticks();
+    for(unsigned pos = 0; pos < reads; ++pos) {
+        in.seek(offsets[pos]);
+        if(in.read(block, BLOCK) != BLOCK || !verify(block, offsets[pos]))
+            ok = false;
+    }
+    report("fsys read", start, reads, "reads/s", ok);
+
+    for(unsigned registered = 0; registered < 2; ++registered) {
+        IORing ring(BATCH * 2);
+        if(registered && (!ring.fixed(in.handle()) || !ring.fixed(block, BLOCK * BATCH)))
+            break;
+
+        IORing::completion_t done[BATCH];
+        ok = true;
+        start = Timer::ticks();
+        for(unsigned pos = 0; ok && pos < reads; pos += BATCH) {
+            unsigned count = reads - pos;
+            if(count > BATCH)
+                count = BATCH;
+            for(unsigned slot = 0; slot < count; ++slot)
+                ring.read(in, block + slot * BLOCK, BLOCK, offsets[pos + slot], (void *)(uintptr_t)slot);
+            ring.submit();
+            unsigned reaped = 0;
+            while(ok && reaped < count) {
+                unsigned got = ring.wait(done, BATCH);
+                if(!got)
+                    ok = false;
+                for(unsigned item = 0; item < got; ++item) {
+                    unsigned slot = (unsigned)(uintptr_t)done[item].user;
+                    if(done[item].result != BLOCK || !verify(block + slot * BLOCK, offsets[pos + slot]))
+                        ok = false;
+                }
+                reaped += got;
+            }
+        }
+        report(registered ? "ioring fixed" : (ring.is_kernel() ? "ioring read" : "fallback read"), start, reads, "reads/s", ok);
+    }
+
+    in.close();
+    remove("bench.dat");
+    delete[] offsets;
+    delete[] block;
+}
+
+static void echo(unsigned messages)
+{
+    TCPServer listener("127.0.0.1", "9448", PAIRS);
+    Socket::address addr("127.0.0.1", "9448");
+    socket_t clients[PAIRS], servers[PAIRS];
+    char outbound[PAIRS][MESSAGE], inbound[PAIRS][MESSAGE];
+
+    IORing ring(PAIRS * 2);
+    IORing::completion_t done[PAIRS * 2];
+
+    // clients wait in the backlog to be accepted through the ring
+    for(unsigned pos = 0; pos < PAIRS; ++pos)
+        clients[pos] = Socket::create(addr);
+    for(unsigned pos = 0; pos < PAIRS; ++pos)
+        ring.accept(listener.handle());
+    ring.submit();
+    unsigned accepted = 0;
+    while(accepted < PAIRS) {
+        unsigned got = ring.wait(done, PAIRS);
+        if(!got)
+            break;
+        for(unsigned item = 0; item < got; ++item)
+            servers[accepted++] = (socket_t)done[item].result;
+    }
+
+    for(unsigned pos = 0; pos < PAIRS; ++pos) {
+        memset(outbound[pos], 'a' + pos % 26, MESSAGE);
+        Socket::nodelay(clients[pos]);
+        Socket::nodelay(servers[pos]);
+    }
+
+    // one message at a time, each pair in turn
+    bool ok = accepted == PAIRS;
+    Timer::tick_t start = Timer::ticks();
+    for(unsigned pos = 0; ok && pos < messages; ++pos) {
+        unsigned pair = pos % PAIRS;
+        if(Socket::sendto(clients[pair], outbound[pair], MESSAGE) != MESSAGE
+        || Socket::recvfrom(servers[pair], inbound[pair], MESSAGE) != MESSAGE
+        || Socket::sendto(servers[pair], inbound[pair], MESSAGE) != MESSAGE
+        || Socket::recvfrom(clients[pair], inbound[pair], MESSAGE) != MESSAGE)
+            ok = false;
+    }
+    report("blocking echo", start, messages, "msgs/s", ok);
+
+    // a message on every pair at once, each leg as one submission
+    start = Timer::ticks();
+    for(unsigned pos = 0; ok && pos < messages; pos += PAIRS) {
+        for(unsigned leg = 0; ok && leg < 2; ++leg) {
+            for(unsigned pair = 0; pair < PAIRS; ++pair) {
+                if(leg) {
+                    ring.send(servers[pair], inbound[pair], MESSAGE);
+                    ring.recv(clients[pair], inbound[pair], MESSAGE);
+                }
+                else {
+                    ring.send(clients[pair], outbound[pair], MESSAGE);
+                    ring.recv(servers[pair], inbound[pair], MESSAGE);
+                }
+            }
+            ring.submit();
+            unsigned reaped = 0;
+            while(ok && reaped < PAIRS * 2) {
+                unsigned got = ring.wait(done, PAIRS * 2);
+                if(!got)
+                    ok = false;
+                for(unsigned item = 0; item < got; ++item) {
+                    if(done[item].result != MESSAGE)
+                        ok = false;
+                }
+                reaped += got;
+            }
+        }
+    }
+    report(ring.is_kernel() ? "ioring echo" : "fallback echo", start, messages, "msgs/s", ok);
+
+    for(unsigned pos = 0; pos < accepted; ++pos)
+        Socket::release(servers[pos]);
+    for(unsigned pos = 0; pos < PAIRS; ++pos)
+        Socket::release(clients[pos]);
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    unsigned count = READS;
+    if(argc > 1)
+        count = atoi(argv[1]);
+
+    files(count);
+    echo(MESSAGES);
+    return 0;
+}
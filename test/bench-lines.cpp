@@ -0,0 +1,110 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ucommon;
+
+#define LINES   1000000
+#define BUFFER  16384
+
+// a control protocol peer sending many short replies
+class sender : public JoinableThread
+{
+public:
+    unsigned count;
+
+    sender(unsigned lines) : JoinableThread() {
+        count = lines;
+    }
+
+    void run(void) {
+        char line[64];
+        TCPBuffer peer("127.0.0.1", "9446", BUFFER);
+
+        for(unsigned pos = 0; pos < count; ++pos) {
+            size_t len = snprintf(line, sizeof(line), "250 message %u accepted\r\n", pos);
+            peer.put(line, len);
+        }
+        peer.flush();
+    }
+
+    inline void finish(void)
+        {join();}
+};
+
+static void report(const char *id, Timer::tick_t start, unsigned lines, bool ok)
+{
+    double secs = (double)(Timer::ticks() - start) / 10000000.0;
+    if(secs <= 0.0)
+        secs = 0.0000001;
+    printf("%-16s %10.0f lines/s%s\n", id, (double)lines / secs, ok ? "" : " (failed)");
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    unsigned count = LINES;
+    if(argc > 1)
+        count = atoi(argv[1]);
+
+    TCPServer listener("127.0.0.1", "9446");
+    char line[64];
+
+    for(unsigned mode = 0; mode < 4; ++mode) {
+        sender peer(count);
+        peer.start();
+        if(!listener.wait(5000))
+            return 1;
+
+        unsigned lines = 0;
+        Timer::tick_t start = Timer::ticks();
+        if(!mode) {
+            // peek and then read each line from the socket
+            socket_t so = listener.accept();
+            while(Socket::readline(so, line, sizeof(line)) > 0)
+                ++lines;
+            Socket::release(so);
+            report("peek readline", start, lines, lines == count);
+        }
+        else {
+            TCPBuffer session(&listener, BUFFER);
+            size_t size;
+            switch(mode) {
+            case 1:
+                // as a character protocol, one character at a time
+                while(((CharacterProtocol&)session).getline(line, sizeof(line)) > 0)
+                    ++lines;
+                report("getchar getline", start, lines, lines == count);
+                break;
+            case 2:
+                while(session.getline(line, sizeof(line)) > 0)
+                    ++lines;
+                report("buffer getline", start, lines, lines == count);
+                break;
+            default:
+                while(session.nextline(size))
+                    ++lines;
+                report("nextline", start, lines, lines == count);
+            }
+        }
+        peer.finish();
+    }
+    return 0;
+}
@@ -0,0 +1,212 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ucommon;
+
+#define SESSIONS    1000000
+#define LOOKUPS     1000000
+#define TABLE       65536
+#define TAGS        100000
+
+// a session filed by call-id, by from-tag, and by expiry time
+class session : public MultiIndex::member
+{
+public:
+    char callid[24], tag[16];
+    int64_t expires;
+
+    MultiIndex::key keyof(unsigned path) const {
+        switch(path) {
+        case 0:
+            return MultiIndex::key(callid);
+        case 1:
+            return MultiIndex::key(tag);
+        default:
+            return MultiIndex::key(expires);
+        }
+    }
+};
+
+// the same session kept on hand-rolled hash chains of fixed tables
+class mapped : public MultiMap
+{
+public:
+    char callid[24], tag[16];
+    int64_t expires;
+
+    inline mapped() : MultiMap(2) {}
+};
+
+static double elapsed(Timer::tick_t start)
+{
+    double secs = (double)(Timer::ticks() - start) / 10000000.0;
+    if(secs <= 0.0)
+        secs = 0.0000001;
+    return secs;
+}
+
+static void report(const char *id, unsigned ops, Timer::tick_t start, bool ok)
+{
+    printf("%-16s %10.0f ops/s%s\n", id, (double)ops / elapsed(start), ok ? "" : " (failed)");
+}
+
+static inline unsigned scramble(unsigned pos, unsigned range)
+{
+    return (unsigned)(((uint64_t)pos * 2654435761u) % range);
+}
+
+static inline void callid(char *buf, unsigned pos)
+{
+    snprintf(buf, 24, "%08x@host.example", pos * 2654435761u);
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    unsigned count = SESSIONS;
+    if(argc > 1)
+        count = atoi(argv[1]);
+
+    char id[24];
+    unsigned tags = count < TAGS ? count : TAGS;
+
+    printf("%u live sessions\n", count);
+
+    multiindex<session> index(3);
+    index.setPath(0, MultiIndex::HASHED | MultiIndex::UNIQUE);
+    index.setPath(2, MultiIndex::ORDERED);
+
+    Timer::tick_t start = Timer::ticks();
+    bool ok = true;
+    for(unsigned pos = 0; pos < count; ++pos) {
+        session *s = new session;
+        callid(s->callid, pos);
+        snprintf(s->tag, sizeof(s->tag), "tag%u", pos % tags);
+        s->expires = scramble(pos, count);
+        if(!index.add(s))
+            ok = false;
+    }
+    report("index add", count, start, ok && index.count() == count);
+
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < LOOKUPS; ++pos) {
+        unsigned which = scramble(pos + 7, count);
+        callid(id, which);
+        session *s = index.find(0, id);
+        if(!s || s->expires != scramble(which, count))
+            ok = false;
+    }
+    report("index callid", LOOKUPS, start, ok);
+
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < LOOKUPS; ++pos) {
+        snprintf(id, sizeof(id), "tag%u", pos % tags);
+        if(!index.find(1, id))
+            ok = false;
+    }
+    report("index tag", LOOKUPS, start, ok);
+
+    // refresh pushes half the sessions to a later expiry and refiles them
+    unsigned refresh = count / 2;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < refresh; ++pos) {
+        callid(id, pos);
+        session *s = index.find(0, id);
+        s->expires += count;
+        if(!index.update(s))
+            ok = false;
+    }
+    report("index refresh", refresh, start, ok);
+
+    // expire the oldest tenth, in order, without visiting the rest
+    unsigned expired = 0;
+    int64_t limit = count / 10;
+    start = Timer::ticks();
+    multiindex<session>::iterator ptr = index.begin(2);
+    while(ptr && MultiIndex::before(*ptr, 2, limit)) {
+        index.remove(*ptr);
+        ptr = index.begin(2);
+        ++expired;
+    }
+    report("index expire", expired, start, expired > 0 && index.count() == count - expired);
+
+    start = Timer::ticks();
+    unsigned left = index.count();
+    index.clear();
+    report("index clear", left, start, index.count() == 0);
+
+    // fixed tables with chains, as parallel keymaps are kept today
+    MultiMap **table = new MultiMap *[TABLE * 2];
+    memset(table, 0, sizeof(MultiMap *) * TABLE * 2);
+    mapped **list = new mapped *[count];
+
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < count; ++pos) {
+        mapped *s = list[pos] = new mapped;
+        callid(s->callid, pos);
+        snprintf(s->tag, sizeof(s->tag), "tag%u", pos % tags);
+        s->expires = scramble(pos, count);
+        s->enlist(0, table, s->callid, TABLE);
+        s->enlist(1, table + TABLE, s->tag, TABLE);
+    }
+    report("multimap add", count, start, true);
+
+    unsigned lookups = LOOKUPS / 10;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < lookups; ++pos) {
+        unsigned which = scramble(pos + 7, count);
+        callid(id, which);
+        mapped *s = static_cast<mapped *>(MultiMap::find(0, table, id, TABLE));
+        if(!s || s->expires != scramble(which, count))
+            ok = false;
+    }
+    report("multimap callid", lookups, start, ok);
+
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < lookups; ++pos) {
+        snprintf(id, sizeof(id), "tag%u", pos % tags);
+        if(!MultiMap::find(1, table + TABLE, id, TABLE))
+            ok = false;
+    }
+    report("multimap tag", lookups, start, ok);
+
+    for(unsigned pos = 0; pos < refresh; ++pos)
+        list[pos]->expires += count;
+
+    // without an ordered key, expiry visits every session
+    expired = 0;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < count; ++pos) {
+        if(list[pos] && list[pos]->expires < limit) {
+            delete list[pos];
+            list[pos] = NULL;
+            ++expired;
+        }
+    }
+    report("multimap expire", expired, start, expired > 0);
+
+    for(unsigned pos = 0; pos < count; ++pos)
+        delete list[pos];
+    delete[] list;
+    delete[] table;
+    return 0;
+}
@@ -0,0 +1,285 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ucommon;
+
+#define ENTRIES     1000000
+#define NAMED       100000
+#define LOOKUPS     1000000
+#define SCANS       1000
+#define SPAN        100
+
+class counted : public CountedObject
+{
+public:
+    inline counted(unsigned v) : CountedObject() {value = v;}
+
+    unsigned value;
+};
+
+class member : public NamedObject
+{
+public:
+    inline member(OrderedIndex *list, char *id, unsigned v) : NamedObject(list, id) {value = v;}
+
+    unsigned value;
+};
+
+class branch : public treemap<unsigned>
+{
+public:
+    inline branch(treemap<unsigned> *parent, char *id, unsigned v) : treemap<unsigned>(parent, id) {value = v;}
+};
+
+// a short name held in the key array rather than behind a pointer
+class keyname
+{
+public:
+    char text[12];
+
+    inline keyname() {text[0] = 0;}
+    inline keyname(const char *id) {String::set(text, sizeof(text), id);}
+
+    inline bool operator<(const keyname& other) const
+        {return strcmp(text, other.text) < 0;}
+};
+
+static double elapsed(Timer::tick_t start)
+{
+    double secs = (double)(Timer::ticks() - start) / 10000000.0;
+    if(secs <= 0.0)
+        secs = 0.0000001;
+    return secs;
+}
+
+static void report(const char *id, unsigned ops, Timer::tick_t start, bool ok)
+{
+    printf("%-16s %10.0f ops/s%s\n", id, (double)ops / elapsed(start), ok ? "" : " (failed)");
+}
+
+static inline unsigned scramble(unsigned pos, unsigned range)
+{
+    return (unsigned)(((uint64_t)pos * 2654435761u) % range);
+}
+
+static inline void named(char *buf, unsigned value)
+{
+    snprintf(buf, 12, "n%08u", value);
+}
+
+template <class M>
+static void numbers(const char *id, M& map, unsigned entries, bool ordered)
+{
+    char label[32];
+    unsigned *keys = new unsigned[entries];
+    for(unsigned pos = 0; pos < entries; ++pos)
+        keys[pos] = ordered ? pos : scramble(pos, entries);
+
+    Timer::tick_t start = Timer::ticks();
+    for(unsigned pos = 0; pos < entries; ++pos)
+        map.add(keys[pos], new counted(keys[pos]));
+    snprintf(label, sizeof(label), "%s insert", id);
+    report(label, entries, start, map.count() == entries);
+
+    bool ok = true;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < LOOKUPS; ++pos) {
+        unsigned key = scramble(pos + 17, entries);
+        counted *obj = map.find(key);
+        if(!obj || obj->value != key)
+            ok = false;
+    }
+    snprintf(label, sizeof(label), "%s lookup", id);
+    report(label, LOOKUPS, start, ok);
+
+    unsigned total = 0;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < SCANS * 10; ++pos) {
+        typename M::iterator ptr = map.from(scramble(pos, entries - SPAN));
+        for(unsigned count = 0; ptr && count < SPAN; ++count) {
+            total += ptr->value;
+            ++ptr;
+        }
+    }
+    snprintf(label, sizeof(label), "%s scan", id);
+    report(label, SCANS * 10 * SPAN, start, total > 0);
+
+    map.clear();
+    delete[] keys;
+}
+
+template <class M>
+static void names(const char *id, M& map, unsigned entries)
+{
+    char label[32], name[12];
+
+    Timer::tick_t start = Timer::ticks();
+    for(unsigned pos = 0; pos < entries; ++pos) {
+        unsigned value = scramble(pos, entries);
+        named(name, value);
+        map.add(keyname(name), new counted(value));
+    }
+    snprintf(label, sizeof(label), "%s insert", id);
+    report(label, entries, start, map.count() == entries);
+
+    bool ok = true;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < LOOKUPS; ++pos) {
+        unsigned value = scramble(pos + 17, entries);
+        named(name, value);
+        counted *obj = map.find(keyname(name));
+        if(!obj || obj->value != value)
+            ok = false;
+    }
+    snprintf(label, sizeof(label), "%s lookup", id);
+    report(label, LOOKUPS, start, ok);
+
+    unsigned total = 0;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < SCANS; ++pos) {
+        named(name, scramble(pos, entries - SPAN));
+        typename M::iterator ptr = map.from(keyname(name));
+        for(unsigned count = 0; ptr && count < SPAN; ++count) {
+            total += ptr->value;
+            ++ptr;
+        }
+    }
+    snprintf(label, sizeof(label), "%s scan", id);
+    report(label, SCANS * SPAN, start, total > 0);
+    map.clear();
+}
+
+// an ordered scan of linked objects must sort them first
+static unsigned scan(NamedObject **list, unsigned entries, unsigned from)
+{
+    char name[12];
+    named(name, from);
+    unsigned low = 0, high = entries, total = 0;
+    while(low < high) {
+        unsigned mid = (low + high) / 2;
+        if(strcmp(list[mid]->getId(), name) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    for(unsigned count = 0; low < entries && count < SPAN; ++count)
+        total += static_cast<member *>(list[low++])->value;
+    return total;
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    unsigned entries = ENTRIES, named_entries = NAMED;
+    if(argc > 1)
+        entries = named_entries = atoi(argv[1]);
+
+    char name[12];
+
+    printf("%u unsigned keys\n", entries);
+    btreemap<unsigned, counted> btree;
+    numbers("btree", btree, entries, false);
+    sortedmap<unsigned, counted> sorted(entries);
+    numbers("sorted", sorted, entries, true);
+
+    printf("%u named keys\n", named_entries);
+    btreemap<keyname, counted> nbtree;
+    names("btree", nbtree, named_entries);
+    sortedmap<keyname, counted> nsorted;
+    names("sorted", nsorted, named_entries);
+
+    // keylist, a linked list searched by name, and checked for duplicate
+    // names on each insert, so it is only filled to a tenth the size
+    keylist<member> list;
+    unsigned listed = named_entries / 10;
+    printf("%u named keys in keylist\n", listed);
+    Timer::tick_t start = Timer::ticks();
+    for(unsigned pos = 0; pos < listed; ++pos) {
+        unsigned value = scramble(pos, listed);
+        named(name, value);
+        new member(&list, strdup(name), value);
+    }
+    report("keylist insert", listed, start, true);
+
+    bool ok = true;
+    unsigned lookups = LOOKUPS / 1000;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < lookups; ++pos) {
+        unsigned value = scramble(pos + 17, listed);
+        named(name, value);
+        member *obj = list.find(name);
+        if(!obj || obj->value != value)
+            ok = false;
+    }
+    report("keylist lookup", lookups, start, ok);
+
+    unsigned total = 0;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < SCANS / 100; ++pos) {
+        NamedObject **index = NamedObject::sort(reinterpret_cast<NamedObject **>(list.OrderedIndex::index()));
+        total += scan(index, listed, scramble(pos, listed - SPAN));
+        delete[] index;
+    }
+    report("keylist scan", SCANS / 100 * SPAN, start, total > 0);
+
+    // treemap, children of one node found by name through its index
+    treemap<unsigned> root;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < named_entries; ++pos) {
+        unsigned value = scramble(pos, named_entries);
+        named(name, value);
+        new branch(&root, strdup(name), value);
+    }
+    report("treemap insert", named_entries, start, true);
+
+    ok = true;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < LOOKUPS; ++pos) {
+        unsigned value = scramble(pos + 17, named_entries);
+        named(name, value);
+        treemap<unsigned> *node = root.getChild(name);
+        if(!node || node->get() != value)
+            ok = false;
+    }
+    report("treemap lookup", LOOKUPS, start, ok);
+
+    total = 0;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < SCANS / 100; ++pos) {
+        NamedObject **index = NamedObject::sort(reinterpret_cast<NamedObject **>(root.getIndex()->index()));
+        unsigned low = 0, high = named_entries, from = scramble(pos, named_entries - SPAN);
+        named(name, from);
+        while(low < high) {
+            unsigned mid = (low + high) / 2;
+            if(strcmp(index[mid]->getId(), name) < 0)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        for(unsigned count = 0; low < named_entries && count < SPAN; ++count)
+            total += static_cast<treemap<unsigned> *>(index[low++])->get();
+        delete[] index;
+    }
+    report("treemap scan", SCANS / 100 * SPAN, start, total > 0);
+
+    return 0;
+}
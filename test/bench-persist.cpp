@@ -0,0 +1,205 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef UCOMMON_SYSRUNTIME
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+
+using namespace ucommon;
+
+#define ELEMENTS 10000000
+#define RECORDS  100000
+
+class benchRecord : public PersistObject
+{
+    DECLARE_PERSISTENCE(benchRecord)
+
+public:
+    int32_t id;
+    std::string name;
+    std::vector<int32_t> values;
+
+    bool write(PersistEngine& ar) const {
+        ar << id << name << values;
+        return true;
+    }
+
+    bool read(PersistEngine& ar) {
+        ar >> id >> name >> values;
+        return true;
+    }
+};
+
+IMPLEMENT_PERSISTENCE(benchRecord, "ucommon::benchRecord")
+
+static void report(const char *id, Timer::tick_t start, size_t bytes, bool ok)
+{
+    double secs = (double)(Timer::ticks() - start) / 10000000.0;
+    if(secs <= 0.0)
+        secs = 0.0000001;
+    printf("%-16s %10.1f MB/s%s\n", id, (double)bytes / secs / 1048576.0, ok ? "" : " (failed)");
+}
+
+static void elapsed(const char *id, Timer::tick_t start, unsigned objects)
+{
+    printf("%-16s %10.1f ms %8u objects\n", id, (double)(Timer::ticks() - start) / 10000.0, objects);
+}
+
+static std::fstream *create(const char *path, std::ios::openmode mode)
+{
+    return new std::fstream(path, mode | std::ios::binary);
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    uint32_t count = ELEMENTS;
+    if(argc > 1)
+        count = atoi(argv[1]);
+
+    std::vector<int32_t> data(count), copy;
+    for(uint32_t pos = 0; pos < count; ++pos)
+        data[pos] = (int32_t)(pos * 2654435761u);
+
+    size_t bytes = (size_t)count * sizeof(int32_t);
+    Timer::tick_t start;
+
+    // one stream operation per element, as the engine used to do
+    start = Timer::ticks();
+    std::fstream *fs = create("bench.dat", std::ios::out | std::ios::trunc);
+    fs->write((const char *)&count, sizeof(count));
+    for(uint32_t pos = 0; pos < count; ++pos)
+        fs->write((const char *)&data[pos], sizeof(int32_t));
+    delete fs;
+    report("stream write", start, bytes, true);
+
+    start = Timer::ticks();
+    fs = create("bench.dat", std::ios::in);
+    uint32_t size = 0;
+    fs->read((char *)&size, sizeof(size));
+    copy.resize(size);
+    for(uint32_t pos = 0; pos < size; ++pos)
+        fs->read((char *)&copy[pos], sizeof(int32_t));
+    delete fs;
+    report("stream read", start, bytes, copy == data);
+
+    start = Timer::ticks();
+    fs = create("bench.dat", std::ios::out | std::ios::trunc);
+    {
+        PersistEngine ar(*fs, PersistEngine::modeWrite);
+        ar << count;
+        for(uint32_t pos = 0; pos < count; ++pos)
+            ar << data[pos];
+    }
+    delete fs;
+    report("element write", start, bytes, true);
+
+    start = Timer::ticks();
+    fs = create("bench.dat", std::ios::out | std::ios::trunc);
+    {
+        PersistEngine ar(*fs, PersistEngine::modeWrite);
+        ar << data;
+    }
+    delete fs;
+    report("bulk write", start, bytes, true);
+
+    copy.clear();
+    start = Timer::ticks();
+    fs = create("bench.dat", std::ios::in);
+    {
+        PersistEngine ar(*fs, PersistEngine::modeRead);
+        ar >> size;
+        copy.resize(size);
+        for(uint32_t pos = 0; pos < size; ++pos)
+            ar >> copy[pos];
+    }
+    delete fs;
+    report("element read", start, bytes, copy == data);
+
+    copy.clear();
+    start = Timer::ticks();
+    fs = create("bench.dat", std::ios::in);
+    {
+        PersistEngine ar(*fs, PersistEngine::modeRead);
+        ar >> copy;
+    }
+    delete fs;
+    report("bulk read", start, bytes, copy == data);
+
+    copy.clear();
+    start = Timer::ticks();
+    {
+        PersistEngine ar("bench.dat");
+        ar >> copy;
+    }
+    report("mapped read", start, bytes, copy == data);
+
+    // restoring a snapshot, in whole or in part
+    unsigned records = RECORDS;
+    benchRecord *snapshot = new benchRecord[records];
+    for(unsigned pos = 0; pos < records; ++pos) {
+        snapshot[pos].id = (int32_t)pos;
+        snapshot[pos].name = "record";
+        snapshot[pos].values.assign(64, (int32_t)pos);
+    }
+
+    for(unsigned indexed = 0; indexed < 2; ++indexed) {
+        fs = create("bench.dat", std::ios::out | std::ios::trunc);
+        {
+            PersistEngine ar(*fs, PersistEngine::modeWrite, indexed != 0);
+            for(unsigned pos = 0; pos < records; ++pos)
+                ar << (PersistObject *)&snapshot[pos];
+        }
+        delete fs;
+
+        start = Timer::ticks();
+        {
+            PersistEngine ar("bench.dat");
+            for(unsigned pos = 0; pos < records; ++pos) {
+                PersistObject *obj = NULL;
+                ar >> obj;
+                delete obj;
+            }
+        }
+        elapsed(indexed ? "indexed all" : "restore all", start, records);
+    }
+
+    // touch one record in a hundred of the indexed snapshot
+    unsigned used = 0;
+    start = Timer::ticks();
+    {
+        PersistEngine ar("bench.dat");
+        for(unsigned pos = 0; pos < records; pos += 100, ++used)
+            delete ar.load(pos);
+    }
+    elapsed("indexed 1%", start, used);
+
+    delete[] snapshot;
+    remove("bench.dat");
+    return 0;
+}
+
+#else
+
+int main(int argc, char **argv)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,104 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ucommon;
+
+#define OPERATIONS  100000
+#define BUFFER      16384
+
+// a stand-in for a key value server answering each request with a line
+class server : public JoinableThread
+{
+public:
+    TCPServer *listener;
+    unsigned count;
+
+    server(TCPServer *from) : JoinableThread() {
+        listener = from;
+        count = 0;
+    }
+
+    void run(void) {
+        TCPBuffer session(listener, BUFFER);
+        const char *request;
+        size_t size;
+
+        // replies are sent when the server waits for more requests
+        while(NULL != (request = session.nextreply(size, &BufferProtocol::lineframe))) {
+            if(size < 6 || strncmp(request, "GET ", 4))
+                break;
+            session.put("+OK ", 4);
+            session.put(request + 4, size - 4);
+            ++count;
+        }
+        session.flush();
+    }
+
+    inline void finish(void)
+        {join();}
+};
+
+extern "C" int main(int argc, char **argv)
+{
+    unsigned count = OPERATIONS;
+    if(argc > 1)
+        count = atoi(argv[1]);
+
+    TCPServer listener("127.0.0.1", "9447");
+    char request[64];
+
+    for(unsigned depth = 1; depth <= 128; depth *= 2) {
+        server peer(&listener);
+        peer.start();
+
+        TCPBuffer client("127.0.0.1", "9447", BUFFER);
+        unsigned batches = (count + depth - 1) / depth;
+        unsigned replies = 0;
+        bool ok = true;
+
+        Timer::tick_t start = Timer::ticks();
+        for(unsigned batch = 0; ok && batch < batches; ++batch) {
+            for(unsigned pos = 0; pos < depth; ++pos) {
+                size_t len = snprintf(request, sizeof(request), "GET key%u\r\n", batch * depth + pos);
+                client.put(request, len);
+            }
+            for(unsigned pos = 0; pos < depth; ++pos) {
+                size_t size;
+                const char *reply = client.nextreply(size, &BufferProtocol::lineframe);
+                if(!reply || strncmp(reply, "+OK key", 7)) {
+                    ok = false;
+                    break;
+                }
+                ++replies;
+            }
+        }
+        double secs = (double)(Timer::ticks() - start) / 10000000.0;
+        if(secs <= 0.0)
+            secs = 0.0000001;
+
+        client.close();
+        peer.finish();
+        printf("depth %-10u %10.0f ops/s%s\n", depth, (double)replies / secs,
+            ok && peer.count == replies ? "" : " (failed)");
+    }
+    return 0;
+}
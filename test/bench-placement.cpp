@@ -0,0 +1,150 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ucommon;
+
+#define ENTRIES     (128 * 1048576)
+#define LOOKUPS     20000000
+#define PAGE        1024
+
+static uint32_t *order;
+
+static double elapsed(Timer::tick_t start)
+{
+    double secs = (double)(Timer::ticks() - start) / 10000000.0;
+    if(secs <= 0.0)
+        secs = 0.0000001;
+    return secs;
+}
+
+// one entry in each page, on a different cache line from page to page
+static inline uint32_t slot(uint32_t page)
+{
+    return page * PAGE + (page % 64) * 16;
+}
+
+// each entry holds the index of the next, in one random cycle of pages
+static void fill(uint32_t *table, unsigned entries)
+{
+    unsigned pages = entries / PAGE;
+    memset(table, 0, entries * sizeof(uint32_t));
+    for(unsigned pos = 0; pos < pages; ++pos)
+        table[slot(order[pos])] = slot(order[(pos + 1) % pages]);
+}
+
+static void chase(const char *id, uint32_t *table, unsigned entries, double setup, double filled)
+{
+    if(!table) {
+        printf("%-16s   unavailable\n", id);
+        return;
+    }
+
+    Timer::tick_t start = Timer::ticks();
+    uint32_t index = slot(order[0]);
+    for(unsigned pos = 0; pos < LOOKUPS; ++pos)
+        index = table[index];
+    double secs = elapsed(start);
+    unsigned pages = entries / PAGE;
+
+    printf("%-16s %10.0f lookups/s %8.1f ms map %8.1f ms fill%s\n", id,
+        (double)LOOKUPS / secs, setup * 1000.0, filled * 1000.0,
+        index == slot(order[LOOKUPS % pages]) ? "" : " (failed)");
+}
+
+static void mapped(const char *id, unsigned entries, unsigned options, int node = -1)
+{
+    size_t size = entries * sizeof(uint32_t);
+    Timer::tick_t start = Timer::ticks();
+    uint32_t *table = (uint32_t *)memalloc::map(size, options, node);
+    double setup = elapsed(start);
+    start = Timer::ticks();
+    if(table)
+        fill(table, entries);
+    chase(id, table, entries, setup, elapsed(start));
+    memalloc::unmap(table, size);
+}
+
+static void shared(const char *id, unsigned entries, unsigned options)
+{
+    size_t size = entries * sizeof(uint32_t);
+    MappedMemory::remove("ucommon-bench-placement");
+    Timer::tick_t start = Timer::ticks();
+    MappedMemory *map;
+    if(options)
+        map = new MappedMemory("ucommon-bench-placement", size, options);
+    else
+        map = new MappedMemory("ucommon-bench-placement", size);
+    double setup = elapsed(start);
+    uint32_t *table = NULL;
+    start = Timer::ticks();
+    if(*map) {
+        table = (uint32_t *)map->offset(0);
+        fill(table, entries);
+    }
+    chase(id, table, entries, setup, elapsed(start));
+    delete map;
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    unsigned entries = ENTRIES;
+    if(argc > 1)
+        entries = atoi(argv[1]);
+
+    // a random order of pages, so lookups miss the tlb but rarely the cache
+    unsigned pages = entries / PAGE;
+    order = new uint32_t[pages];
+    for(unsigned pos = 0; pos < pages; ++pos)
+        order[pos] = pos;
+    srand(1);
+    for(unsigned pos = pages - 1; pos > 0; --pos) {
+        unsigned swap = (unsigned)(((uint64_t)rand() * RAND_MAX + rand()) % pos);
+        uint32_t temp = order[pos];
+        order[pos] = order[swap];
+        order[swap] = temp;
+    }
+
+    printf("table            %10.1f MB, huge pages of %u KB\n",
+        (double)entries * sizeof(uint32_t) / 1048576.0, (unsigned)(memalloc::hugepage() / 1024));
+
+    Timer::tick_t start = Timer::ticks();
+    uint32_t *table = (uint32_t *)malloc(entries * sizeof(uint32_t));
+    double setup = elapsed(start);
+    start = Timer::ticks();
+    fill(table, entries);
+    chase("malloc", table, entries, setup, elapsed(start));
+    free(table);
+
+    mapped("mapped", entries, 0);
+    mapped("prefault", entries, memalloc::PREFAULT);
+    mapped("transparent", entries, memalloc::TRANSPARENT);
+    mapped("hugepages", entries, memalloc::HUGEPAGES | memalloc::PREFAULT);
+    mapped("locked", entries, memalloc::LOCKED | memalloc::PREFAULT);
+    mapped("numa node 0", entries, memalloc::TRANSPARENT | memalloc::PREFAULT, 0);
+
+    shared("shared", entries, 0);
+    shared("shared huge", entries, memalloc::HUGEPAGES | memalloc::PREFAULT);
+
+    delete[] order;
+    return 0;
+}
@@ -0,0 +1,144 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef UCOMMON_SYSRUNTIME
+#include <ucommon/ucommon.h>
+#include <commoncpp/thread.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ost;
+
+#define THREADS     4
+#define MESSAGES    250000
+#define RECORD      64
+
+class benchQueue : public ThreadQueue
+{
+public:
+    volatile unsigned long count;
+    volatile unsigned long batches;
+
+    benchQueue() : ThreadQueue(NULL, 0, 0) {
+        count = batches = 0;
+    }
+
+    benchQueue(size_t size, Overflow mode) : ThreadQueue(NULL, 0, 0, size, mode) {
+        count = batches = 0;
+    }
+
+    ~benchQueue() {
+        stop();
+    }
+
+    void runQueue(void *) {
+        ++count;
+    }
+
+    void runBatch(void **, unsigned total) {
+        ++batches;
+        count += total;
+    }
+};
+
+static benchQueue *queue;
+
+class benchPoster : public Thread
+{
+public:
+    unsigned count;
+
+    benchPoster(unsigned messages) : Thread() {
+        count = messages;
+    }
+
+    void run(void) {
+        char record[RECORD];
+        memset(record, 'x', sizeof(record));
+        for(unsigned pos = 0; pos < count; ++pos)
+            queue->post(record, sizeof(record));
+    }
+};
+
+extern "C" int main(int argc, char **argv)
+{
+    unsigned threads = THREADS;
+    unsigned count = MESSAGES;
+    benchPoster *posters[THREADS * 16];
+    static const char *modes[] = {"list", "ring block", "ring drop", "ring overwrite"};
+
+    if(argc > 1)
+        count = atoi(argv[1]);
+
+    if(argc > 2)
+        threads = atoi(argv[2]);
+
+    if(threads > THREADS * 16)
+        threads = THREADS * 16;
+
+    for(unsigned mode = 0; mode < 4; ++mode) {
+        switch(mode) {
+        case 0:
+            queue = new benchQueue();
+            break;
+        case 1:
+            queue = new benchQueue(65536, ThreadQueue::queueBlock);
+            break;
+        case 2:
+            queue = new benchQueue(65536, ThreadQueue::queueDrop);
+            break;
+        default:
+            queue = new benchQueue(65536, ThreadQueue::queueOverwrite);
+        }
+
+        ucommon::Timer::tick_t start = ucommon::Timer::ticks();
+        for(unsigned pos = 0; pos < threads; ++pos) {
+            posters[pos] = new benchPoster(count);
+            posters[pos]->start();
+        }
+        for(unsigned pos = 0; pos < threads; ++pos) {
+            posters[pos]->join();
+            delete posters[pos];
+        }
+
+        // everything posted is run before the queue thread stops
+        unsigned long posted = (unsigned long)count * threads;
+        benchQueue *finished = queue;
+        finished->stop();
+        double secs = (double)(ucommon::Timer::ticks() - start) / 10000000.0;
+        if(secs <= 0.0)
+            secs = 0.0000001;
+
+        unsigned long dropped = finished->getDropped();
+        unsigned long batches = finished->batches;
+        bool ok = (finished->count + dropped == posted);
+        printf("%-16s %10.0f posts/s %8lu dropped %8lu batches%s\n", modes[mode],
+            (double)posted / secs, dropped, batches, ok ? "" : " (failed)");
+        delete finished;
+    }
+    return 0;
+}
+
+#else
+
+int main(int argc, char **argv)
+{
+    return 0;
+}
+
+#endif
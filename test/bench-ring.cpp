@@ -0,0 +1,171 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef _MSWINDOWS_
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace ucommon;
+
+#define MESSAGES    2000000
+#define RECORD      64
+#define WRITERS     4
+
+typedef struct {
+    unsigned writer;
+    unsigned sequence;
+    char body[RECORD - 8];
+} message_t;
+
+static void report(const char *id, Timer::tick_t start, unsigned messages, bool ok)
+{
+    double secs = (double)(Timer::ticks() - start) / 10000000.0;
+    if(secs <= 0.0)
+        secs = 0.0000001;
+    printf("%-16s %10.0f msgs/s%s\n", id, (double)messages / secs, ok ? "" : " (failed)");
+}
+
+static bool finish(unsigned writers)
+{
+    int status;
+    bool ok = true;
+    while(writers--) {
+        if(wait(&status) < 0 || !WIFEXITED(status) || WEXITSTATUS(status))
+            ok = false;
+    }
+    return ok;
+}
+
+// each writer process attaches to the ring by name
+static void writer(unsigned id, unsigned count, bool inplace)
+{
+    MappedRing ring("ucommon-bench-ring");
+    if(!ring)
+        _exit(1);
+
+    message_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.writer = id;
+    for(unsigned pos = 0; pos < count; ++pos) {
+        if(inplace) {
+            message_t *rec = (message_t *)ring.request(sizeof(message_t), Timer::inf);
+            rec->writer = id;
+            rec->sequence = pos;
+            ring.commit(rec);
+        }
+        else {
+            msg.sequence = pos;
+            ring.post(&msg, sizeof(msg), Timer::inf);
+        }
+    }
+    _exit(0);
+}
+
+static void ring(const char *id, unsigned count, unsigned writers, bool inplace)
+{
+    MappedMemory::remove("ucommon-bench-ring");
+    MappedRing ring("ucommon-bench-ring", 65536, writers > 1);
+    unsigned expected[WRITERS];
+    unsigned total = count * writers;
+    bool ok = true;
+
+    memset(expected, 0, sizeof(expected));
+    Timer::tick_t start = Timer::ticks();
+    for(unsigned pos = 0; pos < writers; ++pos) {
+        if(!fork())
+            writer(pos, count, inplace);
+    }
+
+    message_t msg;
+    for(unsigned pos = 0; pos < total; ++pos) {
+        if(inplace) {
+            size_t len;
+            const message_t *rec = (const message_t *)ring.peek(&len, Timer::inf);
+            if(len != sizeof(message_t) || rec->sequence != expected[rec->writer]++)
+                ok = false;
+            ring.next();
+        }
+        else {
+            if(ring.get(&msg, sizeof(msg), Timer::inf) != sizeof(msg) ||
+              msg.sequence != expected[msg.writer]++)
+                ok = false;
+        }
+    }
+    ok = finish(writers) && ok;
+    report(id, start, total, ok);
+}
+
+static void pipes(unsigned count)
+{
+    int fd[2];
+    message_t msg;
+    bool ok = true;
+
+    if(pipe(fd))
+        return;
+
+    Timer::tick_t start = Timer::ticks();
+    if(!fork()) {
+        ::close(fd[0]);
+        memset(&msg, 0, sizeof(msg));
+        for(unsigned pos = 0; pos < count; ++pos) {
+            msg.sequence = pos;
+            if(::write(fd[1], &msg, sizeof(msg)) != sizeof(msg))
+                _exit(1);
+        }
+        _exit(0);
+    }
+
+    ::close(fd[1]);
+    for(unsigned pos = 0; pos < count; ++pos) {
+        if(::read(fd[0], &msg, sizeof(msg)) != sizeof(msg) || msg.sequence != pos)
+            ok = false;
+    }
+    ::close(fd[0]);
+    ok = finish(1) && ok;
+    report("pipe", start, count, ok);
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    unsigned count = MESSAGES;
+    if(argc > 1)
+        count = atoi(argv[1]);
+
+    pipes(count);
+    ring("ring spsc", count, 1, false);
+    ring("ring inplace", count, 1, true);
+    ring("ring mpsc", count / WRITERS, WRITERS, false);
+    ring("mpsc inplace", count / WRITERS, WRITERS, true);
+    return 0;
+}
+
+#else
+
+int main(int argc, char **argv)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,242 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef _MSWINDOWS_
+#include <sys/wait.h>
+
+using namespace ucommon;
+
+#define BLOCKS      1000000
+#define SESSIONS    1000000
+#define HEAPSIZE    ((size_t)512 * 1048576)
+
+class session
+{
+public:
+    uint32_t id, hits;
+    mapped_pointer<session> peer;
+};
+
+class named : public NamedObject
+{
+public:
+    inline named() : NamedObject() {id = hits = 0;}
+
+    uint32_t id, hits;
+};
+
+static void **blocks;
+
+static double elapsed(Timer::tick_t start)
+{
+    double secs = (double)(Timer::ticks() - start) / 10000000.0;
+    if(secs <= 0.0)
+        secs = 0.0000001;
+    return secs;
+}
+
+static inline size_t sized(unsigned pos)
+{
+    return 16 + ((pos * 2654435761u) >> 20) % 240;
+}
+
+static void report(const char *id, unsigned ops, double secs, bool ok)
+{
+    printf("%-16s %10.0f ops/s%s\n", id, (double)ops / secs, ok ? "" : " (failed)");
+}
+
+static inline void keyed(char *buf, size_t size, unsigned pos)
+{
+    snprintf(buf, size, "session-%08x", pos * 2654435761u);
+}
+
+// allocate every block, free every other one, and allocate those again
+static void churn(const char *id, MappedHeap *heap, unsigned count)
+{
+    Timer::tick_t start = Timer::ticks();
+    bool ok = true;
+    for(unsigned pos = 0; pos < count; ++pos)
+        blocks[pos] = heap ? heap->alloc(sized(pos)) : malloc(sized(pos));
+    for(unsigned pos = 0; pos < count; pos += 2) {
+        if(heap)
+            heap->free(blocks[pos]);
+        else
+            free(blocks[pos]);
+    }
+    for(unsigned pos = 0; pos < count; pos += 2) {
+        blocks[pos] = heap ? heap->alloc(sized(pos)) : malloc(sized(pos));
+        if(!blocks[pos])
+            ok = false;
+    }
+    for(unsigned pos = 0; pos < count; ++pos) {
+        if(heap)
+            heap->free(blocks[pos]);
+        else
+            free(blocks[pos]);
+    }
+    report(id, count * 3, elapsed(start), ok);
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    unsigned count = SESSIONS;
+    if(argc > 1)
+        count = atoi(argv[1]);
+
+    char key[32];
+    blocks = new void *[BLOCKS];
+
+    churn("malloc", NULL, BLOCKS);
+
+    MappedMemory::remove("ucommon-bench-shared");
+    MappedHeap *heap = new MappedHeap("ucommon-bench-shared", HEAPSIZE);
+    if(!*heap) {
+        printf("%-16s   unavailable\n", "shared heap");
+        return 0;
+    }
+
+    churn("shared heap", heap, BLOCKS);
+    size_t top = heap->arena()->inuse();
+
+    // the bump allocator cannot reuse, so only first allocation compares
+    MappedMemory *bump = new MappedMemory("ucommon-bench-sbrk", HEAPSIZE);
+    Timer::tick_t start = Timer::ticks();
+    for(unsigned pos = 0; pos < BLOCKS; ++pos)
+        blocks[pos] = bump->sbrk((sized(pos) + 7) & ~7);
+    report("sbrk (no free)", BLOCKS, elapsed(start), blocks[BLOCKS - 1] != NULL);
+    delete bump;
+
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < BLOCKS; ++pos)
+        blocks[pos] = heap->alloc(sized(pos));
+    report("shared alloc", BLOCKS, elapsed(start), blocks[BLOCKS - 1] != NULL && top == 0);
+    for(unsigned pos = 0; pos < BLOCKS; ++pos)
+        heap->free(blocks[pos]);
+
+    // a session table in process memory and in the shared heap
+    hashmap<named> local;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < count; ++pos) {
+        keyed(key, sizeof(key), pos);
+        named *item = new named;
+        item->id = pos;
+        local.add(strdup(key), item);
+    }
+    report("local insert", count, elapsed(start), local.count() == count);
+
+    bool ok = true;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < count; ++pos) {
+        keyed(key, sizeof(key), pos);
+        named *item = local.get(key);
+        if(!item || item->id != pos)
+            ok = false;
+        else
+            ++item->hits;
+    }
+    report("local find", count, elapsed(start), ok);
+
+    mapped_hashmap<session> *table = mapped_hashmap<session>::create(heap->arena());
+    heap->arena()->root(table);
+    session *prior = NULL;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < count; ++pos) {
+        keyed(key, sizeof(key), pos);
+        session *item = table->add(key);
+        if(!item)
+            break;
+        item->id = pos;
+        item->peer = prior;
+        prior = item;
+    }
+    report("shared insert", count, elapsed(start), table->count() == count);
+
+    ok = true;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < count; ++pos) {
+        keyed(key, sizeof(key), pos);
+        session *item = table->get(key);
+        if(!item || item->id != pos)
+            ok = false;
+        else
+            ++item->hits;
+    }
+    report("shared find", count, elapsed(start), ok);
+
+    // workers attach by name, and update sessions in place under the lock
+    unsigned workers = 4;
+    start = Timer::ticks();
+    for(unsigned worker = 0; worker < workers; ++worker) {
+        if(fork())
+            continue;
+        MappedHeap attached("ucommon-bench-shared");
+        mapped_hashmap<session> *shared = (mapped_hashmap<session> *)attached->root();
+        unsigned failed = 0;
+        for(unsigned pos = worker; pos < count; pos += workers) {
+            keyed(key, sizeof(key), pos);
+            shared->lock();
+            session *item = shared->get(key);
+            if(!item || item->id != pos || (pos && item->peer->id != pos - 1))
+                ++failed;
+            else
+                ++item->hits;
+            shared->unlock();
+        }
+        _exit(failed ? 1 : 0);
+    }
+
+    ok = true;
+    for(unsigned worker = 0; worker < workers; ++worker) {
+        int status = 0;
+        wait(&status);
+        if(!WIFEXITED(status) || WEXITSTATUS(status))
+            ok = false;
+    }
+    double secs = elapsed(start);
+    for(unsigned pos = 0; ok && pos < count; ++pos) {
+        keyed(key, sizeof(key), pos);
+        if(table->get(key)->hits != 2)
+            ok = false;
+    }
+    report("worker update", count, secs, ok);
+
+    printf("%-16s %10.1f MB for %u sessions\n", "shared inuse",
+        (double)heap->arena()->inuse() / 1048576.0, count);
+
+    start = Timer::ticks();
+    table->destroy();
+    report("shared destroy", count, elapsed(start), heap->arena()->inuse() == 0);
+
+    delete heap;
+    delete[] blocks;
+    return 0;
+}
+
+#else
+
+extern "C" int main()
+{
+    return 0;
+}
+
+#endif
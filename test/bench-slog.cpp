@@ -0,0 +1,109 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef UCOMMON_SYSRUNTIME
+#include <ucommon/ucommon.h>
+#include <commoncpp/slog.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ost;
+
+#define THREADS     4
+#define EVENTS      250000
+
+class benchTracer : public Thread
+{
+public:
+    unsigned count;
+    bool binary;
+
+    benchTracer(unsigned events, bool mode) : Thread() {
+        count = events;
+        binary = mode;
+    }
+
+    void run(void) {
+        if(binary) {
+            for(unsigned pos = 0; pos < count; ++pos)
+                slog.trace(Slog::levelInfo, "request %u from %s took %.3f ms\n", pos, "client", pos * 0.001);
+        }
+        else {
+            for(unsigned pos = 0; pos < count; ++pos)
+                slog.info("request %u from %s took %.3f ms\n", pos, "client", pos * 0.001);
+        }
+    }
+};
+
+extern "C" int main(int argc, char **argv)
+{
+    unsigned threads = THREADS;
+    unsigned count = EVENTS;
+    benchTracer *tracers[THREADS * 16];
+
+    if(argc > 1)
+        count = atoi(argv[1]);
+
+    if(argc > 2)
+        threads = atoi(argv[2]);
+
+    if(threads > THREADS * 16)
+        threads = THREADS * 16;
+
+    slog.open("bench", Slog::classUser);
+    slog.clogEnable(false);
+    slog.level(Slog::levelDebug);
+
+    for(unsigned mode = 0; mode < 2; ++mode) {
+        if(mode && !slog.traceOpen("bench.trc", (size_t)count * threads * 64 + 16777216)) {
+            printf("trace            cannot create bench.trc\n");
+            break;
+        }
+
+        ucommon::Timer::tick_t start = ucommon::Timer::ticks();
+        for(unsigned pos = 0; pos < threads; ++pos) {
+            tracers[pos] = new benchTracer(count, mode != 0);
+            tracers[pos]->start();
+        }
+        for(unsigned pos = 0; pos < threads; ++pos) {
+            tracers[pos]->join();
+            delete tracers[pos];
+        }
+        if(mode)
+            slog.traceClose();
+
+        double secs = (double)(ucommon::Timer::ticks() - start) / 10000000.0;
+        if(secs <= 0.0)
+            secs = 0.0000001;
+        double events = (double)count * threads;
+        printf("%-16s %10.0f events/s %8.1f ns/event\n", mode ? "trace" : "syslog",
+            events / secs, secs * 1000000000.0 / events);
+    }
+
+    slog.close();
+    return 0;
+}
+
+#else
+
+int main(int argc, char **argv)
+{
+    return 0;
+}
+
+#endif
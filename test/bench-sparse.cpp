@@ -0,0 +1,206 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef UCOMMON_SYSRUNTIME
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sstream>
+
+using namespace ucommon;
+
+#define RANGE       100000000
+#define IDS         1000000
+#define LOOKUPS     10000000
+
+static double elapsed(Timer::tick_t start)
+{
+    double secs = (double)(Timer::ticks() - start) / 10000000.0;
+    if(secs <= 0.0)
+        secs = 0.0000001;
+    return secs;
+}
+
+static void report(const char *id, double ops, Timer::tick_t start, bool ok)
+{
+    printf("%-16s %10.0f ops/s%s\n", id, ops / elapsed(start), ok ? "" : " (failed)");
+}
+
+static void memory(const char *id, size_t bytes)
+{
+    printf("%-16s %10.2f MB\n", id, (double)bytes / 1048576.0);
+}
+
+static inline uint32_t scatter(uint32_t pos, uint32_t range)
+{
+    return (uint32_t)(((uint64_t)pos * 2654435761u) % range);
+}
+
+// the dense set operations callers had to write for themselves
+static void dense(uint64_t *target, const uint64_t *from, size_t words, unsigned op)
+{
+    for(size_t pos = 0; pos < words; ++pos) {
+        switch(op) {
+        case 0:
+            target[pos] |= from[pos];
+            break;
+        case 1:
+            target[pos] &= from[pos];
+            break;
+        default:
+            target[pos] &= ~from[pos];
+        }
+    }
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    uint32_t range = RANGE;
+    uint32_t count = IDS;
+    if(argc > 1)
+        range = atoi(argv[1]);
+    if(argc > 2)
+        count = atoi(argv[2]);
+
+    size_t words = (range + 63) / 64;
+    uint64_t *dense1 = new uint64_t[words];
+    uint64_t *dense2 = new uint64_t[words];
+    bitmap map1(dense1, range, bitmap::B64), map2(dense2, range, bitmap::B64);
+    sparse_bitmap set1, set2;
+    Timer::tick_t start;
+    size_t total = 0;
+
+    printf("%u ids over %u\n", count, range);
+
+    // subscribers scattered over the whole id range
+    start = Timer::ticks();
+    map1.clear();
+    for(uint32_t pos = 0; pos < count; ++pos)
+        map1.set(scatter(pos, range), true);
+    report("dense set", count, start, true);
+
+    start = Timer::ticks();
+    for(uint32_t pos = 0; pos < count; ++pos)
+        set1.set(scatter(pos, range), true);
+    report("sparse set", count, start, set1.count() == map1.count());
+
+    memory("dense memory", words * sizeof(uint64_t));
+    memory("sparse memory", set1.memory());
+    set1.optimize();
+    memory("sparse optimized", set1.memory());
+
+    start = Timer::ticks();
+    for(uint32_t pos = 0; pos < LOOKUPS; ++pos) {
+        if(map1.get(scatter(pos * 3, range)))
+            ++total;
+    }
+    report("dense get", LOOKUPS, start, true);
+
+    size_t found = 0;
+    start = Timer::ticks();
+    for(uint32_t pos = 0; pos < LOOKUPS; ++pos) {
+        if(set1.get(scatter(pos * 3, range)))
+            ++found;
+    }
+    report("sparse get", LOOKUPS, start, found == total);
+
+    start = Timer::ticks();
+    total = 0;
+    for(bitmap::iterator id(map1); id; ++id)
+        ++total;
+    report("dense iterate", total, start, total == count);
+
+    start = Timer::ticks();
+    found = 0;
+    for(sparse_bitmap::iterator id(set1); id; ++id)
+        ++found;
+    report("sparse iterate", found, start, found == count);
+
+    // a second population overlapping the first, and a block of ranges
+    map2.clear();
+    for(uint32_t pos = count / 2; pos < count + count / 2; ++pos) {
+        map2.set(scatter(pos, range), true);
+        set2.set(scatter(pos, range), true);
+    }
+    for(uint32_t block = 0; block < 16; ++block) {
+        map2.set(block * (range / 16), 100000, true);
+        set2.set(block * (range / 16), 100000, true);
+    }
+    set2.optimize();
+
+    static const char *ops[] = {"union", "intersect", "difference"};
+    char id[32];
+    for(unsigned op = 0; op < 3; ++op) {
+        uint64_t *work = new uint64_t[words];
+        memcpy(work, dense1, words * sizeof(uint64_t));
+        start = Timer::ticks();
+        dense(work, dense2, words, op);
+        snprintf(id, sizeof(id), "dense %s", ops[op]);
+        report(id, range, start, true);
+        bitmap result(work, range, bitmap::B64);
+        total = result.count();
+        delete[] work;
+
+        sparse_bitmap set(set1);
+        start = Timer::ticks();
+        switch(op) {
+        case 0:
+            set |= set2;
+            break;
+        case 1:
+            set &= set2;
+            break;
+        default:
+            set -= set2;
+        }
+        snprintf(id, sizeof(id), "sparse %s", ops[op]);
+        report(id, range, start, set.count() == total);
+    }
+
+    std::stringstream out(std::ios::in | std::ios::out | std::ios::binary);
+    start = Timer::ticks();
+    {
+        PersistEngine ar(out, PersistEngine::modeWrite);
+        ar << set1;
+    }
+    report("sparse save", count, start, true);
+    std::string saved = out.str();
+    memory("sparse archive", saved.size());
+
+    sparse_bitmap copy;
+    start = Timer::ticks();
+    {
+        PersistEngine ar((const uint8_t *)saved.data(), saved.size());
+        ar >> copy;
+    }
+    report("sparse restore", count, start, copy.count() == set1.count());
+
+    delete[] dense1;
+    delete[] dense2;
+    return 0;
+}
+
+#else
+
+int main(int argc, char **argv)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,85 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ucommon;
+
+#define STAMPS  2000000
+
+static void report(const char *id, Timer::tick_t start, unsigned count, size_t bytes)
+{
+    double secs = (double)(Timer::ticks() - start) / 10000000.0;
+    if(secs <= 0.0)
+        secs = 0.0000001;
+    printf("%-16s %12.0f stamps/s%s\n", id, (double)count / secs, bytes ? "" : " (failed)");
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    unsigned count = STAMPS;
+    if(argc > 1)
+        count = atoi(argv[1]);
+
+    char buf[64];
+    size_t bytes = 0;
+    Timer::tick_t start;
+
+    start = Timer::ticks();
+    DateTimeString dts;
+    for(unsigned pos = 0; pos < count; ++pos) {
+        dts.set();
+        bytes += strlen(dts.c_str());
+    }
+    report("datetimestring", start, count, bytes);
+
+    // what log writers did for each record
+    bytes = 0;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < count; ++pos) {
+        struct timeval now;
+        struct tm dt;
+        gettimeofday(&now, NULL);
+        time_t sec = now.tv_sec;
+        localtime_r(&sec, &dt);
+        bytes += snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d.%03d",
+            dt.tm_year + 1900, dt.tm_mon + 1, dt.tm_mday,
+            dt.tm_hour, dt.tm_min, dt.tm_sec, (int)(now.tv_usec / 1000));
+    }
+    report("localtime", start, count, bytes);
+
+    static const char *names[] = {"stamp local", "stamp iso8601", "stamp utc", "stamp syslog"};
+    for(unsigned format = TimeStamp::LOCAL; format <= TimeStamp::SYSLOG; ++format) {
+        TimeStamp stamp((TimeStamp::format_t)format, format == TimeStamp::SYSLOG ? 0 : 3);
+        bytes = 0;
+        start = Timer::ticks();
+        for(unsigned pos = 0; pos < count; ++pos)
+            bytes += stamp.put(buf, sizeof(buf));
+        report(names[format], start, count, bytes);
+    }
+
+    bytes = 0;
+    start = Timer::ticks();
+    for(unsigned pos = 0; pos < count; ++pos)
+        bytes += TimeStamp::format(buf, sizeof(buf), TimeStamp::ISO8601, 6);
+    report("thread iso8601", start, count, bytes);
+
+    return 0;
+}
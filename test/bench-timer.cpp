@@ -0,0 +1,127 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ucommon;
+
+#define UPDATES     10000000
+#define EVENTS      64
+
+class benchEvent : public TimerQueue::event
+{
+public:
+    unsigned fired;
+
+    benchEvent(TimerQueue *tq) : TimerQueue::event(tq, 3600000) {
+        fired = 0;
+    }
+
+    void expired(void) {
+        ++fired;
+    }
+};
+
+class benchQueue : public TimerQueue
+{
+public:
+    void modify(void) {}
+    void update(void) {}
+};
+
+static const char *names[] = {"precise", "coarse", "cycles", "cached"};
+
+static void report(const char *id, Timer::clocking_t source, Timer::tick_t start, unsigned count)
+{
+    double secs = (double)(Timer::ticks() - start) / 10000000.0;
+    printf("%-10s %-8s %8.1f ns\n", id, names[source], secs * 1000000000.0 / (double)count);
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    unsigned count = UPDATES;
+    if(argc > 1)
+        count = atoi(argv[1]);
+
+    benchQueue queue;
+    benchEvent *events[EVENTS];
+    for(unsigned pos = 0; pos < EVENTS; ++pos)
+        events[pos] = new benchEvent(&queue);
+
+    for(unsigned source = Timer::PRECISE; source <= Timer::CACHED; ++source) {
+        Timer::clocking_t used = Timer::clocking((Timer::clocking_t)source);
+        if(used != (Timer::clocking_t)source) {
+            printf("%-10s %-8s unavailable\n", "timer", names[source]);
+            continue;
+        }
+
+        // re-arming a timeout per packet, as protocol stacks do
+        Timer timer;
+        timeout_t left = 0;
+        Timer::tick_t start = Timer::ticks();
+        for(unsigned pos = 0; pos < count; ++pos) {
+            timer.set((timeout_t)1000);
+            left += timer.get();
+        }
+        report("update", used, start, count);
+
+        // a loop refreshing its cached time once a pass over 64 timers
+        start = Timer::ticks();
+        for(unsigned pos = 0; pos < count / EVENTS; ++pos) {
+            if(used == Timer::CACHED)
+                Timer::refresh();
+            left += queue.expire();
+        }
+        report("queue", used, start, (count / EVENTS) * EVENTS);
+
+        // deadlines for timed waits
+        Conditional::clocking(used);
+        struct timespec ts;
+        start = Timer::ticks();
+        for(unsigned pos = 0; pos < count; ++pos) {
+            Conditional::set(&ts, 1000);
+            left += (timeout_t)ts.tv_nsec;
+        }
+        report("deadline", used, start, count);
+        Conditional::clocking(Timer::PRECISE);
+
+        if(!left)
+            printf("\n");
+    }
+
+    // how far each source is from the system clock
+    Timer::refresh();
+    for(unsigned source = Timer::PRECISE; source <= Timer::CACHED; ++source) {
+        Timer::clocking_t used = Timer::clocking((Timer::clocking_t)source);
+        if(used != (Timer::clocking_t)source)
+            continue;
+        Thread::sleep(50);
+        Timer::clocking(Timer::PRECISE);
+        Timer precise((timeout_t)10000);
+        Timer::clocking(used);
+        Timer other((timeout_t)10000);
+        printf("%-10s %-8s %8ld ms\n", "skew", names[source], (long)other.get() - (long)precise.get());
+    }
+    Timer::clocking(Timer::PRECISE);
+
+    for(unsigned pos = 0; pos < EVENTS; ++pos)
+        delete events[pos];
+    return 0;
+}
@@ -0,0 +1,479 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ucommon/ucommon.h>
+#include <ucommon/secure.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <poll.h>
+
+using namespace ucommon;
+
+#define CONNECTS 500
+#define CLIENTS  64
+#define BODY     ((size_t)64 * 1048576)
+
+// loopback tls handshake rate, with and without session resumption.  The
+// certificate file holds both the server certificate and private key.
+
+class server : public JoinableThread
+{
+public:
+    TCPServer *listener;
+    secure::server_t context;
+    unsigned count;
+
+    server(TCPServer *tcp, secure::server_t ctx, unsigned connects) : JoinableThread() {
+        listener = tcp;
+        context = ctx;
+        count = connects;
+    }
+
+    void run(void) {
+        char line[64];
+
+        while(count && listener->wait(5000)) {
+            SSLBuffer conn(listener, context);
+            if(conn.getline(line, sizeof(line)) > 0) {
+                conn.putline(line);
+                conn.flush();
+            }
+            --count;
+        }
+    }
+
+    inline void finish(void)
+        {join();}
+};
+
+static unsigned connects(secure::client_t context, unsigned count)
+{
+    SSLBuffer client(context);
+    unsigned secured = 0;
+    char line[64];
+
+    for(unsigned pos = 0; pos < count; ++pos) {
+        client.open("127.0.0.1", "9443");
+        if(client.is_secure()) {
+            client.putline("ping");
+            client.flush();
+            if(client.getline(line, sizeof(line)) > 0 && eq(line, "ping"))
+                ++secured;
+        }
+        client.close();
+    }
+    return secured;
+}
+
+// a non-blocking session exchanging one line
+struct session
+{
+    SSLBuffer *conn;
+    SSLBuffer::state_t state;
+    bool busy;
+    size_t got, sent;
+    char line[16];
+};
+
+static void reset(session& s, SSLBuffer::state_t state)
+{
+    s.state = state;
+    s.busy = (state != SSLBuffer::CLOSED && state != SSLBuffer::FAILED);
+    s.got = s.sent = 0;
+}
+
+static bool receive(session& s)
+{
+    size_t count;
+
+    while(!s.got || s.line[s.got - 1] != '\n') {
+        if(s.got >= sizeof(s.line) - 1) {
+            s.state = SSLBuffer::FAILED;
+            return false;
+        }
+        s.state = s.conn->recv(s.line + s.got, sizeof(s.line) - s.got - 1, count);
+        if(s.state != SSLBuffer::READY)
+            return false;
+        s.got += count;
+    }
+    return true;
+}
+
+static bool transmit(session& s, const char *data, size_t size)
+{
+    size_t count;
+
+    while(s.sent < size) {
+        s.state = s.conn->send(data + s.sent, size - s.sent, count);
+        if(s.state != SSLBuffer::READY)
+            return false;
+        s.sent += count;
+    }
+    return true;
+}
+
+static short events(const session& s)
+{
+    if(s.state == SSLBuffer::WANT_WRITE)
+        return POLLOUT;
+    return POLLIN;
+}
+
+// one thread terminating many sessions from a poll loop
+class terminator : public JoinableThread
+{
+public:
+    TCPServer *listener;
+    secure::server_t context;
+    unsigned count, clients;
+
+    terminator(TCPServer *tcp, secure::server_t ctx, unsigned connects, unsigned limit) : JoinableThread() {
+        listener = tcp;
+        context = ctx;
+        count = connects;
+        clients = limit;
+    }
+
+    void run(void) {
+        session *list = new session[clients];
+        struct pollfd *pfd = new struct pollfd[clients + 1];
+        unsigned *map = new unsigned[clients + 1];
+
+        for(unsigned pos = 0; pos < clients; ++pos) {
+            list[pos].conn = new SSLBuffer(context);
+            reset(list[pos], SSLBuffer::CLOSED);
+        }
+
+        unsigned accepted = 0, active = 0;
+        while(accepted < count || active) {
+            unsigned used = 0;
+            if(accepted < count && active < clients) {
+                pfd[used].fd = listener->handle();
+                pfd[used].events = POLLIN;
+                map[used++] = clients;
+            }
+            for(unsigned pos = 0; pos < clients; ++pos) {
+                if(!list[pos].busy)
+                    continue;
+                pfd[used].fd = list[pos].conn->handle();
+                pfd[used].events = events(list[pos]);
+                map[used++] = pos;
+            }
+
+            if(poll(pfd, used, 5000) < 1)
+                break;
+
+            for(unsigned ind = 0; ind < used; ++ind) {
+                if(!pfd[ind].revents)
+                    continue;
+
+                unsigned pos = map[ind];
+                if(pos == clients) {
+                    for(pos = 0; list[pos].busy; ++pos)
+                        ;
+                    reset(list[pos], list[pos].conn->accept(listener));
+                    ++accepted;
+                    if(!list[pos].busy)
+                        continue;
+                    ++active;
+                }
+
+                // echo lines until the client closes
+                session& s = list[pos];
+                while(receive(s) && transmit(s, s.line, s.got))
+                    s.got = s.sent = 0;
+
+                if(s.state == SSLBuffer::CLOSED || s.state == SSLBuffer::FAILED) {
+                    s.conn->close();
+                    s.busy = false;
+                    --active;
+                }
+            }
+        }
+
+        for(unsigned pos = 0; pos < clients; ++pos)
+            delete list[pos].conn;
+        delete[] list;
+        delete[] pfd;
+        delete[] map;
+    }
+
+    inline void finish(void)
+        {join();}
+};
+
+// send a request and wait for the reply, closing when done
+static unsigned request(session& s, unsigned& active)
+{
+    unsigned secured = 0;
+    bool done = transmit(s, "ping\n", 5) && receive(s);
+
+    if(done && s.got == 5 && !strncmp(s.line, "ping\n", 5))
+        ++secured;
+
+    if(done || s.state == SSLBuffer::CLOSED || s.state == SSLBuffer::FAILED) {
+        s.conn->close();
+        s.busy = false;
+        --active;
+    }
+    return secured;
+}
+
+// many concurrent non-blocking clients driven from one poll loop
+static unsigned sessions(secure::client_t context, unsigned count, unsigned clients)
+{
+    session *list = new session[clients];
+    struct pollfd *pfd = new struct pollfd[clients];
+    unsigned *map = new unsigned[clients];
+    unsigned started = 0, secured = 0, active = 0;
+
+    for(unsigned pos = 0; pos < clients; ++pos) {
+        list[pos].conn = new SSLBuffer(context);
+        reset(list[pos], SSLBuffer::CLOSED);
+    }
+
+    for(;;) {
+        for(unsigned pos = 0; pos < clients && started < count; ++pos) {
+            if(list[pos].busy)
+                continue;
+            ++started;
+            reset(list[pos], list[pos].conn->connect("127.0.0.1", "9444"));
+            if(list[pos].busy)
+                ++active;
+            if(list[pos].state == SSLBuffer::READY)
+                secured += request(list[pos], active);
+        }
+
+        if(!active)
+            break;
+
+        unsigned used = 0;
+        for(unsigned pos = 0; pos < clients; ++pos) {
+            if(!list[pos].busy)
+                continue;
+            pfd[used].fd = list[pos].conn->handle();
+            pfd[used].events = events(list[pos]);
+            map[used++] = pos;
+        }
+
+        if(poll(pfd, used, 5000) < 1)
+            break;
+
+        for(unsigned ind = 0; ind < used; ++ind) {
+            if(!pfd[ind].revents)
+                continue;
+
+            secured += request(list[map[ind]], active);
+        }
+    }
+
+    for(unsigned pos = 0; pos < clients; ++pos)
+        delete list[pos].conn;
+    delete[] list;
+    delete[] pfd;
+    delete[] map;
+    return secured;
+}
+
+// serve one file body, sent from the file or copied through the buffer
+class streamer : public JoinableThread
+{
+public:
+    TCPServer *listener;
+    secure::server_t context;
+    fsys *file;
+    bool direct, offloaded;
+
+    streamer(TCPServer *tcp, secure::server_t ctx, fsys *fs, bool zerocopy) : JoinableThread() {
+        listener = tcp;
+        context = ctx;
+        file = fs;
+        direct = zerocopy;
+        offloaded = false;
+    }
+
+    void run(void) {
+        char buf[16384];
+
+        if(!listener->wait(5000))
+            return;
+
+        SSLBuffer conn(listener, context, sizeof(buf));
+        offloaded = conn.is_offloaded();
+        if(direct) {
+            conn.sendfile(*file, 0, BODY);
+            return;
+        }
+
+        file->seek(0);
+        size_t total = 0;
+        while(total < BODY) {
+            ssize_t count = file->read(buf, sizeof(buf));
+            if(count < 1 || conn.put(buf, count) < (size_t)count)
+                break;
+            total += count;
+        }
+        conn.flush();
+    }
+
+    inline void finish(void)
+        {join();}
+};
+
+static size_t transfer(secure::client_t context)
+{
+    SSLBuffer client(context);
+    size_t total = 0;
+    char buf[65536];
+
+    client.open("127.0.0.1", "9445", sizeof(buf));
+    while(total < BODY) {
+        size_t count = client.get(buf, sizeof(buf));
+        if(!count)
+            break;
+        total += count;
+    }
+    client.close();
+    return total;
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    unsigned count = CONNECTS;
+    unsigned clients = CLIENTS;
+
+    if(argc < 2) {
+        fprintf(stderr, "use: bench-tls certfile [connects [clients]]\n");
+        return 2;
+    }
+
+    if(argc > 2)
+        count = atoi(argv[2]);
+
+    if(argc > 3)
+        clients = atoi(argv[3]);
+
+#ifdef  SIGPIPE
+    // a close notify may be sent after the peer already hung up
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    if(!secure::init()) {
+        fprintf(stderr, "no tls support\n");
+        return 1;
+    }
+
+    secure::server_t srv = secure::server(argv[1]);
+    if(!srv || !srv->is_valid()) {
+        fprintf(stderr, "%s: cannot load certificate\n", argv[1]);
+        return 1;
+    }
+
+    // short exchanges should not wait on delayed acks
+    secure::nodelay(srv);
+
+    TCPServer listener("127.0.0.1", "9443", 64);
+
+    for(unsigned resume = 0; resume < 2; ++resume) {
+        secure::client_t cli = secure::client();
+        secure::nodelay(cli);
+        if(!resume)
+            secure::cache(cli, 0);
+
+        server service(&listener, srv, count);
+        service.start();
+
+        Timer::tick_t start = Timer::ticks();
+        unsigned secured = connects(cli, count);
+        double secs = (double)(Timer::ticks() - start) / 10000000.0;
+        service.finish();
+
+        if(secs <= 0.0)
+            secs = 0.0000001;
+        printf("%-16s %10.1f handshakes/s  client %lu/%lu  server %lu/%lu%s\n",
+            resume ? "resumed" : "full", (double)secured / secs,
+            cli->hits(), cli->misses(), srv->hits(), srv->misses(),
+            secured == count ? "" : " (failed)");
+
+        delete cli;
+    }
+
+    // both ends of many concurrent sessions, each on a single thread
+    TCPServer events("127.0.0.1", "9444", 1024);
+    for(unsigned resume = 0; resume < 2; ++resume) {
+        secure::client_t cli = secure::client();
+        secure::nodelay(cli);
+        if(!resume)
+            secure::cache(cli, 0);
+
+        terminator service(&events, srv, count, clients);
+        service.start();
+
+        Timer::tick_t start = Timer::ticks();
+        unsigned secured = sessions(cli, count, clients);
+        double secs = (double)(Timer::ticks() - start) / 10000000.0;
+        service.finish();
+
+        if(secs <= 0.0)
+            secs = 0.0000001;
+        printf("%-16s %10.1f handshakes/s  %u clients%s\n",
+            resume ? "poll resumed" : "poll full", (double)secured / secs,
+            clients, secured == count ? "" : " (failed)");
+
+        delete cli;
+    }
+
+    // bulk file bodies, in userspace and from the kernel where possible
+    fsys body("bench.dat", 0640, fsys::REWRITE);
+    char block[65536];
+    memset(block, 'x', sizeof(block));
+    for(size_t pos = 0; pos < BODY; pos += sizeof(block))
+        body.write(block, sizeof(block));
+
+    TCPServer bulk("127.0.0.1", "9445", 4);
+    secure::offload(srv);
+    for(unsigned mode = 0; mode < 4; ++mode) {
+        bool tls = (mode > 1), direct = (mode & 1) != 0;
+        secure::client_t cli = tls ? secure::client() : NULL;
+        if(cli)
+            secure::offload(cli);
+
+        streamer service(&bulk, tls ? srv : NULL, &body, direct);
+        service.start();
+
+        Timer::tick_t start = Timer::ticks();
+        size_t total = transfer(cli);
+        double secs = (double)(Timer::ticks() - start) / 10000000.0;
+        service.finish();
+
+        if(secs <= 0.0)
+            secs = 0.0000001;
+        printf("%-16s %10.1f MB/s%s%s\n",
+            tls ? (direct ? "tls sendfile" : "tls copy") : (direct ? "tcp sendfile" : "tcp copy"),
+            (double)total / secs / 1048576.0, service.offloaded ? "  ktls" : "",
+            total == BODY ? "" : " (failed)");
+
+        delete cli;
+    }
+
+    body.close();
+    fsys::erase("bench.dat");
+    delete srv;
+    return 0;
+}
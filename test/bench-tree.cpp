@@ -0,0 +1,116 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ucommon;
+
+#define GROUPS      1000
+#define MEMBERS     1000
+#define LOOKUPS     200000
+#define HOTPATHS    4096
+
+typedef treemap<unsigned> tree;
+
+static double elapsed(Timer::tick_t start)
+{
+    double secs = (double)(Timer::ticks() - start) / 10000000.0;
+    if(secs <= 0.0)
+        secs = 0.0000001;
+    return secs;
+}
+
+static inline unsigned pick(unsigned pos, unsigned range)
+{
+    return (unsigned)(((uint64_t)pos * 2654435761u) >> 7) % range;
+}
+
+static void children(const char *id, tree *root, unsigned groups, unsigned members)
+{
+    char name[32];
+    bool ok = true;
+    Timer::tick_t start = Timer::ticks();
+    for(unsigned pos = 0; pos < LOOKUPS; ++pos) {
+        unsigned group = pick(pos, groups), member = pick(pos + 7, members);
+        snprintf(name, sizeof(name), "g%u", group);
+        tree *node = root->getChild(name);
+        snprintf(name, sizeof(name), "m%u", member);
+        node = node ? node->getChild(name) : NULL;
+        if(!node || node->get() != group * members + member)
+            ok = false;
+    }
+    double secs = elapsed(start);
+    printf("%-16s %10.0f lookups/s%s\n", id, (double)LOOKUPS / secs, ok ? "" : " (failed)");
+}
+
+static void paths(const char *id, tree *root, unsigned groups, unsigned members, unsigned hot)
+{
+    char name[48];
+    bool ok = true;
+    Timer::tick_t start = Timer::ticks();
+    for(unsigned pos = 0; pos < LOOKUPS; ++pos) {
+        unsigned index = hot ? pick(pos % hot, groups * members) : pick(pos, groups * members);
+        unsigned group = index / members, member = index % members;
+        snprintf(name, sizeof(name), "g%u.m%u", group, member);
+        tree *node = root->path(name);
+        if(!node || node->get() != index)
+            ok = false;
+    }
+    double secs = elapsed(start);
+    printf("%-16s %10.0f paths/s%s\n", id, (double)LOOKUPS / secs, ok ? "" : " (failed)");
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    unsigned groups = GROUPS, members = MEMBERS;
+    if(argc > 1)
+        groups = members = atoi(argv[1]);
+
+    char name[32];
+    tree *root = new tree();
+    Timer::tick_t start = Timer::ticks();
+    for(unsigned group = 0; group < groups; ++group) {
+        snprintf(name, sizeof(name), "g%u", group);
+        tree *node = new tree(root, strdup(name));
+        for(unsigned member = 0; member < members; ++member) {
+            snprintf(name, sizeof(name), "m%u", member);
+            tree *leaf = new tree(node, strdup(name));
+            leaf->set(group * members + member);
+        }
+    }
+    printf("%-16s %10.1f ms for %u nodes\n", "build", elapsed(start) * 1000.0, groups * members + groups);
+
+    children("child walk", root, groups, members);
+    paths("path walk", root, groups, members, 0);
+
+    root->index();
+    children("child indexed", root, groups, members);
+    paths("path indexed", root, groups, members, 0);
+
+    root->setCache(HOTPATHS);
+    paths("path cached", root, groups, members, HOTPATHS / 4);
+    paths("path uncached", root, groups, members, 0);
+
+    start = Timer::ticks();
+    delete root;
+    printf("%-16s %10.1f ms\n", "delete", elapsed(start) * 1000.0);
+    return 0;
+}
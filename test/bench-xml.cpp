@@ -0,0 +1,141 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ucommon;
+
+#define RECORDS 40000
+
+class benchParser : public XMLParser
+{
+public:
+    size_t elements, text;
+
+    benchParser() : XMLParser() {
+        elements = text = 0;
+    }
+
+    void startElement(caddr_t, caddr_t *) {
+        ++elements;
+    }
+
+    void endElement(caddr_t) {
+    }
+
+    void characters(caddr_t, size_t size) {
+        text += size;
+    }
+
+    bool memory(const char *data, size_t size) {
+        return partial(data, size) && end();
+    }
+
+    bool chars(CharacterProtocol& io) {
+        return parse(io);
+    }
+
+    bool file(const char *path) {
+        return load(path);
+    }
+};
+
+static void report(const char *id, Timer::tick_t start, size_t bytes, bool ok)
+{
+    double secs = (double)(Timer::ticks() - start) / 10000000.0;
+    if(secs <= 0.0)
+        secs = 0.0000001;
+    printf("%-16s %10.1f MB/s%s\n", id, (double)bytes / secs / 1048576.0, ok ? "" : " (failed)");
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    unsigned records = RECORDS;
+    if(argc > 1)
+        records = atoi(argv[1]);
+
+    // a provisioning style document of many small records
+    size_t max = (size_t)records * 200 + 64;
+    char *doc = new char[max];
+    size_t len = snprintf(doc, max, "<?xml version=\"1.0\"?>\n<provision>\n");
+    for(unsigned pos = 0; pos < records; ++pos)
+        len += snprintf(doc + len, max - len,
+            "  <user id=\"%u\" realm='local'><name>user%u</name>"
+            "<secret>%08x&amp;%08x</secret><enabled/></user>\n",
+            pos, pos, pos * 2654435761u, pos ^ 0x5a5a5a5a);
+    len += snprintf(doc + len, max - len, "</provision>\n");
+
+    FILE *fp = fopen("bench.xml", "w");
+    if(fp) {
+        fwrite(doc, 1, len, fp);
+        fclose(fp);
+    }
+
+    printf("document         %10.1f MB\n", (double)len / 1048576.0);
+
+    benchParser memparser;
+    Timer::tick_t start = Timer::ticks();
+    bool ok = memparser.memory(doc, len);
+    report("partial", start, len, ok);
+
+    benchParser mapparser;
+    start = Timer::ticks();
+    ok = mapparser.file("bench.xml");
+    report("load", start, len, ok);
+
+    benchParser charparser;
+    charmem chars(doc, len);
+    start = Timer::ticks();
+    ok = charparser.chars(chars);
+    report("getchar", start, len, ok);
+
+    // pull every record id, skipping over the record contents
+    XMLReader reader;
+    size_t ids = 0;
+    start = Timer::ticks();
+    ok = reader.open("bench.xml");
+    while(ok && reader.next() != XMLReader::DONE) {
+        if(*reader == XMLReader::FAILED)
+            ok = false;
+        else if(*reader == XMLReader::START && reader.depth() == 2) {
+            if(reader.attribute("id"))
+                ++ids;
+            ok = reader.skip();
+        }
+    }
+    reader.close();
+    report("pull skip", start, len, ok && ids == records);
+
+    // pull every event without skipping
+    size_t events = 0;
+    start = Timer::ticks();
+    ok = reader.open("bench.xml");
+    while(ok && reader.next() != XMLReader::DONE) {
+        if(*reader == XMLReader::FAILED)
+            ok = false;
+        ++events;
+    }
+    reader.close();
+    report("pull all", start, len, ok && events > records);
+
+    remove("bench.xml");
+    delete[] doc;
+    return 0;
+}
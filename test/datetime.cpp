@@ -98,6 +98,38 @@ int main(int argc, char **argv)
     tmp += 5;   // add 5 seconds to force rollover...
     assert((long)tmp == 20030301l);
 
+    // cached stamps re-form their date only as the second changes
+    struct timeval tv;
+    tv.tv_sec = 1046476795;
+    tv.tv_usec = 123456;
+    TimeStamp utc(TimeStamp::UTC);
+    assert(eq(utc.set(&tv), "2003-02-28T23:59:55.123Z"));
+    tv.tv_usec = 9000;
+    assert(eq(utc.set(&tv), "2003-02-28T23:59:55.009Z"));
+    tv.tv_sec += 5;
+    assert(eq(utc.set(&tv), "2003-03-01T00:00:00.009Z"));
+
+    TimeStamp fine(TimeStamp::UTC, 6);
+    assert(eq(fine.set(&tv), "2003-03-01T00:00:00.009000Z"));
+    char small[8];
+    assert(fine.put(small, sizeof(small), &tv) == 0);
+
+#ifndef _MSWINDOWS_
+    setenv("TZ", "EST5", 1);
+    tzset();
+    tv.tv_sec = 1046476795;
+    TimeStamp iso(TimeStamp::ISO8601, 0);
+    assert(eq(iso.set(&tv), "2003-02-28T18:59:55-05:00"));
+    TimeStamp local(TimeStamp::LOCAL, 1);
+    assert(eq(local.set(&tv), "2003-02-28 18:59:55.0"));
+    TimeStamp syslog(TimeStamp::SYSLOG, 0);
+    assert(eq(syslog.set(&tv), "Feb 28 18:59:55"));
+#endif
+
+    char now[48];
+    assert(TimeStamp::format(now, sizeof(now)) == 23);
+    assert(now[10] == ' ' && now[19] == '.');
+
     return 0;
 }
 
@@ -0,0 +1,94 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DEBUG
+#define DEBUG
+#endif
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+
+using namespace ucommon;
+
+#define BLOCK   512
+
+extern "C" int main()
+{
+    char out[BLOCK * 2], in[BLOCK * 2], text[16];
+    IORing::completion_t done[8];
+    unsigned got = 0;
+
+    for(unsigned pos = 0; pos < sizeof(out); ++pos)
+        out[pos] = (char)('a' + pos % 26);
+
+    // file writes and reads at offsets, collected by user data
+    fsys file("ioring.dat", 0640, fsys::REWRITE);
+    assert(is(file));
+    IORing ring(8);
+    assert(ring.write(file, out + BLOCK, BLOCK, BLOCK, (void *)2));
+    assert(ring.write(file, out, BLOCK, 0, (void *)1));
+    assert(ring.submit() == 2);
+    while(got < 2)
+        got += ring.wait(done + got, 2 - got, 1000);
+    for(unsigned pos = 0; pos < got; ++pos)
+        assert(done[pos].result == BLOCK);
+
+    memset(in, 0, sizeof(in));
+    assert(ring.read(file, in, sizeof(in), 0));
+    assert(ring.wait(done, 8, 1000) == 1);
+    assert(done[0].result == sizeof(in) && !memcmp(in, out, sizeof(in)));
+    assert(ring.pending() == 0);
+    file.close();
+    fsys::erase("ioring.dat");
+
+    // accepted through the ring, then a send and receive on the session
+    TCPServer listener("127.0.0.1", "4447", 4);
+    Socket::address addr("127.0.0.1", "4447");
+    socket_t client = Socket::create(addr);
+    assert(client != INVALID_SOCKET);
+    assert(ring.accept(listener.handle()));
+    assert(ring.wait(done, 8, 1000) == 1 && done[0].result >= 0);
+    socket_t server = (socket_t)done[0].result;
+
+    assert(ring.send(client, "hello", 5, (void *)1));
+    assert(ring.wait(done, 8, 1000) == 1 && done[0].result == 5);
+    memset(text, 0, sizeof(text));
+    assert(ring.recv(server, text, sizeof(text), (void *)2));
+    assert(ring.wait(done, 8, 1000) == 1 && done[0].result == 5);
+    assert(done[0].user == (void *)2 && eq(text, "hello"));
+
+    // a full engine refuses requests rather than overrunning its rings
+    IORing *small = new IORing(2);
+    unsigned queued = 0;
+    while(queued < 64 && small->recv(server, text, sizeof(text)))
+        ++queued;
+    assert(queued < 64);
+    assert(small->pending() == queued);
+
+    // requests that would never complete do not hold up the destructor,
+    // though the fallback performs them when submitted so they are not
+    Timer::tick_t start = Timer::ticks();
+    if(small->is_kernel())
+        small->submit();
+    delete small;
+    assert(Timer::ticks() - start < 50000000l);
+
+    Socket::release(client);
+    Socket::release(server);
+    return 0;
+}
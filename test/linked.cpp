@@ -27,6 +27,7 @@
 using namespace ucommon;
 
 typedef linked_value<int> ints;
+typedef treemap<unsigned> tree;
 
 static OrderedIndex list;
 
@@ -38,6 +39,108 @@ public:
     unsigned value;
 };
 
+class named : public NamedObject
+{
+public:
+    inline named(unsigned v) : NamedObject() {value = v;}
+    inline named(OrderedIndex *list, const char *id, unsigned v) : NamedObject(list, strdup(id)) {value = v;}
+
+    unsigned value;
+};
+
+static unsigned destroyed = 0;
+
+class counted : public CountedObject
+{
+public:
+    inline counted(unsigned v) : CountedObject() {value = v;}
+    inline ~counted() {++destroyed;}
+
+    unsigned value;
+};
+
+class call : public MultiIndex::member
+{
+public:
+    char id[16], tag[16];
+    int64_t stamp;
+
+    inline call(unsigned v) : MultiIndex::member() {
+        snprintf(id, sizeof(id), "call%u", v);
+        snprintf(tag, sizeof(tag), "tag%u", v % 10);
+        stamp = v * 10;
+        ++created;
+    }
+
+    inline ~call() {++destroyed;}
+
+    MultiIndex::key keyof(unsigned path) const {
+        switch(path) {
+        case 0:
+            return MultiIndex::key(id);
+        case 1:
+            return MultiIndex::key(tag);
+        default:
+            return MultiIndex::key(stamp);
+        }
+    }
+
+    static unsigned created;
+};
+
+unsigned call::created = 0;
+
+class binkey : public multimap<unsigned, 1>
+{
+public:
+    uint32_t addr;
+};
+
+// small nodes so the tree splits, grows and collapses many levels
+template <class M>
+static void ordered(M& map, unsigned limit)
+{
+    destroyed = 0;
+    for(unsigned pos = 0; pos < limit; ++pos) {
+        unsigned key = (pos * 7919) % limit;
+        assert(map.add(key, new counted(key)));
+    }
+    assert(map.count() == limit);
+    assert(!map.add(5, new counted(5000)));
+    assert(destroyed == 1 && map.find(5)->value == 5000);
+    assert(map[limit] == NULL);
+
+    unsigned count = 0;
+    typename M::iterator ptr = map.begin();
+    while(ptr) {
+        assert(ptr.key() == count && (ptr->value == count || count == 5));
+        ++count;
+        ++ptr;
+    }
+    assert(count == limit);
+
+    for(unsigned pos = 0; pos < limit; pos += 2)
+        assert(map.remove(pos));
+    assert(!map.remove(0) && map.count() == limit / 2);
+    assert(map.find(100) == NULL && map.find(101)->value == 101);
+
+    count = 0;
+    ptr = map.from(100);
+    while(ptr && ptr.key() < 200) {
+        assert(ptr.key() == 101 + count * 2);
+        ++count;
+        ptr.next();
+    }
+    assert(count == 50);
+
+    for(unsigned pos = 1; pos < limit - 2; pos += 2)
+        assert(map.remove(pos));
+    assert(map.count() == 1 && map.begin().key() == limit - 1);
+    assert(map.from(0).key() == limit - 1 && !map.from(limit));
+    map.clear();
+    assert(destroyed == limit + 1 && !map.begin());
+}
+
 extern "C" int main()
 {
     linked_pointer<ints> ptr;
@@ -90,5 +193,157 @@ extern "C" int main()
     assert(mv != NULL);
 //  assert(mv->value == 1);
 
+    // a hash map grows well past its initial table
+    hashmap<named> map;
+    char name[32];
+    for(unsigned pos = 0; pos < 5000; ++pos) {
+        snprintf(name, sizeof(name), "key%u", pos);
+        map.add(strdup(name), new named(pos));
+    }
+    assert(map.count() == 5000);
+    assert(map.get("key0")->value == 0);
+    assert(map["key4999"]->value == 4999);
+    assert(map.get("key5000") == NULL);
+
+    for(unsigned pos = 0; pos < 5000; pos += 2) {
+        snprintf(name, sizeof(name), "key%u", pos);
+        delete map.remove(name);
+    }
+    assert(map.count() == 2500);
+    assert(map.get("key10") == NULL);
+    assert(map.get("key11")->value == 11);
+
+    map.add(strdup("key11"), new named(11000));
+    assert(map.count() == 2500);
+    assert(map.get("key11")->value == 11000);
+
+    count = 0;
+    named *node = map.begin();
+    while(node) {
+        assert(node->value & 1 || node->value == 11000);
+        ++count;
+        node = map.next(node);
+    }
+    assert(count == 2500);
+
+    // keylists keep every member, replacing any of the same name
+    keylist<named> keys;
+    new named(&keys, "first", 1);
+    new named(&keys, "second", 2);
+    new named(&keys, "third", 3);
+    new named(&keys, "second", 4);
+    assert(keys.count() == 3);
+    assert(keys.find("first")->value == 1 && keys.find("second")->value == 4);
+    assert(keys.end()->value == 4 && keys.begin()->value == 1);
+
+    // indexed trees keep their children current, and first of a name is found
+    tree root;
+    root.setCache(64);
+    tree *group = new tree(&root, strdup("group"));
+    tree *item = NULL;
+    for(unsigned pos = 0; pos < 1000; ++pos) {
+        snprintf(name, sizeof(name), "item%u", pos);
+        item = new tree(group, strdup(name));
+        item->set(pos);
+        new tree(item, strdup("value"));
+    }
+    assert(root.path("group.item999")->get() == 999);
+    root.index();
+    tree *dup = new tree(group, strdup("item10"));
+    dup->set(5000);
+    assert(group->getChild("item999")->get() == 999);
+    assert(group->getChild("item10")->get() == 10);
+    assert(root.path("group.item500.value")->getParent()->get() == 500);
+    assert(root.path("group.item500.value") == group->getChild("item500")->getChild("value"));
+    assert(root.path("group.item1000") == NULL);
+
+    delete group->getChild("item10");
+    assert(group->getChild("item10") == dup);
+    assert(root.path("group.item10") == dup);
+    dup->relistHead(NULL);
+    assert(group->getChild("item10") == NULL && root.path("group.item10") == NULL);
+    dup->relistHead(group);
+    assert(group->getChild("item10") == dup && group->getFirst() == dup);
+    assert(group->getLeaf("item10") == dup);
+    assert(group->getLeaf("item11") == NULL);
+
+    group->getChild("item20")->setId(strdup("renamed"));
+    assert(group->getChild("item20") == NULL);
+    assert(root.path("group.renamed")->get() == 20);
+    assert(group->getChild("item30")->path(".item31")->get() == 31);
+
+    // ordered maps retain objects and iterate them in key order
+    btreemap<unsigned, counted, 4> tree4;
+    ordered(tree4, 10000);
+    btreemap<unsigned, counted> btree;
+    ordered(btree, 10000);
+    sortedmap<unsigned, counted> sorted;
+    ordered(sorted, 2000);
+
+    // objects are found by each of their keys and refiled when changed
+    destroyed = 0;
+    {
+        multiindex<call> calls(3);
+        assert(calls.setPath(0, MultiIndex::HASHED | MultiIndex::UNIQUE));
+        assert(calls.setPath(2, MultiIndex::ORDERED));
+        for(unsigned pos = 0; pos < 1000; ++pos)
+            assert(calls.add(new call(pos)));
+        assert(!calls.setPath(1, MultiIndex::ORDERED));
+        call *dup = new call(5);
+        assert(!calls.add(dup));
+        delete dup;
+        assert(calls.count() == 1000);
+
+        call *found = calls.find(0, "call500");
+        assert(found && found->stamp == 5000);
+        assert(calls.find(2, (int64_t)5000) == found);
+        count = 0;
+        call *tagged = calls.find(1, "tag3");
+        while(tagged) {
+            assert(eq(tagged->tag, "tag3"));
+            ++count;
+            tagged = calls.find(1, "tag3", tagged);
+        }
+        assert(count == 100);
+
+        found->stamp = 5;
+        String::set(found->id, sizeof(found->id), "call1");
+        assert(!calls.update(found));
+        assert(calls.find(2, (int64_t)5000) == found);
+        String::set(found->id, sizeof(found->id), "moved");
+        assert(calls.update(found));
+        assert(calls.find(0, "call500") == NULL && calls.find(0, "moved") == found);
+        assert(calls.find(2, (int64_t)5000) == NULL);
+
+        multiindex<call>::iterator ptr = calls.begin(2);
+        assert(ptr->stamp == 0);
+        ++ptr;
+        assert(*ptr == found);
+        count = 0;
+        ptr = calls.from(2, (int64_t)100);
+        while(ptr && MultiIndex::before(*ptr, 2, (int64_t)200)) {
+            assert(ptr->stamp == 100 + (int64_t)count * 10);
+            ++count;
+            ++ptr;
+        }
+        assert(count == 10);
+
+        assert(calls.remove(calls.find(0, "call10")));
+        assert(calls.find(2, (int64_t)100) == NULL && calls.count() == 999);
+        assert(calls.begin() == calls.find(0, "call0"));
+    }
+    assert(destroyed == 1001 && call::created == 1001);
+
+    // binary keys hash to the same chain they are found on
+    binkey *bins[3];
+    MultiMap *table[16] = {NULL};
+    for(unsigned pos = 0; pos < 3; ++pos) {
+        bins[pos] = new binkey;
+        bins[pos]->addr = 0x0a000001 + pos;
+        bins[pos]->enlist(0, table, (caddr_t)&bins[pos]->addr, 16, sizeof(uint32_t));
+    }
+    uint32_t addr = 0x0a000002;
+    assert(MultiMap::find(0, table, (caddr_t)&addr, 16, sizeof(addr)) == bins[1]);
+
     return 0;
 }
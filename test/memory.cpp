@@ -23,11 +23,23 @@
 #include <ucommon/ucommon.h>
 
 #include <stdio.h>
+#ifdef  __linux__
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
 
 using namespace ucommon;
 
 static int tval = 100;
 
+class session
+{
+public:
+    unsigned id;
+    mapped_pointer<session> next;
+};
+
 extern "C" int main()
 {
     stringlist_t mylist;
@@ -60,5 +72,182 @@ extern "C" int main()
     int& rval = deref_pointer<int>(pval);
     assert(&rval == pval);
 
+    keyassoc assoc(177, 32);
+    char name[32];
+    for(unsigned pos = 0; pos < 2000; ++pos) {
+        snprintf(name, sizeof(name), "key%u", pos);
+        assert(assoc.create(name, &tval));
+    }
+    assert(!assoc.create("key1", &tval));
+    assert(assoc.count() == 2000);
+    assert(assoc.locate("key1999") == &tval);
+    assert(assoc.remove("key100") == &tval);
+    assert(assoc.locate("key100") == NULL);
+    assert(assoc.locate("key101") == &tval);
+    assert(assoc.count() == 1999);
+
+    // pages mapped with placement options
+    memalloc paged;
+    assert(paged.placement(memalloc::HUGEPAGES | memalloc::PREFAULT));
+    assert(paged.size() % memalloc::hugepage() == 0);
+    char *block = (char *)paged._alloc(4096);
+    memset(block, 0x5a, 4096);
+    assert(paged.pages() == 1);
+    assert(!paged.placement(0));
+    paged.purge();
+
+    MappedMemory placed("ucommon-test-placed", 65536, memalloc::TRANSPARENT | memalloc::PREFAULT);
+    assert(placed && placed.len() == 65536);
+    strcpy((char *)placed.offset(0), "placed");
+    MappedMemory viewed("ucommon-test-placed");
+    assert(eq((const char *)viewed.offset(0), "placed"));
+
+    // records pass through a shared ring, wrapping many times
+    for(unsigned multiple = 0; multiple < 2; ++multiple) {
+        MappedRing ring("ucommon-test-ring", 1024, multiple != 0);
+        assert(ring && ring.is_empty());
+        MappedRing writer("ucommon-test-ring");
+        assert(writer && writer.limit() == ring.limit());
+
+        unsigned sent = 0, received = 0;
+        char msg[64], buf[64];
+        while(received < 5000) {
+            snprintf(msg, sizeof(msg), "record %u %*s", sent, sent % 40, "");
+            if(sent < 5000 && writer.post(msg, strlen(msg) + 1)) {
+                ++sent;
+                continue;
+            }
+            assert(!ring.is_empty());
+            size_t len = ring.get(buf, sizeof(buf));
+            assert(len > 0 && len == strlen(buf) + 1);
+            unsigned value = 0;
+            sscanf(buf, "record %u", &value);
+            assert(value == received++);
+        }
+        assert(ring.is_empty());
+        assert(ring.get(buf, sizeof(buf), 10) == 0);
+        assert(writer.request(ring.limit() + 1) == NULL);
+    }
+
+    // a shared heap reuses freed blocks and is read by another mapping
+    MappedHeap heap("ucommon-test-heap", 1024 * 1024);
+    assert(heap);
+    void *first = heap.alloc(100);
+    assert(first != NULL && heap->usable(first) >= 100);
+    heap.free(first);
+    heap.free(first);
+    assert(heap.alloc(100) == first);
+    void *second = heap.alloc(100);
+    assert(second != NULL && second != first);
+    heap.free(second);
+
+    mapped_hashmap<session> *table = mapped_hashmap<session>::create(heap.arena());
+    mapped_vector<mapped_pointer<session> > *order = mapped_vector<mapped_pointer<session> >::create(heap.arena());
+    heap->root(table);
+    table->lock();
+    for(unsigned pos = 0; pos < 1000; ++pos) {
+        snprintf(name, sizeof(name), "session%u", pos);
+        session *entry = table->add(name);
+        entry->id = pos;
+        assert(order->push(entry));
+    }
+    table->unlock();
+    assert(table->remove("session10") && !table->remove("session10"));
+    (*order)[10] = NULL;
+    (*order)[11]->next = (*order)[12];
+
+    MappedHeap other("ucommon-test-heap");
+    assert(other && other->root() != NULL);
+    mapped_hashmap<session> *shared = (mapped_hashmap<session> *)other->root();
+    assert(shared->count() == 999 && shared->get("session10") == NULL);
+    assert(shared->get("session999")->id == 999);
+    assert(shared->get("session11")->next->id == 12);
+    mapped_vector<mapped_pointer<session> > *viewer =
+        (mapped_vector<mapped_pointer<session> > *)other->address(heap->offset(order));
+    assert(viewer->size() == 1000 && !(*viewer)[10] && (*viewer)[500]->id == 500);
+    assert((session *)(*viewer)[500] == shared->get("session500"));
+
+    size_t inuse = heap->inuse();
+    order->destroy();
+    table->destroy();
+    assert(heap->inuse() < inuse && heap->inuse() == heap->usable(first));
+
+#ifdef  __linux__
+    // a process that dies holding a lock leaves what it guards unusable
+    mapped_hashmap<session> *orphan = mapped_hashmap<session>::create(heap.arena());
+    assert(orphan != NULL && orphan->add("kept") != NULL);
+    pid_t pid = fork();
+    if(!pid) {
+        orphan->lock();
+        kill(getpid(), SIGKILL);
+    }
+    int status;
+    assert(pid > 0 && waitpid(pid, &status, 0) == pid && WIFSIGNALED(status));
+    assert(!orphan->lock() && !orphan->lock());
+    assert(orphan->get("kept") == NULL && orphan->add("other") == NULL);
+    assert(!orphan->remove("kept"));
+    assert(heap.alloc(100) != NULL);
+#endif
+
+    // bitmaps search, count and allocate a word at a time
+    bitmap bits(1000);
+    assert(bits.count() == 0 && bits.find(true) == bitmap::npos);
+    bits.set(70, 200, true);
+    assert(bits.count() == 200 && bits.find(true) == 70 && bits.find(false, 70) == 270);
+    assert(bits.get(269) && !bits.get(270) && !bits.get(69));
+    bits.set(100, 10, false);
+    bits.set(999, true);
+    assert(bits.count() == 191 && bits.find(true, 100) == 110);
+    assert(bits.find(true, 270) == 999 && bits.find(false, 999) == bitmap::npos);
+    unsigned count = 0;
+    for(bitmap::iterator bit(bits, 260); bit; ++bit)
+        ++count;
+    assert(count == 11);
+    assert(bits.acquire() == 0 && bits.acquire(70) == 100 && bits.acquire(998) == 998);
+    assert(bits.acquire(998) == 1 && bits.find(false, 260) == 270);
+    bits.release(100);
+    assert(!bits.get(100) && bits.acquire(70) == 100);
+    bits.set(0, 1000, true);
+    assert(bits.acquire() == bitmap::npos);
+    bits.clear();
+    assert(bits.count() == 0);
+
+    uint16_t device[4] = {0, 0, 0, 0xffff};
+    bitmap words(device, 50, bitmap::B16);
+    words.set(3, 20, true);
+    assert(device[0] == 0xfff8 && device[1] == 0x007f && words.count() == 22);
+    assert(words.find(false, 3) == 23 && words.find(true, 23) == 48);
+    words.clear();
+    assert(device[0] == 0 && device[2] == 0 && device[3] == 0xfffc);
+    assert(words.acquire(49) == 49 && words.acquire(49) == 0);
+
+    // compressed bitmaps hold arrays, bitsets, and runs per 64k chunk
+    sparse_bitmap evens, range, both;
+    for(uint32_t pos = 0; pos < 20000; pos += 2)
+        evens.set(3000000000u + pos, true);
+    evens.set(7, true);
+    range.set(3000000000u + 10000, 100000, true);
+    range.set(0xfffffff0u, 100, true);
+    assert(evens.count() == 10001 && range.count() == 100016);
+    assert(evens.get(3000000000u + 19998) && !evens.get(3000000000u + 19999));
+    assert(range.find(3000000000u) == 3000000000u + 10000 && range.find(0xfffffff5u) == 0xfffffff5u);
+    both = evens;
+    both &= range;
+    assert(both.count() == 5000 && both.find() == 3000000000u + 10000);
+    both = evens;
+    both -= range;
+    assert(both.count() == 5001 && both.find(8) == 3000000000u);
+    both |= range;
+    assert(both.count() == 105017 && both.get(7) && both.get(0xffffffffu));
+    size_t used = both.memory();
+    both.optimize();
+    assert(both.memory() < used && both.count() == 105017);
+    count = 0;
+    for(sparse_bitmap::iterator id(both, 3000000000u + 109990); id; ++id)
+        ++count;
+    assert(count == 26);
+    both.set(0, 0xffffffffu, false);
+    assert(both.count() == 1 && both.find() == 0xffffffffu);
+
     return 0;
 }
@@ -0,0 +1,354 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef UCOMMON_SYSRUNTIME
+#ifndef DEBUG
+#define DEBUG
+#endif
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+#include <sstream>
+
+using namespace ucommon;
+
+class testObject : public PersistObject
+{
+    DECLARE_PERSISTENCE(testObject)
+
+public:
+    int32_t value;
+    std::string name;
+    std::vector<int32_t> samples;
+    std::vector<double> weights;
+    std::deque<int16_t> history;
+    testObject *peer;
+
+    testObject() : PersistObject() {
+        value = 0;
+        peer = NULL;
+    }
+
+    bool write(PersistEngine& ar) const {
+        ar << value << name << samples << weights << history << (PersistObject *)peer;
+        return true;
+    }
+
+    bool read(PersistEngine& ar) {
+        PersistObject *obj = NULL;
+        ar >> value >> name >> samples >> weights >> history >> obj;
+        peer = static_cast<testObject *>(obj);
+        return true;
+    }
+};
+
+IMPLEMENT_PERSISTENCE(testObject, "ucommon::testObject")
+
+class testNode : public PersistObject
+{
+    DECLARE_PERSISTENCE(testNode)
+
+public:
+    int32_t value;
+    persist_pointer<testNode> child;
+
+    testNode() : PersistObject() {
+        value = 0;
+    }
+
+    bool write(PersistEngine& ar) const {
+        ar << value << child;
+        return true;
+    }
+
+    bool read(PersistEngine& ar) {
+        ar >> value >> child;
+        return true;
+    }
+};
+
+IMPLEMENT_PERSISTENCE(testNode, "ucommon::testNode")
+
+static void check(PersistEngine& ar)
+{
+    testObject *first = NULL;
+    ar >> first;
+    assert(first != NULL);
+    assert(first->value == 42);
+    assert(eq(first->name.c_str(), "first"));
+    assert(first->samples.size() == 100000);
+    assert(first->samples[99999] == 99999 * 3);
+    assert(first->weights.size() == 2 && first->weights[1] == 2.5);
+    assert(first->history.size() == 3 && first->history[2] == -3);
+
+    testObject *second = first->peer;
+    assert(second != NULL);
+    assert(second->peer == first);
+    assert(second->name.length() == 3 && second->name[1] == 0);
+    assert(second->samples.empty());
+
+    std::string tail;
+    ar >> tail;
+    assert(eq(tail.c_str(), "done"));
+
+    delete first;
+    delete second;
+}
+
+extern "C" int main()
+{
+    testObject first, second;
+
+    first.value = 42;
+    first.name = "first";
+    for(int32_t pos = 0; pos < 100000; ++pos)
+        first.samples.push_back(pos * 3);
+    first.weights.push_back(1.0);
+    first.weights.push_back(2.5);
+    first.history.push_back(-1);
+    first.history.push_back(-2);
+    first.history.push_back(-3);
+    first.peer = &second;
+    second.value = 7;
+    second.name = std::string("a\0b", 3);
+    second.peer = &first;
+
+    std::stringstream out(std::ios::in | std::ios::out | std::ios::binary);
+    {
+        PersistEngine ar(out, PersistEngine::modeWrite);
+        ar << (PersistObject *)&first;
+        // a complete object has been passed on to the stream
+        assert(out.str().size() > 400000);
+        ar << std::string("done");
+    }
+    std::string archive = out.str();
+
+    std::stringstream indexed(std::ios::in | std::ios::out | std::ios::binary);
+    {
+        PersistEngine ar(indexed, PersistEngine::modeWrite, true);
+        ar << (PersistObject *)&first;
+        ar << std::string("done");
+    }
+    std::string index = indexed.str();
+    assert(index.size() > archive.size() - 100);
+
+    // bulk vectors keep the element by element layout
+    std::stringstream bulk(std::ios::in | std::ios::out | std::ios::binary);
+    std::stringstream each(std::ios::in | std::ios::out | std::ios::binary);
+    {
+        PersistEngine ar(bulk, PersistEngine::modeWrite);
+        ar << first.samples;
+    }
+    {
+        PersistEngine ar(each, PersistEngine::modeWrite);
+        ar << (uint32_t)first.samples.size();
+        for(unsigned pos = 0; pos < first.samples.size(); ++pos)
+            ar << first.samples[pos];
+    }
+    assert(bulk.str() == each.str());
+
+    std::stringstream in(archive, std::ios::in | std::ios::out | std::ios::binary);
+    PersistEngine streamed(in, PersistEngine::modeRead);
+    check(streamed);
+
+    PersistEngine memory((const uint8_t *)archive.data(), archive.size());
+    assert(!memory.is_indexed());
+    check(memory);
+
+    PersistEngine imemory((const uint8_t *)index.data(), index.size());
+    assert(imemory.is_indexed());
+    assert(imemory.objects() == 2);
+    check(imemory);
+
+    indexed.seekg(0);
+    PersistEngine istream(indexed, PersistEngine::modeRead, true);
+    check(istream);
+
+    // a chain of nodes, each read only when used
+    testNode nodes[10];
+    for(int32_t pos = 0; pos < 10; ++pos) {
+        nodes[pos].value = pos;
+        if(pos < 9)
+            nodes[pos].child = &nodes[pos + 1];
+    }
+
+    std::stringstream chain(std::ios::in | std::ios::out | std::ios::binary);
+    {
+        PersistEngine ar(chain, PersistEngine::modeWrite, true);
+        ar << (PersistObject *)&nodes[0];
+        ar << std::string("end");
+    }
+    std::string links = chain.str();
+
+    PersistEngine lazy((const uint8_t *)links.data(), links.size());
+    assert(lazy.objects() == 10);
+    PersistObject *obj = NULL;
+    std::string end;
+    lazy >> obj >> end;
+    testNode *root = static_cast<testNode *>(obj);
+    assert(root != NULL && root->value == 0);
+    assert(eq(end.c_str(), "end"));
+    assert(!root->child.is_loaded());
+    assert(root->child->value == 1);
+    assert(root->child.is_loaded());
+    testNode *seven = static_cast<testNode *>(lazy.load(7));
+    assert(seven->value == 7);
+    assert(!seven->child.is_loaded());
+    assert(seven->child->child->value == 9);
+    assert(!seven->child->child->child);
+    assert(lazy.load(7) == seven);
+    assert(root->child->child.is_loaded() == false);
+
+    // random access from a stream before reading anything else
+    chain.seekg(0);
+    PersistEngine random(chain, PersistEngine::modeRead, true);
+    testNode *five = static_cast<testNode *>(random.load(5));
+    assert(five->value == 5 && five->child->value == 6);
+    obj = NULL;
+    random >> obj >> end;
+    testNode *head = static_cast<testNode *>(obj);
+    assert(head->value == 0 && eq(end.c_str(), "end"));
+
+    // a child loaded before its parent is skipped where the parent holds it
+    PersistEngine childfirst((const uint8_t *)index.data(), index.size());
+    testObject *peer = static_cast<testObject *>(childfirst.load(1));
+    assert(peer != NULL && peer->value == 7 && peer->peer != NULL);
+    obj = NULL;
+    childfirst >> obj >> end;
+    assert(obj == peer->peer && static_cast<testObject *>(obj)->peer == peer);
+    assert(eq(end.c_str(), "done"));
+    delete peer;
+    delete obj;
+
+    PersistEngine reference((const uint8_t *)index.data(), index.size());
+    peer = static_cast<testObject *>(reference.load(1));
+    testObject loaded;
+    reference.read(loaded);
+    reference >> end;
+    assert(eq(end.c_str(), "done"));
+    delete peer->peer;
+    delete peer;
+
+    FILE *fp = fopen("persist.dat", "wb");
+    assert(fp != NULL);
+    fwrite(archive.data(), 1, archive.size(), fp);
+    fclose(fp);
+
+    PersistEngine *mapped = new PersistEngine("persist.dat");
+    check(*mapped);
+    delete mapped;
+    remove("persist.dat");
+
+    // a truncated archive is an error rather than garbage
+    bool failed = false;
+    PersistEngine truncated((const uint8_t *)archive.data(), 100);
+    try {
+        testObject *obj = NULL;
+        truncated >> obj;
+    }
+    catch(PersistException& ex) {
+        failed = true;
+    }
+    assert(failed);
+
+    // a corrupt count is found before the vector is sized
+    std::stringstream huge(std::ios::in | std::ios::out | std::ios::binary);
+    {
+        PersistEngine ar(huge, PersistEngine::modeWrite);
+        ar << (uint32_t)0xffffffff << (int64_t)1;
+    }
+    std::string counted = huge.str();
+    std::vector<int64_t> values;
+    for(unsigned pass = 0; pass < 2; ++pass) {
+        failed = false;
+        huge.seekg(0);
+        try {
+            if(pass) {
+                PersistEngine ar(huge, PersistEngine::modeRead);
+                ar >> values;
+            }
+            else {
+                PersistEngine ar((const uint8_t *)counted.data(), counted.size());
+                ar >> values;
+            }
+        }
+        catch(PersistException& ex) {
+            failed = true;
+        }
+        assert(failed && values.capacity() < 1000);
+    }
+
+    // compressed bitmaps keep every chunk type through an archive
+    sparse_bitmap ids, copy;
+    ids.set(100000000, 65536 * 3, true);
+    ids.set(100000000 + 5, 70000, false);
+    for(uint32_t pos = 0; pos < 1000; ++pos)
+        ids.set(pos * 7, true);
+    ids.optimize();
+    std::stringstream bits(std::ios::in | std::ios::out | std::ios::binary);
+    {
+        PersistEngine ar(bits, PersistEngine::modeWrite);
+        ar << ids;
+    }
+    copy.set(3, true);
+    std::string saved = bits.str();
+    PersistEngine restore((const uint8_t *)saved.data(), saved.size());
+    restore >> copy;
+    assert(copy.count() == ids.count() && !copy.get(3) && copy.get(6993));
+    copy -= ids;
+    assert(copy.count() == 0);
+
+    std::string damaged = saved;
+    damaged[6] = 9;
+    failed = false;
+    PersistEngine corrupt((const uint8_t *)damaged.data(), damaged.size());
+    try {
+        corrupt >> copy;
+    }
+    catch(PersistException& ex) {
+        failed = true;
+    }
+    assert(failed);
+
+    // a chunk refused for its content is not left in the bitmap
+    damaged = saved;
+    damaged[18] = damaged[19] = 0;
+    failed = false;
+    PersistEngine unordered((const uint8_t *)damaged.data(), damaged.size());
+    try {
+        unordered >> copy;
+    }
+    catch(PersistException& ex) {
+        failed = true;
+    }
+    assert(failed && copy.count() == 0 && !copy.get(0));
+    copy.set(0, 70000, true);
+    copy -= ids;
+    assert(copy.count() == 70000 - 1000 && !copy.get(7) && copy.get(8));
+
+    return 0;
+}
+
+#else
+
+int main(int argc, char **argv)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,112 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DEBUG
+#define DEBUG
+#endif
+
+#ifndef UCOMMON_SYSRUNTIME
+#include <ucommon/ucommon.h>
+#include <commoncpp/slog.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <wchar.h>
+
+using namespace ost;
+
+#define EVENTS  17
+
+static char expect[EVENTS][256];
+static unsigned events = 0;
+
+// each event is traced in binary and formatted here for comparison
+#define EVENT(...) do { \
+    slog.trace(Slog::levelInfo, __VA_ARGS__); \
+    snprintf(expect[events++], sizeof(expect[0]), __VA_ARGS__); \
+} while(0)
+
+extern "C" int main(int argc, char **argv)
+{
+    const char *slogdump = "../utils/slogdump";
+    char cmd[512], line[512];
+    unsigned count = 0;
+    int value = 42;
+
+    if(argc > 1)
+        slogdump = argv[1];
+
+    slog.open("test", Slog::classUser);
+    slog.clogEnable(false);
+    slog.level(Slog::levelDebug);
+
+    remove("slog.trc");
+    assert(slog.traceOpen("slog.trc", 1048576, 4096));
+
+    EVENT("plain text");
+    EVENT("int %d unsigned %u hex %x octal %o", -17, 17u, 0xbeefu, 8u);
+    EVENT("width %5d|%-5d|%05d|%+d", 12, 34, 56, 78);
+    EVENT("long %ld %lu long long %lld %llx", -1234567890L, 1234567890UL, -123456789012345LL, 0x123456789abcULL);
+    EVENT("size %zu ptrdiff %td intmax %jd", (size_t)65536, (ptrdiff_t)-12, (intmax_t)1 << 40);
+    EVENT("short %hd char %hhu", (short)-300, (unsigned char)200);
+    EVENT("char %c%c%c", 'a', 'b', 'c');
+    EVENT("float %f %.3f %e %g %10.2f", 3.5, 1.0 / 3.0, 12345.678, 0.0001, -2.25);
+    EVENT("long double %Lf", (long double)2.5);
+    EVENT("string %s and %-8s| %.3s", "hello", "pad", "truncated");
+    EVENT("star %*d and %.*f", 6, 99, 2, 3.14159);
+    EVENT("pointer %p", (void *)&value);
+    EVENT("percent %% done");
+    EVENT("empty string '%s'", "");
+    EVENT("mixed %s=%d (%.1f%%) from %s", "load", 7, 12.5, "host");
+    EVENT("%u", 4000000000u);
+    EVENT("wide %ls %S %lc%C then %d", L"text", L"more", (wint_t)L'x', (wint_t)L'y', 5);
+
+    slog.traceClose();
+    slog.close();
+
+    snprintf(cmd, sizeof(cmd), "%s slog.trc", slogdump);
+    FILE *fp = popen(cmd, "r");
+    assert(fp != NULL);
+    while(fgets(line, sizeof(line), fp)) {
+        // skip the time, level and thread prefix of each event
+        char *text = strstr(line, "] ");
+        assert(text != NULL);
+        text = strstr(text, ": ");
+        assert(text != NULL);
+        text += 2;
+        size_t len = strlen(text);
+        assert(len && text[len - 1] == '\n');
+        text[len - 1] = 0;
+        assert(count < events);
+        assert(!strcmp(text, expect[count]));
+        ++count;
+    }
+    assert(pclose(fp) == 0);
+    remove("slog.trc");
+
+    assert(count == events);
+    return 0;
+}
+
+#else
+
+int main()
+{
+    return 0;
+}
+
+#endif
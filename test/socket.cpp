@@ -34,6 +34,19 @@ static Socket::address testing6("44:022:66::1", 4444);
 static Socket::address localhost6("::1", 4444);
 #endif
 
+static size_t framed(const char *data, size_t size, void *)
+{
+    if(size < 2 || (size_t)(data[0] - '0' + 2) > size)
+        return 0;
+
+    return (size_t)(data[0] - '0' + 2);
+}
+
+static size_t oversized(const char *, size_t size, void *)
+{
+    return size ? 65536 : 0;
+}
+
 extern "C" int main()
 {
     struct sockaddr_internet addr;
@@ -94,5 +107,82 @@ extern "C" int main()
         assert(0 == strcmp(addrbuf, "44:22:66::1"));
     }
 #endif
+
+    // lines read from a tcp buffer, and peeked from a plain socket
+    TCPServer lines("127.0.0.1", "4445");
+    TCPBuffer *client = new TCPBuffer("127.0.0.1", "4445");
+    assert(lines.wait(1000));
+    TCPBuffer session(&lines);
+    client->putline("first");
+    client->put("second\n", 7);
+    for(unsigned pos = 0; pos < 1000; ++pos)
+        client->put("x", 1);
+    client->put("\nlast", 5);
+    client->flush();
+    delete client;
+
+    char text[64];
+    size_t size;
+    const char *line;
+    assert(session.getline(text, sizeof(text)) == 6);
+    assert(eq(text, "first"));
+    line = session.nextline(size);
+    assert(size == 6 && !strncmp(line, "second", 6));
+    line = session.nextline(size);
+    assert(size == 536 && line[0] == 'x' && line[535] == 'x');
+    line = session.nextline(size);
+    assert(size == 464 && line[463] == 'x');
+    line = session.nextline(size);
+    assert(size == 4 && !strncmp(line, "last", 4));
+    assert(session.nextline(size) == NULL);
+
+    client = new TCPBuffer("127.0.0.1", "4445");
+    assert(lines.wait(1000));
+    socket_t peer = lines.accept();
+    client->put("one\r\ntwo\n", 9);
+    client->flush();
+    assert(Socket::readline(peer, text, sizeof(text)) == 4);
+    assert(eq(text, "one"));
+    assert(Socket::readline(peer, text, sizeof(text)) == 4);
+    assert(eq(text, "two"));
+    delete client;
+    Socket::release(peer);
+
+    // pipelined requests framed by length, and replies framed by line
+    client = new TCPBuffer("127.0.0.1", "4445");
+    assert(lines.wait(1000));
+    TCPBuffer server(&lines);
+    client->put("3:abc5:hello1:x", 15);
+    client->flush();
+    for(unsigned pos = 0; pos < 3; ++pos) {
+        line = server.nextreply(size, &framed);
+        assert(line != NULL && size == (size_t)(line[0] - '0' + 2));
+        server.put(line + 2, size - 2);
+        server.put("\r\n", 2);
+    }
+    server.flush();
+    line = client->nextreply(size, &BufferProtocol::lineframe);
+    assert(size == 5 && !strncmp(line, "abc\r\n", 5));
+    line = client->nextreply(size, &BufferProtocol::lineframe);
+    assert(size == 7 && !strncmp(line, "hello\r\n", 7));
+    line = client->nextreply(size, &BufferProtocol::lineframe);
+    assert(size == 3 && !strncmp(line, "x\r\n", 3));
+    delete client;
+    assert(server.nextreply(size, &framed) == NULL);
+
+    // replies that can never fit in the buffer fail rather than stall
+    char reply[100];
+    memset(reply, 'x', sizeof(reply));
+    for(unsigned pos = 0; pos < 2; ++pos) {
+        client = new TCPBuffer("127.0.0.1", "4445", 64);
+        assert(lines.wait(1000));
+        TCPBuffer large(&lines);
+        large.put(reply, sizeof(reply));
+        large.put("\n", 1);
+        large.flush();
+        assert(client->nextreply(size, pos ? &oversized : &BufferProtocol::lineframe) == NULL);
+        assert(client->BufferProtocol::err() == EMSGSIZE);
+        delete client;
+    }
     return 0;
 }
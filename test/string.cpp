@@ -96,6 +96,27 @@ extern "C" int main()
     string_t hex = String::hex(hbuf, 2);
     assert(eq(hex, "23a9"));
 
+    uint8_t check[] = "123456789";
+    assert(String::crc16(check, 9) == 0x4b37);
+    assert(String::crc24(check, 9) == 0x21cf02);
+    assert(String::crc32c(check, 9) == 0xe3069283);
+    assert(String::crc32c(check + 4, 5, String::crc32c(check, 4)) == 0xe3069283);
+
+    uint8_t bin[100], bout[100];
+    char b64buf[140];
+    for(unsigned pos = 0; pos < sizeof(bin); ++pos)
+        bin[pos] = (uint8_t)(pos * 7 + 3);
+    assert(String::b64encode(b64buf, bin, sizeof(bin)) == sizeof(bin));
+    assert(eq(b64buf, String::b64(bin, sizeof(bin))));
+    assert(String::b64decode(bout, b64buf, sizeof(bout)) == sizeof(bin));
+    assert(!memcmp(bin, bout, sizeof(bin)));
+    assert(String::b64decode(bout, "aGVsbG8gd29ybGQgYW5kIG1vcmU=", sizeof(bout)) == 20);
+    assert(!memcmp(bout, "hello world and more", 20));
+    assert(String::b64decode(bout, "aGVsbG8gd29ybG!gYW5kIG1vcmU=", sizeof(bout)) == 9);
+
+    hex = String::hex(bin, 20);
+    assert(eq(hex, "030a11181f262d343b424950575e656c737a8188"));
+
     delete[] test;
     delete[] cdup;
 
@@ -58,6 +58,31 @@ extern "C" int main()
     evt.wait(2000);
     time(&later);
     assert(later >= now + 1);
+
+    // each clock source expires timers, falling back where missing
+    for(unsigned source = Timer::PRECISE; source <= Timer::CYCLES; ++source) {
+        Timer::clocking((Timer::clocking_t)source);
+        Timer timer((timeout_t)100);
+        assert(timer.get() > 50);
+        Thread::sleep(150);
+        assert(timer.get() == 0);
+    }
+
+    // the cached clock only moves when refreshed
+    assert(Timer::clocking(Timer::CACHED) == Timer::CACHED);
+    Timer cached((timeout_t)50);
+    Thread::sleep(100);
+    assert(cached.get() > 0);
+    Timer::refresh();
+    assert(cached.get() == 0);
+    Timer::clocking(Timer::PRECISE);
+
+    Conditional::clocking(Timer::COARSE);
+    time(&now);
+    evt.wait(1500);
+    time(&later);
+    assert(later >= now + 1);
+    Conditional::clocking(Timer::PRECISE);
     return 0;
 }
 
@@ -0,0 +1,137 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DEBUG
+#define DEBUG
+#endif
+
+#ifndef UCOMMON_SYSRUNTIME
+#include <ucommon/ucommon.h>
+#include <commoncpp/thread.h>
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace ost;
+
+#define RECORD  16
+
+static volatile bool released = false;
+
+class testQueue : public ThreadQueue
+{
+public:
+    volatile unsigned long count;
+
+    testQueue() : ThreadQueue(NULL, 0, 0) {
+        count = 0;
+    }
+
+    testQueue(size_t size, Overflow mode) : ThreadQueue(NULL, 0, 0, size, mode) {
+        count = 0;
+    }
+
+    ~testQueue() {
+        stop();
+    }
+
+    void runQueue(void *) {
+        ++count;
+    }
+
+    void runBatch(void **list, unsigned total) {
+        // hold the ring full until the poster gives up
+        while(!released)
+            Thread::sleep(1);
+        ThreadQueue::runBatch(list, total);
+    }
+};
+
+static testQueue *queue;
+
+class testPoster : public Thread
+{
+public:
+    volatile unsigned long posted;
+
+    testPoster() : Thread() {
+        posted = 0;
+    }
+
+    void run(void) {
+        char record[RECORD];
+        memset(record, 'x', sizeof(record));
+        while(queue->post(record, sizeof(record)))
+            ++posted;
+        released = true;
+    }
+};
+
+class testStop : public Thread
+{
+public:
+    testStop() : Thread() {}
+
+    void run(void) {
+        queue->stop();
+    }
+};
+
+extern "C" int main()
+{
+    char record[RECORD];
+    memset(record, 'x', sizeof(record));
+
+    // a poster blocked on a full ring is released when the queue stops
+    queue = new testQueue(64, ThreadQueue::queueBlock);
+    testPoster *poster = new testPoster();
+    poster->start();
+    while(poster->posted < 2)
+        Thread::sleep(1);
+    Thread::sleep(50);
+    assert(!released);
+
+    testStop *stopper = new testStop();
+    stopper->start();
+    poster->join();
+    stopper->join();
+    assert(released);
+    assert(queue->count == poster->posted);
+    assert(!queue->post(record, sizeof(record)));
+    delete stopper;
+    delete poster;
+    delete queue;
+
+    // a queue without a ring runs what was posted and then refuses data
+    queue = new testQueue();
+    for(unsigned pos = 0; pos < 10; ++pos)
+        assert(queue->post(record, sizeof(record)));
+    queue->stop();
+    assert(queue->count == 10);
+    assert(!queue->post(record, sizeof(record)));
+    delete queue;
+    return 0;
+}
+
+#else
+
+int main()
+{
+    return 0;
+}
+
+#endif
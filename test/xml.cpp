@@ -0,0 +1,268 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DEBUG
+#define DEBUG
+#endif
+
+#include <ucommon/ucommon.h>
+
+#include <stdio.h>
+
+using namespace ucommon;
+
+static const char *doc =
+    "<?xml version=\"1.0\"?>\n"
+    "<!-- leading -- comment -->\n"
+    "<root id=\"1\" name='top'>\n"
+    "  <item>first &amp; second &lt;3&gt;</item>\n"
+    "  <empty/>\n"
+    "  <data><![CDATA[raw <text> ]] here]]></data>\n"
+    "</root>\n";
+
+static const char *events =
+    "{root id=1 name=top}[\n  ]{item}[first & second <3>]/item[\n  ]"
+    "{empty}/empty[\n  ]{data}[raw <text> ]] here]/data[\n]/root";
+
+class testBuffer : public BufferProtocol
+{
+private:
+    const char *text;
+    size_t pos, len;
+
+public:
+    testBuffer(const char *data) : BufferProtocol() {
+        text = data;
+        pos = 0;
+        len = strlen(data);
+        allocate(16, RDONLY);
+    }
+
+    ~testBuffer() {
+        release();
+    }
+
+    size_t _push(const char *, size_t) {
+        return 0;
+    }
+
+    size_t _pull(char *address, size_t size) {
+        if(size > len - pos)
+            size = len - pos;
+        memcpy(address, text + pos, size);
+        pos += size;
+        return size;
+    }
+
+    bool _blocking(void) {
+        return true;
+    }
+
+    int _err(void) const {
+        return 0;
+    }
+
+    void _clear(void) {
+    }
+};
+
+class testParser : public XMLParser
+{
+public:
+    char log[512];
+    unsigned comments;
+
+    testParser() : XMLParser(64) {
+        clear();
+    }
+
+    void clear(void) {
+        log[0] = 0;
+        comments = 0;
+    }
+
+    void append(const char *text, size_t size) {
+        size_t len = strlen(log);
+        memcpy(log + len, text, size);
+        log[len + size] = 0;
+    }
+
+    void startElement(caddr_t name, caddr_t *attr) {
+        append("{", 1);
+        append(name, strlen(name));
+        while(attr && *attr) {
+            append(" ", 1);
+            append(attr[0], strlen(attr[0]));
+            append("=", 1);
+            append(attr[1], strlen(attr[1]));
+            attr += 2;
+        }
+        append("}", 1);
+    }
+
+    void endElement(caddr_t name) {
+        append("/", 1);
+        append(name, strlen(name));
+    }
+
+    void comment(caddr_t, size_t) {
+        ++comments;
+    }
+
+    // adjacent runs of text are joined so splits do not change the log
+    void characters(caddr_t text, size_t size) {
+        size_t len = strlen(log);
+        if(len && log[len - 1] == ']')
+            log[--len] = 0;
+        else
+            append("[", 1);
+        append(text, size);
+        append("]", 1);
+    }
+
+    bool feed(const char *data, size_t size, size_t chunk) {
+        while(size) {
+            size_t count = (size < chunk) ? size : chunk;
+            if(!partial(data, count))
+                return false;
+            data += count;
+            size -= count;
+        }
+        return end();
+    }
+
+    bool file(FILE *fp) {
+        return parse(fp);
+    }
+
+    bool stream(CharacterProtocol& io) {
+        return parse(io);
+    }
+
+    bool stream(BufferProtocol& io) {
+        return parse(io);
+    }
+
+    bool path(const char *filename) {
+        return load(filename);
+    }
+};
+
+extern "C" int main()
+{
+    testParser parser;
+    size_t len = strlen(doc);
+
+    for(size_t chunk = 1; chunk <= len; chunk += (chunk < 8) ? 1 : 17) {
+        parser.clear();
+        assert(parser.feed(doc, len, chunk));
+        assert(eq(parser.log, events));
+        assert(parser.comments == 1);
+    }
+
+    FILE *fp = fopen("xmltest.xml", "w");
+    assert(fp != NULL);
+    fputs(doc, fp);
+    fputs(doc, fp);
+    fclose(fp);
+
+    // two documents in one file are parsed one after the other
+    fp = fopen("xmltest.xml", "r");
+    parser.clear();
+    assert(parser.file(fp));
+    assert(eq(parser.log, events));
+    parser.clear();
+    assert(parser.file(fp));
+    assert(eq(parser.log, events));
+    assert(!parser.file(fp));
+    fclose(fp);
+
+    char twice[1024];
+    snprintf(twice, sizeof(twice), "%s%s", doc, doc);
+
+    charmem chars(twice, strlen(twice));
+    parser.clear();
+    assert(parser.stream((CharacterProtocol&)chars));
+    assert(eq(parser.log, events));
+    parser.clear();
+    assert(parser.stream((CharacterProtocol&)chars));
+    assert(eq(parser.log, events));
+
+    testBuffer buffer(twice);
+    parser.clear();
+    assert(parser.stream(buffer));
+    assert(eq(parser.log, events));
+    parser.clear();
+    assert(parser.stream(buffer));
+    assert(eq(parser.log, events));
+    assert(!parser.stream(buffer));
+
+    parser.clear();
+    assert(parser.path("xmltest.xml"));
+    assert(eq(parser.log, events));
+
+    parser.clear();
+    assert(!parser.feed("<root>&bogus;</root>", 20, 20));
+
+    // pull parsing from memory, skipping the item subtree
+    XMLReader reader;
+    reader.open(doc, len);
+    assert(reader.next() == XMLReader::START);
+    assert(eq(reader.name(), "root"));
+    assert(eq(reader.attribute("name"), "top"));
+    assert(reader.attribute("none") == NULL);
+    assert(reader.next() == XMLReader::TEXT);
+    assert(reader.next() == XMLReader::START);
+    assert(eq(reader.name(), "item"));
+    assert(reader.skip());
+    assert(reader.depth() == 1);
+    assert(reader.next() == XMLReader::TEXT);
+    assert(reader.next() == XMLReader::START);
+    assert(eq(reader.name(), "empty"));
+    assert(reader.next() == XMLReader::END);
+    assert(eq(reader.name(), "empty"));
+    assert(reader.next() == XMLReader::TEXT);
+    assert(reader.next() == XMLReader::START);
+    assert(reader.next() == XMLReader::TEXT);
+    assert(!strncmp(reader.text(), "raw <text> ]] here", reader.size()));
+    assert(reader.skip());
+    assert(reader.next() == XMLReader::END);
+    assert(eq(reader.name(), "data"));
+    assert(reader.next() == XMLReader::TEXT);
+    assert(reader.next() == XMLReader::END);
+    assert(eq(reader.name(), "root"));
+    assert(reader.next() == XMLReader::DONE);
+
+    // a tiny input block splits every token across reads
+    fp = fopen("xmltest.xml", "r");
+    XMLReader small(7, 64);
+    small.open(fp);
+    unsigned starts = 0;
+    while(small.next() == XMLReader::START || *small != XMLReader::DONE) {
+        assert(*small != XMLReader::FAILED);
+        if(*small == XMLReader::START && eq(small.name(), "root"))
+            assert(eq(small.attribute("id"), "1"));
+        if(*small == XMLReader::START && ++starts == 2)
+            assert(small.skip());
+    }
+    assert(starts == 4);
+    small.close();
+    fclose(fp);
+    remove("xmltest.xml");
+
+    return 0;
+}
@@ -25,6 +25,10 @@
 #cmakedefine HAVE_STDLIB_H 1
 #cmakedefine HAVE_SYS_FILIO_H 1
 #cmakedefine HAVE_SYS_MMAN_H 1
+#cmakedefine HAVE_SYS_SENDFILE_H 1
+#cmakedefine HAVE_LINUX_IO_URING_H 1
+#cmakedefine HAVE_LINUX_FUTEX_H 1
+#cmakedefine HAVE_LINUX_MEMPOLICY_H 1
 #cmakedefine HAVE_SYS_POLL_H 1
 #cmakedefine HAVE_SYS_RESOURCE_H 1
 #cmakedefine HAVE_SYS_SHM_H 1
@@ -65,6 +69,7 @@
 #cmakedefine HAVE_PTHREAD_CONDATTR_SETCLOCK 1
 #cmakedefine HAVE_PTHREAD_DELAY 1
 #cmakedefine HAVE_PTHREAD_DELAY_NP 1
+#cmakedefine HAVE_PTHREAD_MUTEXATTR_SETROBUST 1
 #cmakedefine HAVE_PTHREAD_SETCONCURRENCY 1
 #cmakedefine HAVE_PTHREAD_SETSCHEDPRIO 1
 #cmakedefine HAVE_PTHREAD_YIELD 1
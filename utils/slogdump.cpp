@@ -0,0 +1,394 @@
+// Copyright (C) 2015 Cherokees of Idaho.
+//
+// This file is part of GNU uCommon C++.
+//
+// GNU uCommon C++ is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// GNU uCommon C++ is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with GNU uCommon C++.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ucommon/ucommon.h>
+#include <commoncpp/slog.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <time.h>
+
+using namespace ucommon;
+
+#define MAX_FORMATS 4096    // formats a trace may intern
+
+typedef ost::Slog::trace_header_t header_t;
+typedef ost::Slog::trace_record_t record_t;
+
+static shell::flagopt helpflag('h',"--help",    _TEXT("display this list"));
+static shell::flagopt althelp('?', NULL, NULL);
+static shell::flagopt unsorted('u', "--unsorted", _TEXT("events in file rather than time order"));
+
+typedef struct {
+    uint64_t time;
+    size_t offset;
+} event_t;
+
+static const char *levels[] = {
+    "unknown", "emerg", "alert", "crit", "error", "warn", "notice", "info", "debug"};
+
+static int compare(const void *a, const void *b)
+{
+    const event_t *e1 = (const event_t *)a;
+    const event_t *e2 = (const event_t *)b;
+
+    if(e1->time != e2->time)
+        return e1->time < e2->time ? -1 : 1;
+    if(e1->offset != e2->offset)
+        return e1->offset < e2->offset ? -1 : 1;
+    return 0;
+}
+
+template<typename T>
+static T value(const char *& data, const char *end)
+{
+    T result = 0;
+    if(data + sizeof(T) <= end)
+        memcpy(&result, data, sizeof(T));
+    data += sizeof(T);
+    return result;
+}
+
+// widths and precisions are clamped to what is kept of a field, so a
+// corrupt trace cannot ask for gigabytes of padding
+static size_t field(char *spec, long value)
+{
+    if(value > 255)
+        value = 255;
+    if(value < -255)
+        value = -255;
+    return snprintf(spec, 16, "%ld", value);
+}
+
+static size_t digits(char *spec, const char *& format)
+{
+    long value = 0;
+    while(isdigit(*format)) {
+        if(value < 256)
+            value = value * 10 + (*format - '0');
+        ++format;
+    }
+    return field(spec, value);
+}
+
+// render an event by walking its format as the encoder did
+static void render(String& out, const char *format, const char *data, const char *end)
+{
+    char spec[64], text[256];
+    size_t len;
+
+    while(*format) {
+        if(*format != '%') {
+            out.add(*(format++));
+            continue;
+        }
+        if(format[1] == '%') {
+            out.add('%');
+            format += 2;
+            continue;
+        }
+
+        len = 0;
+        spec[len++] = *(format++);
+        while(*format && strchr("-+ #0'", *format) && len < 32)
+            spec[len++] = *(format++);
+        if(*format == '*') {
+            len += field(spec + len, value<int>(data, end));
+            ++format;
+        }
+        else if(isdigit(*format))
+            len += digits(spec + len, format);
+        if(*format == '.') {
+            spec[len++] = *(format++);
+            if(*format == '*') {
+                len += field(spec + len, value<int>(data, end));
+                ++format;
+            }
+            else if(isdigit(*format))
+                len += digits(spec + len, format);
+        }
+
+        char size = 'i';
+        int shorts = 0;
+        switch(*format) {
+        case 'h':
+            while(*format == 'h' && shorts < 2) {
+                ++shorts;
+                ++format;
+            }
+            break;
+        case 'l':
+            size = 'l';
+            if(*(++format) == 'l') {
+                size = 'q';
+                ++format;
+            }
+            break;
+        case 'q':
+        case 'L':
+            size = 'q';
+            ++format;
+            break;
+        case 'j':
+        case 'z':
+        case 't':
+            size = *(format++);
+            break;
+        }
+
+        char type = *format;
+        if(!type)
+            break;
+        ++format;
+        text[0] = 0;
+
+        switch(type) {
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            switch(size) {
+            case 'l':
+                snprintf(spec + len, 8, "l%c", type);
+                snprintf(text, sizeof(text), spec, value<long>(data, end));
+                break;
+            case 'q':
+                snprintf(spec + len, 8, "ll%c", type);
+                snprintf(text, sizeof(text), spec, value<long long>(data, end));
+                break;
+            case 'j':
+                snprintf(spec + len, 8, "j%c", type);
+                snprintf(text, sizeof(text), spec, value<intmax_t>(data, end));
+                break;
+            case 'z':
+                snprintf(spec + len, 8, "z%c", type);
+                snprintf(text, sizeof(text), spec, value<size_t>(data, end));
+                break;
+            case 't':
+                snprintf(spec + len, 8, "t%c", type);
+                snprintf(text, sizeof(text), spec, value<ptrdiff_t>(data, end));
+                break;
+            default:
+                snprintf(spec + len, 8, "%.*s%c", shorts, "hh", type);
+                snprintf(text, sizeof(text), spec, value<int>(data, end));
+            }
+            break;
+        case 'c':
+        case 'C':
+            if(size == 'l' || type == 'C')
+                snprintf(spec + len, 8, "lc");
+            else
+                snprintf(spec + len, 8, "c");
+            snprintf(text, sizeof(text), spec, value<int>(data, end));
+            break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            if(size == 'q') {
+                snprintf(spec + len, 8, "L%c", type);
+                snprintf(text, sizeof(text), spec, value<long double>(data, end));
+            }
+            else {
+                snprintf(spec + len, 8, "%c", type);
+                snprintf(text, sizeof(text), spec, value<double>(data, end));
+            }
+            break;
+        case 's':
+        case 'S':
+            // wide strings were recorded as multibyte text
+            {
+                uint16_t count = value<uint16_t>(data, end);
+                if(data + count > end)
+                    count = 0;
+                char *str = new char[count + 1];
+                memcpy(str, data, count);
+                str[count] = 0;
+                data += count;
+                snprintf(spec + len, 8, "s");
+                size_t need = count + 64;
+                char *buf = new char[need];
+                snprintf(buf, need, spec, str);
+                out.add(buf);
+                delete[] buf;
+                delete[] str;
+            }
+            break;
+        case 'p':
+            snprintf(spec + len, 8, "p");
+            snprintf(text, sizeof(text), spec, value<void *>(data, end));
+            break;
+        case 'n':
+            value<void *>(data, end);
+            break;
+        default:
+            spec[len] = type;
+            spec[len + 1] = 0;
+            out.add(spec);
+        }
+        if(text[0])
+            out.add(text);
+    }
+}
+
+static void dump(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if(!fp)
+        shell::errexit(2, "*** slogdump: %s: %s\n", path, _TEXT("cannot open"));
+
+    fseek(fp, 0, SEEK_END);
+    long fsize = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if(fsize < (long)sizeof(header_t)) {
+        fclose(fp);
+        shell::errexit(3, "*** slogdump: %s: %s\n", path, _TEXT("not a trace file"));
+    }
+
+    char *map = new char[fsize];
+    size_t got = fread(map, 1, fsize, fp);
+    fclose(fp);
+
+    header_t *header = (header_t *)map;
+    if(got != (size_t)fsize || memcmp(header->magic, "slogtrc", 8) || header->version != 1)
+        shell::errexit(3, "*** slogdump: %s: %s\n", path, _TEXT("not a trace file"));
+
+    if(header->sizes[0] != sizeof(long) || header->sizes[1] != sizeof(long double) ||
+      header->sizes[2] != sizeof(void *) || header->sizes[3] != sizeof(intmax_t))
+        shell::errexit(4, "*** slogdump: %s: %s\n", path, _TEXT("written on a different host type"));
+
+    size_t used = (size_t)header->used;
+    size_t chunk = header->chunk;
+    if(used > (size_t)fsize)
+        used = (size_t)fsize;
+    if(chunk < sizeof(record_t))
+        shell::errexit(3, "*** slogdump: %s: %s\n", path, _TEXT("not a trace file"));
+
+    // formats first, since any thread may use a format another saved
+    uint32_t formats = 0;
+    size_t events = 0;
+    size_t base = (sizeof(header_t) + 63) & ~63;
+    for(size_t offset = base; offset + chunk <= used; offset += chunk) {
+        size_t pos = offset;
+        while(pos + sizeof(record_t) <= offset + chunk) {
+            record_t *rec = (record_t *)(map + pos);
+            if(rec->size < sizeof(record_t) || rec->size > offset + chunk - pos)
+                break;
+            if(rec->type == ost::Slog::traceFormat && rec->id > formats && rec->id <= MAX_FORMATS)
+                formats = rec->id;
+            else if(rec->type == ost::Slog::traceEvent)
+                ++events;
+            pos += rec->size;
+        }
+    }
+
+    const char **format = new const char *[formats + 1];
+    event_t *list = new event_t[events + 1];
+    memset(format, 0, sizeof(const char *) * (formats + 1));
+    events = 0;
+
+    for(size_t offset = base; offset + chunk <= used; offset += chunk) {
+        size_t pos = offset;
+        while(pos + sizeof(record_t) <= offset + chunk) {
+            record_t *rec = (record_t *)(map + pos);
+            if(rec->size < sizeof(record_t) || rec->size > offset + chunk - pos)
+                break;
+            if(rec->type == ost::Slog::traceFormat && rec->id <= formats && rec->size > sizeof(record_t)) {
+                map[pos + rec->size - 1] = 0;
+                format[rec->id] = map + pos + sizeof(record_t);
+            }
+            else if(rec->type == ost::Slog::traceEvent) {
+                list[events].time = rec->time;
+                list[events++].offset = pos;
+            }
+            pos += rec->size;
+        }
+    }
+
+    if(!is(unsorted))
+        qsort(list, events, sizeof(event_t), &compare);
+
+    String out((strsize_t)8192);
+    struct tm epoch;
+    for(size_t pos = 0; pos < events; ++pos) {
+        record_t *rec = (record_t *)(map + list[pos].offset);
+        uint64_t nsec = header->nanoseconds + rec->time;
+        time_t now = (time_t)(header->seconds + nsec / 1000000000ul);
+        struct tm *dt = localtime(&now);
+        if(!dt) {
+            // a corrupt start time cannot be shown as a date
+            memset(&epoch, 0, sizeof(epoch));
+            epoch.tm_year = 70;
+            epoch.tm_mday = 1;
+            dt = &epoch;
+        }
+        const char *level = levels[rec->level < 9 ? rec->level : 0];
+        char prefix[80];
+
+        snprintf(prefix, sizeof(prefix), "%04d-%02d-%02d %02d:%02d:%02d.%06ld [%s] %u: ",
+            dt->tm_year + 1900, dt->tm_mon + 1, dt->tm_mday,
+            dt->tm_hour, dt->tm_min, dt->tm_sec,
+            (long)((nsec % 1000000000ul) / 1000), level, rec->thread);
+
+        out = prefix;
+        if(rec->id <= formats && format[rec->id])
+            render(out, format[rec->id], (const char *)(rec + 1), (const char *)rec + rec->size);
+        else
+            out.add("?");
+        if(!out.len() || out[out.len() - 1] != '\n')
+            out.add("\n");
+        fputs(*out, stdout);
+    }
+
+    if(header->dropped)
+        fprintf(stderr, "slogdump: %s: %lu %s\n", path,
+            (unsigned long)header->dropped, _TEXT("events dropped"));
+
+    delete[] list;
+    delete[] format;
+    delete[] map;
+}
+
+int main(int argc, char **argv)
+{
+    shell::bind("slogdump");
+    shell args(argc, argv);
+    unsigned count = 0;
+
+    if(is(helpflag) || is(althelp)) {
+        printf("%s\n", _TEXT("Usage: slogdump [options] path..."));
+        printf("%s\n\n", _TEXT("Render binary slog trace files as text"));
+        printf("%s\n", _TEXT("Options:"));
+        shell::help();
+        printf("\n%s\n", _TEXT("Report bugs to dyfet@gnu.org"));
+        return 0;
+    }
+
+    if(!args())
+        shell::errexit(1, "*** slogdump: %s\n", _TEXT("no trace files specified"));
+
+    while(count < args())
+        dump(args[count++]);
+
+    return 0;
+}